@@ -0,0 +1,270 @@
+#include <glad/glad.h>
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <argparse/argparse.hpp>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <loo/loo.hpp>
+#include <map>
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <string>
+#include "core/Headless.hpp"
+#include "core/JobSystem.hpp"
+#include "core/Profiler.hpp"
+#include "core/RenderLoo.hpp"
+#include "core/Statistics.hpp"
+#include "core/TextureCompression.hpp"
+#include "core/TextureLoader.hpp"
+
+using json = nlohmann::json;
+
+namespace fs = std::filesystem;
+using namespace std;
+
+static json summaryToJSON(const SampleSummary& summary) {
+    return json{{"count", summary.count}, {"mean", summary.mean},
+                {"min", summary.min},     {"max", summary.max},
+                {"p50", summary.p50},     {"p95", summary.p95},
+                {"p99", summary.p99}};
+}
+
+static glm::vec3 parseVec3(const json& j, const string& key,
+                           glm::vec3 defaultVal) {
+    if (j.contains(key)) {
+        auto& v = j[key];
+        return glm::vec3(v[0], v[1], v[2]);
+    } else {
+        return defaultVal;
+    }
+}
+
+// same format as "cameraPath" in config.json, or a recorded path
+static CameraPath loadCameraPath(const fs::path& filename,
+                                 const CameraPose& start) {
+    ifstream file(filename);
+    json path = json::parse(file, nullptr, false);
+    if (path.is_discarded()) {
+        LOG(FATAL) << "Failed to parse camera path " << filename.string();
+    }
+    if (path.value("type", string("orbit")) == "spline") {
+        vector<CameraPose> keyframes;
+        for (auto& key : path["keyframes"])
+            keyframes.push_back(
+                CameraPose{parseVec3(key, "position", start.position),
+                           parseVec3(key, "lookat", start.target)});
+        return CameraPath::spline(std::move(keyframes));
+    }
+    return CameraPath::orbit(
+        CameraPose{parseVec3(path, "position", start.position),
+                   parseVec3(path, "lookat", start.target)},
+        path.value("degrees", 360.f));
+}
+
+// per pass GPU time of every measured frame, keyed by the scope path
+static map<string, vector<double>> collectPassTimings(
+    const vector<GPUFrameTimings>& frames) {
+    map<string, vector<double>> passes;
+    for (auto& frame : frames) {
+        map<string, double> frameTotal;
+        vector<string> stack;
+        for (auto& pass : frame.passes) {
+            stack.resize(pass.depth);
+            stack.push_back(pass.name);
+            string key;
+            for (auto& name : stack)
+                key += key.empty() ? name : "/" + name;
+            frameTotal[key] += pass.milliseconds;
+        }
+        for (auto& [key, ms] : frameTotal)
+            passes[key].push_back(ms);
+    }
+    return passes;
+}
+
+template <typename Function>
+static double measureMilliseconds(Function&& function) {
+    auto start = chrono::steady_clock::now();
+    function();
+    return chrono::duration<double, milli>(chrono::steady_clock::now() -
+                                           start)
+        .count();
+}
+
+// decode, mip generation and upload of every image in directory, the
+// throughput is in decoded(RGBA8, level 0) megabytes per second
+static json benchmarkTextureLoad(const fs::path& directory) {
+    vector<fs::path> paths;
+    for (auto& entry : fs::recursive_directory_iterator(directory)) {
+        string extension = entry.path().extension().string();
+        transform(extension.begin(), extension.end(), extension.begin(),
+                  ::tolower);
+        if (extension == ".png" || extension == ".jpg" ||
+            extension == ".jpeg" || extension == ".tga" || extension == ".bmp")
+            paths.push_back(entry.path());
+    }
+    vector<DecodedImage> images;
+    double serial = measureMilliseconds([&] {
+        for (auto& path : paths)
+            decodeImages({path});
+    });
+    double decode = measureMilliseconds([&] { images = decodeImages(paths); });
+    double megabytes = 0.0;
+    for (auto& image : images)
+        megabytes += image.pixels.size() / (1024.0 * 1024.0);
+    vector<MipChain> mips(images.size());
+    auto generate = [&](MipFilter filter) {
+        return measureMilliseconds([&] {
+            JobSystem::parallelFor(
+                static_cast<int>(images.size()), 1, [&](int first, int last) {
+                    for (int i = first; i < last; i++) {
+                        if (!images[i].pixels.empty())
+                            mips[i] = generateMipChain(
+                                images[i].pixels.data(), images[i].width,
+                                images[i].height, true, filter);
+                    }
+                });
+        });
+    };
+    double kaiser = generate(MipFilter::Kaiser);
+    double box = generate(MipFilter::Box);
+    vector<shared_ptr<loo::Texture2D>> textures;
+    double upload = measureMilliseconds([&] {
+        for (size_t i = 0; i < images.size(); i++) {
+            if (!images[i].pixels.empty())
+                textures.push_back(createTextureFromPixels(
+                    images[i].pixels.data(), images[i].width,
+                    images[i].height, GL_SRGB8_ALPHA8, mips[i]));
+        }
+        glFinish();
+    });
+    // what a scene cache hit does instead of decoding and mip generation
+    vector<optional<CompressedTexture>> compressed(images.size());
+    double compress = measureMilliseconds([&] {
+        JobSystem::parallelFor(
+            static_cast<int>(images.size()), 1, [&](int first, int last) {
+                for (int i = first; i < last; i++) {
+                    if (!images[i].pixels.empty())
+                        compressed[i] = CompressedTexture::compress(
+                            images[i].pixels.data(), images[i].width,
+                            images[i].height, mips[i], BlockFormat::BC7SRGB,
+                            0);
+                }
+            });
+    });
+    double compressedUpload = measureMilliseconds([&] {
+        for (auto& texture : compressed) {
+            if (texture)
+                textures.push_back(texture->createTexture(0));
+        }
+        glFinish();
+    });
+    auto stage = [&](double ms) {
+        return json{{"ms", ms},
+                    {"MBps", ms > 0.0 ? megabytes * 1000.0 / ms : 0.0}};
+    };
+    return json{{"images", images.size()},
+                {"megabytes", megabytes},
+                {"workers", JobSystem::getWorkerCount()},
+                {"decodeSerial", stage(serial)},
+                {"decode", stage(decode)},
+                {"mipsBox", stage(box)},
+                {"mipsKaiser", stage(kaiser)},
+                {"upload", stage(upload)},
+                {"compressBC7", stage(compress)},
+                {"uploadBC7", stage(compressedUpload)}};
+}
+
+int main(int argc, char* argv[]) {
+    loo::initialize(argv[0]);
+
+    argparse::ArgumentParser program("renderloo_bench");
+    program.add_argument("-m", "--model").help("Model file path").required();
+    program.add_argument("-b", "--skybox").help("HDRI file path");
+    program.add_argument("-s", "--size")
+        .help("Framebuffer size")
+        .nargs(2)
+        .default_value(vector<int>{1920, 1080})
+        .scan<'i', int>();
+    program.add_argument("-w", "--warmup")
+        .help("Warmup frames")
+        .default_value(60)
+        .scan<'i', int>();
+    program.add_argument("-n", "--frames")
+        .help("Measured frames")
+        .default_value(600)
+        .scan<'i', int>();
+    program.add_argument("-p", "--camera-path")
+        .help("Camera path json, orbit around the model if absent");
+    program.add_argument("-d", "--degrees")
+        .help("Orbit angle covered by the measured frames")
+        .default_value(360.f)
+        .scan<'g', float>();
+    program.add_argument("-o", "--output")
+        .help("Result json path, stdout if absent");
+    program.add_argument("-t", "--textures")
+        .help("Image directory, adds a texture load benchmark");
+
+    try {
+        program.parse_args(argc, argv);
+    } catch (const std::runtime_error& err) {
+        std::cerr << err.what() << endl;
+        std::cout << program;
+        exit(1);
+    }
+
+    prepareHeadlessContext();
+    auto size = program.get<vector<int>>("-s");
+    RenderLoo app(size[0], size[1]);
+    string modelPath = program.get<string>("-m");
+    app.loadModel(modelPath);
+    if (auto path = program.present<string>("-b")) {
+        app.loadSkybox(*path);
+    }
+
+    HeadlessOptions options;
+    options.frames = program.get<int>("-n");
+    options.warmupFrames = program.get<int>("-w");
+    options.finishEachFrame = true;
+    options.fov = glm::degrees(app.getMainCamera().getFov());
+    CameraPose start{app.getMainCamera().position,
+                     app.getScene().computeAABBWorldSpace().getCenter()};
+    if (auto path = program.present<string>("-p")) {
+        options.cameraPath = loadCameraPath(*path, start);
+    } else {
+        options.cameraPath =
+            CameraPath::orbit(start, program.get<float>("-d"));
+    }
+
+    GPUProfiler::setEnabled(true);
+    HeadlessStats stats = app.runHeadless(options);
+
+    json result;
+    result["model"] = modelPath;
+    result["renderer"] =
+        reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+    result["resolution"] = {size[0], size[1]};
+    result["warmupFrames"] = options.warmupFrames;
+    result["frames"] = stats.frames;
+    result["fps"] = stats.fps();
+    result["frameTime"] = summaryToJSON(summarize(stats.frameTimes));
+    json passes = json::object();
+    for (auto& [name, samples] : collectPassTimings(stats.gpuFrames))
+        passes[name] = summaryToJSON(summarize(samples));
+    result["passes"] = passes;
+    if (auto directory = program.present<string>("-t")) {
+        result["textureLoad"] = benchmarkTextureLoad(*directory);
+    }
+
+    if (auto output = program.present<string>("-o")) {
+        ofstream file(*output);
+        file << result.dump(4) << endl;
+        LOG(INFO) << "Benchmark result written to " << *output;
+    } else {
+        cout << result.dump(4) << endl;
+    }
+}
@@ -0,0 +1,7 @@
+target("renderloo_bench")
+    set_kind("binary")
+    add_deps("renderloo_lib")
+    set_languages("c11", "cxx17")
+    add_packages("argparse", "nlohmann_json")
+
+    add_files("*.cpp")
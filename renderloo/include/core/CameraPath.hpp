@@ -0,0 +1,37 @@
+#ifndef RENDERLOO_INCLUDE_CORE_CAMERA_PATH_HPP
+#define RENDERLOO_INCLUDE_CORE_CAMERA_PATH_HPP
+#include <filesystem>
+#include <glm/glm.hpp>
+#include <vector>
+
+struct CameraPose {
+    glm::vec3 position;
+    glm::vec3 target;
+};
+/**
+ * Scripted camera motion for non-interactive rendering
+ * - Orbit: rotate the start pose around the world up axis through its target
+ * - Spline: Catmull-Rom curve through the keyframes(position and target)
+ */
+class CameraPath {
+   public:
+    enum class Type : int { Orbit = 0, Spline = 1 };
+    CameraPath() = default;
+    static CameraPath orbit(const CameraPose& start, float degrees);
+    static CameraPath spline(std::vector<CameraPose> keyframes);
+    // t in [0, 1], clamped
+    [[nodiscard]] CameraPose sample(float t) const;
+    [[nodiscard]] Type getType() const { return m_type; }
+    [[nodiscard]] bool empty() const { return m_keyframes.empty(); }
+
+   private:
+    Type m_type{Type::Orbit};
+    std::vector<CameraPose> m_keyframes;
+    float m_degrees{360.f};
+};
+
+// write keyframes as a spline path, same format as "cameraPath" in config
+bool saveCameraPath(const std::filesystem::path& filename,
+                    const std::vector<CameraPose>& keyframes);
+
+#endif /* RENDERLOO_INCLUDE_CORE_CAMERA_PATH_HPP */
@@ -0,0 +1,73 @@
+#ifndef RENDERLOO_INCLUDE_CORE_CONTENT_REGISTRY_HPP
+#define RENDERLOO_INCLUDE_CORE_CONTENT_REGISTRY_HPP
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <loo/Texture.hpp>
+#include <map>
+#include <memory>
+#include <tuple>
+
+// decoded level 0 pixels and the sampling state of a texture
+struct TextureContentKey {
+    uint64_t pixelHash;
+    int32_t width, height;
+    uint32_t internalFormat, levels;
+    int32_t minFilter, magFilter, wrap;
+    [[nodiscard]] auto tie() const {
+        return std::tie(pixelHash, width, height, internalFormat, levels,
+                        minFilter, magFilter, wrap);
+    }
+    bool operator<(const TextureContentKey& other) const {
+        return tie() < other.tie();
+    }
+};
+
+// parameters(bit exact) and texture identities of a material
+struct MaterialContentKey {
+    std::array<uint32_t, 12> parameters;
+    uint32_t flags;
+    std::array<const void*, 6> textures;
+    [[nodiscard]] auto tie() const {
+        return std::tie(parameters, flags, textures);
+    }
+    bool operator<(const MaterialContentKey& other) const {
+        return tie() < other.tie();
+    }
+    bool operator==(const MaterialContentKey& other) const {
+        return tie() == other.tie();
+    }
+};
+
+/**
+ * Content addressed objects
+ * intern() returns the first object registered with an equal key, so that
+ * duplicates share it, and counts the bytes the duplicates would have
+ * taken. Interning an object again is not a duplicate.
+ */
+template <typename Key, typename T>
+class ContentRegistry {
+   public:
+    std::shared_ptr<T> intern(const Key& key, const std::shared_ptr<T>& object,
+                              size_t bytes = 0) {
+        auto [it, inserted] = m_objects.try_emplace(key, object);
+        if (!inserted && it->second != object) {
+            m_duplicates++;
+            m_savedBytes += bytes;
+        }
+        return it->second;
+    }
+    // distinct contents
+    [[nodiscard]] size_t size() const { return m_objects.size(); }
+    [[nodiscard]] int getDuplicates() const { return m_duplicates; }
+    [[nodiscard]] size_t getSavedBytes() const { return m_savedBytes; }
+
+   private:
+    std::map<Key, std::shared_ptr<T>> m_objects;
+    int m_duplicates{0};
+    size_t m_savedBytes{0};
+};
+
+using TextureRegistry = ContentRegistry<TextureContentKey, loo::Texture2D>;
+
+#endif /* RENDERLOO_INCLUDE_CORE_CONTENT_REGISTRY_HPP */
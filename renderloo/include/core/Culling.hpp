@@ -0,0 +1,98 @@
+#ifndef RENDERLOO_INCLUDE_CORE_CULLING_HPP
+#define RENDERLOO_INCLUDE_CORE_CULLING_HPP
+#include <array>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <loo/Scene.hpp>
+#include <vector>
+#include "core/TransformCache.hpp"
+
+// one byte per mesh in scene.getMeshes() order, non zero if visible
+using MeshVisibility = std::vector<uint8_t>;
+
+// plane order of extractFrustum(), with reverse-Z FrustumPlane_DepthOne
+// is the near plane
+enum FrustumPlane : int {
+    FrustumPlane_Left = 0,
+    FrustumPlane_Right = 1,
+    FrustumPlane_Bottom = 2,
+    FrustumPlane_Top = 3,
+    FrustumPlane_DepthZero = 4,
+    FrustumPlane_DepthOne = 5,
+};
+
+struct Frustum {
+    // normalized, dot(plane.xyz, p) + plane.w >= 0 inside
+    std::array<glm::vec4, 6> planes;
+    // the plane keeps everything afterwards
+    void disablePlane(FrustumPlane plane) {
+        planes[plane] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    }
+};
+
+// projection * view with [0, 1] clip depth(either depth direction), an
+// infinite far plane becomes a plane that keeps everything
+Frustum extractFrustum(const glm::mat4& viewProjection);
+
+/**
+ * World space AABBs as structure of arrays
+ * Arrays are padded to a multiple of AABB_BATCH_WIDTH so that the cull
+ * loop only runs full SIMD batches.
+ */
+constexpr size_t AABB_BATCH_WIDTH = 8;
+struct AABBBatch {
+    std::vector<float> centerX, centerY, centerZ;
+    std::vector<float> extentX, extentY, extentZ;
+    size_t count{0};
+
+    void resize(size_t n);
+    void set(size_t i, const glm::vec3& center, const glm::vec3& extent);
+    // local box(center, half extent) under an affine transform
+    void setTransformed(size_t i, const glm::mat4& transform,
+                        const glm::vec3& center, const glm::vec3& extent);
+};
+
+// one byte per mesh, non zero if the mesh is moved by bones, its bind pose
+// bounds do not hold. Meshes of an animated scene with an unexpected
+// vertex layout are counted as skinned. GL context required.
+std::vector<uint8_t> findSkinnedMeshes(const loo::Scene& scene);
+
+// multi draw indices are scene mesh indices, returns draws itself if
+// visibility is nullptr, otherwise the visible draws written to output
+const std::vector<int>& filterVisibleDraws(const std::vector<int>& draws,
+                                           const MeshVisibility* visibility,
+                                           std::vector<int>& output);
+
+// visibility[i] = 1 unless box i is completely outside one of the planes,
+// conservative: boxes crossing a frustum corner may be kept
+void cullAABBs(const Frustum& frustum, const AABBBatch& boxes,
+               uint8_t* visibility);
+
+class FrustumCuller {
+   public:
+    // transforms: updated for the scene this frame
+    void cull(const loo::Scene& scene, const TransformCache& transforms,
+              const glm::mat4& viewProjection);
+    void cull(const loo::Scene& scene, const TransformCache& transforms,
+              const Frustum& frustum);
+    // one byte per mesh, non zero meshes are kept by every cull(skinned
+    // meshes, see findSkinnedMeshes())
+    void setAlwaysVisible(std::vector<uint8_t> meshes) {
+        m_alwaysVisible = std::move(meshes);
+    }
+    [[nodiscard]] const MeshVisibility& getVisibility() const {
+        return m_visibility;
+    }
+    [[nodiscard]] int getVisible() const { return m_visible; }
+    [[nodiscard]] int getTotal() const {
+        return static_cast<int>(m_visibility.size());
+    }
+
+   private:
+    AABBBatch m_bounds;
+    MeshVisibility m_visibility;
+    std::vector<uint8_t> m_alwaysVisible;
+    int m_visible{0};
+};
+
+#endif /* RENDERLOO_INCLUDE_CORE_CULLING_HPP */
@@ -21,7 +21,9 @@ class FinalProcess {
    public:
     FinalProcess(int width, int height);
     void init();
-    void render(const loo::Texture2D& deferredTexture);
+    // render to the default framebuffer if target is null
+    void render(const loo::Texture2D& deferredTexture,
+                loo::Framebuffer* target = nullptr);
 };
 
 #endif /* HDSSS_INCLUDE_FINAL_PROCESS_HPP */
@@ -0,0 +1,118 @@
+#ifndef RENDERLOO_INCLUDE_CORE_FRAME_CAPTURE_HPP
+#define RENDERLOO_INCLUDE_CORE_FRAME_CAPTURE_HPP
+#include <glad/glad.h>
+#include <array>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <loo/Texture.hpp>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "core/FrameSequence.hpp"
+
+constexpr int CAPTURE_RING_SIZE = 4;
+// encode jobs waiting for the worker before captures block
+constexpr size_t ENCODER_QUEUE_SIZE = 8;
+
+struct EncodeJob {
+    // appended to the sequence if set, written to filename otherwise
+    std::filesystem::path filename;
+    std::shared_ptr<FrameSequenceWriter> sequence;
+    int width, height, channels;
+    // 32bit float channels if true, 8bit otherwise
+    bool hdr;
+    // bottom-up rows, as read back from OpenGL
+    std::vector<unsigned char> pixels;
+};
+
+/**
+ * Background image encoder
+ * Jobs are flipped and written(PNG, or EXR for float data) on a worker
+ * thread in submission order.
+ * The queue is bounded: submit() blocks while it is full, which slows the
+ * producer down to the disk speed. Pixel buffers of finished jobs are
+ * recycled through acquireBuffer(), so a long recording allocates at most
+ * queue size + 2 frames.
+ */
+class ImageEncoder {
+   public:
+    explicit ImageEncoder(size_t maxQueuedJobs = ENCODER_QUEUE_SIZE);
+    ~ImageEncoder();
+    void submit(EncodeJob job);
+    // block until every submitted job is written
+    void wait();
+    // recycled buffer if available, resized to size
+    std::vector<unsigned char> acquireBuffer(size_t size);
+    // submits that had to wait for the worker
+    [[nodiscard]] int getBlockedSubmits() const { return m_blockedSubmits; }
+
+   private:
+    void run();
+
+    size_t m_maxQueuedJobs;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<EncodeJob> m_jobs;
+    std::vector<std::vector<unsigned char>> m_freeBuffers;
+    bool m_busy{false}, m_quit{false};
+    int m_blockedSubmits{0};
+    // last member, starts after everything above is initialized
+    std::thread m_worker;
+};
+
+/**
+ * Asynchronous framebuffer/texture readback
+ * Pixels are read into a ring of pixel buffer objects, each guarded by a
+ * fence. update() maps the buffers whose fence has signaled(usually a few
+ * frames later) and hands the pixels to the encoder thread, so neither the
+ * GPU nor the frame loop waits for the readback or the file write.
+ * The output format follows the filename extension(.png or .exr), or
+ * the sequence format when frames are appended to a FrameSequenceWriter.
+ */
+class AsyncFrameCapture {
+   public:
+    AsyncFrameCapture() = default;
+    AsyncFrameCapture(const AsyncFrameCapture&) = delete;
+    AsyncFrameCapture& operator=(const AsyncFrameCapture&) = delete;
+    ~AsyncFrameCapture();
+    void captureFramebuffer(GLuint framebuffer, int width, int height,
+                            const std::filesystem::path& filename);
+    void captureTexture(const loo::Texture2D& texture,
+                        const std::filesystem::path& filename);
+    void captureFramebuffer(GLuint framebuffer, int width, int height,
+                            std::shared_ptr<FrameSequenceWriter> sequence);
+    void captureTexture(const loo::Texture2D& texture,
+                        std::shared_ptr<FrameSequenceWriter> sequence);
+    // call once per frame
+    void update();
+    // retire every pending readback and wait for the encoder
+    void flush();
+    // captures that had to wait for the GPU because the ring was full
+    [[nodiscard]] int getStalls() const { return m_stalls; }
+    // captures that had to wait for the encoder(disk) to catch up
+    [[nodiscard]] int getEncoderStalls() const {
+        return m_encoder.getBlockedSubmits();
+    }
+
+   private:
+    struct Slot {
+        GLuint pbo{0};
+        GLsizeiptr capacity{0};
+        GLsync fence{nullptr};
+        EncodeJob job;
+    };
+    Slot& acquireSlot(int width, int height, bool hdr);
+    void readFramebuffer(Slot& slot, GLuint framebuffer);
+    void readTexture(Slot& slot, const loo::Texture2D& texture);
+    void retire(Slot& slot);
+
+    std::array<Slot, CAPTURE_RING_SIZE> m_slots;
+    // next slot to write, also the oldest pending one
+    int m_next{0};
+    int m_stalls{0};
+    ImageEncoder m_encoder;
+};
+
+#endif /* RENDERLOO_INCLUDE_CORE_FRAME_CAPTURE_HPP */
@@ -0,0 +1,59 @@
+#ifndef RENDERLOO_INCLUDE_CORE_FRAME_SEQUENCE_HPP
+#define RENDERLOO_INCLUDE_CORE_FRAME_SEQUENCE_HPP
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+enum class SequenceFormat : int {
+    // YUV4MPEG2, 8bit 4:4:4 planar, playable by ffmpeg/mpv directly
+    Y4M = 0,
+    // headerless interleaved rgb24
+    Raw = 1,
+    // one float EXR per frame, numbered, in a directory
+    EXR = 2,
+};
+
+// .y4m, .rgb/.raw, anything else is an EXR directory
+SequenceFormat sequenceFormatFromPath(const std::filesystem::path& path);
+
+// BT.709 limited range, planar output
+void rgbToYCbCr444(const uint8_t* rgb, int width, int height, uint8_t* y,
+                   uint8_t* cb, uint8_t* cr);
+
+/**
+ * Frame sequence sink for continuous capture
+ * Frames are appended by the encoder thread in capture order, so a writer
+ * is never touched by two threads at once. The stream is finalized when
+ * the last reference(held by pending encode jobs) is released.
+ */
+class FrameSequenceWriter {
+   public:
+    FrameSequenceWriter(std::filesystem::path path, SequenceFormat format,
+                        int fps);
+    ~FrameSequenceWriter();
+    FrameSequenceWriter(const FrameSequenceWriter&) = delete;
+    FrameSequenceWriter& operator=(const FrameSequenceWriter&) = delete;
+    // pixels are top-down rgb, uint8 or float when isHDR()
+    bool write(int width, int height, const void* pixels);
+    [[nodiscard]] bool isHDR() const { return m_format == SequenceFormat::EXR; }
+    [[nodiscard]] SequenceFormat getFormat() const { return m_format; }
+    [[nodiscard]] const std::filesystem::path& getPath() const {
+        return m_path;
+    }
+
+   private:
+    bool open(int width, int height);
+
+    std::filesystem::path m_path;
+    SequenceFormat m_format;
+    int m_fps;
+    int m_width{0}, m_height{0};
+    int m_frames{0};
+    bool m_failed{false};
+    std::ofstream m_file;
+    // Y, Cb, Cr planes, reused across frames
+    std::vector<uint8_t> m_planes;
+};
+
+#endif /* RENDERLOO_INCLUDE_CORE_FRAME_SEQUENCE_HPP */
@@ -0,0 +1,108 @@
+#ifndef RENDERLOO_INCLUDE_CORE_GEOMETRY_ARENA_HPP
+#define RENDERLOO_INCLUDE_CORE_GEOMETRY_ARENA_HPP
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <loo/Scene.hpp>
+#include <unordered_map>
+#include <vector>
+#include "core/MeshLOD.hpp"
+
+class MeshInstancing;
+
+// default capacity of an arena, larger meshes get an arena of their own
+constexpr size_t GEOMETRY_ARENA_VERTICES = 1 << 20;
+constexpr size_t GEOMETRY_ARENA_INDEX_BYTES = 32 << 20;
+// meshes with at most this many vertices use 16 bit indices
+constexpr size_t GEOMETRY_SHORT_INDEX_VERTICES = 1 << 16;
+
+[[nodiscard]] inline bool useShortIndices(size_t vertexCount) {
+    return vertexCount <= GEOMETRY_SHORT_INDEX_VERTICES;
+}
+// indices must be below 65536
+void narrowIndices(const uint32_t* indices, size_t count, uint16_t* narrow);
+
+struct GeometryRange {
+    uint32_t arena;
+    // in vertices, the base vertex of the draw
+    size_t firstVertex;
+    size_t indexOffset;
+};
+
+/**
+ * Bump suballocation of vertices and index bytes
+ * Arenas are filled in order, a mesh that does not fit the last one opens
+ * the next. CPU only, GeometryArena creates the buffers from the sizes.
+ */
+class GeometryAllocator {
+   public:
+    struct Arena {
+        size_t vertexCapacity, indexCapacity;
+        size_t vertices{0}, indexBytes{0};
+    };
+    GeometryAllocator(size_t vertexCapacity = GEOMETRY_ARENA_VERTICES,
+                      size_t indexCapacity = GEOMETRY_ARENA_INDEX_BYTES)
+        : m_vertexCapacity(vertexCapacity), m_indexCapacity(indexCapacity) {}
+    // indexBytes start aligned to indexSize
+    GeometryRange allocate(size_t vertexCount, size_t indexBytes,
+                           size_t indexSize);
+    [[nodiscard]] const std::vector<Arena>& getArenas() const {
+        return m_arenas;
+    }
+
+   private:
+    size_t m_vertexCapacity, m_indexCapacity;
+    std::vector<Arena> m_arenas;
+};
+
+// what drawMesh needs to draw a mesh out of an arena
+struct GeometryDraw {
+    struct Level {
+        GLsizei count;
+        size_t indexOffset;
+    };
+    GLuint vao;
+    GLenum indexType;
+    GLint baseVertex;
+    // level 0 is the full mesh
+    int levelCount;
+    Level levels[MESH_LOD_COUNT];
+};
+
+/**
+ * Shared vertex and index buffers of the per mesh path
+ * build() copies every mesh into a few large arenas, one VAO each, so that
+ * consecutive draws rarely switch vertex arrays. Indices of meshes with few
+ * enough vertices are stored as 16 bit, 16 and 32 bit ranges share the
+ * index buffer of an arena. The LOD levels of a mesh follow its indices.
+ * Draws use glDrawElementsBaseVertex. The vertex and index buffers of the
+ * copied meshes are released, their own VAOs only keep the vertex format.
+ */
+class GeometryArena {
+   public:
+    GeometryArena() = default;
+    GeometryArena(const GeometryArena&) = delete;
+    GeometryArena& operator=(const GeometryArena&) = delete;
+    ~GeometryArena();
+    // call after the scene changed, every mesh is expected to have the
+    // vertex layout of the first one. lods are indexed like
+    // scene.getMeshes(), may be null. Copies found by instancing share the
+    // geometry of their prototype.
+    void build(const loo::Scene& scene,
+               const std::vector<MeshLODs>* lods = nullptr,
+               const MeshInstancing* instancing = nullptr);
+    // nullptr if the mesh is not part of the arena
+    [[nodiscard]] const GeometryDraw* find(const loo::Mesh* mesh) const;
+    [[nodiscard]] bool empty() const { return m_draws.empty(); }
+
+   private:
+    struct Arena {
+        GLuint vao, vertexBuffer, indexBuffer;
+    };
+    void release();
+
+    std::vector<Arena> m_arenas;
+    std::unordered_map<const loo::Mesh*, GeometryDraw> m_draws;
+};
+
+#endif /* RENDERLOO_INCLUDE_CORE_GEOMETRY_ARENA_HPP */
@@ -1,7 +1,44 @@
 #ifndef RENDERLOO_INCLUDE_CORE_GRAPHICS_HPP
 #define RENDERLOO_INCLUDE_CORE_GRAPHICS_HPP
+#include <cstdint>
 #include <loo/Mesh.hpp>
 
-void drawMesh(const loo::Mesh& mesh, glm::mat4 transform,
-              glm::mat4 previousTransform, const loo::ShaderProgram& sp);
+struct GeometryDraw;
+class RenderStateCache;
+class TransformCache;
+
+// camera part of the MVP blocks, copied into every per draw block
+// call once per frame after UniformRing::beginFrame(), binds both blocks
+void setCameraMatrices(const glm::mat4& view, const glm::mat4& projection,
+                       const glm::mat4& prevView,
+                       const glm::mat4& prevProjection);
+
+// transforms of the mesh at meshIndex in scene.getMeshes(), geometry
+// draws the full mesh out of its GeometryArena
+void drawMesh(const loo::Mesh& mesh, const TransformCache& transforms,
+              size_t meshIndex, const loo::ShaderProgram& sp,
+              const GeometryDraw* geometry = nullptr);
+// cull and polygon mode are left to the caller, VAO and material are bound
+// through the state cache so that repeated binds are skipped. geometry
+// draws the mesh out of its GeometryArena instead of its own VAO, at the
+// given LOD level if it has one.
+void drawMesh(const loo::Mesh& mesh, const TransformCache& transforms,
+              size_t meshIndex, const loo::ShaderProgram& sp,
+              RenderStateCache& state, bool bindMaterial,
+              const GeometryDraw* geometry = nullptr, int lod = 0);
+// one instanced draw of copies sharing the geometry and material of mesh,
+// meshIndices holds the transforms of every instance. They are read from
+// the per draw data buffer with gl_InstanceID while the "instanced"
+// uniform is set.
+void drawMeshInstances(const loo::Mesh& mesh,
+                       const TransformCache& transforms,
+                       const uint32_t* meshIndices, size_t count,
+                       loo::ShaderProgram& sp,
+                       const GeometryDraw* geometry = nullptr);
+void drawMeshInstances(const loo::Mesh& mesh,
+                       const TransformCache& transforms,
+                       const uint32_t* meshIndices, size_t count,
+                       loo::ShaderProgram& sp, RenderStateCache& state,
+                       bool bindMaterial,
+                       const GeometryDraw* geometry = nullptr, int lod = 0);
 #endif /* RENDERLOO_INCLUDE_CORE_GRAPHICS_HPP */
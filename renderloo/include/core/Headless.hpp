@@ -0,0 +1,46 @@
+#ifndef RENDERLOO_INCLUDE_CORE_HEADLESS_HPP
+#define RENDERLOO_INCLUDE_CORE_HEADLESS_HPP
+#include <filesystem>
+#include <vector>
+#include "core/CameraPath.hpp"
+#include "core/Profiler.hpp"
+
+struct HeadlessOptions {
+    int frames{120};
+    // rendered at the start pose before measuring, never written
+    int warmupFrames{0};
+    // wait for the GPU after every frame so frame times include GPU work
+    bool finishEachFrame{false};
+    // fixed timestep, makes animation independent of the render speed
+    float deltaTime{1.0f / 60.0f};
+    // empty path: render only, no frame is written
+    std::filesystem::path outputDir{};
+    // empty path: no recording, otherwise every measured frame is appended
+    // to one sequence at 1/deltaTime fps, format by extension(.y4m, .rgb,
+    // or a directory of EXRs)
+    std::filesystem::path recordPath{};
+    CameraPath cameraPath{};
+    // camera fov in degrees
+    float fov{60.f}, zNear{0.01f}, zFar{30.f};
+};
+
+struct HeadlessStats {
+    int frames{0};
+    double seconds{0.0};
+    // per measured frame, milliseconds
+    std::vector<double> frameTimes;
+    // GPU pass timings of the measured frames when the profiler is enabled,
+    // not capped by GPU_PROFILER_HISTORY_SIZE
+    std::vector<GPUFrameTimings> gpuFrames;
+    [[nodiscard]] double fps() const {
+        return seconds > 0.0 ? frames / seconds : 0.0;
+    }
+};
+
+// Must be called before the application creates its window.
+// With GLFW 3.4+ the null platform is used together with an OSMesa
+// context, so no display server is required(e.g. Mesa llvmpipe on CPU only
+// machines); older GLFW falls back to a hidden window.
+void prepareHeadlessContext();
+
+#endif /* RENDERLOO_INCLUDE_CORE_HEADLESS_HPP */
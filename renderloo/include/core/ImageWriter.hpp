@@ -0,0 +1,14 @@
+#ifndef RENDERLOO_INCLUDE_CORE_IMAGE_WRITER_HPP
+#define RENDERLOO_INCLUDE_CORE_IMAGE_WRITER_HPP
+#include <cstddef>
+#include <filesystem>
+
+// flip image rows in place, OpenGL reads back bottom-up
+void flipImageRows(void* data, size_t rowBytes, int height);
+
+// single part, scanline, uncompressed OpenEXR with 32bit float channels
+// data is top-down, interleaved, channels in [1, 4](Y, -, RGB, RGBA)
+bool writeEXR(const std::filesystem::path& filename, int width, int height,
+              int channels, const float* data);
+
+#endif /* RENDERLOO_INCLUDE_CORE_IMAGE_WRITER_HPP */
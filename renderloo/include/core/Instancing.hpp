@@ -0,0 +1,50 @@
+#ifndef RENDERLOO_INCLUDE_CORE_INSTANCING_HPP
+#define RENDERLOO_INCLUDE_CORE_INSTANCING_HPP
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <loo/Material.hpp>
+#include <loo/Scene.hpp>
+#include <vector>
+
+// content hash of the vertex and index arrays
+uint64_t hashMeshGeometry(const loo::Mesh& mesh);
+// every mesh on the job system, scene.getMeshes() order
+std::vector<uint64_t> hashSceneGeometry(const loo::Scene& scene);
+// the same object, or PBR materials with equal content keys
+bool isSameMaterial(const loo::Material* a, const loo::Material* b);
+
+// prototype[i] is the first j <= i with hashes[j] == hashes[i] and
+// equal(j, i), so a hash collision never merges different content
+std::vector<uint32_t> groupInstances(
+    const std::vector<uint64_t>& hashes,
+    const std::function<bool(size_t, size_t)>& equal);
+
+/**
+ * Meshes repeated with the same geometry and material
+ * The copies of a group share the geometry of their prototype(the first
+ * copy) in the GeometryArena and the multi draw buffers. Neighbouring draws
+ * of a group become one instanced draw, the per instance transforms are
+ * read from the per draw data buffer(shaders/include/multiDraw.glsl).
+ */
+class MeshInstancing {
+   public:
+    // hashes from hashSceneGeometry(), computed here if their count does
+    // not match
+    void build(const loo::Scene& scene,
+               const std::vector<uint64_t>& geometryHashes);
+    // the mesh itself if it has no earlier copy
+    [[nodiscard]] uint32_t getPrototype(size_t mesh) const {
+        return m_prototypes.empty() ? static_cast<uint32_t>(mesh)
+                                    : m_prototypes[mesh];
+    }
+    // groups of at least two meshes and the meshes in them
+    [[nodiscard]] int getGroups() const { return m_groups; }
+    [[nodiscard]] int getInstancedMeshes() const { return m_instancedMeshes; }
+
+   private:
+    std::vector<uint32_t> m_prototypes;
+    int m_groups{0}, m_instancedMeshes{0};
+};
+
+#endif /* RENDERLOO_INCLUDE_CORE_INSTANCING_HPP */
@@ -0,0 +1,85 @@
+#ifndef RENDERLOO_INCLUDE_CORE_JOB_SYSTEM_HPP
+#define RENDERLOO_INCLUDE_CORE_JOB_SYSTEM_HPP
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+struct Job {
+    std::function<void()> function;
+    // guards continuations and finished
+    std::mutex mutex;
+    std::vector<std::shared_ptr<Job>> continuations;
+    // unfinished dependencies, +1 until submitted
+    std::atomic<int> dependencies{1};
+    std::atomic<bool> finished{false};
+};
+using JobHandle = std::shared_ptr<Job>;
+
+struct JobStatistics {
+    int workers{0};
+    int jobs{0}, steals{0};
+    // stolen jobs over executed jobs
+    float stealRate{0.f};
+    // time spent in jobs over the time of every thread of the pool(the
+    // workers and the thread calling newFrame())
+    float utilization{0.f};
+};
+
+/**
+ * Work stealing thread pool
+ * Every worker owns a deque, it pushes and pops its own jobs at the back
+ * and steals from the front of the others when it runs dry. Threads that
+ * are not workers share one more deque. Waiting threads(wait() and
+ * parallelFor()) run jobs instead of blocking, so jobs may wait on other
+ * jobs. Before init(), or with no workers, everything runs on the waiting
+ * thread.
+ */
+class JobSystem {
+   public:
+    // workers < 0: one per hardware thread minus the calling thread
+    static void init(int workers = -1);
+    static void shutdown();
+    [[nodiscard]] static int getWorkerCount();
+
+    // the job runs once submitted and all its dependencies finished
+    static JobHandle createJob(std::function<void()> function);
+    // after must not be submitted yet
+    static void addDependency(const JobHandle& before, const JobHandle& after);
+    static void submit(const JobHandle& job);
+    static void wait(const JobHandle& job);
+
+    // body(begin, end) over [0, count) in chunks of at least grain items,
+    // returns when every chunk finished
+    static void parallelFor(int count, int grain,
+                            const std::function<void(int, int)>& body);
+    // sorts chunks in parallel, then merges them on the calling thread
+    template <typename Iterator, typename Compare>
+    static void parallelSort(Iterator begin, Iterator end, Compare compare,
+                             int grain = 1024) {
+        int count = static_cast<int>(std::distance(begin, end));
+        int chunks = std::max(
+            std::min(count / std::max(grain, 1), getWorkerCount() + 1), 1);
+        if (chunks == 1) {
+            std::sort(begin, end, compare);
+            return;
+        }
+        parallelFor(chunks, 1, [&](int first, int last) {
+            for (int i = first; i < last; i++)
+                std::sort(begin + count * i / chunks,
+                          begin + count * (i + 1) / chunks, compare);
+        });
+        for (int i = 1; i < chunks; i++)
+            std::inplace_merge(begin, begin + count * i / chunks,
+                               begin + count * (i + 1) / chunks, compare);
+    }
+
+    // moves the counters of the finished frame to getStatistics()
+    static void newFrame();
+    [[nodiscard]] static const JobStatistics& getStatistics();
+};
+
+#endif /* RENDERLOO_INCLUDE_CORE_JOB_SYSTEM_HPP */
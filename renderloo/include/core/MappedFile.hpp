@@ -0,0 +1,42 @@
+#ifndef RENDERLOO_INCLUDE_CORE_MAPPED_FILE_HPP
+#define RENDERLOO_INCLUDE_CORE_MAPPED_FILE_HPP
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+/**
+ * Read only memory mapping of a whole file
+ * Pages are faulted in on first access, so sections that are never read
+ * cost nothing.
+ */
+class MappedFile {
+   public:
+    MappedFile() = default;
+    explicit MappedFile(const std::filesystem::path& path) { open(path); }
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    // false if the file is missing or empty
+    bool open(const std::filesystem::path& path);
+    void close();
+    [[nodiscard]] bool isOpen() const { return m_data != nullptr; }
+    [[nodiscard]] const uint8_t* data() const { return m_data; }
+    [[nodiscard]] size_t size() const { return m_size; }
+
+   private:
+    const uint8_t* m_data{nullptr};
+    size_t m_size{0};
+#ifdef _WIN32
+    void* m_file{nullptr};
+    void* m_mapping{nullptr};
+#endif
+};
+
+// FNV-1a, 64 bit
+uint64_t hashBytes(const void* data, size_t size,
+                   uint64_t seed = 0xcbf29ce484222325ull);
+
+#endif /* RENDERLOO_INCLUDE_CORE_MAPPED_FILE_HPP */
@@ -0,0 +1,141 @@
+#ifndef RENDERLOO_INCLUDE_CORE_MESH_LOD_HPP
+#define RENDERLOO_INCLUDE_CORE_MESH_LOD_HPP
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <loo/Scene.hpp>
+#include <vector>
+#include "core/TransformCache.hpp"
+
+// the mesh itself and up to three simplified levels
+constexpr int MESH_LOD_COUNT = 4;
+// triangles a level keeps of the previous one
+constexpr float MESH_LOD_REDUCTION = 0.5f;
+// a level that keeps more than this of the previous one is dropped
+constexpr float MESH_LOD_MIN_REDUCTION = 0.8f;
+// meshes below are not simplified
+constexpr size_t MESH_LOD_MIN_TRIANGLES = 256;
+// error bound of the simplification, relative to the mesh radius
+constexpr float MESH_LOD_MAX_ERROR = 0.05f;
+// a collapse may not turn a face normal further than acos(this)
+constexpr float MESH_LOD_MIN_NORMAL_DOT = 0.7f;
+// projected error a level may have, in pixels
+constexpr float MESH_LOD_PIXEL_ERROR = 1.0f;
+constexpr float MESH_LOD_SHADOW_PIXEL_ERROR = 4.0f;
+
+struct MeshLODLevel {
+    // into MeshLODs::indices
+    uint32_t firstIndex, indexCount;
+    // object space distance the level may deviate from the mesh
+    float error;
+};
+
+// simplified levels 1.. of a mesh, level 0 is the mesh itself
+struct MeshLODs {
+    std::vector<MeshLODLevel> levels;
+    std::vector<uint32_t> indices;
+    [[nodiscard]] int getLevelCount() const {
+        return static_cast<int>(levels.size()) + 1;
+    }
+};
+
+/**
+ * Quadric error metric simplification(Garland and Heckbert 1997)
+ * Collapses edges onto one of their vertices, so the levels index the
+ * vertices of the mesh. Vertices on an edge that is not shared by exactly
+ * two triangles are locked: open borders, and UV or normal seams, where
+ * loo splits the vertices. Collapses that turn a face normal by more than
+ * MESH_LOD_MIN_NORMAL_DOT or break the manifold are rejected.
+ */
+class MeshSimplifier {
+   public:
+    MeshSimplifier(const std::vector<glm::vec3>& positions,
+                   const std::vector<uint32_t>& indices);
+    // continues until at most targetIndexCount indices are left or every
+    // collapse would exceed maxError, a distance
+    void simplify(size_t targetIndexCount, float maxError);
+    [[nodiscard]] const std::vector<uint32_t>& getIndices() const {
+        return m_indices;
+    }
+    // of the collapses so far, a bound of the distance to the input
+    [[nodiscard]] float getError() const { return m_error; }
+
+   private:
+    struct Quadric {
+        // upper triangle of the symmetric 4x4 plane matrix
+        double a[10]{};
+        void addPlane(const glm::dvec4& plane);
+        Quadric& operator+=(const Quadric& other);
+        [[nodiscard]] double evaluate(const glm::vec3& p) const;
+    };
+    // false if the collapse of u onto v breaks the mesh
+    bool canCollapse(uint32_t u, uint32_t v);
+
+    const std::vector<glm::vec3>& m_positions;
+    std::vector<uint32_t> m_indices;
+    std::vector<Quadric> m_quadrics;
+    std::vector<uint8_t> m_locked;
+    // triangles per vertex of m_indices, rebuilt every pass
+    std::vector<uint32_t> m_adjacencyOffsets, m_adjacency;
+    // scratch of canCollapse()
+    std::vector<uint32_t> m_neighbors[2], m_common;
+    float m_error{0.f};
+};
+
+MeshLODs generateMeshLODs(const std::vector<glm::vec3>& positions,
+                          const std::vector<uint32_t>& indices);
+template <typename Vertex>
+MeshLODs generateMeshLODs(const std::vector<Vertex>& vertices,
+                          const std::vector<uint32_t>& indices) {
+    std::vector<glm::vec3> positions;
+    positions.reserve(vertices.size());
+    for (auto& vertex : vertices)
+        positions.push_back(vertex.position);
+    return generateMeshLODs(positions, indices);
+}
+// every mesh on the job system, scene.getMeshes() order
+std::vector<MeshLODs> generateSceneLODs(const loo::Scene& scene);
+
+// pixels covered by an object space unit at the bounding sphere of a mesh,
+// projectionScale is viewport height / (2 tan(fovy / 2))
+float getLODPixelScale(const glm::mat4& world, const glm::vec3& center,
+                       float radius, const glm::vec3& cameraPosition,
+                       float projectionScale);
+// coarsest level whose error covers at most pixelError pixels
+int selectMeshLOD(const MeshLODs& lods, float pixelScale, float pixelError);
+
+/**
+ * Per frame LOD selection
+ * setScene() takes the levels of importScene(), select() picks a level per
+ * mesh from its projected error, once for the main view and once with the
+ * coarser shadow threshold, shadows are seen from the main view too.
+ */
+class LODSelector {
+   public:
+    // lods may be empty or of another scene, every mesh stays at level 0
+    void setScene(const loo::Scene& scene, std::vector<MeshLODs>&& lods);
+    void select(const TransformCache& transforms,
+                const glm::vec3& cameraPosition, float projectionScale);
+    // indexed like scene.getMeshes(), null if no mesh has levels
+    [[nodiscard]] const std::vector<MeshLODs>* getLODs() const {
+        return m_lods.empty() ? nullptr : &m_lods;
+    }
+    [[nodiscard]] const std::vector<uint8_t>* getLevels() const {
+        return enabled && !m_lods.empty() ? &m_levels : nullptr;
+    }
+    [[nodiscard]] const std::vector<uint8_t>* getShadowLevels() const {
+        return enabled && !m_lods.empty() ? &m_shadowLevels : nullptr;
+    }
+
+    bool enabled{true};
+    float pixelError{MESH_LOD_PIXEL_ERROR};
+    float shadowPixelError{MESH_LOD_SHADOW_PIXEL_ERROR};
+
+   private:
+    std::vector<MeshLODs> m_lods;
+    // object space bounding spheres
+    std::vector<glm::vec4> m_spheres;
+    std::vector<uint8_t> m_levels, m_shadowLevels;
+};
+
+#endif /* RENDERLOO_INCLUDE_CORE_MESH_LOD_HPP */
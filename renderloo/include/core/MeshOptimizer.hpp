@@ -0,0 +1,104 @@
+#ifndef RENDERLOO_INCLUDE_CORE_MESH_OPTIMIZER_HPP
+#define RENDERLOO_INCLUDE_CORE_MESH_OPTIMIZER_HPP
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <loo/Scene.hpp>
+#include <vector>
+
+// FIFO post-transform cache the statistics and the reordering assume
+constexpr int VERTEX_CACHE_SIZE = 16;
+// ACMR the overdraw order may give up, relative to the cache order
+constexpr float OVERDRAW_ACMR_THRESHOLD = 1.05f;
+
+// counts, so that meshes add up
+struct VertexCacheStatistics {
+    uint64_t triangles{0};
+    // referenced vertices
+    uint64_t vertices{0};
+    // cache misses
+    uint64_t transformed{0};
+
+    // average cache miss ratio, transformed vertices per triangle, 0.5 at
+    // best on regular meshes
+    [[nodiscard]] float getACMR() const {
+        return triangles ? float(transformed) / triangles : 0.f;
+    }
+    // average transformed vertex ratio, 1 at best
+    [[nodiscard]] float getATVR() const {
+        return vertices ? float(transformed) / vertices : 0.f;
+    }
+    VertexCacheStatistics& operator+=(const VertexCacheStatistics& other) {
+        triangles += other.triangles;
+        vertices += other.vertices;
+        transformed += other.transformed;
+        return *this;
+    }
+};
+
+struct MeshOptimizationStatistics {
+    VertexCacheStatistics before, after;
+    MeshOptimizationStatistics& operator+=(
+        const MeshOptimizationStatistics& other) {
+        before += other.before;
+        after += other.after;
+        return *this;
+    }
+};
+
+VertexCacheStatistics analyzeVertexCache(
+    const uint32_t* indices, size_t indexCount, size_t vertexCount,
+    int cacheSize = VERTEX_CACHE_SIZE);
+
+// Tipsify(Sander et al. 2007), in place. clusters receives the first
+// triangle of every run that starts with a cold cache.
+void optimizeVertexCache(uint32_t* indices, size_t indexCount,
+                         size_t vertexCount,
+                         std::vector<uint32_t>* clusters = nullptr,
+                         int cacheSize = VERTEX_CACHE_SIZE);
+// splits the clusters further as long as each keeps its ACMR within
+// threshold of its parent, then sorts them outward facing first, so that
+// the silhouette occludes the inside(Sander et al. 2007)
+void optimizeOverdraw(uint32_t* indices, size_t indexCount,
+                      const std::vector<glm::vec3>& positions,
+                      const std::vector<uint32_t>& clusters,
+                      float threshold = OVERDRAW_ACMR_THRESHOLD,
+                      int cacheSize = VERTEX_CACHE_SIZE);
+// renumbers the vertices in order of first use, unreferenced ones move to
+// the end. Returns the new index of every old vertex.
+std::vector<uint32_t> optimizeVertexFetch(uint32_t* indices,
+                                          size_t indexCount,
+                                          size_t vertexCount);
+
+// all three stages on the arrays of a mesh
+template <typename Vertex>
+MeshOptimizationStatistics optimizeMesh(std::vector<Vertex>& vertices,
+                                        std::vector<uint32_t>& indices) {
+    MeshOptimizationStatistics statistics;
+    statistics.before =
+        analyzeVertexCache(indices.data(), indices.size(), vertices.size());
+    std::vector<uint32_t> clusters;
+    optimizeVertexCache(indices.data(), indices.size(), vertices.size(),
+                        &clusters);
+    std::vector<glm::vec3> positions;
+    positions.reserve(vertices.size());
+    for (auto& vertex : vertices)
+        positions.push_back(vertex.position);
+    optimizeOverdraw(indices.data(), indices.size(), positions, clusters);
+    auto remap =
+        optimizeVertexFetch(indices.data(), indices.size(), vertices.size());
+    std::vector<Vertex> reordered(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++)
+        reordered[remap[i]] = vertices[i];
+    vertices = std::move(reordered);
+    statistics.after =
+        analyzeVertexCache(indices.data(), indices.size(), vertices.size());
+    return statistics;
+}
+
+// GL context required. Reorders every mesh on the job system and copies
+// the arrays into the mesh buffers, statistics per mesh.
+std::vector<MeshOptimizationStatistics> optimizeSceneMeshes(
+    loo::Scene& scene);
+
+#endif /* RENDERLOO_INCLUDE_CORE_MESH_OPTIMIZER_HPP */
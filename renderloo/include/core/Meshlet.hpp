@@ -0,0 +1,51 @@
+#ifndef RENDERLOO_INCLUDE_CORE_MESHLET_HPP
+#define RENDERLOO_INCLUDE_CORE_MESHLET_HPP
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <loo/Scene.hpp>
+#include <vector>
+
+constexpr size_t MESHLET_MAX_VERTICES = 64;
+constexpr size_t MESHLET_MAX_TRIANGLES = 124;
+// meshes below are culled and drawn whole
+constexpr size_t MESHLET_MIN_MESH_TRIANGLES = 8192;
+
+/**
+ * Cluster of consecutive triangles of a mesh
+ * The index order of the import(vertex cache optimized) is split greedily,
+ * so a meshlet is a range of the mesh indices and needs no indices of its
+ * own. Bounds are in object space.
+ */
+struct Meshlet {
+    glm::vec3 center;
+    float radius;
+    // normal cone: every triangle normal n has dot(n, coneAxis) >=
+    // sqrt(1 - coneCutoff^2), 1 if the cone can never face away
+    glm::vec3 coneAxis;
+    float coneCutoff;
+    // into the mesh indices
+    uint32_t firstIndex, indexCount;
+};
+
+std::vector<Meshlet> buildMeshlets(const std::vector<glm::vec3>& positions,
+                                   const std::vector<uint32_t>& indices);
+template <typename Vertex>
+std::vector<Meshlet> buildMeshlets(const std::vector<Vertex>& vertices,
+                                   const std::vector<uint32_t>& indices) {
+    std::vector<glm::vec3> positions;
+    positions.reserve(vertices.size());
+    for (auto& vertex : vertices)
+        positions.push_back(vertex.position);
+    return buildMeshlets(positions, indices);
+}
+// every mesh with at least MESHLET_MIN_MESH_TRIANGLES triangles on the job
+// system, empty for the others, scene.getMeshes() order
+std::vector<std::vector<Meshlet>> buildSceneMeshlets(const loo::Scene& scene);
+
+// every triangle faces away from an object space camera position, matches
+// shaders/clusterCull.comp
+bool isMeshletBackfacing(const Meshlet& meshlet,
+                         const glm::vec3& cameraPosition);
+
+#endif /* RENDERLOO_INCLUDE_CORE_MESHLET_HPP */
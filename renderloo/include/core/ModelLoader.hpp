@@ -0,0 +1,129 @@
+#ifndef RENDERLOO_INCLUDE_CORE_MODEL_LOADER_HPP
+#define RENDERLOO_INCLUDE_CORE_MODEL_LOADER_HPP
+#include <glad/glad.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <loo/Scene.hpp>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "core/SceneCache.hpp"
+
+struct GLFWwindow;
+
+// main thread time spent on vertex arrays per frame
+constexpr float MODEL_LOADER_FRAME_BUDGET_MS = 2.0f;
+
+// vertex array state, vertex arrays are not shared between contexts
+struct VertexArrayLayout {
+    struct Attribute {
+        GLuint index;
+        GLint size;
+        GLenum type;
+        GLboolean normalized, integer;
+        GLuint relativeOffset, binding;
+    };
+    struct Binding {
+        GLuint index, buffer;
+        GLintptr offset;
+        GLsizei stride;
+        GLuint divisor;
+    };
+    std::vector<Attribute> attributes;
+    std::vector<Binding> bindings;
+    GLuint elementBuffer{0};
+};
+// the vertex array must belong to the current context
+VertexArrayLayout captureVertexArrayLayout(GLuint vao);
+GLuint createVertexArray(const VertexArrayLayout& layout);
+
+enum class ModelLoadPhase {
+    Idle,
+    // loader thread: parse, texture decode and upload, prepare callback
+    Import,
+    // main thread: vertex arrays, a few per frame
+    VertexArrays,
+    // waiting for takeScene()
+    Ready,
+    Failed,
+};
+
+// milliseconds
+struct ModelLoadTimes {
+    // importScene: parse, decode and upload, or the scene cache
+    float import{0.f};
+    // the steps of the scene cache load within import, 0 without one
+    float cacheMapping{0.f}, cacheTextures{0.f}, cacheBuffers{0.f};
+    // prepare callback, material conversion
+    float prepare{0.f};
+    float vertexArrays{0.f};
+    // after the swap, multi draw packing and culling setup
+    float setup{0.f};
+};
+
+/**
+ * Background model loading
+ * The import runs on a thread with a hidden window whose context shares
+ * buffers and textures with the main one. Vertex arrays are not shared, so
+ * their layouts are recorded there and rebuilt on the main thread within
+ * MODEL_LOADER_FRAME_BUDGET_MS per frame. The current scene keeps rendering
+ * until update() reports the new one ready.
+ */
+class ModelLoader {
+   public:
+    // runs on the loader thread after the import, CPU work only
+    using PrepareFunction = std::function<void(loo::Scene&)>;
+    ModelLoader() = default;
+    ModelLoader(const ModelLoader&) = delete;
+    ModelLoader& operator=(const ModelLoader&) = delete;
+    ~ModelLoader();
+
+    // main thread, false if no shared context could be created
+    bool init(GLFWwindow* mainWindow);
+    [[nodiscard]] bool isAvailable() const { return m_window != nullptr; }
+    // false while another model is loading
+    bool start(const std::string& filename, PrepareFunction prepare);
+    // main thread, once per frame, true once takeScene() may be called
+    bool update();
+    // meshData receives the per mesh results of importScene()
+    loo::Scene takeScene(SceneMeshData* meshData = nullptr);
+    // waits for a running import(it cannot be interrupted), then destroys
+    // the shared context, main thread
+    void shutdown();
+
+    [[nodiscard]] ModelLoadPhase getPhase() const { return m_phase; }
+    [[nodiscard]] bool isLoading() const {
+        return m_phase != ModelLoadPhase::Idle;
+    }
+    [[nodiscard]] const std::string& getFilename() const {
+        return m_filename;
+    }
+    [[nodiscard]] float getElapsedSeconds() const;
+    // scene cache steps while importing(0 until the cache is mapped or
+    // without one), then vertex arrays built so far
+    [[nodiscard]] float getProgress() const;
+    // of the last finished load, setup is filled in by the caller
+    [[nodiscard]] ModelLoadTimes& getLastTimes() { return m_lastTimes; }
+
+   private:
+    void run(const std::string& filename, const PrepareFunction& prepare);
+
+    GLFWwindow* m_window{nullptr};
+    std::thread m_thread;
+    std::atomic<ModelLoadPhase> m_phase{ModelLoadPhase::Idle};
+    std::string m_filename;
+    std::chrono::steady_clock::time_point m_start;
+    // written by the loader thread before it leaves Import
+    std::unique_ptr<loo::Scene> m_scene;
+    SceneMeshData m_meshData;
+    // progress of the import, read by the main thread
+    std::unique_ptr<SceneCacheLoadStatus> m_cacheStatus;
+    std::vector<VertexArrayLayout> m_layouts;
+    ModelLoadTimes m_times;
+    size_t m_nextMesh{0};
+    ModelLoadTimes m_lastTimes;
+};
+
+#endif /* RENDERLOO_INCLUDE_CORE_MODEL_LOADER_HPP */
@@ -0,0 +1,212 @@
+#ifndef RENDERLOO_INCLUDE_CORE_MULTI_DRAW_HPP
+#define RENDERLOO_INCLUDE_CORE_MULTI_DRAW_HPP
+#include <glad/glad.h>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <loo/Scene.hpp>
+#include <loo/Shader.hpp>
+#include <unordered_map>
+#include <vector>
+#include "core/MeshLOD.hpp"
+#include "core/Meshlet.hpp"
+#include "core/PBRMaterials.hpp"
+#include "core/TransformCache.hpp"
+#include "core/UniformRing.hpp"
+#include "core/VertexFormat.hpp"
+
+class MeshInstancing;
+
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+// std430, must match DrawData in shaders/include/multiDraw.glsl
+struct ShaderDrawData {
+    glm::mat4 model;
+    glm::mat4 prevModel;
+    glm::mat4 normalMatrix;
+    // material index(1) + vertex flags(1) + padding(2)
+    glm::uvec4 info;
+    // PositionQuantization of packed vertices, xyz
+    glm::vec4 positionOffset;
+    glm::vec4 positionScale;
+};
+
+// std430, object space box of a mesh for GPU culling
+struct ShaderMeshBounds {
+    // w non zero: always visible, the box is the bind pose of a skinned mesh
+    glm::vec4 center;
+    glm::vec4 extent;
+};
+
+// std430, a meshlet for GPU cluster culling
+struct ShaderCluster {
+    // object space bounding sphere, center(3) + radius(1)
+    glm::vec4 sphere;
+    // normal cone, axis(3) + cutoff(1)
+    glm::vec4 cone;
+    // first index in the index buffer(1) + index count(1) + padding(2)
+    glm::uvec4 info;
+};
+
+// std430, clusters of a mesh
+struct ShaderMeshClusters {
+    // first cluster(1) + cluster count(1) + double sided(1) + padding(1)
+    glm::uvec4 info;
+};
+
+/**
+ * Multi draw indirect scene submission
+ * build() packs every mesh into one vertex/index buffer pair behind a
+ * shared VAO and every material into a storage buffer. update() copies the
+ * per mesh transforms once per frame, draw() turns a list of meshes into
+ * indirect commands: consecutive meshes with the same cull mode and
+ * textures are submitted by one glMultiDrawElementsIndirect, and the
+ * shaders fetch transforms and material parameters with gl_DrawID.
+ * Textures are still bound per run, so opaque lists are sorted by state.
+ * Vertices are packed(core/VertexFormat.hpp) unless the mesh vertex
+ * arrays have an unexpected layout. The LOD levels of a mesh follow its
+ * indices, commands use the levels set by setLODLevels(). Indices are 16
+ * bit when every mesh has at most GEOMETRY_SHORT_INDEX_VERTICES vertices.
+ * Meshes split into meshlets also own a region of a separate 32 bit index
+ * buffer, where cluster culling compacts the indices of their visible
+ * meshlets. Copies found by
+ * MeshInstancing reference the vertices, indices and meshlets of their
+ * prototype.
+ */
+class MultiDrawScene {
+   public:
+    MultiDrawScene() = default;
+    MultiDrawScene(const MultiDrawScene&) = delete;
+    MultiDrawScene& operator=(const MultiDrawScene&) = delete;
+    ~MultiDrawScene();
+    // call after the scene(or its materials) changed, leaves the scene
+    // empty if a mesh has no PBR material. lods and meshlets are indexed
+    // like scene.getMeshes(), may be null.
+    void build(const loo::Scene& scene,
+               const std::vector<MeshLODs>* lods = nullptr,
+               const std::vector<std::vector<Meshlet>>* meshlets = nullptr,
+               const MeshInstancing* instancing = nullptr);
+    void update(const TransformCache& transforms);
+    // mesh indices(scene.getMeshes() order) sorted by state
+    [[nodiscard]] const std::vector<int>& getOpaqueDraws() const {
+        return m_opaqueDraws;
+    }
+    [[nodiscard]] const std::vector<int>& getBlendDraws() const {
+        return m_blendDraws;
+    }
+    // -1 if the mesh is not part of the packed scene
+    [[nodiscard]] int getIndex(const loo::Mesh* mesh) const;
+    [[nodiscard]] bool empty() const { return m_meshes.empty(); }
+    // draws keep their order, bindMaterial false merges runs regardless of
+    // textures(depth only passes)
+    void draw(const std::vector<int>& draws, loo::ShaderProgram& sp,
+              bool cullBackFaces = true, bool bindMaterial = true);
+    // draw() split in two so that the commands can be edited on the GPU in
+    // between(instance count 0 skips a draw). No ring allocation may happen
+    // between the two calls, the material blocks of the draws are pushed by
+    // writeCommands when bindMaterial is set. clusterOutput commands draw the
+    // compaction region of the meshes with a count of 0, for drawsClusters()
+    // meshes. countStatistics false leaves getDraws() and friends alone, for
+    // draws submitted again in the same frame.
+    UniformRange writeCommands(const std::vector<int>& draws,
+                               bool clusterOutput = false,
+                               bool bindMaterial = true);
+    void submitCommands(const std::vector<int>& draws,
+                        const UniformRange& commands, loo::ShaderProgram& sp,
+                        bool cullBackFaces = true, bool bindMaterial = true,
+                        bool countStatistics = true);
+    // LOD level per mesh of the following commands, null draws the full
+    // meshes
+    void setLODLevels(const std::vector<uint8_t>* levels) {
+        m_lodLevels = levels;
+    }
+    // binds the buffers read through a command range: per draw data, mesh
+    // indices and materials
+    void bindCommandInputs(const UniformRange& commands, size_t count) const;
+    // ShaderMeshBounds per mesh
+    [[nodiscard]] GLuint getBoundsBuffer() const { return m_boundsBuffer; }
+    // split into meshlets and drawn at level 0
+    [[nodiscard]] bool drawsClusters(int mesh) const {
+        return m_meshes[mesh].clusterCount > 0 && getLevelIndex(mesh) == 0;
+    }
+    // ShaderCluster per meshlet, ShaderMeshClusters per mesh
+    [[nodiscard]] GLuint getClusterBuffer() const { return m_clusterBuffer; }
+    [[nodiscard]] GLuint getMeshClusterBuffer() const {
+        return m_meshClusterBuffer;
+    }
+    // static indices, read by cluster culling as packed 16 bit pairs when
+    // the index type is GL_UNSIGNED_SHORT
+    [[nodiscard]] GLuint getIndexBuffer() const { return m_indexBuffer; }
+    [[nodiscard]] GLenum getIndexType() const { return m_indexType; }
+    // compaction regions, always 32 bit
+    [[nodiscard]] GLuint getClusterIndexBuffer() const {
+        return m_clusterIndexBuffer;
+    }
+    // meshlets of the most clustered mesh
+    [[nodiscard]] int getMaxClusters() const { return m_maxClusters; }
+    [[nodiscard]] int getMeshCount() const {
+        return static_cast<int>(m_meshes.size());
+    }
+
+    // since the last update()
+    [[nodiscard]] int getDraws() const { return m_draws; }
+    [[nodiscard]] int getDrawCalls() const { return m_drawCalls; }
+    // at the submitted LOD levels, before GPU culling
+    [[nodiscard]] int getTriangles() const { return m_triangles; }
+
+   private:
+    struct MeshEntry {
+        struct Level {
+            GLuint count;
+            GLuint firstIndex;
+        };
+        // level 0 is the full mesh
+        Level levels[MESH_LOD_COUNT];
+        int levelCount;
+        GLint baseVertex;
+        int materialIndex;
+        // meshes sharing a texture set
+        int bindGroup;
+        bool doubleSided;
+        bool alphaBlend;
+        PBRMetallicMaterial* material;
+        GLuint vertexFlags;
+        PositionQuantization quantization;
+        // 0 if the mesh is not split into meshlets
+        GLuint clusterCount;
+        // compaction region in the cluster index buffer
+        GLuint clusterFirstIndex;
+    };
+    void release();
+    void uploadDrawData();
+    [[nodiscard]] int getLevelIndex(int mesh) const;
+    [[nodiscard]] const MeshEntry::Level& getLevel(int mesh) const {
+        return m_meshes[mesh].levels[getLevelIndex(mesh)];
+    }
+
+    GLuint m_vao{0}, m_vertexBuffer{0}, m_skinBuffer{0}, m_indexBuffer{0};
+    GLuint m_clusterIndexBuffer{0};
+    GLenum m_indexType{GL_UNSIGNED_INT};
+    GLuint m_materialBuffer{0}, m_boundsBuffer{0};
+    GLuint m_clusterBuffer{0}, m_meshClusterBuffer{0};
+    int m_maxClusters{0};
+    std::vector<MeshEntry> m_meshes;
+    std::unordered_map<const loo::Mesh*, int> m_meshIndices;
+    std::vector<int> m_opaqueDraws, m_blendDraws;
+    std::vector<ShaderDrawData> m_drawData;
+    UniformRange m_drawDataRange{};
+    uint64_t m_drawDataEpoch{0};
+    // epoch of the last writeCommands, submitCommands checks it
+    uint64_t m_commandsEpoch{0};
+    // the last writeCommands drew the compaction regions
+    bool m_commandsClusterOutput{false};
+    const std::vector<uint8_t>* m_lodLevels{nullptr};
+    int m_draws{0}, m_drawCalls{0}, m_triangles{0};
+};
+
+#endif /* RENDERLOO_INCLUDE_CORE_MULTI_DRAW_HPP */
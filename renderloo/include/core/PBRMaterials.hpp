@@ -7,6 +7,8 @@
 #include <loo/Material.hpp>
 #include <memory>
 #include "constants.hpp"
+#include "core/ContentRegistry.hpp"
+#include "core/UniformRing.hpp"
 
 #include <assimp/types.h>
 #include <loo/Texture.hpp>
@@ -31,6 +33,9 @@ class PBRMetallicMaterial : public loo::Material {
     ShaderPBRMetallicMaterial m_shadermaterial;
     static std::shared_ptr<PBRMetallicMaterial> defaultMaterial;
     unsigned int m_flags;
+    // parameter block of the current frame, see UniformRing::getEpoch
+    UniformRange m_uniformRange{};
+    uint64_t m_uniformEpoch{0};
 
    public:
     ShaderPBRMetallicMaterial& getShaderMaterial() { return m_shadermaterial; }
@@ -49,6 +54,11 @@ class PBRMetallicMaterial : public loo::Material {
         return m_flags & loo::LOO_MATERIAL_FLAG_DOUBLE_SIDED;
     }
     void bind(const loo::ShaderProgram& sp) override;
+    // parameter block in the uniform ring, pushed on the first call of a
+    // frame
+    const UniformRange& getUniformRange();
+    // equal for materials that render the same, see ContentRegistry
+    [[nodiscard]] MaterialContentKey getContentKey() const;
     std::shared_ptr<loo::Texture2D> baseColorTex{};
     std::shared_ptr<loo::Texture2D> occlusionTex{};
     std::shared_ptr<loo::Texture2D> metallicTex{};
@@ -0,0 +1,51 @@
+#ifndef RENDERLOO_INCLUDE_CORE_PROFILER_HPP
+#define RENDERLOO_INCLUDE_CORE_PROFILER_HPP
+#include <deque>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+constexpr int GPU_PROFILER_FRAMES_IN_FLIGHT = 4;
+constexpr int GPU_PROFILER_HISTORY_SIZE = 600;
+
+struct GPUPassTiming {
+    std::string name;
+    // nesting level of the scope, 0 for top level passes
+    int depth;
+    double milliseconds;
+};
+struct GPUFrameTimings {
+    unsigned int frame{0};
+    std::vector<GPUPassTiming> passes;
+};
+/**
+ * GPU pass timer
+ * Every beginEvent/endEvent scope emits a debug marker and records two
+ * GL_TIMESTAMP queries into the slot of the current frame. Slots are reused
+ * after GPU_PROFILER_FRAMES_IN_FLIGHT frames, results are only fetched when
+ * they are already available(otherwise the frame is dropped), so reading
+ * timings never stalls the pipeline.
+ */
+class GPUProfiler {
+   public:
+    static void beginEvent(const std::string& name);
+    static void endEvent();
+    // close the current frame and open the next one
+    static void newFrame();
+    // resolve every frame in flight, call after glFinish()
+    static void flush();
+
+    // latest frame whose results are available
+    static const GPUFrameTimings& getLatest();
+    static const std::deque<GPUFrameTimings>& getHistory();
+    static void clearHistory();
+    static int getDroppedFrames();
+
+    static bool exportCSV(const std::filesystem::path& filename);
+    static bool exportJSON(const std::filesystem::path& filename);
+
+    static void setEnabled(bool enabled);
+    static bool isEnabled();
+};
+
+#endif /* RENDERLOO_INCLUDE_CORE_PROFILER_HPP */
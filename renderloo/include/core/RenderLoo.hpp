@@ -17,8 +17,20 @@
 #include <memory>
 #include <string>
 #include <vector>
+#include "core/Culling.hpp"
+#include "core/FrameCapture.hpp"
+#include "core/GeometryArena.hpp"
+#include "core/Headless.hpp"
+#include "core/Instancing.hpp"
 #include "core/Light.hpp"
+#include "core/MeshLOD.hpp"
+#include "core/ModelLoader.hpp"
+#include "core/MultiDraw.hpp"
+#include "core/RenderQueue.hpp"
 #include "core/Skybox.hpp"
+#include "core/SoftwareOcclusion.hpp"
+#include "core/TransformCache.hpp"
+#include "passes/ClusterCullingPass.hpp"
 #include "passes/ShadowMapPass.hpp"
 #include "passes/TransparentPass.hpp"
 
@@ -29,6 +41,7 @@
 #include "core/FinalProcess.hpp"
 #include "passes/BloomPass.hpp"
 #include "passes/DebugOutputPass.hpp"
+#include "passes/OcclusionCullingPass.hpp"
 
 enum RenderFlag {
     RenderFlag_Opaque = 1 << 0,
@@ -47,22 +60,59 @@ class RenderLoo : public loo::Application {
    public:
     RenderLoo(int width, int height);
     void handleDrop(const std::string& paths);
-    // only load model
+    // only load model, blocks until the new scene is in place
     void loadModel(const std::string& filename);
+    // the current scene keeps rendering until the new one is ready
+    void loadModelAsync(const std::string& filename);
     void loadSkybox(const std::string& filename);
     loo::PerspectiveCamera& getMainCamera() { return *m_mainCamera; }
     auto getMainCameraMode() const { return m_cameraMode; }
+    void setCameraPose(const CameraPose& pose, float fov, float zNear,
+                       float zFar);
+    loo::Scene& getScene() { return m_scene; }
+    // render without presenting, frames go to an offscreen target
+    HeadlessStats runHeadless(const HeadlessOptions& options);
+    // append every following frame to a sequence, animation then advances
+    // by 1/fps per frame instead of the wall clock
+    void startRecording(const std::filesystem::path& path,
+                        SequenceFormat format, int fps);
+    void stopRecording();
+    [[nodiscard]] bool isRecording() const { return bool(m_frameSequence); }
     void afterCleanup() override;
-    void convertMaterial();
+    static void convertMaterial(loo::Scene& scene);
     void clear();
 
    private:
     void initGBuffers();
     void initDeferredPass();
     void initVelocity();
+    void initOffscreenOutput();
 
     void loop() override;
-    void animation();
+    void renderFrame(float deltaTime);
+    // replaces the scene with a loaded and converted one
+    void setScene(loo::Scene&& scene, SceneMeshData&& meshData = {});
+    // levels of the main view or of the shadow passes
+    void setLODLevels(const std::vector<uint8_t>* levels) {
+        m_renderQueue.setLODLevels(levels);
+        m_multiDraw.setLODLevels(levels);
+    }
+    // nullptr when meshes are drawn one by one
+    MultiDrawScene* multiDraw() {
+        return m_enableMultiDraw && !m_multiDraw.empty() ? &m_multiDraw
+                                                         : nullptr;
+    }
+    // nullptr when every mesh is drawn
+    const MeshVisibility* visibility() const {
+        if (m_enableSoftwareOcclusion)
+            return &m_softwareOcclusion.getVisibility();
+        return m_enableFrustumCulling ? &m_frustumCuller.getVisibility()
+                                      : nullptr;
+    }
+    // fixed timestep while recording
+    float frameDeltaTime();
+    void recordFrame();
+    void animation(float deltaTime);
     void gui() override;
     void scene(loo::ShaderProgram& shader, RenderFlag flag = RenderFlag_All);
     void skyboxPass();
@@ -89,14 +139,38 @@ class RenderLoo : public loo::Application {
     void finalScreenPass(const loo::Texture2D& texture);
     void keyboard();
     void mouse();
-    void saveScreenshot(std::filesystem::path filename) const;
+    void saveScreenshot(const std::filesystem::path& filename);
 
     loo::ShaderProgram m_baseshader;
     loo::Scene m_scene;
+    ModelLoader m_modelLoader;
+    TransformCache m_transforms;
+    LODSelector m_lodSelector;
+    // copies share geometry, neighbouring per mesh draws become instanced
+    MeshInstancing m_instancing;
+    bool m_enableInstancing{true};
+    MultiDrawScene m_multiDraw;
+    // per mesh path
+    GeometryArena m_geometryArena;
+    RenderQueue m_renderQueue;
+    FrustumCuller m_frustumCuller;
+    bool m_enableFrustumCulling{true};
+    // CPU occlusion culling on top of the frustum test
+    SoftwareOcclusionCuller m_softwareOcclusion;
+    bool m_enableSoftwareOcclusion{false};
+    // multi draw lists filtered by visibility
+    std::vector<int> m_visibleDraws;
+    bool m_enableMultiDraw{true};
     Skybox m_skybox;
 
     CameraMode m_cameraMode{CameraMode::ArcBall};
     std::unique_ptr<loo::PerspectiveCamera> m_mainCamera;
+    // camera of the last rendered frame, for velocity and TAA
+    glm::mat4 m_prevView{1.0f}, m_prevProjection{1.0f};
+    // camera path recording, replayed by headless mode and the benchmark
+    bool m_recordingCameraPath{false};
+    float m_cameraPathTimer{0.f};
+    std::vector<CameraPose> m_recordedCameraPath;
 
     std::vector<ShaderLight> m_lights;
 
@@ -105,6 +179,13 @@ class RenderLoo : public loo::Application {
     // gbuffer
     GBuffer m_gbuffers;
     loo::Framebuffer m_gbufferfb;
+    // multi draw path only
+    OcclusionCullingPass m_occlusionCullingPass;
+    bool m_enableOcclusionCulling{true};
+    ClusterCullingPass m_clusterCullingPass;
+    bool m_enableClusterCulling{true};
+    // last frame's pyramid, may drop a revealed meshlet for a frame
+    bool m_enableClusterOcclusion{false};
     // ambient occlusion
     AOMethod m_aomethod{AOMethod::SSAO};
     SSAO m_ssao;
@@ -128,6 +209,14 @@ class RenderLoo : public loo::Application {
     DebugOutputPass m_debugOutputPass;
 
     std::unique_ptr<loo::Texture2D> m_velocityTexture;
+    AsyncFrameCapture m_frameCapture;
+    // continuous capture: LDR final frame, or HDR scene color for EXR
+    std::shared_ptr<FrameSequenceWriter> m_frameSequence;
+    SequenceFormat m_sequenceFormat{SequenceFormat::Y4M};
+    int m_sequenceFPS{60};
+    // headless output, replaces the default framebuffer when present
+    loo::Framebuffer m_offscreenfb;
+    std::unique_ptr<loo::Texture2D> m_offscreenOutput;
 
     bool m_wireframe{false};
     bool m_enablenormal{true};
@@ -0,0 +1,172 @@
+#ifndef RENDERLOO_INCLUDE_CORE_RENDER_QUEUE_HPP
+#define RENDERLOO_INCLUDE_CORE_RENDER_QUEUE_HPP
+#include <glad/glad.h>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <loo/Scene.hpp>
+#include <loo/Shader.hpp>
+#include <vector>
+#include "core/Culling.hpp"
+#include "core/GeometryArena.hpp"
+#include "core/SortKey.hpp"
+#include "core/TransformCache.hpp"
+
+class MeshInstancing;
+
+enum RenderItemFlag : uint32_t {
+    RenderItem_AlphaBlend = 1 << 0,
+    RenderItem_DoubleSided = 1 << 1,
+};
+
+struct RenderItem {
+    uint64_t sortKey;
+    const loo::Mesh* mesh;
+    // in scene.getMeshes()
+    uint32_t meshIndex;
+    uint32_t flags;
+};
+
+struct RenderStateCounters {
+    int draws{0};
+    // meshes drawn as instances, every instanced draw counts once in draws
+    int instancedMeshes{0};
+    // at the drawn LOD levels
+    int triangles{0};
+    // state changes issued / skipped because the state was already set
+    int cullChanges{0}, cullSkipped{0};
+    int vertexArrayBinds{0}, vertexArraySkipped{0};
+    int materialBinds{0}, materialSkipped{0};
+    [[nodiscard]] int skipped() const {
+        return cullSkipped + vertexArraySkipped + materialSkipped;
+    }
+};
+
+/**
+ * Shadow of the GL state touched by mesh draws
+ * Binds that match the current state are skipped and counted. The state
+ * is unknown after other passes ran, call reset() before every submission.
+ */
+class RenderStateCache {
+   public:
+    void reset();
+    void setCullFace(bool backFaceCulling);
+    void bindVertexArray(GLuint vao);
+    void bindMaterial(loo::Material& material, const loo::ShaderProgram& sp);
+    RenderStateCounters counters;
+
+   private:
+    // -1: unknown
+    int m_cullFace{-1};
+    GLuint m_vertexArray{0};
+    bool m_vertexArrayKnown{false};
+    const loo::Material* m_material{nullptr};
+};
+
+/**
+ * Instance gathering of sorted render items
+ * Items whose keys differ only in depth form a run of equal state. gather()
+ * moves the copies of a prototype next to its front most item in the run,
+ * a stable counting sort by that item keeps the state order and every
+ * other item in place. CPU only, the scratch is reused between calls.
+ */
+class InstanceGatherer {
+   public:
+    // prototypes are indexed by RenderItem::meshIndex, the mesh itself if
+    // it has no earlier copy
+    void gather(std::vector<RenderItem>& items,
+                const std::vector<uint32_t>& prototypes);
+
+   private:
+    // first item of a prototype in the current run of equal state
+    struct FirstInstance {
+        uint32_t runStart, item;
+    };
+    // per mesh, runStart is UINT32_MAX between gather() calls
+    std::vector<FirstInstance> m_firstInstance;
+    std::vector<uint32_t> m_itemRanks, m_rankOffsets;
+    std::vector<RenderItem> m_gathered;
+};
+
+// end of the instanced draw starting at items[first]: the following copies
+// of the same prototype at the same LOD level. lodLevels may be null.
+[[nodiscard]] size_t findInstanceRunEnd(const std::vector<RenderItem>& items,
+                                        size_t first,
+                                        const std::vector<uint32_t>& prototypes,
+                                        const std::vector<uint8_t>* lodLevels);
+
+enum class RenderQueuePass : uint32_t {
+    Opaque = 0,
+    // depth only, materials are not bound
+    ShadowOpaque = 1,
+    ShadowAlphaTest = 2,
+};
+
+/**
+ * Sorted per mesh submission
+ * setScene() caches the mesh flags(no virtual calls per frame) and gives
+ * materials and vertex arrays compact ids, transforms are read from the
+ * cache given there. build() collects the meshes of
+ * a pass into render items with a 64 bit sort key(see core/SortKey.hpp):
+ * grouped by cull mode, material and VAO, then front to back along the
+ * view axis. submit() draws them while skipping redundant state changes.
+ * Meshes of a GeometryArena are drawn from its shared vertex arrays.
+ * Copies found by MeshInstancing sort like their prototype, build() moves
+ * them next to its first item of the same state and submit() draws
+ * consecutive copies at the same LOD level as one instanced draw.
+ */
+class RenderQueue {
+   public:
+    // transforms and geometry must outlive the queue or the next
+    // setScene(), geometry and instancing may be null
+    void setScene(const loo::Scene& scene, const TransformCache& transforms,
+                  const GeometryArena* geometry = nullptr,
+                  const MeshInstancing* instancing = nullptr);
+    // opaque/blend select the meshes by their alpha blend flag, meshes
+    // marked invisible are skipped
+    const std::vector<RenderItem>& build(
+        RenderQueuePass pass, const glm::vec3& viewOrigin,
+        const glm::vec3& viewAxis, bool opaque, bool blend,
+        const MeshVisibility* visibility = nullptr);
+    // draws the items of the last build()
+    void submit(loo::ShaderProgram& sp, bool cullBackFaces = true);
+    // LOD level per mesh of the following submissions, null draws the full
+    // meshes. Only meshes of the GeometryArena have levels.
+    void setLODLevels(const std::vector<uint8_t>* levels) {
+        m_lodLevels = levels;
+    }
+    // merge copies into instanced draws, on by default
+    void setInstancing(bool enable) { m_enableInstancing = enable; }
+    // move the counters of the finished frame to getLastFrameCounters()
+    void newFrame();
+    [[nodiscard]] const RenderStateCounters& getLastFrameCounters() const {
+        return m_lastFrameCounters;
+    }
+
+   private:
+    struct MeshEntry {
+        const loo::Mesh* mesh;
+        uint32_t flags;
+        uint32_t materialId, vertexArrayId;
+        // null if the mesh is drawn from its own VAO
+        const GeometryDraw* geometry;
+    };
+    [[nodiscard]] int getLODLevel(uint32_t meshIndex) const {
+        return m_lodLevels ? (*m_lodLevels)[meshIndex] : 0;
+    }
+    std::vector<MeshEntry> m_meshes;
+    // per mesh, in m_meshes, the mesh itself if it has no earlier copy
+    std::vector<uint32_t> m_prototypes;
+    std::vector<RenderItem> m_items;
+    // per item, reused to normalize the depth field
+    std::vector<float> m_depths;
+    bool m_hasInstances{false}, m_enableInstancing{true};
+    InstanceGatherer m_gatherer;
+    std::vector<uint32_t> m_instanceMeshes;
+    const TransformCache* m_transforms{nullptr};
+    const std::vector<uint8_t>* m_lodLevels{nullptr};
+    bool m_bindMaterial{true};
+    RenderStateCache m_state;
+    RenderStateCounters m_lastFrameCounters;
+};
+
+#endif /* RENDERLOO_INCLUDE_CORE_RENDER_QUEUE_HPP */
@@ -0,0 +1,104 @@
+#ifndef RENDERLOO_INCLUDE_CORE_SCENE_CACHE_HPP
+#define RENDERLOO_INCLUDE_CORE_SCENE_CACHE_HPP
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <loo/Scene.hpp>
+#include <optional>
+#include <vector>
+#include "core/MeshLOD.hpp"
+#include "core/MeshOptimizer.hpp"
+#include "core/Meshlet.hpp"
+
+constexpr uint32_t SCENE_CACHE_MAGIC = 0x4353524c;  // "LRSC"
+// bump on any change of the layout below or of what is stored
+constexpr uint32_t SCENE_CACHE_VERSION = 7;
+// sections start on a page boundary, they are uploaded from the mapping
+constexpr uint64_t SCENE_CACHE_ALIGNMENT = 4096;
+
+// identity of the source file. The hash covers the main file only, the
+// buffers and images a .gltf refers to change dependencies: the size and
+// mtime of every other file below its directory(0 for a .glb).
+struct SceneCacheKey {
+    uint64_t hash{0};
+    uint64_t size{0};
+    int64_t time{0};
+    uint64_t dependencies{0};
+};
+std::optional<SceneCacheKey> makeSceneCacheKey(
+    const std::filesystem::path& source);
+
+struct SceneCacheSection {
+    uint64_t offset{0}, size{0};
+};
+
+/**
+ * File layout: this header, then the page aligned sections
+ * - meta: meshes, materials and textures, read sequentially
+ * - vertices, indices: the vertex and index arrays of every mesh, the
+ *   indices of its LOD levels follow
+ * - pixels: every level of every texture, RGBA8, mips generated with the
+ *   box filter on write. Material textures are block compressed through
+ *   the texture cache from level 0, the others are uploaded as stored.
+ * Everything is in native byte order and layout, vertexSize catches most
+ * layout changes of loo::Vertex.
+ */
+struct SceneCacheHeader {
+    uint32_t magic{SCENE_CACHE_MAGIC};
+    uint32_t version{SCENE_CACHE_VERSION};
+    SceneCacheKey key;
+    uint32_t vertexSize{0};
+    uint32_t meshCount{0}, materialCount{0}, textureCount{0};
+    SceneCacheSection meta, vertices, indices, pixels;
+};
+
+// dependencies and size match, then mtime or the content hash
+bool isSceneCacheKeyValid(const SceneCacheKey& cached,
+                          const std::filesystem::path& source);
+// a file per source path in the cache directory
+std::filesystem::path getSceneCachePath(const std::filesystem::path& source);
+
+// GL context required. Animated scenes are not cached, the animation
+// belongs to the importer. optimized holds the statistics of
+// optimizeSceneMeshes and lods the levels of generateSceneLODs, both
+// stored per mesh.
+bool writeSceneCache(
+    const loo::Scene& scene, const std::filesystem::path& source,
+    const std::vector<MeshOptimizationStatistics>& optimized = {},
+    const std::vector<MeshLODs>& lods = {});
+// progress and step times of a loadSceneCache(), the counters may be read
+// from another thread while it runs
+struct SceneCacheLoadStatus {
+    // a step per texture(compressed or uploaded) and per mesh
+    std::atomic<int> stepsDone{0}, steps{0};
+    // milliseconds: mapping and the meta section, texture preparation and
+    // uploads, mesh buffers and vertex arrays
+    float mapping{0.f}, textures{0.f}, buffers{0.f};
+};
+// nullopt if there is no valid cache for source, lods receives the levels
+// of every mesh
+std::optional<loo::Scene> loadSceneCache(
+    const std::filesystem::path& source,
+    std::vector<MeshLODs>* lods = nullptr,
+    SceneCacheLoadStatus* status = nullptr);
+// GL context required. Textures of the materials with the same decoded
+// pixels and sampling state are replaced by the first of them, logs the
+// memory saved.
+void deduplicateSceneTextures(loo::Scene& scene);
+// per mesh results of an import, indexed like scene.getMeshes()
+struct SceneMeshData {
+    std::vector<MeshLODs> lods;
+    std::vector<std::vector<Meshlet>> meshlets;
+    // hashSceneGeometry(), for MeshInstancing
+    std::vector<uint64_t> geometryHashes;
+};
+// createSceneFromFile through the cache. On a miss the meshes are
+// optimized and simplified into LOD levels, then cached and loaded back
+// from the cache so that every import is alike. meshlets and geometry
+// hashes are computed from the cached data on every import, both are cheap.
+// status follows the scene cache load, if there is one.
+loo::Scene importScene(const std::string& filename,
+                       SceneMeshData* meshData = nullptr,
+                       SceneCacheLoadStatus* status = nullptr);
+
+#endif /* RENDERLOO_INCLUDE_CORE_SCENE_CACHE_HPP */
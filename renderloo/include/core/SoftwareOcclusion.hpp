@@ -0,0 +1,107 @@
+#ifndef RENDERLOO_INCLUDE_CORE_SOFTWARE_OCCLUSION_HPP
+#define RENDERLOO_INCLUDE_CORE_SOFTWARE_OCCLUSION_HPP
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <loo/Scene.hpp>
+#include <vector>
+#include "core/Culling.hpp"
+
+// low resolution occlusion buffer, the width is a multiple of 4(SIMD)
+constexpr int SOFTWARE_OCCLUSION_WIDTH = 256;
+constexpr int SOFTWARE_OCCLUSION_HEIGHT = 128;
+// rows rasterized by one task
+constexpr int SOFTWARE_OCCLUSION_BAND_HEIGHT = 8;
+constexpr int SOFTWARE_OCCLUSION_MAX_OCCLUDERS = 64;
+// larger meshes are too expensive to rasterize every frame
+constexpr int SOFTWARE_OCCLUSION_MAX_OCCLUDER_TRIANGLES = 4096;
+
+// screen space triangle ready for rasterization
+struct OcclusionTriangle {
+    // a * x + b * y + c >= 0 for pixel centers inside the triangle
+    float a[3], b[3], c[3];
+    // conservative(farthest within a pixel) depth plane, clamped to zMin
+    float zx, zy, z0, zMin;
+    int minX, maxX, minY, maxY;
+};
+
+// pixel centers at +0.5, depth is reverse-Z [0, 1]
+bool setupOcclusionTriangle(const glm::vec3& v0, const glm::vec3& v1,
+                            const glm::vec3& v2, OcclusionTriangle& triangle);
+// rasterize rows [rowBegin, rowEnd) of the triangle into the buffer(width
+// SOFTWARE_OCCLUSION_WIDTH) keeping the nearest(largest) depth
+void rasterizeOcclusionTriangle(const OcclusionTriangle& triangle,
+                                int rowBegin, int rowEnd, float* depth);
+// rows [rowBegin, rowEnd) of one pass of the 3x3 minimum that shrinks the
+// occluders by a pixel(clamped at the borders): horizontal from depth to
+// scratch, then vertical from scratch back to depth once every row of
+// scratch is written. A pixel keeps a depth only if its neighbours are
+// covered too, so a pixel whose center is covered but not its whole area
+// never occludes.
+void erodeOcclusionRows(const float* depth, int rowBegin, int rowEnd,
+                        float* scratch);
+void erodeOcclusionColumns(const float* scratch, int rowBegin, int rowEnd,
+                           float* depth);
+// true if every pixel of the rectangle holds an occluder nearer than depth
+bool isRectOccluded(const float* buffer, int minX, int minY, int maxX,
+                    int maxY, float depth);
+
+struct SoftwareOcclusionStatistics {
+    int occluders{0}, triangles{0};
+    int tested{0}, occluded{0};
+    float milliseconds{0.f};
+};
+
+/**
+ * CPU occlusion culling
+ * setScene() picks the largest opaque meshes with a small triangle count
+ * as occluders. Every frame their triangles are rasterized into a low
+ * resolution depth buffer with pixel center coverage and conservative
+ * depth, in bands of rows spread over the job system. The covered area is
+ * then shrunk by a pixel, which keeps the coverage conservative without
+ * opening cracks along the shared edges of a mesh. Finally the boxes of
+ * the meshes that passed the frustum test are tested against it. Nothing
+ * is read back from the GPU, so it behaves the same on software GL drivers.
+ */
+class SoftwareOcclusionCuller {
+   public:
+    SoftwareOcclusionCuller();
+
+    // skinned meshes(see findSkinnedMeshes()) neither occlude nor get
+    // culled
+    // transforms: updated for the scene, by both calls
+    void setScene(const loo::Scene& scene, const TransformCache& transforms,
+                  const std::vector<uint8_t>& skinned = {});
+    // frustum: meshes already culled, nullptr if every mesh is a candidate
+    void cull(const loo::Scene& scene, const TransformCache& transforms,
+              const glm::mat4& viewProjection, const MeshVisibility* frustum);
+    [[nodiscard]] const MeshVisibility& getVisibility() const {
+        return m_visibility;
+    }
+    [[nodiscard]] const std::vector<float>& getDepthBuffer() const {
+        return m_depth;
+    }
+    [[nodiscard]] const SoftwareOcclusionStatistics& getStatistics() const {
+        return m_statistics;
+    }
+
+   private:
+    struct Occluder {
+        int mesh;
+        size_t firstVertex, vertexCount;
+        size_t firstIndex, indexCount;
+    };
+    std::vector<Occluder> m_occluders;
+    std::vector<glm::vec3> m_occluderVertices;
+    std::vector<uint32_t> m_occluderIndices;
+    // per frame
+    std::vector<glm::vec4> m_clipVertices;
+    std::vector<OcclusionTriangle> m_triangles;
+    std::vector<std::vector<uint32_t>> m_bands;
+    std::vector<float> m_depth, m_erodeScratch;
+    AABBBatch m_bounds;
+    std::vector<uint8_t> m_skinned;
+    MeshVisibility m_visibility;
+    SoftwareOcclusionStatistics m_statistics;
+};
+
+#endif /* RENDERLOO_INCLUDE_CORE_SOFTWARE_OCCLUSION_HPP */
@@ -0,0 +1,45 @@
+#ifndef RENDERLOO_INCLUDE_CORE_SORT_KEY_HPP
+#define RENDERLOO_INCLUDE_CORE_SORT_KEY_HPP
+#include <cstdint>
+
+// 64 bit draw sort key, most significant field first:
+// pass(3) | cull mode(1) | material(20) | vertex array(20) | depth(20)
+// so that sorting groups draws by the most expensive state change
+constexpr int SORT_KEY_PASS_BITS = 3;
+constexpr int SORT_KEY_MATERIAL_BITS = 20;
+constexpr int SORT_KEY_VERTEX_ARRAY_BITS = 20;
+constexpr int SORT_KEY_DEPTH_BITS = 20;
+
+constexpr uint64_t sortKeyField(uint64_t value, int bits, int shift) {
+    return (value & ((uint64_t(1) << bits) - 1)) << shift;
+}
+
+// material and vertex array are compact ids, not GL names or pointers
+constexpr uint64_t makeSortKey(uint32_t pass, bool doubleSided,
+                               uint32_t material, uint32_t vertexArray,
+                               uint32_t depth) {
+    constexpr int depthShift = 0;
+    constexpr int vertexArrayShift = depthShift + SORT_KEY_DEPTH_BITS;
+    constexpr int materialShift =
+        vertexArrayShift + SORT_KEY_VERTEX_ARRAY_BITS;
+    constexpr int cullShift = materialShift + SORT_KEY_MATERIAL_BITS;
+    constexpr int passShift = cullShift + 1;
+    return sortKeyField(pass, SORT_KEY_PASS_BITS, passShift) |
+           sortKeyField(doubleSided, 1, cullShift) |
+           sortKeyField(material, SORT_KEY_MATERIAL_BITS, materialShift) |
+           sortKeyField(vertexArray, SORT_KEY_VERTEX_ARRAY_BITS,
+                        vertexArrayShift) |
+           sortKeyField(depth, SORT_KEY_DEPTH_BITS, depthShift);
+}
+
+// normalized depth in [0, 1] to the depth field, clamped
+inline uint32_t quantizeSortDepth(float depth) {
+    constexpr float maxDepth = float((1u << SORT_KEY_DEPTH_BITS) - 1);
+    if (!(depth > 0.0f))
+        return 0;
+    if (depth >= 1.0f)
+        return static_cast<uint32_t>(maxDepth);
+    return static_cast<uint32_t>(depth * maxDepth + 0.5f);
+}
+
+#endif /* RENDERLOO_INCLUDE_CORE_SORT_KEY_HPP */
@@ -0,0 +1,16 @@
+#ifndef RENDERLOO_INCLUDE_CORE_STATISTICS_HPP
+#define RENDERLOO_INCLUDE_CORE_STATISTICS_HPP
+#include <vector>
+
+struct SampleSummary {
+    int count{0};
+    double mean{0.0}, min{0.0}, max{0.0};
+    double p50{0.0}, p95{0.0}, p99{0.0};
+};
+
+// linearly interpolated percentile, p in [0, 100]
+double percentile(std::vector<double> samples, double p);
+
+SampleSummary summarize(const std::vector<double>& samples);
+
+#endif /* RENDERLOO_INCLUDE_CORE_STATISTICS_HPP */
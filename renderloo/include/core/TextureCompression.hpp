@@ -0,0 +1,90 @@
+#ifndef RENDERLOO_INCLUDE_CORE_TEXTURE_COMPRESSION_HPP
+#define RENDERLOO_INCLUDE_CORE_TEXTURE_COMPRESSION_HPP
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <loo/Texture.hpp>
+#include <memory>
+#include <optional>
+#include <vector>
+#include "core/MappedFile.hpp"
+#include "core/TextureLoader.hpp"
+
+// what a material samples from a texture, decides the block format
+enum class TextureRole : uint8_t {
+    Other,
+    // base color, emissive: BC7
+    Color,
+    // tangent space xy, z is rebuilt by the shaders: BC5
+    Normal,
+    // single channels of the(usually packed) maps: BC4
+    Metallic,
+    Roughness,
+    Occlusion,
+};
+
+enum class BlockFormat : uint8_t { BC4, BC5, BC7, BC7SRGB };
+
+constexpr size_t getBlockBytes(BlockFormat format) {
+    return format == BlockFormat::BC4 ? 8 : 16;
+}
+GLenum getBlockInternalFormat(BlockFormat format);
+// nullopt: the role stays uncompressed
+std::optional<BlockFormat> getRoleBlockFormat(TextureRole role, bool srgb);
+// channel a single channel role reads(the glTF packing: occlusion r,
+// roughness g, metallic b), the shaders keep reading it through a swizzle
+int getRoleChannel(TextureRole role);
+
+// 4x4 texels, row major
+void encodeBC4Block(const uint8_t values[16], uint8_t block[8]);
+void decodeBC4Block(const uint8_t block[8], uint8_t values[16]);
+// mode 6 only(one subset, RGBA, 4 bit indices), false for other modes
+void encodeBC7Block(const uint8_t rgba[64], uint8_t block[16]);
+bool decodeBC7Block(const uint8_t block[16], uint8_t rgba[64]);
+// RGBA8 level to blocks, edge blocks repeat the last row and column.
+// channel is the source of BC4, BC5 takes r and g.
+void compressLevel(const uint8_t* pixels, int width, int height,
+                   BlockFormat format, int channel, uint8_t* blocks);
+
+/**
+ * Block compressed level 0 and mips
+ * Either freshly compressed or mapped from the on-disk cache, which is
+ * keyed by the hash of the uncompressed level 0, the format and the
+ * channel.
+ */
+class CompressedTexture {
+   public:
+    // mips are the uncompressed levels below level 0
+    static CompressedTexture compress(const uint8_t* pixels, int width,
+                                      int height, const MipChain& mips,
+                                      BlockFormat format, int channel);
+    // nullopt if absent or not matching
+    static std::optional<CompressedTexture> load(uint64_t hash,
+                                                 BlockFormat format,
+                                                 int channel);
+    bool save(uint64_t hash, int channel) const;
+
+    // GL context required, the swizzle routes channel back to where the
+    // shaders read it
+    [[nodiscard]] std::shared_ptr<loo::Texture2D> createTexture(
+        int channel) const;
+
+    [[nodiscard]] BlockFormat getFormat() const { return m_format; }
+    [[nodiscard]] const std::vector<MipLevel>& getLevels() const {
+        return m_levels;
+    }
+    [[nodiscard]] const uint8_t* getLevel(size_t i) const;
+    [[nodiscard]] size_t getLevelSize(size_t i) const;
+
+   private:
+    BlockFormat m_format{BlockFormat::BC7};
+    // level 0 first, offsets into the blocks
+    std::vector<MipLevel> m_levels;
+    std::vector<uint8_t> m_blocks;
+    // blocks of a cached texture stay in the mapping
+    MappedFile m_file;
+    size_t m_fileOffset{0};
+};
+
+#endif /* RENDERLOO_INCLUDE_CORE_TEXTURE_COMPRESSION_HPP */
@@ -0,0 +1,64 @@
+#ifndef RENDERLOO_INCLUDE_CORE_TEXTURE_LOADER_HPP
+#define RENDERLOO_INCLUDE_CORE_TEXTURE_LOADER_HPP
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <loo/Texture.hpp>
+#include <memory>
+#include <vector>
+
+enum class MipFilter {
+    // 2x2 average
+    Box,
+    // separable 8 tap windowed sinc, sharper minification
+    Kaiser,
+};
+
+struct MipLevel {
+    int width, height;
+    size_t offset;
+};
+// RGBA8 levels below level 0, tightly packed, largest first
+struct MipChain {
+    std::vector<uint8_t> pixels;
+    std::vector<MipLevel> levels;
+    [[nodiscard]] const uint8_t* getLevel(size_t i) const {
+        return pixels.data() + levels[i].offset;
+    }
+};
+
+// down to 1x1, level 0 included
+int countMipLevels(int width, int height);
+[[nodiscard]] bool isSRGBFormat(GLenum internalFormat);
+// RGBA8 to the next level(half size, rounded down, at least 1). sRGB
+// colors are filtered in linear space, alpha always is linear.
+void downsampleRGBA8(const uint8_t* source, int width, int height,
+                     uint8_t* destination, bool srgb, MipFilter filter);
+// levels counts level 0, 0 for the full chain
+MipChain generateMipChain(const uint8_t* pixels, int width, int height,
+                          bool srgb, MipFilter filter = MipFilter::Box,
+                          int levels = 0);
+
+struct DecodedImage {
+    int width{0}, height{0};
+    // RGBA8, empty if decoding failed
+    std::vector<uint8_t> pixels;
+};
+// decodes on the job system, results in the order of paths
+std::vector<DecodedImage> decodeImages(
+    const std::vector<std::filesystem::path>& paths);
+
+// GL context required, the levels of mips are uploaded as they are
+std::shared_ptr<loo::Texture2D> createTextureFromPixels(
+    const uint8_t* pixels, int width, int height, GLenum internalFormat,
+    const MipChain& mips);
+// bytes of levels RGBA8 levels from width x height down, level 0 included
+size_t mipChainBytes(int width, int height, int levels);
+// GL context required, pixels holds level 0 directly followed by the
+// pixels of a MipChain with levels - 1 levels
+std::shared_ptr<loo::Texture2D> createTextureFromLevels(
+    const uint8_t* pixels, int width, int height, GLenum internalFormat,
+    int levels);
+
+#endif /* RENDERLOO_INCLUDE_CORE_TEXTURE_LOADER_HPP */
@@ -0,0 +1,50 @@
+#ifndef RENDERLOO_INCLUDE_CORE_TRANSFORM_CACHE_HPP
+#define RENDERLOO_INCLUDE_CORE_TRANSFORM_CACHE_HPP
+#include <glm/glm.hpp>
+#include <loo/Scene.hpp>
+#include <vector>
+
+// out = a * b
+void multiplyTransforms(const glm::mat4& a, const glm::mat4& b,
+                        glm::mat4& out);
+// transpose(inverse(world)) for affine transforms, the translation row is
+// left out since normals are directions
+void computeNormalMatrix(const glm::mat4& world, glm::mat4& out);
+
+/**
+ * Per mesh world, previous world and normal matrices
+ * update() runs once per frame after the animation and before any pass.
+ * A mesh is only recomputed when the scene model matrix or its object
+ * matrices differ from the values seen by the last update(), so static
+ * meshes cost a compare per frame instead of a 4x4 inverse per draw.
+ * Indexed like scene.getMeshes().
+ */
+class TransformCache {
+   public:
+    void update(const loo::Scene& scene);
+    [[nodiscard]] const glm::mat4& getWorld(size_t mesh) const {
+        return m_world[mesh];
+    }
+    [[nodiscard]] const glm::mat4& getPreviousWorld(size_t mesh) const {
+        return m_prevWorld[mesh];
+    }
+    [[nodiscard]] const glm::mat4& getNormal(size_t mesh) const {
+        return m_normal[mesh];
+    }
+    [[nodiscard]] const glm::mat4& getPreviousNormal(size_t mesh) const {
+        return m_prevNormal[mesh];
+    }
+    [[nodiscard]] size_t size() const { return m_world.size(); }
+    // meshes whose current transforms were recomputed by the last update()
+    [[nodiscard]] int getUpdated() const { return m_updated; }
+
+   private:
+    glm::mat4 m_model{1.0f}, m_prevModel{1.0f};
+    // inputs of the cached values
+    std::vector<glm::mat4> m_objectMatrices, m_prevObjectMatrices;
+    std::vector<glm::mat4> m_world, m_prevWorld;
+    std::vector<glm::mat4> m_normal, m_prevNormal;
+    int m_updated{0};
+};
+
+#endif /* RENDERLOO_INCLUDE_CORE_TRANSFORM_CACHE_HPP */
@@ -0,0 +1,59 @@
+#ifndef RENDERLOO_INCLUDE_CORE_UNIFORM_RING_HPP
+#define RENDERLOO_INCLUDE_CORE_UNIFORM_RING_HPP
+#include <glad/glad.h>
+#include <cstdint>
+#include <cstring>
+
+constexpr int UNIFORM_RING_FRAMES_IN_FLIGHT = 3;
+// per frame, doubled whenever a frame runs out of space
+constexpr GLsizeiptr UNIFORM_RING_INITIAL_FRAME_SIZE = 1 << 20;
+
+struct UniformRange {
+    GLuint buffer{0};
+    GLintptr offset{0};
+    GLsizeiptr size{0};
+};
+
+/**
+ * Per frame uniform allocator
+ * One persistently and coherently mapped buffer split into
+ * UNIFORM_RING_FRAMES_IN_FLIGHT regions. Per draw blocks are written
+ * straight into the region of the current frame and bound with
+ * glBindBufferRange, no map/unmap or driver copy per draw. A region is
+ * only reused after the fence of the frame that last wrote it signaled.
+ * Running out of space mid frame switches to a larger buffer, the old one
+ * is orphaned until its frame retired, so bound ranges stay valid.
+ * Ranges may also be bound as shader storage or read as indirect commands.
+ */
+class UniformRing {
+   public:
+    static void init();
+    // wait for the region of this frame, must be called before allocate
+    static void beginFrame();
+    // fence the region written this frame
+    static void endFrame();
+    // aligned to both uniform and shader storage offset alignments
+    static UniformRange allocate(GLsizeiptr size, void** data);
+    static void bind(int port, const UniformRange& range);
+    static void bindStorage(int port, const UniformRange& range);
+    template <typename T>
+    static UniformRange push(int port, const T& value) {
+        void* data = nullptr;
+        UniformRange range = allocate(sizeof(T), &data);
+        memcpy(data, &value, sizeof(T));
+        bind(port, range);
+        return range;
+    }
+    // changes every frame and whenever the buffer is reallocated, ranges
+    // allocated under an older frame must not be bound again, ranges of a
+    // reallocated buffer stay valid until the end of the frame
+    static uint64_t getEpoch();
+
+    // bytes allocated by the last complete frame
+    static GLsizeiptr getFrameBytes();
+    static GLsizeiptr getFrameCapacity();
+    // frames that had to wait for the GPU to release their region
+    static int getStalls();
+};
+
+#endif /* RENDERLOO_INCLUDE_CORE_UNIFORM_RING_HPP */
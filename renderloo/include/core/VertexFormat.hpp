@@ -0,0 +1,91 @@
+#ifndef RENDERLOO_INCLUDE_CORE_VERTEX_FORMAT_HPP
+#define RENDERLOO_INCLUDE_CORE_VERTEX_FORMAT_HPP
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <optional>
+
+// attribute locations of the mesh vertex arrays and the vertex shaders
+enum VertexAttribute : GLuint {
+    VERTEX_POSITION = 0,
+    VERTEX_NORMAL,
+    VERTEX_TEXCOORD,
+    VERTEX_TANGENT,
+    VERTEX_BITANGENT,
+    VERTEX_BONE_IDS,
+    VERTEX_WEIGHTS,
+    VERTEX_ATTRIBUTE_COUNT,
+};
+
+// vertex flags in DrawData.info.y, must match shaders/include/vertex.glsl
+constexpr GLuint VERTEX_FLAG_PACKED = 1;
+constexpr GLuint VERTEX_FLAG_SKINNED = 2;
+
+// loo::Vertex was about 88 bytes, bones included
+struct PackedVertex {
+    // unorm16 within the mesh box, w is the bitangent sign(0: -1, 1: +1)
+    uint16_t position[4];
+    // snorm16 octahedral normal(xy) and tangent(zw)
+    int16_t normalTangent[4];
+    // half floats
+    uint16_t texCoord[2];
+};
+static_assert(sizeof(PackedVertex) == 20);
+
+// second stream, only allocated if a mesh of the scene is skinned
+struct PackedSkin {
+    // PACKED_NO_BONE for unused influences
+    uint8_t boneIDs[4];
+    // unorm8, the sum is 255
+    uint8_t weights[4];
+};
+static_assert(sizeof(PackedSkin) == 8);
+constexpr uint8_t PACKED_NO_BONE = 255;
+
+// object space position = offset + scale * unorm position
+struct PositionQuantization {
+    glm::vec3 offset{0.f}, scale{1.f};
+};
+PositionQuantization getPositionQuantization(const glm::vec3& min,
+                                             const glm::vec3& max);
+
+// unit vector to the octahedron unfolded into [-1, 1]^2
+glm::vec2 encodeOctahedral(const glm::vec3& n);
+glm::vec3 decodeOctahedral(const glm::vec2& e);
+
+PackedVertex packVertex(const glm::vec3& position, const glm::vec3& normal,
+                        const glm::vec2& texCoord, const glm::vec3& tangent,
+                        const glm::vec3& bitangent,
+                        const PositionQuantization& quantization);
+// bone ids below 0 are unused
+PackedSkin packSkin(const glm::ivec4& boneIDs, const glm::vec4& weights);
+
+// byte offsets of the attributes in a source vertex, -1 if absent
+struct SourceVertexLayout {
+    size_t stride{0};
+    int offsets[VERTEX_ATTRIBUTE_COUNT];
+};
+// layout of a mesh vertex array, nullopt if an attribute has a type the
+// packing does not expect(positions to bitangents and weights float, bone
+// ids int)
+std::optional<SourceVertexLayout> getSourceVertexLayout(GLuint vao,
+                                                        size_t stride);
+// recreates the attribute formats of a mesh vertex array on top of binding
+// 0 of target. Meshes are set up with glVertexAttribPointer, so the binding
+// of every attribute equals its index.
+void copyVertexLayout(GLuint source, GLuint target);
+// packs count vertices of the source layout, skins may be null. Returns
+// true if a vertex has a bone influence.
+bool packVertices(const uint8_t* vertices, size_t count,
+                  const SourceVertexLayout& layout,
+                  const PositionQuantization& quantization,
+                  PackedVertex* packed, PackedSkin* skins);
+// true if a vertex of the source layout has a bone influence
+bool hasBoneInfluence(const uint8_t* vertices, size_t count,
+                      const SourceVertexLayout& layout);
+// attribute formats of the packed streams, skinBuffer may be 0
+void setupPackedVertexArray(GLuint vao, GLuint vertexBuffer,
+                            GLuint skinBuffer);
+
+#endif /* RENDERLOO_INCLUDE_CORE_VERTEX_FORMAT_HPP */
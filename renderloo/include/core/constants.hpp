@@ -36,4 +36,20 @@ constexpr int SHADER_UB_PORT_DIRECTIONAL_SHADOW_MATRICES = 4;
 constexpr int SHADER_UB_PORT_PREVIOUS_FRAME_MVP = 5;
 constexpr int SHADER_UB_PORT_RENDER_INFO = 6;
 
+// multi draw indirect storage buffers
+constexpr int SHADER_SSBO_PORT_DRAW_DATA = 0;
+constexpr int SHADER_SSBO_PORT_DRAW_INDICES = 1;
+constexpr int SHADER_SSBO_PORT_MATERIALS = 2;
+// hierarchical-Z occlusion culling
+constexpr int SHADER_SSBO_PORT_MESH_BOUNDS = 3;
+constexpr int SHADER_SSBO_PORT_DRAW_COMMANDS = 4;
+constexpr int SHADER_SSBO_PORT_OCCLUSION_DRAWN = 5;
+constexpr int SHADER_SSBO_PORT_OCCLUSION_STATISTICS = 6;
+// cluster culling, reuses the ports that are free in its shader
+constexpr int SHADER_SSBO_PORT_CLUSTERS = 3;
+constexpr int SHADER_SSBO_PORT_MESH_CLUSTERS = 5;
+constexpr int SHADER_SSBO_PORT_CLUSTER_STATISTICS = 6;
+constexpr int SHADER_SSBO_PORT_CLUSTER_INDICES = 7;
+constexpr int SHADER_SSBO_PORT_CLUSTER_OUTPUT = 8;
+
 #endif /* HDSSS_INCLUDE_CONSTANTS_HPP */
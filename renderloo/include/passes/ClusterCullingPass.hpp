@@ -0,0 +1,60 @@
+#ifndef RENDERLOO_INCLUDE_PASSES_CLUSTER_CULLING_PASS_HPP
+#define RENDERLOO_INCLUDE_PASSES_CLUSTER_CULLING_PASS_HPP
+#include <loo/ComputeShader.hpp>
+#include <loo/Shader.hpp>
+#include <loo/Texture.hpp>
+#include <glm/glm.hpp>
+#include <vector>
+#include "core/MultiDraw.hpp"
+
+struct ClusterStatistics {
+    int tested{0};
+    int frustumCulled{0};
+    int backfaceCulled{0};
+    int occluded{0};
+    // of the tested meshlets and of the visible ones
+    int testedTriangles{0};
+    int drawnTriangles{0};
+};
+
+/**
+ * Meshlet culling of multi draw meshes
+ * The meshes of a draw list that MultiDrawScene::drawsClusters() get one
+ * command each. A compute dispatch tests their meshlets against the
+ * frustum, the normal cone and optionally last frame's Hi-Z pyramid, and
+ * copies the indices of the survivors into the compaction region of the
+ * mesh, counting them into the command. The pyramid test uses last frame's
+ * matrices, a meshlet revealed this frame appears one frame late.
+ */
+class ClusterCullingPass {
+   public:
+    ClusterCullingPass();
+    ClusterCullingPass(const ClusterCullingPass&) = delete;
+    ClusterCullingPass& operator=(const ClusterCullingPass&) = delete;
+    ~ClusterCullingPass();
+    // draws the clustered meshes of draws, returns the others(in order)
+    // for the per mesh commands. hiZ is last frame's pyramid or null.
+    const std::vector<int>& render(MultiDrawScene& multiDraw,
+                                   const std::vector<int>& draws,
+                                   loo::ShaderProgram& sp, bool cullBackFaces,
+                                   const glm::mat4& viewProjection,
+                                   const glm::vec3& cameraPosition,
+                                   const loo::Texture2D* hiZ,
+                                   const glm::mat4& prevViewProjection);
+    // UNIFORM_RING_FRAMES_IN_FLIGHT frames old, never waits for the GPU
+    [[nodiscard]] const ClusterStatistics& getStatistics() const {
+        return m_statistics;
+    }
+
+   private:
+    void readStatistics();
+
+    loo::ComputeShader m_cullShader;
+    // one slot of 8 counters per frame in flight
+    GLuint m_statisticsBuffer{0};
+    unsigned int m_frame{0};
+    ClusterStatistics m_statistics;
+    std::vector<int> m_clusterDraws, m_meshDraws;
+};
+
+#endif /* RENDERLOO_INCLUDE_PASSES_CLUSTER_CULLING_PASS_HPP */
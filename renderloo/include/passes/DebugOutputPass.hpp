@@ -18,7 +18,9 @@ class DebugOutputPass {
    public:
     DebugOutputPass();
     void init(int width, int height);
-    void render(const GBuffer& gbuffer, const loo::Texture2D& ao);
+    // blits to the default framebuffer if target is null
+    void render(const GBuffer& gbuffer, const loo::Texture2D& ao,
+                loo::Framebuffer* target = nullptr);
 
     DebugOutputOption debugOutputOption{DebugOutputOption::None};
 
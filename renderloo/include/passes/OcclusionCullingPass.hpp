@@ -0,0 +1,69 @@
+#ifndef RENDERLOO_INCLUDE_PASSES_OCCLUSION_CULLING_PASS_HPP
+#define RENDERLOO_INCLUDE_PASSES_OCCLUSION_CULLING_PASS_HPP
+#include <loo/ComputeShader.hpp>
+#include <loo/Shader.hpp>
+#include <loo/Texture.hpp>
+#include <array>
+#include <memory>
+#include <vector>
+#include "core/MultiDraw.hpp"
+#include "core/UniformRing.hpp"
+
+struct OcclusionStatistics {
+    // drawn by the first phase(visible against last frame's pyramid)
+    int firstPhase{0};
+    // revealed by the second phase
+    int secondPhase{0};
+    int occluded{0};
+};
+
+/**
+ * Two phase hierarchical-Z occlusion culling of multi draw commands
+ * Phase 1 tests the mesh boxes against last frame's depth pyramid(with
+ * last frame's matrices) and draws the survivors. The pyramid is then
+ * rebuilt from that depth, phase 2 tests the remaining meshes against it
+ * and draws the newly revealed ones, so a stale pyramid never drops a
+ * visible mesh. Depth is reverse-Z, the pyramid keeps the farthest(min)
+ * depth. Must be called with the depth attachment bound for drawing.
+ */
+class OcclusionCullingPass {
+   public:
+    OcclusionCullingPass();
+    OcclusionCullingPass(const OcclusionCullingPass&) = delete;
+    OcclusionCullingPass& operator=(const OcclusionCullingPass&) = delete;
+    ~OcclusionCullingPass();
+    void render(MultiDrawScene& multiDraw, const std::vector<int>& draws,
+                loo::ShaderProgram& sp, bool cullBackFaces,
+                const loo::Texture2D& depth, const glm::mat4& viewProjection,
+                const glm::mat4& prevViewProjection);
+    // after a camera cut or when culling was off, phase 1 draws everything
+    void invalidate() { m_pyramidValid = false; }
+    // until the next render(), the pyramid of the last frame, null if it is
+    // invalid
+    [[nodiscard]] const loo::Texture2D* getPyramid() const {
+        return m_pyramidValid ? m_pyramid.get() : nullptr;
+    }
+    // UNIFORM_RING_FRAMES_IN_FLIGHT frames old, never waits for the GPU
+    [[nodiscard]] const OcclusionStatistics& getStatistics() const {
+        return m_statistics;
+    }
+
+   private:
+    void buildPyramid(const loo::Texture2D& depth);
+    void cull(int phase, const UniformRange& commands, int count,
+              const glm::mat4& viewProjection);
+    void prepareBuffers(int meshCount);
+
+    loo::ComputeShader m_hiZBuildShader, m_cullShader;
+    std::unique_ptr<loo::Texture2D> m_pyramid;
+    int m_pyramidLevels{0};
+    bool m_pyramidValid{false};
+    GLuint m_drawnBuffer{0};
+    int m_drawnCapacity{0};
+    // one slot of 4 counters per frame in flight
+    GLuint m_statisticsBuffer{0};
+    unsigned int m_frame{0};
+    OcclusionStatistics m_statistics;
+};
+
+#endif /* RENDERLOO_INCLUDE_PASSES_OCCLUSION_CULLING_PASS_HPP */
@@ -4,7 +4,10 @@
 #include <loo/Framebuffer.hpp>
 #include <loo/Shader.hpp>
 #include <vector>
+#include "core/Culling.hpp"
 #include "core/Light.hpp"
+#include "core/MultiDraw.hpp"
+#include "core/RenderQueue.hpp"
 enum class TransparentShadowMode : int {
     Solid = 0,     // treat transparent objects as opaque ones
     AlphaTest = 1  // use alpha test to discard some of fragments
@@ -13,19 +16,37 @@ class ShadowMapPass {
    public:
     ShadowMapPass();
     void init();
-    void render(const loo::Scene& scene, const std::vector<ShaderLight>& lights,
-                float alphaTestThreshold);
+    // meshes are drawn one by one through renderQueue if multiDraw is
+    // nullptr
+    void render(const loo::Scene& scene, const TransformCache& transforms,
+                const std::vector<ShaderLight>& lights,
+                float alphaTestThreshold, RenderQueue& renderQueue,
+                MultiDrawScene* multiDraw = nullptr);
     [[nodiscard]] const loo::Texture2D& getDirectionalShadowMap() const {
         return *m_directionalShadowMap;
     }
 
+    // casters of the last shadowed light
+    [[nodiscard]] const FrustumCuller& getCasterCuller() const {
+        return m_casterCuller;
+    }
+
+    // meshes always kept as casters, see findSkinnedMeshes()
+    void setAlwaysVisible(std::vector<uint8_t> meshes) {
+        m_casterCuller.setAlwaysVisible(std::move(meshes));
+    }
+
     TransparentShadowMode transparentShadowMode{
         TransparentShadowMode::AlphaTest};
+    // skip meshes outside the light volume(extended toward the light)
+    bool enableCasterCulling{true};
 
    private:
     loo::Framebuffer m_fb;
     loo::ShaderProgram m_opaqueShader, m_transparentShader;
     std::unique_ptr<loo::Texture2D> m_directionalShadowMap;
+    FrustumCuller m_casterCuller;
+    std::vector<int> m_opaqueCasterDraws, m_blendCasterDraws;
 };
 
 #endif /* RENDERLOO_INCLUDE_PASSES_SHADOW_MAP_PASS_HPP */
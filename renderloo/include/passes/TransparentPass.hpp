@@ -3,16 +3,26 @@
 #include <loo/Application.hpp>
 #include <loo/Framebuffer.hpp>
 #include <loo/Shader.hpp>
+#include "core/Culling.hpp"
+#include "core/GeometryArena.hpp"
+#include "core/Instancing.hpp"
 #include "core/Light.hpp"
+#include "core/MultiDraw.hpp"
 #include "core/Skybox.hpp"
+#include "core/TransformCache.hpp"
 class TransparentPass {
    public:
     TransparentPass();
     void init(const loo::Texture2D& depthStencil, const loo::Texture2D& output);
-    void render(const loo::Scene& scene, const Skybox& skybox,
+    void render(const loo::Scene& scene, const TransformCache& transforms,
+                const Skybox& skybox,
                 const loo::Camera& camera,
                 const loo::Texture2D& mainLightShadowMap,
-                bool enableCompensation);
+                bool enableCompensation,
+                const MeshVisibility* visibility = nullptr,
+                MultiDrawScene* multiDraw = nullptr,
+                const MeshInstancing* instancing = nullptr,
+                const GeometryArena* geometry = nullptr);
     [[nodiscard]] auto getAlphaTestThreshold() const {
         return m_alphaTestThreshold;
     }
@@ -22,6 +32,10 @@ class TransparentPass {
     loo::ShaderProgram m_transparentShader;
 
     float m_alphaTestThreshold{0.65f};
+    // per scene mesh, reused every frame
+    std::vector<float> m_distances;
+    // scene mesh indices of an instanced draw
+    std::vector<uint32_t> m_instanceMeshes;
 };
 
 #endif /* RENDERLOO_INCLUDE_PASSES_TRANSPARENT_PASS_HPP */
@@ -1,6 +1,8 @@
 #version 460 core
 #extension GL_GOOGLE_include_directive : enable
 
+#include "include/multiDraw.glsl"
+
 layout(early_fragment_tests) in;
 
 layout(location = 0) in vec3 vPos;
@@ -11,6 +13,7 @@ layout(location = 3) in vec3 vTangent;
 layout(location = 4) in vec3 vBitangent;
 layout(location = 5) in vec4 vScreenCoord;
 layout(location = 6) in vec4 vPrevScreenCoord;
+layout(location = 7) flat in uint vMaterialIndex;
 
 layout(location = 0) out vec4 FragPosition;
 // base color(3) + unused(1)
@@ -100,8 +103,14 @@ void main() {
     vec2 texCoord = vTexCoord;
 
     // shading normal
-    vec3 sNormal = texture(normalTex, texCoord).rgb;
-    sNormal = length(sNormal) == 0.0 ? vNormal : (TBN * (sNormal * 2.0 - 1.0));
+    // xy only, z is rebuilt(BC5 normal maps have no blue)
+    vec2 normalXY = texture(normalTex, texCoord).rg;
+    vec3 sNormal = vNormal;
+    if (length(normalXY) != 0.0) {
+        normalXY = normalXY * 2.0 - 1.0;
+        sNormal = TBN * vec3(normalXY,
+                             sqrt(max(1.0 - dot(normalXY, normalXY), 0.0)));
+    }
     sNormal = normalize(enableNormal ? sNormal : vNormal);
     FragPosition = vec4(vPos, 1);
     GBufferC.rgb = sNormal;
@@ -109,11 +118,16 @@ void main() {
                     vPrevScreenCoord.xy / vPrevScreenCoord.w) *
                    0.5;
 #ifdef MATERIAL_PBR
+    MaterialData mat = MaterialData(material.baseColor,
+                                    material.metallicRoughness,
+                                    material.emissive);
+    if (multiDraw)
+        mat = materials[vMaterialIndex];
     GBufferFromPBRMaterial(texCoord, baseColorTex, occlusionTex, metallicTex,
-                           roughnessTex, emissiveTex, material.baseColor.rgb,
-                           material.metallicRoughness.r,
-                           material.metallicRoughness.g, material.emissive.rgb,
-                           GBufferA, GBufferB, GBufferC, GBufferD);
+                           roughnessTex, emissiveTex, mat.baseColor.rgb,
+                           mat.metallicRoughness.r, mat.metallicRoughness.g,
+                           mat.emissive.rgb, GBufferA, GBufferB, GBufferC,
+                           GBufferD);
 #else
     GBufferFromSimpleMaterial(texCoord, diffuseTex, specularTex,
                               material.diffuse.rgb, material.specular.rgb,
@@ -2,16 +2,10 @@
 #extension GL_GOOGLE_include_directive : enable
 
 #include "include/constants.glsl"
+#include "include/multiDraw.glsl"
 #include "include/renderInfo.glsl"
 #include "include/sampling.glsl"
-
-layout(location = 0) in vec3 aPos;
-layout(location = 1) in vec3 aNormal;
-layout(location = 2) in vec2 aTexCoord;
-layout(location = 3) in vec3 aTangent;
-layout(location = 4) in vec3 aBitangent;
-layout(location = 5) in ivec4 aBoneIDs;
-layout(location = 6) in vec4 aWeights;
+#include "include/vertex.glsl"
 
 layout(location = 0) out vec3 vPos;
 layout(location = 1) out vec3 vNormal;
@@ -20,6 +14,7 @@ layout(location = 3) out vec3 vTangent;
 layout(location = 4) out vec3 vBitangent;
 layout(location = 5) out vec4 vScreenCoord;
 layout(location = 6) out vec4 vPrevScreenCoord;
+layout(location = 7) flat out uint vMaterialIndex;
 
 layout(std140, binding = 0) uniform MVPMatrices {
     mat4 model;
@@ -40,31 +35,48 @@ layout(std140, binding = 5) uniform PrevMVPMatrices {
 };
 
 void main() {
-    mat3 model3 = mat3(model);
-    vTexCoord = aTexCoord;
+    mat4 drawModel = model, drawPrevModel = prevModel,
+         drawNormalMatrix = normalMatrix;
+    vMaterialIndex = 0;
+    uint vertexFlags = 0u;
+    vec3 positionOffset = vec3(0.0), positionScale = vec3(1.0);
+    if (multiDraw || instanced) {
+        DrawData draw = draws[multiDraw ? drawIndices[drawOffset + gl_DrawID]
+                                        : uint(gl_InstanceID)];
+        drawModel = draw.model;
+        drawPrevModel = draw.prevModel;
+        drawNormalMatrix = draw.normalMatrix;
+        vMaterialIndex = draw.info.x;
+        vertexFlags = draw.info.y;
+        positionOffset = draw.positionOffset.xyz;
+        positionScale = draw.positionScale.xyz;
+    }
+    Vertex vertex = loadVertex(vertexFlags, positionOffset, positionScale);
+    vTexCoord = vertex.texCoord;
 
     int influenceCount = 0;
     mat4 boneMatrix = mat4(0.0);
     for (int i = 0; i < BONES_MAX_INFLUENCE; i++) {
-        if (aBoneIDs[i] == -1)
+        if (vertex.boneIDs[i] == -1)
             continue;
-        if (aBoneIDs[i] >= BONES_MAX_COUNT) {
+        if (vertex.boneIDs[i] >= BONES_MAX_COUNT) {
             break;
         }
         influenceCount++;
         // compute the position in bone space
-        boneMatrix += aWeights[i] * bones[aBoneIDs[i]];
+        boneMatrix += vertex.weights[i] * bones[vertex.boneIDs[i]];
     }
     if (influenceCount == 0) {
-        boneMatrix = model;
+        boneMatrix = drawModel;
     }
-    vec4 normalWS = vec4(aNormal, 0.0);
+    vec4 normalWS = vec4(vertex.normal, 0.0);
     normalWS = boneMatrix * normalWS;
-    vNormal = normalize((normalMatrix * normalWS).xyz);
-    vPos = (boneMatrix * vec4(aPos, 1.0)).xyz;
-    vec3 vPrevPos = (prevModel * boneMatrix * vec4(aPos, 1.0)).xyz;
-    vTangent = normalize((boneMatrix * vec4(aTangent, 0.0)).xyz);
-    vBitangent = normalize((boneMatrix * vec4(aBitangent, 0.0)).xyz);
+    vNormal = normalize((drawNormalMatrix * normalWS).xyz);
+    vPos = (boneMatrix * vec4(vertex.position, 1.0)).xyz;
+    vec3 vPrevPos =
+        (drawPrevModel * boneMatrix * vec4(vertex.position, 1.0)).xyz;
+    vTangent = normalize((boneMatrix * vec4(vertex.tangent, 0.0)).xyz);
+    vBitangent = normalize((boneMatrix * vec4(vertex.bitangent, 0.0)).xyz);
     vec4 vView = view * vec4(vPos, 1.0);
     vScreenCoord = projection * vView;
     // ignore bone influence for prevScreenCoord for now
@@ -0,0 +1,48 @@
+#ifndef RENDERLOO_SHADERS_INCLUDE_HI_Z_HPP
+#define RENDERLOO_SHADERS_INCLUDE_HI_Z_HPP
+
+// farthest depth pyramid, reverse-Z, see passes/OcclusionCullingPass.hpp
+layout(binding = 0) uniform sampler2D hiZ;
+
+// false if the box(center, half extent) under mvp is behind the pyramid
+bool isVisibleHiZ(mat4 mvp, vec3 center, vec3 extent) {
+    vec2 uvMin = vec2(1.0), uvMax = vec2(0.0);
+    // larger depth is closer
+    float nearest = 0.0;
+    for (int i = 0; i < 8; i++) {
+        vec3 corner = vec3((i & 1) != 0 ? 1.0 : -1.0,
+                           (i & 2) != 0 ? 1.0 : -1.0,
+                           (i & 4) != 0 ? 1.0 : -1.0);
+        vec4 clip = mvp * vec4(center + extent * corner, 1.0);
+        // crosses the camera plane
+        if (clip.w <= 1e-5) {
+            return true;
+        }
+        vec3 ndc = clip.xyz / clip.w;
+        uvMin = min(uvMin, ndc.xy * 0.5 + 0.5);
+        uvMax = max(uvMax, ndc.xy * 0.5 + 0.5);
+        nearest = max(nearest, ndc.z);
+    }
+    if (any(lessThan(uvMax, vec2(0.0))) || any(greaterThan(uvMin, vec2(1.0)))) {
+        return false;
+    }
+    ivec2 size = textureSize(hiZ, 0);
+    ivec2 pixelMin = clamp(ivec2(uvMin * vec2(size)), ivec2(0), size - 1);
+    ivec2 pixelMax = clamp(ivec2(uvMax * vec2(size)), ivec2(0), size - 1);
+    // smallest level where the box covers at most 2x2 texels
+    ivec2 extentTexels = pixelMax - pixelMin;
+    int level =
+        int(ceil(log2(float(max(extentTexels.x, extentTexels.y) + 1))));
+    level = min(level, textureQueryLevels(hiZ) - 1);
+    ivec2 levelMax = textureSize(hiZ, level) - 1;
+    ivec2 texelMin = min(pixelMin >> level, levelMax);
+    ivec2 texelMax = min(pixelMax >> level, levelMax);
+    float farthest =
+        min(min(texelFetch(hiZ, texelMin, level).r,
+                texelFetch(hiZ, ivec2(texelMax.x, texelMin.y), level).r),
+            min(texelFetch(hiZ, ivec2(texelMin.x, texelMax.y), level).r,
+                texelFetch(hiZ, texelMax, level).r));
+    return nearest >= farthest;
+}
+
+#endif /* RENDERLOO_SHADERS_INCLUDE_HI_Z_HPP */
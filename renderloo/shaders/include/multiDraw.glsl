@@ -0,0 +1,41 @@
+#ifndef RENDERLOO_SHADERS_INCLUDE_MULTI_DRAW_HPP
+#define RENDERLOO_SHADERS_INCLUDE_MULTI_DRAW_HPP
+
+// multi draw indirect submission, see core/MultiDraw.hpp
+struct DrawData {
+    mat4 model;
+    mat4 prevModel;
+    mat4 normalMatrix;
+    // material index(1) + vertex flags(1) + padding(2)
+    uvec4 info;
+    // packed positions: offset + scale * unorm position, xyz
+    vec4 positionOffset;
+    vec4 positionScale;
+};
+struct MaterialData {
+    vec4 baseColor;
+    // metallic(1) + roughness(1) + padding(2)
+    vec4 metallicRoughness;
+    // emissive(3) + padding(1)
+    vec4 emissive;
+};
+// one per mesh, or one per instance of an instanced draw
+layout(std430, binding = 0) readonly buffer DrawBuffer {
+    DrawData draws[];
+};
+// mesh of every command in the pass
+layout(std430, binding = 1) readonly buffer DrawIndexBuffer {
+    uint drawIndices[];
+};
+layout(std430, binding = 2) readonly buffer MaterialBuffer {
+    MaterialData materials[];
+};
+// per draw data comes from the buffers above instead of the MVP blocks
+layout(location = 16) uniform bool multiDraw;
+// first command of the current glMultiDrawElementsIndirect call, the
+// command index is drawOffset + gl_DrawID
+layout(location = 17) uniform int drawOffset;
+// instanced per mesh draw, the per draw data is draws[gl_InstanceID]
+layout(location = 18) uniform bool instanced;
+
+#endif /* RENDERLOO_SHADERS_INCLUDE_MULTI_DRAW_HPP */
@@ -0,0 +1,65 @@
+#ifndef RENDERLOO_SHADERS_INCLUDE_VERTEX_HPP
+#define RENDERLOO_SHADERS_INCLUDE_VERTEX_HPP
+
+// mesh vertex inputs, either the float layout of the mesh vertex arrays or
+// the packed one of the multi draw scene, see core/VertexFormat.hpp
+layout(location = 0) in vec4 aPos;
+layout(location = 1) in vec4 aNormal;
+layout(location = 2) in vec2 aTexCoord;
+layout(location = 3) in vec3 aTangent;
+layout(location = 4) in vec3 aBitangent;
+layout(location = 5) in ivec4 aBoneIDs;
+layout(location = 6) in vec4 aWeights;
+
+#define VERTEX_FLAG_PACKED 1u
+#define VERTEX_FLAG_SKINNED 2u
+#define PACKED_NO_BONE 255
+
+struct Vertex {
+    vec3 position;
+    vec3 normal;
+    vec2 texCoord;
+    vec3 tangent;
+    vec3 bitangent;
+    // -1 for unused influences
+    ivec4 boneIDs;
+    vec4 weights;
+};
+
+vec3 decodeOctahedral(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += mix(vec2(t), vec2(-t), greaterThanEqual(n.xy, vec2(0.0)));
+    return normalize(n);
+}
+
+// flags and quantization of DrawData, float vertices ignore the latter
+Vertex loadVertex(uint flags, vec3 positionOffset, vec3 positionScale) {
+    Vertex v;
+    v.texCoord = aTexCoord;
+    if ((flags & VERTEX_FLAG_PACKED) == 0u) {
+        v.position = aPos.xyz;
+        v.normal = aNormal.xyz;
+        v.tangent = aTangent;
+        v.bitangent = aBitangent;
+        v.boneIDs = aBoneIDs;
+        v.weights = aWeights;
+        return v;
+    }
+    v.position = positionOffset + positionScale * aPos.xyz;
+    v.normal = decodeOctahedral(aNormal.xy);
+    v.tangent = decodeOctahedral(aNormal.zw);
+    // w holds the handedness
+    v.bitangent = (aPos.w * 2.0 - 1.0) * cross(v.normal, v.tangent);
+    v.boneIDs = ivec4(-1);
+    v.weights = vec4(0.0);
+    // no skin stream otherwise
+    if ((flags & VERTEX_FLAG_SKINNED) != 0u) {
+        v.boneIDs = mix(aBoneIDs, ivec4(-1),
+                        equal(aBoneIDs, ivec4(PACKED_NO_BONE)));
+        v.weights = aWeights;
+    }
+    return v;
+}
+
+#endif /* RENDERLOO_SHADERS_INCLUDE_VERTEX_HPP */
@@ -2,13 +2,11 @@
 #extension GL_GOOGLE_include_directive : enable
 
 #include "include/constants.glsl"
-
-layout(location = 0) in vec3 aPos;
-layout(location = 2) in vec2 aTexCoord;
-layout(location = 5) in ivec4 aBoneIDs;
-layout(location = 6) in vec4 aWeights;
+#include "include/multiDraw.glsl"
+#include "include/vertex.glsl"
 
 layout(location = 0) out vec2 vTexCoord;
+layout(location = 1) flat out uint vMaterialIndex;
 
 layout(std140, binding = 0) uniform MVPMatrices {
     mat4 model;
@@ -21,22 +19,36 @@ layout(std140, binding = 2) uniform BoneMatrices {
 };
 layout(location = 0) uniform mat4 lightSpaceMatrix;
 void main() {
+    mat4 drawModel = model;
+    vMaterialIndex = 0;
+    uint vertexFlags = 0u;
+    vec3 positionOffset = vec3(0.0), positionScale = vec3(1.0);
+    if (multiDraw || instanced) {
+        DrawData draw = draws[multiDraw ? drawIndices[drawOffset + gl_DrawID]
+                                        : uint(gl_InstanceID)];
+        drawModel = draw.model;
+        vMaterialIndex = draw.info.x;
+        vertexFlags = draw.info.y;
+        positionOffset = draw.positionOffset.xyz;
+        positionScale = draw.positionScale.xyz;
+    }
+    Vertex vertex = loadVertex(vertexFlags, positionOffset, positionScale);
     int influenceCount = 0;
     mat4 boneMatrix = mat4(0.0);
     for (int i = 0; i < BONES_MAX_INFLUENCE; i++) {
-        if (aBoneIDs[i] == -1)
+        if (vertex.boneIDs[i] == -1)
             continue;
-        if (aBoneIDs[i] >= BONES_MAX_COUNT) {
+        if (vertex.boneIDs[i] >= BONES_MAX_COUNT) {
             break;
         }
         influenceCount++;
         // compute the position in bone space
-        boneMatrix += aWeights[i] * bones[aBoneIDs[i]];
+        boneMatrix += vertex.weights[i] * bones[vertex.boneIDs[i]];
     }
     if (influenceCount == 0) {
-        boneMatrix = model;
+        boneMatrix = drawModel;
     }
-    vec3 vPos = (boneMatrix * vec4(aPos, 1.0)).xyz;
-    vTexCoord = aTexCoord;
+    vec3 vPos = (boneMatrix * vec4(vertex.position, 1.0)).xyz;
+    vTexCoord = vertex.texCoord;
     gl_Position = lightSpaceMatrix * vec4(vPos, 1.0);
 }
\ No newline at end of file
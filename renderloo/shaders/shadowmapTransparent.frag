@@ -1,6 +1,10 @@
 #version 460
+#extension GL_GOOGLE_include_directive : enable
+
+#include "include/multiDraw.glsl"
 
 layout(location = 0) in vec2 vTexCoord;
+layout(location = 1) flat in uint vMaterialIndex;
 
 layout(location = 1) uniform float alphaTestThreshold;
 
@@ -16,7 +20,9 @@ material;
 layout(binding = 10, location = 2) uniform sampler2D baseColorTex;
 
 void main() {
-    float alpha = texture(baseColorTex, vTexCoord).a * material.baseColor.a;
+    vec4 baseColor =
+        multiDraw ? materials[vMaterialIndex].baseColor : material.baseColor;
+    float alpha = texture(baseColorTex, vTexCoord).a * baseColor.a;
     if (alpha < alphaTestThreshold) {
         discard;
     }
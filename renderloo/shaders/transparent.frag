@@ -4,6 +4,7 @@
 #define REVERSE_Z
 #include "include/constants.glsl"
 #include "include/lighting.glsl"
+#include "include/multiDraw.glsl"
 
 layout(location = 0) in vec3 vPos;
 layout(location = 1) in vec3 vNormal;
@@ -11,6 +12,7 @@ layout(location = 2) in vec2 vTexCoord;
 // tangent space -> world space
 layout(location = 3) in vec3 vTangent;
 layout(location = 4) in vec3 vBitangent;
+layout(location = 7) flat in uint vMaterialIndex;
 
 layout(location = 0) out vec4 FragResult;
 
@@ -56,17 +58,27 @@ void main() {
     vec2 texCoord = vTexCoord;
 
     // shading normal
-    vec3 sNormal = texture(normalTex, texCoord).rgb;
-    sNormal = length(sNormal) == 0.0 ? vNormal : (TBN * (sNormal * 2.0 - 1.0));
+    // xy only, z is rebuilt(BC5 normal maps have no blue)
+    vec2 normalXY = texture(normalTex, texCoord).rg;
+    vec3 sNormal = vNormal;
+    if (length(normalXY) != 0.0) {
+        normalXY = normalXY * 2.0 - 1.0;
+        sNormal = TBN * vec3(normalXY,
+                             sqrt(max(1.0 - dot(normalXY, normalXY), 0.0)));
+    }
     sNormal = normalize(sNormal);
+    MaterialData mat = MaterialData(material.baseColor,
+                                    material.metallicRoughness,
+                                    material.emissive);
+    if (multiDraw)
+        mat = materials[vMaterialIndex];
     vec4 baseColor4 = texture(baseColorTex, texCoord).rgba;
-    vec3 baseColor = baseColor4.rgb * material.baseColor.rgb;
-    vec3 emissive = texture(emissiveTex, texCoord).rgb * material.emissive.rgb;
-    float metallic =
-        texture(metallicTex, texCoord).b * material.metallicRoughness.r;
+    vec3 baseColor = baseColor4.rgb * mat.baseColor.rgb;
+    vec3 emissive = texture(emissiveTex, texCoord).rgb * mat.emissive.rgb;
+    float metallic = texture(metallicTex, texCoord).b * mat.metallicRoughness.r;
     float roughness =
-        texture(roughnessTex, texCoord).g * material.metallicRoughness.g;
-    float alpha = baseColor4.a * material.baseColor.a;
+        texture(roughnessTex, texCoord).g * mat.metallicRoughness.g;
+    float alpha = baseColor4.a * mat.baseColor.a;
     if (alphaTest == 1 && alpha < alphaTestThreshold)
         discard;
 
@@ -0,0 +1,81 @@
+#include "core/CameraPath.hpp"
+#include <glog/logging.h>
+#include <algorithm>
+#include <fstream>
+#include <glm/gtc/matrix_transform.hpp>
+using namespace glm;
+using namespace std;
+
+CameraPath CameraPath::orbit(const CameraPose& start, float degrees) {
+    CameraPath path;
+    path.m_type = Type::Orbit;
+    path.m_keyframes = {start};
+    path.m_degrees = degrees;
+    return path;
+}
+CameraPath CameraPath::spline(std::vector<CameraPose> keyframes) {
+    CameraPath path;
+    path.m_type = Type::Spline;
+    path.m_keyframes = std::move(keyframes);
+    return path;
+}
+
+static vec3 catmullRom(const vec3& p0, const vec3& p1, const vec3& p2,
+                       const vec3& p3, float t) {
+    float t2 = t * t, t3 = t2 * t;
+    return 0.5f * ((2.0f * p1) + (-p0 + p2) * t +
+                   (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2 +
+                   (-p0 + 3.0f * p1 - 3.0f * p2 + p3) * t3);
+}
+
+CameraPose CameraPath::sample(float t) const {
+    if (m_keyframes.empty())
+        return CameraPose{vec3(0), vec3(0, 0, -1)};
+    t = std::clamp(t, 0.0f, 1.0f);
+    if (m_type == Type::Orbit) {
+        const CameraPose& start = m_keyframes[0];
+        mat4 rotation = glm::rotate(mat4(1.0f), glm::radians(m_degrees * t),
+                                    vec3(0, 1, 0));
+        vec3 offset = vec3(rotation * vec4(start.position - start.target, 0));
+        return CameraPose{start.target + offset, start.target};
+    }
+    int n = static_cast<int>(m_keyframes.size());
+    if (n == 1)
+        return m_keyframes[0];
+    // uniform parameterization, each segment takes 1 / (n - 1)
+    float x = t * static_cast<float>(n - 1);
+    int segment = std::min(static_cast<int>(x), n - 2);
+    float local = x - static_cast<float>(segment);
+    auto key = [&](int i) -> const CameraPose& {
+        return m_keyframes[std::clamp(i, 0, n - 1)];
+    };
+    return CameraPose{
+        catmullRom(key(segment - 1).position, key(segment).position,
+                   key(segment + 1).position, key(segment + 2).position, local),
+        catmullRom(key(segment - 1).target, key(segment).target,
+                   key(segment + 1).target, key(segment + 2).target, local)};
+}
+
+bool saveCameraPath(const std::filesystem::path& filename,
+                    const std::vector<CameraPose>& keyframes) {
+    ofstream file(filename);
+    if (!file) {
+        LOG(ERROR) << "Failed to open " << filename.string();
+        return false;
+    }
+    auto writeVec3 = [&](const vec3& v) {
+        file << "[" << v.x << ", " << v.y << ", " << v.z << "]";
+    };
+    file << "{\n    \"type\": \"spline\",\n    \"keyframes\": [";
+    for (size_t i = 0; i < keyframes.size(); i++) {
+        file << (i ? "," : "") << "\n        {\"position\": ";
+        writeVec3(keyframes[i].position);
+        file << ", \"lookat\": ";
+        writeVec3(keyframes[i].target);
+        file << "}";
+    }
+    file << "\n    ]\n}\n";
+    LOG(INFO) << "Camera path with " << keyframes.size()
+              << " keyframes saved to " << filename.string();
+    return true;
+}
@@ -0,0 +1,201 @@
+#include "core/Culling.hpp"
+#include "core/JobSystem.hpp"
+#include "core/VertexFormat.hpp"
+
+#include <cmath>
+#include <type_traits>
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+using namespace loo;
+using namespace std;
+
+Frustum extractFrustum(const glm::mat4& viewProjection) {
+    // rows of the matrix(glm is column major)
+    glm::vec4 row[4];
+    for (int i = 0; i < 4; i++)
+        row[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i],
+                           viewProjection[2][i], viewProjection[3][i]);
+    Frustum frustum{};
+    // left, right, bottom, top, z >= 0, z <= w
+    frustum.planes = {row[3] + row[0], row[3] - row[0], row[3] + row[1],
+                      row[3] - row[1], row[2],          row[3] - row[2]};
+    for (auto& plane : frustum.planes) {
+        float length = glm::length(glm::vec3(plane));
+        if (length < 1e-6f)
+            plane = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        else
+            plane = plane / length;
+    }
+    return frustum;
+}
+
+std::vector<uint8_t> findSkinnedMeshes(const Scene& scene) {
+    const auto& meshes = scene.getMeshes();
+    std::vector<uint8_t> skinned(meshes.size(), 0);
+    for (size_t i = 0; i < meshes.size(); i++) {
+        const auto& mesh = meshes[i];
+        using Vertex =
+            std::decay_t<decltype(mesh->vertices)>::value_type;
+        auto layout = getSourceVertexLayout(mesh->vao, sizeof(Vertex));
+        if (!layout) {
+            skinned[i] = scene.animation != nullptr;
+            continue;
+        }
+        skinned[i] = hasBoneInfluence(
+            reinterpret_cast<const uint8_t*>(mesh->vertices.data()),
+            mesh->vertices.size(), *layout);
+    }
+    return skinned;
+}
+
+const std::vector<int>& filterVisibleDraws(const std::vector<int>& draws,
+                                           const MeshVisibility* visibility,
+                                           std::vector<int>& output) {
+    if (!visibility)
+        return draws;
+    output.clear();
+    for (int draw : draws) {
+        if ((*visibility)[draw])
+            output.push_back(draw);
+    }
+    return output;
+}
+
+void AABBBatch::resize(size_t n) {
+    count = n;
+    size_t padded = (n + AABB_BATCH_WIDTH - 1) / AABB_BATCH_WIDTH *
+                    AABB_BATCH_WIDTH;
+    for (auto* v : {&centerX, &centerY, &centerZ, &extentX, &extentY,
+                    &extentZ})
+        v->assign(padded, 0.0f);
+}
+
+void AABBBatch::set(size_t i, const glm::vec3& center,
+                    const glm::vec3& extent) {
+    centerX[i] = center.x;
+    centerY[i] = center.y;
+    centerZ[i] = center.z;
+    extentX[i] = extent.x;
+    extentY[i] = extent.y;
+    extentZ[i] = extent.z;
+}
+
+void AABBBatch::setTransformed(size_t i, const glm::mat4& transform,
+                               const glm::vec3& center,
+                               const glm::vec3& extent) {
+    glm::vec3 worldCenter(transform * glm::vec4(center, 1.0f));
+    // extent of the transformed box is |M| * extent
+    glm::vec3 worldExtent = glm::abs(glm::vec3(transform[0])) * extent.x +
+                            glm::abs(glm::vec3(transform[1])) * extent.y +
+                            glm::abs(glm::vec3(transform[2])) * extent.z;
+    set(i, worldCenter, worldExtent);
+}
+
+void cullAABBs(const Frustum& frustum, const AABBBatch& boxes,
+               uint8_t* visibility) {
+    size_t i = 0;
+#if defined(__AVX__)
+    for (; i < boxes.count; i += 8) {
+        __m256 cx = _mm256_loadu_ps(&boxes.centerX[i]),
+               cy = _mm256_loadu_ps(&boxes.centerY[i]),
+               cz = _mm256_loadu_ps(&boxes.centerZ[i]),
+               ex = _mm256_loadu_ps(&boxes.extentX[i]),
+               ey = _mm256_loadu_ps(&boxes.extentY[i]),
+               ez = _mm256_loadu_ps(&boxes.extentZ[i]);
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (const auto& p : frustum.planes) {
+            // signed distance of the center plus the projected radius
+            __m256 d = _mm256_add_ps(
+                _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(p.x), cx),
+                              _mm256_mul_ps(_mm256_set1_ps(p.y), cy)),
+                _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(p.z), cz),
+                              _mm256_set1_ps(p.w)));
+            __m256 r = _mm256_add_ps(
+                _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(fabs(p.x)), ex),
+                              _mm256_mul_ps(_mm256_set1_ps(fabs(p.y)), ey)),
+                _mm256_mul_ps(_mm256_set1_ps(fabs(p.z)), ez));
+            inside = _mm256_and_ps(
+                inside, _mm256_cmp_ps(_mm256_add_ps(d, r),
+                                      _mm256_setzero_ps(), _CMP_GE_OQ));
+        }
+        int mask = _mm256_movemask_ps(inside);
+        for (size_t j = 0; j < 8 && i + j < boxes.count; j++)
+            visibility[i + j] = (mask >> j) & 1;
+    }
+#elif defined(__SSE2__) || defined(_M_X64)
+    for (; i < boxes.count; i += 4) {
+        __m128 cx = _mm_loadu_ps(&boxes.centerX[i]),
+               cy = _mm_loadu_ps(&boxes.centerY[i]),
+               cz = _mm_loadu_ps(&boxes.centerZ[i]),
+               ex = _mm_loadu_ps(&boxes.extentX[i]),
+               ey = _mm_loadu_ps(&boxes.extentY[i]),
+               ez = _mm_loadu_ps(&boxes.extentZ[i]);
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (const auto& p : frustum.planes) {
+            // signed distance of the center plus the projected radius
+            __m128 d = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(p.x), cx),
+                           _mm_mul_ps(_mm_set1_ps(p.y), cy)),
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(p.z), cz),
+                           _mm_set1_ps(p.w)));
+            __m128 r = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(fabs(p.x)), ex),
+                           _mm_mul_ps(_mm_set1_ps(fabs(p.y)), ey)),
+                _mm_mul_ps(_mm_set1_ps(fabs(p.z)), ez));
+            inside = _mm_and_ps(
+                inside, _mm_cmpge_ps(_mm_add_ps(d, r), _mm_setzero_ps()));
+        }
+        int mask = _mm_movemask_ps(inside);
+        for (size_t j = 0; j < 4 && i + j < boxes.count; j++)
+            visibility[i + j] = (mask >> j) & 1;
+    }
+#else
+    for (; i < boxes.count; i++) {
+        bool inside = true;
+        for (const auto& p : frustum.planes) {
+            float d = p.x * boxes.centerX[i] + p.y * boxes.centerY[i] +
+                      p.z * boxes.centerZ[i] + p.w;
+            float r = fabs(p.x) * boxes.extentX[i] +
+                      fabs(p.y) * boxes.extentY[i] +
+                      fabs(p.z) * boxes.extentZ[i];
+            inside = inside && d + r >= 0.0f;
+        }
+        visibility[i] = inside;
+    }
+#endif
+}
+
+void FrustumCuller::cull(const Scene& scene, const TransformCache& transforms,
+                         const glm::mat4& viewProjection) {
+    cull(scene, transforms, extractFrustum(viewProjection));
+}
+
+void FrustumCuller::cull(const Scene& scene, const TransformCache& transforms,
+                         const Frustum& frustum) {
+    const auto& meshes = scene.getMeshes();
+    m_bounds.resize(meshes.size());
+    auto transformBounds = [&](int first, int last) {
+        for (int i = first; i < last; i++) {
+            const auto& mesh = meshes[i];
+            m_bounds.setTransformed(i, transforms.getWorld(i),
+                                    mesh->aabb.getCenter(),
+                                    mesh->aabb.getDiagonal() * 0.5f);
+        }
+    };
+    // cheap per mesh, only large scenes are split
+    JobSystem::parallelFor(static_cast<int>(meshes.size()), 512,
+                           transformBounds);
+    m_visibility.resize(meshes.size());
+    cullAABBs(frustum, m_bounds, m_visibility.data());
+    if (m_alwaysVisible.size() == meshes.size()) {
+        for (size_t i = 0; i < meshes.size(); i++)
+            m_visibility[i] |= m_alwaysVisible[i];
+    }
+    m_visible = 0;
+    for (uint8_t v : m_visibility)
+        m_visible += v;
+}
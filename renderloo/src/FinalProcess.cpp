@@ -17,8 +17,12 @@ FinalProcess::FinalProcess(int width, int height)
 void FinalProcess::init() {
     panicPossibleGLError();
 }
-void FinalProcess::render(const loo::Texture2D& deferredTexture) {
-    Framebuffer::bindDefault();
+void FinalProcess::render(const loo::Texture2D& deferredTexture,
+                          Framebuffer* target) {
+    if (target)
+        target->bind();
+    else
+        Framebuffer::bindDefault();
     glClearColor(0, 0, 0, 1);
     glDisable(GL_DEPTH_TEST);
     glDisable(GL_STENCIL_TEST);
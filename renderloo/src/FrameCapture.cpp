@@ -0,0 +1,243 @@
+#include "core/FrameCapture.hpp"
+#include <glog/logging.h>
+#include <stb_image_write.h>
+#include <cstring>
+#include <loo/glError.hpp>
+#include "core/ImageWriter.hpp"
+
+using namespace loo;
+using namespace std;
+namespace fs = std::filesystem;
+
+ImageEncoder::ImageEncoder(size_t maxQueuedJobs)
+    : m_maxQueuedJobs(maxQueuedJobs), m_worker([this] { run(); }) {}
+
+ImageEncoder::~ImageEncoder() {
+    {
+        std::lock_guard lock(m_mutex);
+        m_quit = true;
+    }
+    m_cv.notify_all();
+    m_worker.join();
+}
+
+void ImageEncoder::submit(EncodeJob job) {
+    {
+        std::unique_lock lock(m_mutex);
+        if (m_jobs.size() >= m_maxQueuedJobs) {
+            m_blockedSubmits++;
+            m_cv.wait(lock,
+                      [this] { return m_jobs.size() < m_maxQueuedJobs; });
+        }
+        m_jobs.push_back(std::move(job));
+    }
+    m_cv.notify_all();
+}
+
+std::vector<unsigned char> ImageEncoder::acquireBuffer(size_t size) {
+    std::vector<unsigned char> buffer;
+    {
+        std::lock_guard lock(m_mutex);
+        if (!m_freeBuffers.empty()) {
+            buffer = std::move(m_freeBuffers.back());
+            m_freeBuffers.pop_back();
+        }
+    }
+    // no reallocation unless the frame grew
+    buffer.resize(size);
+    return buffer;
+}
+
+void ImageEncoder::wait() {
+    std::unique_lock lock(m_mutex);
+    m_cv.wait(lock, [this] { return m_jobs.empty() && !m_busy; });
+}
+
+static void encode(EncodeJob& job) {
+    size_t rowBytes = static_cast<size_t>(job.width) * job.channels *
+                      (job.hdr ? sizeof(float) : 1);
+    flipImageRows(job.pixels.data(), rowBytes, job.height);
+    if (job.sequence) {
+        // the writer reports its own errors
+        job.sequence->write(job.width, job.height, job.pixels.data());
+        return;
+    }
+    bool success;
+    if (job.hdr) {
+        success = writeEXR(job.filename, job.width, job.height, job.channels,
+                           reinterpret_cast<const float*>(job.pixels.data()));
+    } else {
+        success = stbi_write_png(job.filename.string().c_str(), job.width,
+                                 job.height, job.channels, job.pixels.data(),
+                                 static_cast<int>(rowBytes)) != 0;
+    }
+    if (!success)
+        LOG(ERROR) << "Failed to write " << job.filename.string();
+}
+
+void ImageEncoder::run() {
+    while (true) {
+        EncodeJob job;
+        {
+            std::unique_lock lock(m_mutex);
+            m_cv.wait(lock, [this] { return m_quit || !m_jobs.empty(); });
+            if (m_jobs.empty())
+                return;
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+            m_busy = true;
+        }
+        // wake up a blocked submit
+        m_cv.notify_all();
+        encode(job);
+        // release the sequence before waking wait(), so it is finalized
+        job.sequence.reset();
+        {
+            std::lock_guard lock(m_mutex);
+            m_busy = false;
+            if (m_freeBuffers.size() < m_maxQueuedJobs + 2)
+                m_freeBuffers.push_back(std::move(job.pixels));
+        }
+        m_cv.notify_all();
+    }
+}
+
+AsyncFrameCapture::~AsyncFrameCapture() {
+    flush();
+    for (auto& slot : m_slots) {
+        if (slot.pbo)
+            glDeleteBuffers(1, &slot.pbo);
+    }
+}
+
+AsyncFrameCapture::Slot& AsyncFrameCapture::acquireSlot(int width,
+                                                        int height, bool hdr) {
+    Slot& slot = m_slots[m_next];
+    m_next = (m_next + 1) % CAPTURE_RING_SIZE;
+    if (slot.fence) {
+        // ring is full, the oldest readback has to complete now
+        m_stalls++;
+        retire(slot);
+    }
+    slot.job.filename.clear();
+    slot.job.sequence.reset();
+    slot.job.width = width;
+    slot.job.height = height;
+    slot.job.channels = 3;
+    slot.job.hdr = hdr;
+    GLsizeiptr size = static_cast<GLsizeiptr>(width) * height *
+                      slot.job.channels * (hdr ? sizeof(float) : 1);
+    if (!slot.pbo)
+        glCreateBuffers(1, &slot.pbo);
+    if (slot.capacity < size) {
+        glNamedBufferData(slot.pbo, size, nullptr, GL_STREAM_READ);
+        slot.capacity = size;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    return slot;
+}
+
+void AsyncFrameCapture::readFramebuffer(Slot& slot, GLuint framebuffer) {
+    GLint previousFramebuffer = 0;
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previousFramebuffer);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    glReadPixels(0, 0, slot.job.width, slot.job.height, GL_RGB,
+                 slot.job.hdr ? GL_FLOAT : GL_UNSIGNED_BYTE, nullptr);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, previousFramebuffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    logPossibleGLError();
+}
+
+void AsyncFrameCapture::readTexture(Slot& slot, const Texture2D& texture) {
+    glGetTextureImage(texture.getId(), 0, GL_RGB,
+                      slot.job.hdr ? GL_FLOAT : GL_UNSIGNED_BYTE,
+                      slot.capacity, nullptr);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    logPossibleGLError();
+}
+
+void AsyncFrameCapture::captureFramebuffer(GLuint framebuffer, int width,
+                                           int height,
+                                           const fs::path& filename) {
+    Slot& slot = acquireSlot(width, height, filename.extension() == ".exr");
+    slot.job.filename = filename;
+    readFramebuffer(slot, framebuffer);
+}
+
+void AsyncFrameCapture::captureTexture(const Texture2D& texture,
+                                       const fs::path& filename) {
+    Slot& slot = acquireSlot(texture.getWidth(), texture.getHeight(),
+                             filename.extension() == ".exr");
+    slot.job.filename = filename;
+    readTexture(slot, texture);
+}
+
+void AsyncFrameCapture::captureFramebuffer(
+    GLuint framebuffer, int width, int height,
+    shared_ptr<FrameSequenceWriter> sequence) {
+    Slot& slot = acquireSlot(width, height, sequence->isHDR());
+    slot.job.sequence = std::move(sequence);
+    readFramebuffer(slot, framebuffer);
+}
+
+void AsyncFrameCapture::captureTexture(
+    const Texture2D& texture, shared_ptr<FrameSequenceWriter> sequence) {
+    Slot& slot = acquireSlot(texture.getWidth(), texture.getHeight(),
+                             sequence->isHDR());
+    slot.job.sequence = std::move(sequence);
+    readTexture(slot, texture);
+}
+
+void AsyncFrameCapture::retire(Slot& slot) {
+    // returns immediately if the fence has signaled
+    glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                     GL_TIMEOUT_IGNORED);
+    glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+
+    // moved out, so the slot does not keep a finished sequence open
+    EncodeJob job = std::move(slot.job);
+    size_t size = static_cast<size_t>(job.width) * job.height * job.channels *
+                  (job.hdr ? sizeof(float) : 1);
+    const void* mapped =
+        glMapNamedBufferRange(slot.pbo, 0, size, GL_MAP_READ_BIT);
+    if (mapped) {
+        job.pixels = m_encoder.acquireBuffer(size);
+        memcpy(job.pixels.data(), mapped, size);
+        glUnmapNamedBuffer(slot.pbo);
+        // blocks while the encoder queue is full
+        m_encoder.submit(std::move(job));
+    } else {
+        LOG(ERROR) << "Failed to map capture buffer for "
+                   << (job.sequence ? job.sequence->getPath()
+                                    : job.filename)
+                          .string();
+    }
+}
+
+void AsyncFrameCapture::update() {
+    // retire in submission order so that files are written in order
+    for (int i = 0; i < CAPTURE_RING_SIZE; i++) {
+        Slot& slot = m_slots[(m_next + i) % CAPTURE_RING_SIZE];
+        if (!slot.fence)
+            continue;
+        GLenum status = glClientWaitSync(slot.fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+            break;
+        retire(slot);
+    }
+}
+
+void AsyncFrameCapture::flush() {
+    for (int i = 0; i < CAPTURE_RING_SIZE; i++) {
+        Slot& slot = m_slots[(m_next + i) % CAPTURE_RING_SIZE];
+        if (slot.fence)
+            retire(slot);
+    }
+    m_encoder.wait();
+}
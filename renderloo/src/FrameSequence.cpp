@@ -0,0 +1,135 @@
+#include "core/FrameSequence.hpp"
+#include <glog/logging.h>
+#include <cstdio>
+#include <string>
+#include "core/ImageWriter.hpp"
+
+using namespace std;
+namespace fs = std::filesystem;
+
+SequenceFormat sequenceFormatFromPath(const fs::path& path) {
+    auto extension = path.extension();
+    if (extension == ".y4m")
+        return SequenceFormat::Y4M;
+    if (extension == ".rgb" || extension == ".raw")
+        return SequenceFormat::Raw;
+    return SequenceFormat::EXR;
+}
+
+namespace {
+// 16.16 fixed point
+constexpr int32_t fixedPoint(double v) {
+    return static_cast<int32_t>(v * 65536.0 + (v < 0.0 ? -0.5 : 0.5));
+}
+constexpr double KR = 0.2126, KB = 0.0722, KG = 1.0 - KR - KB;
+constexpr double Y_SCALE = 219.0 / 255.0, C_SCALE = 224.0 / 255.0;
+constexpr int32_t YR = fixedPoint(Y_SCALE * KR), YG = fixedPoint(Y_SCALE * KG),
+                  YB = fixedPoint(Y_SCALE * KB);
+constexpr int32_t CBR = fixedPoint(-C_SCALE * KR / (2.0 * (1.0 - KB))),
+                  CBG = fixedPoint(-C_SCALE * KG / (2.0 * (1.0 - KB))),
+                  CBB = fixedPoint(C_SCALE * 0.5);
+constexpr int32_t CRR = fixedPoint(C_SCALE * 0.5),
+                  CRG = fixedPoint(-C_SCALE * KG / (2.0 * (1.0 - KR))),
+                  CRB = fixedPoint(-C_SCALE * KB / (2.0 * (1.0 - KR)));
+// offset and rounding folded together, keeps the sums positive
+constexpr int32_t Y_BIAS = (16 << 16) + (1 << 15),
+                  C_BIAS = (128 << 16) + (1 << 15);
+}  // namespace
+
+void rgbToYCbCr444(const uint8_t* rgb, int width, int height, uint8_t* y,
+                   uint8_t* cb, uint8_t* cr) {
+    size_t count = static_cast<size_t>(width) * height;
+    for (size_t i = 0; i < count; i++) {
+        int32_t r = rgb[i * 3], g = rgb[i * 3 + 1], b = rgb[i * 3 + 2];
+        y[i] = static_cast<uint8_t>((YR * r + YG * g + YB * b + Y_BIAS) >> 16);
+        cb[i] =
+            static_cast<uint8_t>((CBR * r + CBG * g + CBB * b + C_BIAS) >> 16);
+        cr[i] =
+            static_cast<uint8_t>((CRR * r + CRG * g + CRB * b + C_BIAS) >> 16);
+    }
+}
+
+FrameSequenceWriter::FrameSequenceWriter(fs::path path, SequenceFormat format,
+                                         int fps)
+    : m_path(std::move(path)), m_format(format), m_fps(fps) {}
+
+FrameSequenceWriter::~FrameSequenceWriter() {
+    if (m_frames == 0)
+        return;
+    LOG(INFO) << "Recorded " << m_frames << " frames to " << m_path.string();
+    if (m_format == SequenceFormat::Raw) {
+        LOG(INFO) << "Play with: ffplay -f rawvideo -pixel_format rgb24 "
+                  << "-video_size " << m_width << "x" << m_height
+                  << " -framerate " << m_fps << " " << m_path.string();
+    }
+}
+
+bool FrameSequenceWriter::open(int width, int height) {
+    m_width = width;
+    m_height = height;
+    if (m_format == SequenceFormat::EXR) {
+        fs::create_directories(m_path);
+        return true;
+    }
+    if (m_path.has_parent_path())
+        fs::create_directories(m_path.parent_path());
+    m_file.open(m_path, ios::binary);
+    if (!m_file) {
+        LOG(ERROR) << "Failed to open " << m_path.string();
+        return false;
+    }
+    if (m_format == SequenceFormat::Y4M) {
+        m_planes.resize(static_cast<size_t>(width) * height * 3);
+        // XCOLORRANGE is understood by ffmpeg, other readers ignore it
+        m_file << "YUV4MPEG2 W" << width << " H" << height << " F" << m_fps
+               << ":1 Ip A1:1 C444 XCOLORRANGE=LIMITED\n";
+    }
+    return static_cast<bool>(m_file);
+}
+
+bool FrameSequenceWriter::write(int width, int height, const void* pixels) {
+    if (m_failed)
+        return false;
+    if (m_frames == 0 && !open(width, height)) {
+        m_failed = true;
+        return false;
+    }
+    if (width != m_width || height != m_height) {
+        LOG(ERROR) << "Frame size changed while recording " << m_path.string()
+                   << ", recording stopped";
+        m_failed = true;
+        return false;
+    }
+    size_t pixelCount = static_cast<size_t>(width) * height;
+    switch (m_format) {
+        case SequenceFormat::Y4M: {
+            uint8_t* y = m_planes.data();
+            rgbToYCbCr444(static_cast<const uint8_t*>(pixels), width, height,
+                          y, y + pixelCount, y + pixelCount * 2);
+            m_file << "FRAME\n";
+            m_file.write(reinterpret_cast<const char*>(m_planes.data()),
+                         m_planes.size());
+            break;
+        }
+        case SequenceFormat::Raw:
+            m_file.write(static_cast<const char*>(pixels), pixelCount * 3);
+            break;
+        case SequenceFormat::EXR: {
+            char filename[32];
+            snprintf(filename, sizeof(filename), "frame_%05d.exr", m_frames);
+            if (!writeEXR(m_path / filename, width, height, 3,
+                          static_cast<const float*>(pixels))) {
+                m_failed = true;
+                return false;
+            }
+            break;
+        }
+    }
+    if (m_format != SequenceFormat::EXR && !m_file) {
+        LOG(ERROR) << "Failed to write " << m_path.string();
+        m_failed = true;
+        return false;
+    }
+    m_frames++;
+    return true;
+}
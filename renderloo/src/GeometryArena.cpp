@@ -0,0 +1,213 @@
+#include "core/GeometryArena.hpp"
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <loo/glError.hpp>
+#include <set>
+#include <type_traits>
+#include "core/Instancing.hpp"
+#include "core/ModelLoader.hpp"
+#include "core/VertexFormat.hpp"
+
+using namespace loo;
+using namespace std;
+
+void narrowIndices(const uint32_t* indices, size_t count, uint16_t* narrow) {
+    for (size_t i = 0; i < count; i++)
+        narrow[i] = static_cast<uint16_t>(indices[i]);
+}
+
+GeometryRange GeometryAllocator::allocate(size_t vertexCount,
+                                          size_t indexBytes,
+                                          size_t indexSize) {
+    if (!m_arenas.empty()) {
+        Arena& arena = m_arenas.back();
+        size_t indexOffset =
+            (arena.indexBytes + indexSize - 1) / indexSize * indexSize;
+        if (arena.vertices + vertexCount <= arena.vertexCapacity &&
+            indexOffset + indexBytes <= arena.indexCapacity) {
+            GeometryRange range{static_cast<uint32_t>(m_arenas.size() - 1),
+                                arena.vertices, indexOffset};
+            arena.vertices += vertexCount;
+            arena.indexBytes = indexOffset + indexBytes;
+            return range;
+        }
+    }
+    Arena arena{std::max(m_vertexCapacity, vertexCount),
+                std::max(m_indexCapacity, indexBytes)};
+    arena.vertices = vertexCount;
+    arena.indexBytes = indexBytes;
+    m_arenas.push_back(arena);
+    return GeometryRange{static_cast<uint32_t>(m_arenas.size() - 1), 0, 0};
+}
+
+GeometryArena::~GeometryArena() {
+    release();
+}
+
+void GeometryArena::release() {
+    for (auto& arena : m_arenas) {
+        glDeleteVertexArrays(1, &arena.vao);
+        GLuint buffers[] = {arena.vertexBuffer, arena.indexBuffer};
+        glDeleteBuffers(2, buffers);
+    }
+    m_arenas.clear();
+    m_draws.clear();
+}
+
+void GeometryArena::build(const Scene& scene,
+                          const std::vector<MeshLODs>* lods,
+                          const MeshInstancing* instancing) {
+    release();
+    const auto& meshes = scene.getMeshes();
+    if (meshes.empty())
+        return;
+    if (lods && lods->size() != meshes.size())
+        lods = nullptr;
+    auto lodIndexCount = [lods](size_t mesh) {
+        return lods ? (*lods)[mesh].indices.size() : 0;
+    };
+    auto isCopy = [instancing](size_t mesh) {
+        return instancing && instancing->getPrototype(mesh) != mesh;
+    };
+    using Vertex =
+        std::decay_t<decltype(meshes.front()->vertices)>::value_type;
+    GeometryAllocator allocator;
+    std::vector<GeometryRange> ranges(meshes.size());
+    size_t arenaBytes = 0;
+    for (size_t i = 0; i < meshes.size(); i++) {
+        const Mesh& mesh = *meshes[i];
+        // empty meshes keep their own vertex array
+        if (mesh.vertices.empty() || mesh.indices.empty() || isCopy(i))
+            continue;
+        size_t indexSize = useShortIndices(mesh.vertices.size())
+                               ? sizeof(uint16_t)
+                               : sizeof(uint32_t);
+        ranges[i] = allocator.allocate(
+            mesh.vertices.size(),
+            (mesh.indices.size() + lodIndexCount(i)) * indexSize, indexSize);
+    }
+    // sized to the content, the arenas of a scene never grow
+    for (auto& usage : allocator.getArenas()) {
+        Arena arena{};
+        glCreateBuffers(1, &arena.vertexBuffer);
+        glNamedBufferStorage(arena.vertexBuffer,
+                             usage.vertices * sizeof(Vertex), nullptr,
+                             GL_DYNAMIC_STORAGE_BIT);
+        glCreateBuffers(1, &arena.indexBuffer);
+        glNamedBufferStorage(arena.indexBuffer, usage.indexBytes, nullptr,
+                             GL_DYNAMIC_STORAGE_BIT);
+        glCreateVertexArrays(1, &arena.vao);
+        copyVertexLayout(meshes.front()->vao, arena.vao);
+        glVertexArrayVertexBuffer(arena.vao, 0, arena.vertexBuffer, 0,
+                                  sizeof(Vertex));
+        glVertexArrayElementBuffer(arena.vao, arena.indexBuffer);
+        m_arenas.push_back(arena);
+        arenaBytes += usage.vertices * sizeof(Vertex) + usage.indexBytes;
+    }
+
+    std::vector<uint16_t> narrow;
+    size_t shortMeshes = 0, savedBytes = 0;
+    for (size_t i = 0; i < meshes.size(); i++) {
+        const Mesh& mesh = *meshes[i];
+        if (mesh.vertices.empty() || mesh.indices.empty() || isCopy(i))
+            continue;
+        const GeometryRange& range = ranges[i];
+        const Arena& arena = m_arenas[range.arena];
+        glNamedBufferSubData(arena.vertexBuffer,
+                             range.firstVertex * sizeof(Vertex),
+                             mesh.vertices.size() * sizeof(Vertex),
+                             mesh.vertices.data());
+        bool shortIndices = useShortIndices(mesh.vertices.size());
+        size_t indexSize = shortIndices ? sizeof(uint16_t) : sizeof(uint32_t);
+        GeometryDraw draw{};
+        draw.vao = arena.vao;
+        draw.indexType = shortIndices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+        draw.baseVertex = static_cast<GLint>(range.firstVertex);
+        draw.levelCount = 1;
+        draw.levels[0] = {static_cast<GLsizei>(mesh.indices.size()),
+                          range.indexOffset};
+        size_t lodOffset = range.indexOffset + mesh.indices.size() * indexSize;
+        if (lods) {
+            for (auto& level : (*lods)[i].levels) {
+                if (draw.levelCount == MESH_LOD_COUNT)
+                    break;
+                draw.levels[draw.levelCount++] = {
+                    static_cast<GLsizei>(level.indexCount),
+                    lodOffset + level.firstIndex * indexSize};
+            }
+        }
+        auto upload = [&](const std::vector<uint32_t>& indices,
+                          size_t offset) {
+            size_t count = indices.size();
+            if (shortIndices) {
+                narrow.resize(count);
+                narrowIndices(indices.data(), count, narrow.data());
+                glNamedBufferSubData(arena.indexBuffer, offset,
+                                     count * sizeof(uint16_t), narrow.data());
+                savedBytes += count * sizeof(uint16_t);
+            } else {
+                glNamedBufferSubData(arena.indexBuffer, offset,
+                                     count * sizeof(uint32_t), indices.data());
+            }
+        };
+        upload(mesh.indices, range.indexOffset);
+        if (lodIndexCount(i))
+            upload((*lods)[i].indices, lodOffset);
+        shortMeshes += shortIndices;
+        m_draws[meshes[i].get()] = draw;
+    }
+    size_t copies = 0;
+    for (size_t i = 0; i < meshes.size(); i++) {
+        if (!isCopy(i))
+            continue;
+        auto it = m_draws.find(meshes[instancing->getPrototype(i)].get());
+        if (it != m_draws.end()) {
+            GeometryDraw draw = it->second;
+            m_draws[meshes[i].get()] = draw;
+            copies++;
+        }
+    }
+    // the arenas hold the only GPU copy of the geometry, the buffers of the
+    // meshes are shrunk to nothing. The names stay valid for their owner(loo
+    // or the scene cache) to delete, immutable buffers are kept.
+    std::set<GLuint> released;
+    size_t releasedBytes = 0;
+    for (auto& mesh : meshes) {
+        if (!m_draws.count(mesh.get()))
+            continue;
+        VertexArrayLayout layout = captureVertexArrayLayout(mesh->vao);
+        std::vector<GLuint> buffers{layout.elementBuffer};
+        for (auto& binding : layout.bindings)
+            buffers.push_back(binding.buffer);
+        for (GLuint buffer : buffers) {
+            if (!buffer || !released.insert(buffer).second)
+                continue;
+            GLint immutable = GL_FALSE;
+            glGetNamedBufferParameteriv(buffer, GL_BUFFER_IMMUTABLE_STORAGE,
+                                        &immutable);
+            if (immutable)
+                continue;
+            GLint64 size = 0;
+            glGetNamedBufferParameteri64v(buffer, GL_BUFFER_SIZE, &size);
+            glNamedBufferData(buffer, 0, nullptr, GL_STATIC_DRAW);
+            releasedBytes += static_cast<size_t>(size);
+        }
+    }
+    panicPossibleGLError();
+    auto netBytes = static_cast<int64_t>(arenaBytes) -
+                    static_cast<int64_t>(releasedBytes);
+    LOG(INFO) << "Suballocated " << m_draws.size() << " meshes from "
+              << m_arenas.size() << " geometry arenas, " << shortMeshes
+              << " with 16 bit indices(" << savedBytes / 1024
+              << " KB of indices saved), " << copies
+              << " instances share the geometry of another mesh";
+    LOG(INFO) << "Geometry arenas take " << arenaBytes / 1024 << " KB, "
+              << releasedBytes / 1024 << " KB of per mesh buffers released, "
+              << netBytes / 1024 << " KB net";
+}
+
+const GeometryDraw* GeometryArena::find(const Mesh* mesh) const {
+    auto it = m_draws.find(mesh);
+    return it == m_draws.end() ? nullptr : &it->second;
+}
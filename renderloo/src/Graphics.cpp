@@ -1,28 +1,162 @@
 #include "core/Graphics.hpp"
+#include <algorithm>
 #include <loo/Shader.hpp>
-#include <loo/UniformBuffer.hpp>
 #include <loo/glError.hpp>
+#include "core/GeometryArena.hpp"
+#include "core/MultiDraw.hpp"
+#include "core/RenderQueue.hpp"
+#include "core/TransformCache.hpp"
 #include "core/Transforms.hpp"
+#include "core/UniformRing.hpp"
 #include "core/constants.hpp"
-void drawMesh(const loo::Mesh& mesh, glm::mat4 transform,
-              glm::mat4 previousTransform, const loo::ShaderProgram& sp) {
-    loo::ShaderProgram::getUniformBlock(SHADER_UB_PORT_MVP)
-        .mapBufferScoped<MVP>([&](MVP& mvp) {
-            mvp.model = transform * mesh.objectMatrix;
-            mvp.normalMatrix = glm::transpose(glm::inverse(mvp.model));
-        });
-    loo::ShaderProgram::getUniformBlock(SHADER_UB_PORT_PREVIOUS_FRAME_MVP)
-        .mapBufferScoped<MVP>([&](MVP& mvp) {
-            mvp.model = previousTransform * mesh.objectMatrixPrev;
-            mvp.normalMatrix = glm::transpose(glm::inverse(mvp.model));
-        });
+
+static MVP cameraMVP{glm::mat4(1.0f)}, prevCameraMVP{glm::mat4(1.0f)};
+
+void setCameraMatrices(const glm::mat4& view, const glm::mat4& projection,
+                       const glm::mat4& prevView,
+                       const glm::mat4& prevProjection) {
+    cameraMVP.view = view;
+    cameraMVP.projection = projection;
+    prevCameraMVP.view = prevView;
+    prevCameraMVP.projection = prevProjection;
+    // full screen passes only read the camera matrices
+    UniformRing::push(SHADER_UB_PORT_MVP, cameraMVP);
+    UniformRing::push(SHADER_UB_PORT_PREVIOUS_FRAME_MVP, prevCameraMVP);
+}
+
+static void pushMeshTransforms(const TransformCache& transforms,
+                               size_t meshIndex) {
+    MVP mvp = cameraMVP;
+    mvp.model = transforms.getWorld(meshIndex);
+    mvp.normalMatrix = transforms.getNormal(meshIndex);
+    UniformRing::push(SHADER_UB_PORT_MVP, mvp);
+    MVP prevMVP = prevCameraMVP;
+    prevMVP.model = transforms.getPreviousWorld(meshIndex);
+    prevMVP.normalMatrix = transforms.getPreviousNormal(meshIndex);
+    UniformRing::push(SHADER_UB_PORT_PREVIOUS_FRAME_MVP, prevMVP);
+}
+
+void drawMesh(const loo::Mesh& mesh, const TransformCache& transforms,
+              size_t meshIndex, const loo::ShaderProgram& sp,
+              const GeometryDraw* geometry) {
+    pushMeshTransforms(transforms, meshIndex);
     glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-    glBindVertexArray(mesh.vao);
+    glBindVertexArray(geometry ? geometry->vao : mesh.vao);
     // bind material uniforms
     mesh.material->bind(sp);
     logPossibleGLError();
-    glDrawElements(GL_TRIANGLES, static_cast<GLuint>(mesh.indices.size()),
-                   GL_UNSIGNED_INT, (void*)(0));
+    if (geometry) {
+        glDrawElementsBaseVertex(
+            GL_TRIANGLES, geometry->levels[0].count, geometry->indexType,
+            reinterpret_cast<const void*>(geometry->levels[0].indexOffset),
+            geometry->baseVertex);
+    } else {
+        glDrawElements(GL_TRIANGLES,
+                       static_cast<GLuint>(mesh.indices.size()),
+                       GL_UNSIGNED_INT, (void*)(0));
+    }
 
     glBindVertexArray(0);
-}
\ No newline at end of file
+}
+
+void drawMesh(const loo::Mesh& mesh, const TransformCache& transforms,
+              size_t meshIndex, const loo::ShaderProgram& sp,
+              RenderStateCache& state, bool bindMaterial,
+              const GeometryDraw* geometry, int lod) {
+    pushMeshTransforms(transforms, meshIndex);
+    state.bindVertexArray(geometry ? geometry->vao : mesh.vao);
+    if (bindMaterial)
+        state.bindMaterial(*mesh.material, sp);
+    if (geometry) {
+        const GeometryDraw::Level& level =
+            geometry->levels[std::min(lod, geometry->levelCount - 1)];
+        glDrawElementsBaseVertex(
+            GL_TRIANGLES, level.count, geometry->indexType,
+            reinterpret_cast<const void*>(level.indexOffset),
+            geometry->baseVertex);
+        state.counters.triangles += level.count / 3;
+    } else {
+        glDrawElements(GL_TRIANGLES,
+                       static_cast<GLuint>(mesh.indices.size()),
+                       GL_UNSIGNED_INT, (void*)(0));
+        state.counters.triangles += static_cast<int>(mesh.indices.size() / 3);
+    }
+    state.counters.draws++;
+}
+
+// transforms of the instances, read by the vertex shaders with
+// gl_InstanceID. Unpacked vertices, the material is bound per draw.
+static void pushInstanceTransforms(const TransformCache& transforms,
+                                   const uint32_t* meshIndices,
+                                   size_t count) {
+    void* data = nullptr;
+    UniformRange range = UniformRing::allocate(
+        static_cast<GLsizeiptr>(count * sizeof(ShaderDrawData)), &data);
+    auto draws = static_cast<ShaderDrawData*>(data);
+    for (size_t i = 0; i < count; i++) {
+        uint32_t meshIndex = meshIndices[i];
+        draws[i] = ShaderDrawData{transforms.getWorld(meshIndex),
+                                  transforms.getPreviousWorld(meshIndex),
+                                  transforms.getNormal(meshIndex),
+                                  glm::uvec4(0), glm::vec4(0.0f),
+                                  glm::vec4(1.0f)};
+    }
+    UniformRing::bindStorage(SHADER_SSBO_PORT_DRAW_DATA, range);
+}
+
+void drawMeshInstances(const loo::Mesh& mesh,
+                       const TransformCache& transforms,
+                       const uint32_t* meshIndices, size_t count,
+                       loo::ShaderProgram& sp, const GeometryDraw* geometry) {
+    pushInstanceTransforms(transforms, meshIndices, count);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    glBindVertexArray(geometry ? geometry->vao : mesh.vao);
+    mesh.material->bind(sp);
+    sp.setUniform("instanced", true);
+    logPossibleGLError();
+    if (geometry) {
+        glDrawElementsInstancedBaseVertex(
+            GL_TRIANGLES, geometry->levels[0].count, geometry->indexType,
+            reinterpret_cast<const void*>(geometry->levels[0].indexOffset),
+            static_cast<GLsizei>(count), geometry->baseVertex);
+    } else {
+        glDrawElementsInstanced(
+            GL_TRIANGLES, static_cast<GLsizei>(mesh.indices.size()),
+            GL_UNSIGNED_INT, (void*)(0), static_cast<GLsizei>(count));
+    }
+    sp.setUniform("instanced", false);
+
+    glBindVertexArray(0);
+}
+
+void drawMeshInstances(const loo::Mesh& mesh,
+                       const TransformCache& transforms,
+                       const uint32_t* meshIndices, size_t count,
+                       loo::ShaderProgram& sp, RenderStateCache& state,
+                       bool bindMaterial, const GeometryDraw* geometry,
+                       int lod) {
+    pushInstanceTransforms(transforms, meshIndices, count);
+    state.bindVertexArray(geometry ? geometry->vao : mesh.vao);
+    if (bindMaterial)
+        state.bindMaterial(*mesh.material, sp);
+    sp.setUniform("instanced", true);
+    auto instances = static_cast<GLsizei>(count);
+    if (geometry) {
+        const GeometryDraw::Level& level =
+            geometry->levels[std::min(lod, geometry->levelCount - 1)];
+        glDrawElementsInstancedBaseVertex(
+            GL_TRIANGLES, level.count, geometry->indexType,
+            reinterpret_cast<const void*>(level.indexOffset), instances,
+            geometry->baseVertex);
+        state.counters.triangles += level.count / 3 * instances;
+    } else {
+        glDrawElementsInstanced(
+            GL_TRIANGLES, static_cast<GLsizei>(mesh.indices.size()),
+            GL_UNSIGNED_INT, (void*)(0), instances);
+        state.counters.triangles +=
+            static_cast<int>(mesh.indices.size() / 3) * instances;
+    }
+    sp.setUniform("instanced", false);
+    state.counters.draws++;
+    state.counters.instancedMeshes += instances;
+}
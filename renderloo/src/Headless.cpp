@@ -0,0 +1,106 @@
+#include "core/Headless.hpp"
+#include <GLFW/glfw3.h>
+#include <glog/logging.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <loo/glError.hpp>
+#include "core/Profiler.hpp"
+#include "core/RenderLoo.hpp"
+
+using namespace loo;
+using namespace std;
+namespace fs = std::filesystem;
+
+void prepareHeadlessContext() {
+#ifdef GLFW_PLATFORM_NULL
+    glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+#endif
+    if (!glfwInit()) {
+        LOG(FATAL) << "Failed to initialize GLFW for headless rendering";
+    }
+    // hints persist until the application creates its window
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+#ifdef GLFW_PLATFORM_NULL
+    glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+#endif
+}
+
+HeadlessStats RenderLoo::runHeadless(const HeadlessOptions& options) {
+    initOffscreenOutput();
+    if (!options.outputDir.empty())
+        fs::create_directories(options.outputDir);
+    LOG(INFO) << "Rendering " << options.frames << " frames headlessly";
+
+    HeadlessStats stats;
+    stats.frameTimes.reserve(options.frames);
+    frameCount = 0;
+    for (int i = 0; i < options.warmupFrames; i++) {
+        if (!options.cameraPath.empty()) {
+            setCameraPose(options.cameraPath.sample(0.0f), options.fov,
+                          options.zNear, options.zFar);
+        }
+        renderFrame(options.deltaTime);
+        frameCount++;
+    }
+    glFinish();
+    GPUProfiler::flush();
+    GPUProfiler::clearHistory();
+
+    if (!options.recordPath.empty()) {
+        startRecording(options.recordPath,
+                       sequenceFormatFromPath(options.recordPath),
+                       static_cast<int>(lround(1.0f / options.deltaTime)));
+    }
+    // the profiler only keeps its last GPU_PROFILER_HISTORY_SIZE frames,
+    // new ones are copied after every frame
+    unsigned lastGPUFrame = 0;
+    auto collectGPUTimings = [&]() {
+        for (auto& frame : GPUProfiler::getHistory()) {
+            if (frame.frame <= lastGPUFrame)
+                continue;
+            stats.gpuFrames.push_back(frame);
+            lastGPUFrame = frame.frame;
+        }
+    };
+    auto start = chrono::steady_clock::now();
+    auto frameStart = start;
+    for (int i = 0; i < options.frames; i++) {
+        float t = options.frames > 1
+                      ? static_cast<float>(i) / (options.frames - 1)
+                      : 0.0f;
+        if (!options.cameraPath.empty()) {
+            setCameraPose(options.cameraPath.sample(t), options.fov,
+                          options.zNear, options.zFar);
+        }
+        renderFrame(options.deltaTime);
+        if (!options.outputDir.empty()) {
+            char filename[32];
+            snprintf(filename, sizeof(filename), "frame_%05d.png", i);
+            m_frameCapture.captureTexture(*m_offscreenOutput,
+                                          options.outputDir / filename);
+        }
+        if (options.finishEachFrame)
+            glFinish();
+        auto frameEnd = chrono::steady_clock::now();
+        stats.frameTimes.push_back(
+            chrono::duration<double, milli>(frameEnd - frameStart).count());
+        frameStart = frameEnd;
+        frameCount++;
+        stats.frames++;
+        collectGPUTimings();
+    }
+    stopRecording();
+    m_frameCapture.flush();
+    glFinish();
+    GPUProfiler::flush();
+    collectGPUTimings();
+    stats.seconds = chrono::duration<double>(chrono::steady_clock::now() -
+                                             start)
+                        .count();
+    logPossibleGLError();
+    LOG(INFO) << "Rendered " << stats.frames << " frames in " << stats.seconds
+              << "s, " << stats.fps() << " frames/s";
+    return stats;
+}
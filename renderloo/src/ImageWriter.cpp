@@ -0,0 +1,135 @@
+#include "core/ImageWriter.hpp"
+#include <glog/logging.h>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+void flipImageRows(void* data, size_t rowBytes, int height) {
+    auto bytes = static_cast<unsigned char*>(data);
+    std::vector<unsigned char> row(rowBytes);
+    for (int y = 0; y < height / 2; y++) {
+        unsigned char* top = bytes + y * rowBytes;
+        unsigned char* bottom = bytes + (height - 1 - y) * rowBytes;
+        memcpy(row.data(), top, rowBytes);
+        memcpy(top, bottom, rowBytes);
+        memcpy(bottom, row.data(), rowBytes);
+    }
+}
+
+namespace {
+// OpenEXR is little endian
+class EXRBuffer {
+   public:
+    void u8(uint8_t v) { m_data.push_back(v); }
+    void i32(int32_t v) { raw(&v, 4); }
+    void u64(uint64_t v) { raw(&v, 8); }
+    void f32(float v) { raw(&v, 4); }
+    void str(const std::string& s) { raw(s.c_str(), s.size() + 1); }
+    void attribute(const std::string& name, const std::string& type,
+                   int32_t size) {
+        str(name);
+        str(type);
+        i32(size);
+    }
+    void raw(const void* p, size_t size) {
+        auto bytes = static_cast<const uint8_t*>(p);
+        m_data.insert(m_data.end(), bytes, bytes + size);
+    }
+    [[nodiscard]] size_t size() const { return m_data.size(); }
+    const std::vector<uint8_t>& data() const { return m_data; }
+
+   private:
+    std::vector<uint8_t> m_data;
+};
+}  // namespace
+
+bool writeEXR(const std::filesystem::path& filename, int width, int height,
+              int channels, const float* data) {
+    // channel names must be sorted alphabetically, index into the source
+    std::vector<std::pair<const char*, int>> channelList;
+    switch (channels) {
+        case 1:
+            channelList = {{"Y", 0}};
+            break;
+        case 3:
+            channelList = {{"B", 2}, {"G", 1}, {"R", 0}};
+            break;
+        case 4:
+            channelList = {{"A", 3}, {"B", 2}, {"G", 1}, {"R", 0}};
+            break;
+        default:
+            LOG(ERROR) << "Unsupported EXR channel count " << channels;
+            return false;
+    }
+    constexpr int32_t PIXEL_TYPE_FLOAT = 2;
+    EXRBuffer header;
+    header.u8(0x76);
+    header.u8(0x2f);
+    header.u8(0x31);
+    header.u8(0x01);
+    // version 2, single part scanline
+    header.i32(2);
+
+    header.attribute("channels", "chlist",
+                     static_cast<int32_t>(channelList.size() * 18 + 1));
+    for (auto& [name, index] : channelList) {
+        header.str(name);
+        header.i32(PIXEL_TYPE_FLOAT);
+        // pLinear + reserved
+        header.i32(0);
+        // x/y sampling
+        header.i32(1);
+        header.i32(1);
+    }
+    header.u8(0);
+    header.attribute("compression", "compression", 1);
+    header.u8(0);
+    for (const char* window : {"dataWindow", "displayWindow"}) {
+        header.attribute(window, "box2i", 16);
+        header.i32(0);
+        header.i32(0);
+        header.i32(width - 1);
+        header.i32(height - 1);
+    }
+    header.attribute("lineOrder", "lineOrder", 1);
+    header.u8(0);
+    header.attribute("pixelAspectRatio", "float", 4);
+    header.f32(1.0f);
+    header.attribute("screenWindowCenter", "v2f", 8);
+    header.f32(0.0f);
+    header.f32(0.0f);
+    header.attribute("screenWindowWidth", "float", 4);
+    header.f32(1.0f);
+    header.u8(0);
+
+    // one scanline per chunk: y(4) + size(4) + pixels
+    const uint64_t lineBytes = static_cast<uint64_t>(width) * channels * 4;
+    const uint64_t chunkStart = header.size() + 8ull * height;
+    for (int y = 0; y < height; y++)
+        header.u64(chunkStart + y * (lineBytes + 8));
+
+    std::ofstream file(filename, std::ios::binary);
+    if (!file) {
+        LOG(ERROR) << "Failed to open " << filename.string();
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(header.data().data()),
+               header.size());
+    std::vector<float> line(width * channels);
+    for (int y = 0; y < height; y++) {
+        const float* row = data + static_cast<size_t>(y) * width * channels;
+        float* dst = line.data();
+        for (auto& [name, index] : channelList) {
+            for (int x = 0; x < width; x++)
+                *dst++ = row[x * channels + index];
+        }
+        int32_t chunkHeader[2] = {y, static_cast<int32_t>(lineBytes)};
+        file.write(reinterpret_cast<const char*>(chunkHeader), 8);
+        file.write(reinterpret_cast<const char*>(line.data()), lineBytes);
+    }
+    return static_cast<bool>(file);
+}
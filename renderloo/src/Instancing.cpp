@@ -0,0 +1,92 @@
+#include "core/Instancing.hpp"
+#include <glog/logging.h>
+
+#include <cstring>
+#include <unordered_map>
+#include "core/JobSystem.hpp"
+#include "core/MappedFile.hpp"
+#include "core/PBRMaterials.hpp"
+
+using namespace loo;
+using namespace std;
+
+uint64_t hashMeshGeometry(const Mesh& mesh) {
+    uint64_t hash = hashBytes(mesh.vertices.data(),
+                              mesh.vertices.size() * sizeof(mesh.vertices[0]));
+    return hashBytes(mesh.indices.data(),
+                     mesh.indices.size() * sizeof(mesh.indices[0]), hash);
+}
+
+std::vector<uint64_t> hashSceneGeometry(const Scene& scene) {
+    const auto& meshes = scene.getMeshes();
+    std::vector<uint64_t> hashes(meshes.size());
+    JobSystem::parallelFor(
+        static_cast<int>(meshes.size()), 4, [&](int first, int last) {
+            for (int i = first; i < last; i++)
+                hashes[i] = hashMeshGeometry(*meshes[i]);
+        });
+    return hashes;
+}
+
+bool isSameMaterial(const Material* a, const Material* b) {
+    if (a == b)
+        return true;
+    auto pa = dynamic_cast<const PBRMetallicMaterial*>(a);
+    auto pb = dynamic_cast<const PBRMetallicMaterial*>(b);
+    return pa && pb && pa->getContentKey() == pb->getContentKey();
+}
+
+std::vector<uint32_t> groupInstances(
+    const std::vector<uint64_t>& hashes,
+    const std::function<bool(size_t, size_t)>& equal) {
+    std::vector<uint32_t> prototypes(hashes.size());
+    // prototypes seen per hash, usually one
+    std::unordered_map<uint64_t, std::vector<uint32_t>> seen;
+    for (size_t i = 0; i < hashes.size(); i++) {
+        auto& candidates = seen[hashes[i]];
+        prototypes[i] = static_cast<uint32_t>(i);
+        for (uint32_t candidate : candidates) {
+            if (equal(candidate, i)) {
+                prototypes[i] = candidate;
+                break;
+            }
+        }
+        if (prototypes[i] == i)
+            candidates.push_back(static_cast<uint32_t>(i));
+    }
+    return prototypes;
+}
+
+void MeshInstancing::build(const Scene& scene,
+                           const std::vector<uint64_t>& geometryHashes) {
+    const auto& meshes = scene.getMeshes();
+    std::vector<uint64_t> computed;
+    const std::vector<uint64_t>* hashes = &geometryHashes;
+    if (geometryHashes.size() != meshes.size()) {
+        computed = hashSceneGeometry(scene);
+        hashes = &computed;
+    }
+    m_prototypes = groupInstances(*hashes, [&](size_t a, size_t b) {
+        const Mesh &ma = *meshes[a], &mb = *meshes[b];
+        return ma.vertices.size() == mb.vertices.size() &&
+               ma.indices.size() == mb.indices.size() &&
+               !ma.vertices.empty() && !ma.indices.empty() &&
+               isSameMaterial(ma.material.get(), mb.material.get()) &&
+               memcmp(ma.vertices.data(), mb.vertices.data(),
+                      ma.vertices.size() * sizeof(ma.vertices[0])) == 0 &&
+               memcmp(ma.indices.data(), mb.indices.data(),
+                      ma.indices.size() * sizeof(ma.indices[0])) == 0;
+    });
+    std::vector<int> copies(meshes.size(), 0);
+    for (uint32_t prototype : m_prototypes)
+        copies[prototype]++;
+    m_groups = m_instancedMeshes = 0;
+    for (int count : copies) {
+        if (count > 1) {
+            m_groups++;
+            m_instancedMeshes += count;
+        }
+    }
+    LOG(INFO) << "Found " << m_instancedMeshes << " meshes in " << m_groups
+              << " instance groups";
+}
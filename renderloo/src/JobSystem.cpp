@@ -0,0 +1,236 @@
+#include "core/JobSystem.hpp"
+#include <glog/logging.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <thread>
+
+using namespace std;
+
+namespace {
+struct JobQueue {
+    std::mutex mutex;
+    std::deque<JobHandle> jobs;
+};
+
+struct PoolState {
+    // queue 0 is shared by the threads that are not workers
+    std::vector<std::unique_ptr<JobQueue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<int> queued{0};
+    std::mutex sleepMutex;
+    std::condition_variable sleepCv;
+    bool quit{false};
+
+    std::atomic<int> jobs{0}, steals{0};
+    std::atomic<int64_t> busyNanoseconds{0};
+    std::chrono::steady_clock::time_point frameStart{
+        std::chrono::steady_clock::now()};
+    JobStatistics statistics;
+
+    ~PoolState() { stop(); }
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            quit = true;
+        }
+        sleepCv.notify_all();
+        for (auto& worker : workers)
+            worker.join();
+        workers.clear();
+        queues.clear();
+        quit = false;
+    }
+};
+PoolState pool;
+thread_local int currentQueue = 0;
+
+void run(const JobHandle& job);
+
+void push(const JobHandle& job) {
+    // nobody would pick it up
+    if (pool.workers.empty()) {
+        run(job);
+        return;
+    }
+    JobQueue& queue = *pool.queues[currentQueue];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.jobs.push_back(job);
+    }
+    pool.queued++;
+    // a worker going to sleep checks queued under this lock
+    { std::lock_guard<std::mutex> lock(pool.sleepMutex); }
+    pool.sleepCv.notify_one();
+}
+
+void finish(const JobHandle& job) {
+    std::vector<JobHandle> continuations;
+    {
+        std::lock_guard<std::mutex> lock(job->mutex);
+        job->finished = true;
+        continuations.swap(job->continuations);
+    }
+    for (auto& next : continuations) {
+        if (--next->dependencies == 0)
+            push(next);
+    }
+}
+
+void run(const JobHandle& job) {
+    auto start = std::chrono::steady_clock::now();
+    job->function();
+    pool.busyNanoseconds +=
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start)
+            .count();
+    pool.jobs++;
+    finish(job);
+}
+
+// own queue from the back(most recent, still in cache), others from the
+// front(oldest, usually the largest remaining work)
+JobHandle findJob() {
+    if (pool.queued.load() == 0)
+        return nullptr;
+    int count = static_cast<int>(pool.queues.size());
+    for (int i = 0; i < count; i++) {
+        JobQueue& queue = *pool.queues[(currentQueue + i) % count];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.jobs.empty())
+            continue;
+        JobHandle job;
+        if (i == 0) {
+            job = std::move(queue.jobs.back());
+            queue.jobs.pop_back();
+        } else {
+            job = std::move(queue.jobs.front());
+            queue.jobs.pop_front();
+            pool.steals++;
+        }
+        pool.queued--;
+        return job;
+    }
+    return nullptr;
+}
+
+void workerLoop(int index) {
+    currentQueue = index;
+    while (true) {
+        if (JobHandle job = findJob()) {
+            run(job);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(pool.sleepMutex);
+        pool.sleepCv.wait(lock,
+                          [] { return pool.quit || pool.queued.load() > 0; });
+        if (pool.quit)
+            return;
+    }
+}
+
+// run other jobs until done() holds
+template <typename Predicate>
+void helpUntil(Predicate done) {
+    while (!done()) {
+        if (JobHandle job = findJob())
+            run(job);
+        else
+            std::this_thread::yield();
+    }
+}
+}  // namespace
+
+void JobSystem::init(int workers) {
+    if (!pool.queues.empty())
+        return;
+    if (workers < 0)
+        workers = static_cast<int>(std::thread::hardware_concurrency()) - 1;
+    workers = std::max(workers, 0);
+    for (int i = 0; i <= workers; i++)
+        pool.queues.push_back(std::make_unique<JobQueue>());
+    for (int i = 1; i <= workers; i++)
+        pool.workers.emplace_back(workerLoop, i);
+    pool.frameStart = std::chrono::steady_clock::now();
+    LOG(INFO) << "Job system: " << workers << " workers";
+}
+
+void JobSystem::shutdown() {
+    pool.stop();
+}
+
+int JobSystem::getWorkerCount() {
+    return static_cast<int>(pool.workers.size());
+}
+
+JobHandle JobSystem::createJob(std::function<void()> function) {
+    auto job = std::make_shared<Job>();
+    job->function = std::move(function);
+    return job;
+}
+
+void JobSystem::addDependency(const JobHandle& before,
+                              const JobHandle& after) {
+    std::lock_guard<std::mutex> lock(before->mutex);
+    if (before->finished)
+        return;
+    after->dependencies++;
+    before->continuations.push_back(after);
+}
+
+void JobSystem::submit(const JobHandle& job) {
+    if (--job->dependencies == 0)
+        push(job);
+}
+
+void JobSystem::wait(const JobHandle& job) {
+    helpUntil([&] { return job->finished.load(); });
+}
+
+void JobSystem::parallelFor(int count, int grain,
+                            const std::function<void(int, int)>& body) {
+    if (count <= 0)
+        return;
+    int chunks = (count + std::max(grain, 1) - 1) / std::max(grain, 1);
+    // a few chunks per thread leave something to steal
+    chunks = std::min(chunks, (getWorkerCount() + 1) * 4);
+    if (chunks <= 1 || pool.workers.empty()) {
+        body(0, count);
+        return;
+    }
+    std::atomic<int> remaining{chunks - 1};
+    for (int i = 1; i < chunks; i++) {
+        submit(createJob([&, i] {
+            body(count * i / chunks, count * (i + 1) / chunks);
+            remaining--;
+        }));
+    }
+    body(0, count / chunks);
+    helpUntil([&] { return remaining.load() == 0; });
+}
+
+void JobSystem::newFrame() {
+    auto now = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double, std::nano>(
+                         now - pool.frameStart)
+                         .count();
+    pool.frameStart = now;
+    JobStatistics& statistics = pool.statistics;
+    statistics.workers = getWorkerCount();
+    statistics.jobs = pool.jobs.exchange(0);
+    statistics.steals = pool.steals.exchange(0);
+    statistics.stealRate =
+        statistics.jobs > 0
+            ? static_cast<float>(statistics.steals) / statistics.jobs
+            : 0.f;
+    double busy = static_cast<double>(pool.busyNanoseconds.exchange(0));
+    statistics.utilization =
+        elapsed > 0
+            ? static_cast<float>(busy / (elapsed * (statistics.workers + 1)))
+            : 0.f;
+}
+
+const JobStatistics& JobSystem::getStatistics() {
+    return pool.statistics;
+}
@@ -0,0 +1,342 @@
+#include "core/MeshLOD.hpp"
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <iterator>
+#include <numeric>
+#include <type_traits>
+#include "core/JobSystem.hpp"
+#include "core/MeshOptimizer.hpp"
+
+using namespace loo;
+using namespace std;
+
+void MeshSimplifier::Quadric::addPlane(const glm::dvec4& plane) {
+    int k = 0;
+    for (int i = 0; i < 4; i++) {
+        for (int j = i; j < 4; j++)
+            a[k++] += plane[i] * plane[j];
+    }
+}
+
+MeshSimplifier::Quadric& MeshSimplifier::Quadric::operator+=(
+    const Quadric& other) {
+    for (int i = 0; i < 10; i++)
+        a[i] += other.a[i];
+    return *this;
+}
+
+double MeshSimplifier::Quadric::evaluate(const glm::vec3& p) const {
+    double x = p.x, y = p.y, z = p.z;
+    // v^T Q v with v = (x, y, z, 1)
+    return a[0] * x * x + 2 * a[1] * x * y + 2 * a[2] * x * z + 2 * a[3] * x +
+           a[4] * y * y + 2 * a[5] * y * z + 2 * a[6] * y + a[7] * z * z +
+           2 * a[8] * z + a[9];
+}
+
+MeshSimplifier::MeshSimplifier(const std::vector<glm::vec3>& positions,
+                               const std::vector<uint32_t>& indices)
+    : m_positions(positions),
+      m_indices(indices.begin(),
+                indices.begin() +
+                    static_cast<std::ptrdiff_t>(indices.size() / 3 * 3)),
+      m_quadrics(positions.size()),
+      m_locked(positions.size(), 0) {
+    for (size_t i = 0; i < m_indices.size(); i += 3) {
+        const glm::vec3 &p0 = positions[m_indices[i]],
+                        &p1 = positions[m_indices[i + 1]],
+                        &p2 = positions[m_indices[i + 2]];
+        glm::dvec3 normal = glm::cross(glm::dvec3(p1 - p0),
+                                       glm::dvec3(p2 - p0));
+        double length = glm::length(normal);
+        if (length == 0.0)
+            continue;
+        normal /= length;
+        glm::dvec4 plane(normal, -glm::dot(normal, glm::dvec3(p0)));
+        for (int k = 0; k < 3; k++)
+            m_quadrics[m_indices[i + k]].addPlane(plane);
+    }
+    // borders and seams: edges not shared by exactly two triangles
+    std::vector<uint64_t> edges;
+    edges.reserve(m_indices.size());
+    for (size_t i = 0; i < m_indices.size(); i += 3) {
+        for (int k = 0; k < 3; k++) {
+            uint64_t a = m_indices[i + k], b = m_indices[i + (k + 1) % 3];
+            edges.push_back(std::min(a, b) << 32 | std::max(a, b));
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+    for (size_t first = 0; first < edges.size();) {
+        size_t last = first;
+        while (last < edges.size() && edges[last] == edges[first])
+            last++;
+        if (last - first != 2) {
+            m_locked[edges[first] >> 32] = 1;
+            m_locked[edges[first] & 0xffffffffu] = 1;
+        }
+        first = last;
+    }
+}
+
+bool MeshSimplifier::canCollapse(uint32_t u, uint32_t v) {
+    // the neighbors u and v have in common must be the vertices opposite
+    // the edge, otherwise the collapse pinches the surface
+    auto& neighborsU = m_neighbors[0];
+    auto& neighborsV = m_neighbors[1];
+    neighborsU.clear();
+    neighborsV.clear();
+    size_t shared = 0;
+    for (uint32_t i = m_adjacencyOffsets[u]; i < m_adjacencyOffsets[u + 1];
+         i++) {
+        const uint32_t* triangle = &m_indices[3 * m_adjacency[i]];
+        bool hasV = false;
+        glm::vec3 p[3], q[3];
+        for (int k = 0; k < 3; k++) {
+            hasV = hasV || triangle[k] == v;
+            if (triangle[k] != u)
+                neighborsU.push_back(triangle[k]);
+            p[k] = m_positions[triangle[k]];
+            q[k] = triangle[k] == u ? m_positions[v] : p[k];
+        }
+        if (hasV) {
+            shared++;
+            continue;
+        }
+        glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]),
+                  after = glm::cross(q[1] - q[0], q[2] - q[0]);
+        float lengths = glm::length(before) * glm::length(after);
+        if (glm::length(after) == 0.f ||
+            glm::dot(before, after) < MESH_LOD_MIN_NORMAL_DOT * lengths)
+            return false;
+    }
+    for (uint32_t i = m_adjacencyOffsets[v]; i < m_adjacencyOffsets[v + 1];
+         i++) {
+        const uint32_t* triangle = &m_indices[3 * m_adjacency[i]];
+        for (int k = 0; k < 3; k++) {
+            if (triangle[k] != v)
+                neighborsV.push_back(triangle[k]);
+        }
+    }
+    for (auto* neighbors : {&neighborsU, &neighborsV}) {
+        std::sort(neighbors->begin(), neighbors->end());
+        neighbors->erase(std::unique(neighbors->begin(), neighbors->end()),
+                         neighbors->end());
+    }
+    m_common.clear();
+    std::set_intersection(neighborsU.begin(), neighborsU.end(),
+                          neighborsV.begin(), neighborsV.end(),
+                          std::back_inserter(m_common));
+    return m_common.size() <= shared;
+}
+
+void MeshSimplifier::simplify(size_t targetIndexCount, float maxError) {
+    const double maxCost = static_cast<double>(maxError) * maxError;
+    const size_t vertexCount = m_positions.size();
+    struct Collapse {
+        double cost;
+        uint32_t u, v;
+    };
+    std::vector<Collapse> collapses;
+    std::vector<uint32_t> remap(vertexCount);
+    std::vector<uint8_t> touched(vertexCount);
+    // a pass collapses the cheapest edges whose fans do not overlap, then
+    // the adjacency is rebuilt
+    while (m_indices.size() > targetIndexCount) {
+        m_adjacencyOffsets.assign(vertexCount + 1, 0);
+        for (uint32_t index : m_indices)
+            m_adjacencyOffsets[index + 1]++;
+        std::partial_sum(m_adjacencyOffsets.begin(), m_adjacencyOffsets.end(),
+                         m_adjacencyOffsets.begin());
+        m_adjacency.resize(m_indices.size());
+        std::vector<uint32_t> cursor(m_adjacencyOffsets.begin(),
+                                     m_adjacencyOffsets.end() - 1);
+        for (size_t i = 0; i < m_indices.size(); i++)
+            m_adjacency[cursor[m_indices[i]]++] = static_cast<uint32_t>(i / 3);
+
+        collapses.clear();
+        for (size_t i = 0; i < m_indices.size(); i += 3) {
+            for (int k = 0; k < 3; k++) {
+                uint32_t a = m_indices[i + k], b = m_indices[i + (k + 1) % 3];
+                // interior edges show up once per direction
+                if (a >= b)
+                    continue;
+                Quadric quadric = m_quadrics[a];
+                quadric += m_quadrics[b];
+                if (!m_locked[a])
+                    collapses.push_back(
+                        Collapse{quadric.evaluate(m_positions[b]), a, b});
+                if (!m_locked[b])
+                    collapses.push_back(
+                        Collapse{quadric.evaluate(m_positions[a]), b, a});
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(),
+                  [](const Collapse& a, const Collapse& b) {
+                      return a.cost < b.cost;
+                  });
+
+        std::iota(remap.begin(), remap.end(), 0u);
+        std::fill(touched.begin(), touched.end(), 0);
+        const size_t removable = (m_indices.size() - targetIndexCount) / 3;
+        size_t removed = 0, performed = 0;
+        for (const Collapse& collapse : collapses) {
+            if (collapse.cost > maxCost || removed >= removable)
+                break;
+            uint32_t u = collapse.u, v = collapse.v;
+            if (touched[u] || touched[v] || !canCollapse(u, v))
+                continue;
+            // the fan of u changes, its vertices wait for the next pass
+            for (uint32_t i = m_adjacencyOffsets[u];
+                 i < m_adjacencyOffsets[u + 1]; i++) {
+                const uint32_t* triangle = &m_indices[3 * m_adjacency[i]];
+                bool hasV = false;
+                for (int k = 0; k < 3; k++) {
+                    touched[triangle[k]] = 1;
+                    hasV = hasV || triangle[k] == v;
+                }
+                removed += hasV;
+            }
+            remap[u] = v;
+            m_quadrics[v] += m_quadrics[u];
+            m_error = std::max(
+                m_error,
+                static_cast<float>(std::sqrt(std::max(collapse.cost, 0.0))));
+            performed++;
+        }
+        if (performed == 0)
+            break;
+        size_t count = 0;
+        for (size_t i = 0; i < m_indices.size(); i += 3) {
+            uint32_t a = remap[m_indices[i]], b = remap[m_indices[i + 1]],
+                     c = remap[m_indices[i + 2]];
+            if (a == b || b == c || a == c)
+                continue;
+            m_indices[count++] = a;
+            m_indices[count++] = b;
+            m_indices[count++] = c;
+        }
+        m_indices.resize(count);
+    }
+}
+
+MeshLODs generateMeshLODs(const std::vector<glm::vec3>& positions,
+                          const std::vector<uint32_t>& indices) {
+    MeshLODs lods;
+    if (indices.size() < MESH_LOD_MIN_TRIANGLES * 3)
+        return lods;
+    glm::vec3 min(FLT_MAX), max(-FLT_MAX);
+    for (auto& position : positions) {
+        min = glm::min(min, position);
+        max = glm::max(max, position);
+    }
+    float maxError = glm::length(max - min) * 0.5f * MESH_LOD_MAX_ERROR;
+    MeshSimplifier simplifier(positions, indices);
+    size_t previous = indices.size();
+    for (int level = 1; level < MESH_LOD_COUNT; level++) {
+        auto target = static_cast<size_t>(
+                          static_cast<float>(previous / 3) *
+                          MESH_LOD_REDUCTION) *
+                      3;
+        simplifier.simplify(target, maxError);
+        const auto& simplified = simplifier.getIndices();
+        if (simplified.empty() ||
+            static_cast<float>(simplified.size()) >
+                static_cast<float>(previous) * MESH_LOD_MIN_REDUCTION)
+            break;
+        MeshLODLevel lod{static_cast<uint32_t>(lods.indices.size()),
+                         static_cast<uint32_t>(simplified.size()),
+                         simplifier.getError()};
+        lods.indices.insert(lods.indices.end(), simplified.begin(),
+                            simplified.end());
+        // the collapses keep the triangle order of the full mesh
+        optimizeVertexCache(lods.indices.data() + lod.firstIndex,
+                            lod.indexCount, positions.size());
+        lods.levels.push_back(lod);
+        previous = simplified.size();
+    }
+    return lods;
+}
+
+std::vector<MeshLODs> generateSceneLODs(const Scene& scene) {
+    const auto& meshes = scene.getMeshes();
+    using Index = std::decay_t<decltype(Mesh::indices)>::value_type;
+    static_assert(std::is_same_v<Index, uint32_t>,
+                  "levels are generated from uint32_t indices");
+    std::vector<MeshLODs> lods(meshes.size());
+    JobSystem::parallelFor(
+        static_cast<int>(meshes.size()), 1, [&](int first, int last) {
+            for (int i = first; i < last; i++)
+                lods[i] = generateMeshLODs(meshes[i]->vertices,
+                                           meshes[i]->indices);
+        });
+    size_t triangles = 0, simplified = 0;
+    for (size_t i = 0; i < meshes.size(); i++) {
+        triangles += meshes[i]->indices.size() / 3;
+        if (!lods[i].levels.empty())
+            simplified += lods[i].levels.back().indexCount / 3;
+        else
+            simplified += meshes[i]->indices.size() / 3;
+    }
+    LOG(INFO) << "Generated mesh LODs, " << triangles
+              << " triangles at level 0, " << simplified
+              << " at the coarsest levels";
+    return lods;
+}
+
+float getLODPixelScale(const glm::mat4& world, const glm::vec3& center,
+                       float radius, const glm::vec3& cameraPosition,
+                       float projectionScale) {
+    glm::vec3 worldCenter(world * glm::vec4(center, 1.0f));
+    float scale = std::max({glm::length(glm::vec3(world[0])),
+                            glm::length(glm::vec3(world[1])),
+                            glm::length(glm::vec3(world[2]))});
+    float distance = glm::length(worldCenter - cameraPosition) - radius * scale;
+    // inside the bounding sphere
+    if (distance <= 0.f)
+        return FLT_MAX;
+    return projectionScale * scale / distance;
+}
+
+int selectMeshLOD(const MeshLODs& lods, float pixelScale, float pixelError) {
+    int level = 0;
+    for (auto& lod : lods.levels) {
+        if (lod.error * pixelScale > pixelError)
+            break;
+        level++;
+    }
+    return level;
+}
+
+void LODSelector::setScene(const Scene& scene, std::vector<MeshLODs>&& lods) {
+    const auto& meshes = scene.getMeshes();
+    m_lods = std::move(lods);
+    if (m_lods.size() != meshes.size())
+        m_lods.clear();
+    m_spheres.clear();
+    for (auto& mesh : meshes)
+        m_spheres.emplace_back(mesh->aabb.getCenter(),
+                               glm::length(mesh->aabb.getDiagonal()) * 0.5f);
+    m_levels.assign(meshes.size(), 0);
+    m_shadowLevels.assign(meshes.size(), 0);
+}
+
+void LODSelector::select(const TransformCache& transforms,
+                         const glm::vec3& cameraPosition,
+                         float projectionScale) {
+    if (!enabled || m_lods.empty())
+        return;
+    JobSystem::parallelFor(
+        static_cast<int>(m_lods.size()), 256, [&](int first, int last) {
+            for (int i = first; i < last; i++) {
+                float scale = getLODPixelScale(
+                    transforms.getWorld(i), glm::vec3(m_spheres[i]),
+                    m_spheres[i].w, cameraPosition, projectionScale);
+                m_levels[i] = static_cast<uint8_t>(
+                    selectMeshLOD(m_lods[i], scale, pixelError));
+                m_shadowLevels[i] = static_cast<uint8_t>(
+                    selectMeshLOD(m_lods[i], scale, shadowPixelError));
+            }
+        });
+}
@@ -0,0 +1,300 @@
+#include "core/MeshOptimizer.hpp"
+#include <glog/logging.h>
+#include <loo/glError.hpp>
+
+#include <algorithm>
+#include <numeric>
+#include <type_traits>
+#include "core/JobSystem.hpp"
+#include "core/ModelLoader.hpp"
+
+using namespace loo;
+using namespace std;
+
+namespace {
+constexpr uint32_t NO_VERTEX = ~0u;
+
+// timestamps instead of a queue: a vertex is cached while fewer than size
+// misses happened since its own
+class FifoCache {
+   public:
+    FifoCache(size_t vertexCount, int size)
+        : m_times(vertexCount, 0),
+          m_size(static_cast<uint32_t>(size)),
+          m_timestamp(m_size + 1) {}
+    // true on a miss
+    bool access(uint32_t vertex) {
+        if (m_timestamp - m_times[vertex] <= m_size)
+            return false;
+        m_times[vertex] = m_timestamp++;
+        return true;
+    }
+    [[nodiscard]] bool contains(uint32_t vertex) const {
+        return m_timestamp - m_times[vertex] <= m_size;
+    }
+    // misses since the vertex entered, at most size while it is cached
+    [[nodiscard]] uint32_t age(uint32_t vertex) const {
+        return m_timestamp - m_times[vertex];
+    }
+    void flush() { m_timestamp += m_size + 1; }
+
+   private:
+    std::vector<uint32_t> m_times;
+    uint32_t m_size;
+    uint32_t m_timestamp;
+};
+
+// triangles around every vertex
+struct Adjacency {
+    std::vector<uint32_t> offsets, triangles;
+    Adjacency(const uint32_t* indices, size_t indexCount, size_t vertexCount)
+        : offsets(vertexCount + 1, 0), triangles(indexCount) {
+        for (size_t i = 0; i < indexCount; i++)
+            offsets[indices[i] + 1]++;
+        std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+        std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < indexCount; i++)
+            triangles[cursor[indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+};
+}  // namespace
+
+VertexCacheStatistics analyzeVertexCache(const uint32_t* indices,
+                                         size_t indexCount,
+                                         size_t vertexCount, int cacheSize) {
+    VertexCacheStatistics statistics;
+    statistics.triangles = indexCount / 3;
+    FifoCache cache(vertexCount, cacheSize);
+    std::vector<bool> referenced(vertexCount, false);
+    for (size_t i = 0; i < indexCount; i++) {
+        statistics.transformed += cache.access(indices[i]);
+        if (!referenced[indices[i]]) {
+            referenced[indices[i]] = true;
+            statistics.vertices++;
+        }
+    }
+    return statistics;
+}
+
+void optimizeVertexCache(uint32_t* indices, size_t indexCount,
+                         size_t vertexCount, std::vector<uint32_t>* clusters,
+                         int cacheSize) {
+    size_t triangleCount = indexCount / 3;
+    if (clusters)
+        clusters->clear();
+    if (triangleCount == 0)
+        return;
+    Adjacency adjacency(indices, indexCount, vertexCount);
+    // triangles left around each vertex
+    std::vector<uint32_t> live(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++)
+        live[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> deadEnd, candidates, output;
+    output.reserve(triangleCount * 3);
+    FifoCache cache(vertexCount, cacheSize);
+    uint32_t fanning = indices[0];
+    size_t cursor = 0;
+    bool cold = true;
+    while (fanning != NO_VERTEX) {
+        candidates.clear();
+        for (uint32_t i = adjacency.offsets[fanning];
+             i < adjacency.offsets[fanning + 1]; i++) {
+            uint32_t triangle = adjacency.triangles[i];
+            if (emitted[triangle])
+                continue;
+            if (cold && clusters)
+                clusters->push_back(
+                    static_cast<uint32_t>(output.size() / 3));
+            cold = false;
+            for (int k = 0; k < 3; k++) {
+                uint32_t v = indices[triangle * 3 + k];
+                output.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+                cache.access(v);
+            }
+            emitted[triangle] = true;
+        }
+        // the candidate that stays in the cache the longest while its
+        // remaining triangles are emitted
+        fanning = NO_VERTEX;
+        int bestPriority = -1;
+        for (uint32_t v : candidates) {
+            if (live[v] == 0)
+                continue;
+            int priority = 0;
+            if (cache.age(v) + 2 * live[v] <= static_cast<uint32_t>(cacheSize))
+                priority = static_cast<int>(cache.age(v));
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                fanning = v;
+            }
+        }
+        if (fanning != NO_VERTEX)
+            continue;
+        // dead end: a recent vertex, or the next one with triangles left
+        while (!deadEnd.empty() && fanning == NO_VERTEX) {
+            uint32_t v = deadEnd.back();
+            deadEnd.pop_back();
+            if (live[v] > 0)
+                fanning = v;
+        }
+        if (fanning != NO_VERTEX && cache.contains(fanning))
+            continue;
+        while (fanning == NO_VERTEX && cursor < vertexCount) {
+            if (live[cursor] > 0)
+                fanning = static_cast<uint32_t>(cursor);
+            cursor++;
+        }
+        cold = true;
+    }
+    std::copy(output.begin(), output.end(), indices);
+}
+
+void optimizeOverdraw(uint32_t* indices, size_t indexCount,
+                      const std::vector<glm::vec3>& positions,
+                      const std::vector<uint32_t>& clusters, float threshold,
+                      int cacheSize) {
+    size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0)
+        return;
+    std::vector<uint32_t> hard = clusters;
+    if (hard.empty() || hard.front() != 0)
+        hard.insert(hard.begin(), 0);
+    // soft boundaries: cut as soon as the run is about as cache friendly as
+    // its whole hard cluster
+    std::vector<uint32_t> starts;
+    FifoCache cache(positions.size(), cacheSize);
+    for (size_t c = 0; c < hard.size(); c++) {
+        uint32_t first = hard[c];
+        uint32_t last = c + 1 < hard.size()
+                            ? hard[c + 1]
+                            : static_cast<uint32_t>(triangleCount);
+        cache.flush();
+        uint32_t misses = 0;
+        for (uint32_t i = first * 3; i < last * 3; i++)
+            misses += cache.access(indices[i]);
+        float target = threshold * misses / float(last - first);
+        cache.flush();
+        starts.push_back(first);
+        uint32_t runMisses = 0, runTriangles = 0;
+        for (uint32_t t = first; t < last; t++) {
+            for (int k = 0; k < 3; k++)
+                runMisses += cache.access(indices[t * 3 + k]);
+            runTriangles++;
+            if (t + 1 < last && runMisses <= target * runTriangles) {
+                starts.push_back(t + 1);
+                cache.flush();
+                runMisses = runTriangles = 0;
+            }
+        }
+    }
+
+    struct Cluster {
+        uint32_t first, last;
+        glm::vec3 centroid{0.f}, normal{0.f};
+        float area{0.f}, sortKey{0.f};
+    };
+    std::vector<Cluster> sorted(starts.size());
+    glm::vec3 meshCentroid{0.f};
+    float meshArea = 0.f;
+    for (size_t c = 0; c < starts.size(); c++) {
+        Cluster& cluster = sorted[c];
+        cluster.first = starts[c];
+        cluster.last = c + 1 < starts.size()
+                           ? starts[c + 1]
+                           : static_cast<uint32_t>(triangleCount);
+        for (uint32_t t = cluster.first; t < cluster.last; t++) {
+            const glm::vec3& a = positions[indices[t * 3]];
+            const glm::vec3& b = positions[indices[t * 3 + 1]];
+            const glm::vec3& d = positions[indices[t * 3 + 2]];
+            glm::vec3 normal = glm::cross(b - a, d - a);
+            float area = glm::length(normal);
+            cluster.centroid += (a + b + d) * (area / 3.f);
+            cluster.normal += normal;
+            cluster.area += area;
+        }
+        meshCentroid += cluster.centroid;
+        meshArea += cluster.area;
+        if (cluster.area > 0.f)
+            cluster.centroid /= cluster.area;
+    }
+    if (meshArea > 0.f)
+        meshCentroid /= meshArea;
+    for (auto& cluster : sorted) {
+        float length = glm::length(cluster.normal);
+        if (length > 0.f)
+            cluster.sortKey =
+                glm::dot(cluster.centroid - meshCentroid, cluster.normal) /
+                length;
+    }
+    std::stable_sort(sorted.begin(), sorted.end(),
+                     [](const Cluster& a, const Cluster& b) {
+                         return a.sortKey > b.sortKey;
+                     });
+    std::vector<uint32_t> output;
+    output.reserve(triangleCount * 3);
+    for (auto& cluster : sorted)
+        output.insert(output.end(), indices + cluster.first * 3,
+                      indices + cluster.last * 3);
+    std::copy(output.begin(), output.end(), indices);
+}
+
+std::vector<uint32_t> optimizeVertexFetch(uint32_t* indices,
+                                          size_t indexCount,
+                                          size_t vertexCount) {
+    std::vector<uint32_t> remap(vertexCount, NO_VERTEX);
+    uint32_t next = 0;
+    for (size_t i = 0; i < indexCount; i++) {
+        uint32_t& index = remap[indices[i]];
+        if (index == NO_VERTEX)
+            index = next++;
+        indices[i] = index;
+    }
+    for (auto& index : remap) {
+        if (index == NO_VERTEX)
+            index = next++;
+    }
+    return remap;
+}
+
+std::vector<MeshOptimizationStatistics> optimizeSceneMeshes(Scene& scene) {
+    const auto& meshes = scene.getMeshes();
+    using Vertex = std::decay_t<decltype(Mesh::vertices)>::value_type;
+    using Index = std::decay_t<decltype(Mesh::indices)>::value_type;
+    static_assert(std::is_same_v<Index, uint32_t>,
+                  "indices are reordered as uint32_t");
+    std::vector<MeshOptimizationStatistics> statistics(meshes.size());
+    JobSystem::parallelFor(
+        static_cast<int>(meshes.size()), 1, [&](int first, int last) {
+            for (int i = first; i < last; i++) {
+                statistics[i] =
+                    optimizeMesh(meshes[i]->vertices, meshes[i]->indices);
+            }
+        });
+    // same sizes, copied through a staging buffer as the mesh buffers may
+    // be immutable
+    for (auto& mesh : meshes) {
+        VertexArrayLayout layout = captureVertexArrayLayout(mesh->vao);
+        if (layout.bindings.empty() || layout.elementBuffer == 0)
+            continue;
+        size_t vertexBytes = mesh->vertices.size() * sizeof(Vertex);
+        size_t indexBytes = mesh->indices.size() * sizeof(Index);
+        GLuint staging = 0;
+        glCreateBuffers(1, &staging);
+        glNamedBufferStorage(staging, vertexBytes + indexBytes, nullptr,
+                             GL_DYNAMIC_STORAGE_BIT);
+        glNamedBufferSubData(staging, 0, vertexBytes, mesh->vertices.data());
+        glNamedBufferSubData(staging, vertexBytes, indexBytes,
+                             mesh->indices.data());
+        glCopyNamedBufferSubData(staging, layout.bindings.front().buffer, 0,
+                                 layout.bindings.front().offset, vertexBytes);
+        glCopyNamedBufferSubData(staging, layout.elementBuffer, vertexBytes, 0,
+                                 indexBytes);
+        glDeleteBuffers(1, &staging);
+    }
+    logPossibleGLError();
+    return statistics;
+}
@@ -0,0 +1,128 @@
+#include "core/Meshlet.hpp"
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <type_traits>
+#include "core/JobSystem.hpp"
+
+using namespace loo;
+using namespace std;
+
+static Meshlet computeMeshletBounds(const std::vector<glm::vec3>& positions,
+                                    const std::vector<uint32_t>& indices,
+                                    uint32_t firstIndex,
+                                    uint32_t indexCount) {
+    Meshlet meshlet{};
+    meshlet.firstIndex = firstIndex;
+    meshlet.indexCount = indexCount;
+    const uint32_t* index = indices.data() + firstIndex;
+    glm::vec3 min(FLT_MAX), max(-FLT_MAX);
+    for (uint32_t i = 0; i < indexCount; i++) {
+        min = glm::min(min, positions[index[i]]);
+        max = glm::max(max, positions[index[i]]);
+    }
+    meshlet.center = (min + max) * 0.5f;
+    float radius2 = 0.f;
+    for (uint32_t i = 0; i < indexCount; i++) {
+        glm::vec3 d = positions[index[i]] - meshlet.center;
+        radius2 = std::max(radius2, glm::dot(d, d));
+    }
+    meshlet.radius = std::sqrt(radius2);
+
+    // the cone around the average unit normal
+    glm::vec3 axis(0.f);
+    for (uint32_t i = 0; i < indexCount; i += 3) {
+        glm::vec3 normal = glm::cross(
+            positions[index[i + 1]] - positions[index[i]],
+            positions[index[i + 2]] - positions[index[i]]);
+        float length = glm::length(normal);
+        if (length > 0.f)
+            axis += normal / length;
+    }
+    meshlet.coneAxis = glm::vec3(0.f, 0.f, 1.f);
+    meshlet.coneCutoff = 1.f;
+    float axisLength = glm::length(axis);
+    if (axisLength <= 1e-6f)
+        return meshlet;
+    axis /= axisLength;
+    float minDot = 1.f;
+    for (uint32_t i = 0; i < indexCount; i += 3) {
+        glm::vec3 normal = glm::cross(
+            positions[index[i + 1]] - positions[index[i]],
+            positions[index[i + 2]] - positions[index[i]]);
+        float length = glm::length(normal);
+        if (length > 0.f)
+            minDot = std::min(minDot, glm::dot(normal / length, axis));
+    }
+    meshlet.coneAxis = axis;
+    // a cone of 90 degrees or wider always has a side facing the camera
+    if (minDot > 0.f)
+        meshlet.coneCutoff = std::sqrt(1.f - minDot * minDot);
+    return meshlet;
+}
+
+std::vector<Meshlet> buildMeshlets(const std::vector<glm::vec3>& positions,
+                                   const std::vector<uint32_t>& indices) {
+    std::vector<Meshlet> meshlets;
+    // meshlet index + 1 of the last meshlet that used a vertex
+    std::vector<uint32_t> used(positions.size(), 0);
+    uint32_t first = 0, vertices = 0;
+    auto close = [&](uint32_t end) {
+        if (end > first)
+            meshlets.push_back(
+                computeMeshletBounds(positions, indices, first, end - first));
+        first = end;
+        vertices = 0;
+    };
+    for (uint32_t i = 0; i + 2 < indices.size(); i += 3) {
+        auto stamp = static_cast<uint32_t>(meshlets.size() + 1);
+        uint32_t a = indices[i], b = indices[i + 1], c = indices[i + 2];
+        uint32_t added = (used[a] != stamp) + (used[b] != stamp && b != a) +
+                         (used[c] != stamp && c != a && c != b);
+        if (vertices + added > MESHLET_MAX_VERTICES ||
+            (i - first) / 3 == MESHLET_MAX_TRIANGLES) {
+            close(i);
+            stamp++;
+            added = 1 + (b != a) + (c != a && c != b);
+        }
+        used[a] = used[b] = used[c] = stamp;
+        vertices += added;
+    }
+    close(static_cast<uint32_t>(indices.size() / 3 * 3));
+    return meshlets;
+}
+
+std::vector<std::vector<Meshlet>> buildSceneMeshlets(const Scene& scene) {
+    const auto& meshes = scene.getMeshes();
+    using Index = std::decay_t<decltype(Mesh::indices)>::value_type;
+    static_assert(std::is_same_v<Index, uint32_t>,
+                  "meshlets are built from uint32_t indices");
+    std::vector<std::vector<Meshlet>> meshlets(meshes.size());
+    JobSystem::parallelFor(
+        static_cast<int>(meshes.size()), 1, [&](int first, int last) {
+            for (int i = first; i < last; i++) {
+                if (meshes[i]->indices.size() / 3 >= MESHLET_MIN_MESH_TRIANGLES)
+                    meshlets[i] = buildMeshlets(meshes[i]->vertices,
+                                                meshes[i]->indices);
+            }
+        });
+    size_t clustered = 0, count = 0;
+    for (auto& mesh : meshlets) {
+        clustered += !mesh.empty();
+        count += mesh.size();
+    }
+    if (clustered) {
+        LOG(INFO) << "Split " << clustered << " meshes into " << count
+                  << " meshlets";
+    }
+    return meshlets;
+}
+
+bool isMeshletBackfacing(const Meshlet& meshlet,
+                         const glm::vec3& cameraPosition) {
+    glm::vec3 view = meshlet.center - cameraPosition;
+    return glm::dot(view, meshlet.coneAxis) >
+           meshlet.coneCutoff * glm::length(view) + meshlet.radius;
+}
@@ -0,0 +1,229 @@
+#include "core/ModelLoader.hpp"
+#include <GLFW/glfw3.h>
+#include <glog/logging.h>
+#include <loo/glError.hpp>
+
+#include <exception>
+#include "core/SceneCache.hpp"
+
+using namespace loo;
+using namespace std;
+
+using Clock = std::chrono::steady_clock;
+
+static float millisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<float, std::milli>(Clock::now() - start)
+        .count();
+}
+
+VertexArrayLayout captureVertexArrayLayout(GLuint vao) {
+    VertexArrayLayout layout;
+    glBindVertexArray(vao);
+    GLint maxAttribs = 0;
+    glGetIntegerv(GL_MAX_VERTEX_ATTRIBS, &maxAttribs);
+    std::vector<bool> usedBindings(maxAttribs, false);
+    for (GLuint i = 0; i < static_cast<GLuint>(maxAttribs); i++) {
+        GLint enabled = 0;
+        glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_ENABLED, &enabled);
+        if (!enabled)
+            continue;
+        GLint size, type, normalized, integer, relativeOffset, binding;
+        glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_SIZE, &size);
+        glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_TYPE, &type);
+        glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_NORMALIZED, &normalized);
+        glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_INTEGER, &integer);
+        glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_RELATIVE_OFFSET,
+                            &relativeOffset);
+        glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_BINDING, &binding);
+        layout.attributes.push_back(VertexArrayLayout::Attribute{
+            i, size, static_cast<GLenum>(type),
+            static_cast<GLboolean>(normalized),
+            static_cast<GLboolean>(integer),
+            static_cast<GLuint>(relativeOffset),
+            static_cast<GLuint>(binding)});
+        usedBindings[binding] = true;
+    }
+    for (GLuint i = 0; i < usedBindings.size(); i++) {
+        if (!usedBindings[i])
+            continue;
+        GLint buffer, stride, divisor;
+        GLint64 offset;
+        glGetIntegeri_v(GL_VERTEX_BINDING_BUFFER, i, &buffer);
+        glGetIntegeri_v(GL_VERTEX_BINDING_STRIDE, i, &stride);
+        glGetIntegeri_v(GL_VERTEX_BINDING_DIVISOR, i, &divisor);
+        glGetInteger64i_v(GL_VERTEX_BINDING_OFFSET, i, &offset);
+        layout.bindings.push_back(VertexArrayLayout::Binding{
+            i, static_cast<GLuint>(buffer), static_cast<GLintptr>(offset),
+            stride, static_cast<GLuint>(divisor)});
+    }
+    GLint elementBuffer = 0;
+    glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &elementBuffer);
+    layout.elementBuffer = static_cast<GLuint>(elementBuffer);
+    glBindVertexArray(0);
+    return layout;
+}
+
+GLuint createVertexArray(const VertexArrayLayout& layout) {
+    GLuint vao = 0;
+    glCreateVertexArrays(1, &vao);
+    for (auto& attribute : layout.attributes) {
+        glEnableVertexArrayAttrib(vao, attribute.index);
+        if (attribute.integer) {
+            glVertexArrayAttribIFormat(vao, attribute.index, attribute.size,
+                                       attribute.type,
+                                       attribute.relativeOffset);
+        } else {
+            glVertexArrayAttribFormat(vao, attribute.index, attribute.size,
+                                      attribute.type, attribute.normalized,
+                                      attribute.relativeOffset);
+        }
+        glVertexArrayAttribBinding(vao, attribute.index, attribute.binding);
+    }
+    for (auto& binding : layout.bindings) {
+        glVertexArrayVertexBuffer(vao, binding.index, binding.buffer,
+                                  binding.offset, binding.stride);
+        glVertexArrayBindingDivisor(vao, binding.index, binding.divisor);
+    }
+    glVertexArrayElementBuffer(vao, layout.elementBuffer);
+    return vao;
+}
+
+ModelLoader::~ModelLoader() {
+    shutdown();
+}
+
+bool ModelLoader::init(GLFWwindow* mainWindow) {
+    // the other hints(version, profile) are the ones of the main window
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    m_window = glfwCreateWindow(1, 1, "RenderLoo loader", nullptr, mainWindow);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+    if (!m_window) {
+        LOG(WARNING) << "Failed to create a shared context, models will be "
+                        "loaded on the main thread";
+        return false;
+    }
+    return true;
+}
+
+bool ModelLoader::start(const std::string& filename,
+                        PrepareFunction prepare) {
+    if (!isAvailable() || isLoading())
+        return false;
+    if (m_thread.joinable())
+        m_thread.join();
+    m_filename = filename;
+    m_start = Clock::now();
+    m_times = ModelLoadTimes{};
+    m_cacheStatus = std::make_unique<SceneCacheLoadStatus>();
+    m_layouts.clear();
+    m_nextMesh = 0;
+    m_phase = ModelLoadPhase::Import;
+    m_thread = std::thread(&ModelLoader::run, this, filename,
+                           std::move(prepare));
+    return true;
+}
+
+void ModelLoader::run(const std::string& filename,
+                      const PrepareFunction& prepare) {
+    glfwMakeContextCurrent(m_window);
+    LOG(INFO) << "Loading model from " << filename << " in the background";
+    try {
+        auto start = Clock::now();
+        m_scene = std::make_unique<Scene>(
+            importScene(filename, &m_meshData, m_cacheStatus.get()));
+        m_times.import = millisecondsSince(start);
+        m_times.cacheMapping = m_cacheStatus->mapping;
+        m_times.cacheTextures = m_cacheStatus->textures;
+        m_times.cacheBuffers = m_cacheStatus->buffers;
+        start = Clock::now();
+        if (prepare)
+            prepare(*m_scene);
+        m_times.prepare = millisecondsSince(start);
+        // vertex arrays of this context are useless to the main one
+        for (auto& mesh : m_scene->getMeshes()) {
+            m_layouts.push_back(captureVertexArrayLayout(mesh->vao));
+            glDeleteVertexArrays(1, &mesh->vao);
+            mesh->vao = 0;
+        }
+        // uploads must be complete before another context uses them
+        glFinish();
+        logPossibleGLError();
+        m_phase = ModelLoadPhase::VertexArrays;
+    } catch (const std::exception& e) {
+        LOG(ERROR) << "Failed to load " << filename << ": " << e.what();
+        m_scene.reset();
+        m_meshData = {};
+        m_phase = ModelLoadPhase::Failed;
+    }
+    glfwMakeContextCurrent(nullptr);
+}
+
+bool ModelLoader::update() {
+    ModelLoadPhase phase = m_phase;
+    if (phase == ModelLoadPhase::Failed) {
+        m_thread.join();
+        m_phase = ModelLoadPhase::Idle;
+        return false;
+    }
+    if (phase == ModelLoadPhase::Ready)
+        return true;
+    if (phase != ModelLoadPhase::VertexArrays)
+        return false;
+    if (m_thread.joinable())
+        m_thread.join();
+    auto start = Clock::now();
+    const auto& meshes = m_scene->getMeshes();
+    while (m_nextMesh < meshes.size() &&
+           millisecondsSince(start) < MODEL_LOADER_FRAME_BUDGET_MS) {
+        meshes[m_nextMesh]->vao = createVertexArray(m_layouts[m_nextMesh]);
+        m_nextMesh++;
+    }
+    logPossibleGLError();
+    m_times.vertexArrays += millisecondsSince(start);
+    if (m_nextMesh < meshes.size())
+        return false;
+    m_phase = ModelLoadPhase::Ready;
+    return true;
+}
+
+Scene ModelLoader::takeScene(SceneMeshData* meshData) {
+    Scene scene = std::move(*m_scene);
+    m_scene.reset();
+    if (meshData)
+        *meshData = std::move(m_meshData);
+    m_meshData = {};
+    m_layouts.clear();
+    m_lastTimes = m_times;
+    m_phase = ModelLoadPhase::Idle;
+    LOG(INFO) << "Loaded " << m_filename << " in "
+              << getElapsedSeconds() << "s";
+    return scene;
+}
+
+void ModelLoader::shutdown() {
+    if (m_thread.joinable())
+        m_thread.join();
+    // the GL objects of an unclaimed scene go before the contexts
+    m_scene.reset();
+    m_meshData = {};
+    m_phase = ModelLoadPhase::Idle;
+    if (m_window) {
+        glfwDestroyWindow(m_window);
+        m_window = nullptr;
+    }
+}
+
+float ModelLoader::getElapsedSeconds() const {
+    return millisecondsSince(m_start) / 1000.0f;
+}
+
+float ModelLoader::getProgress() const {
+    if (m_phase == ModelLoadPhase::Import && m_cacheStatus) {
+        int steps = m_cacheStatus->steps;
+        return steps > 0 ? static_cast<float>(m_cacheStatus->stepsDone) / steps
+                         : 0.0f;
+    }
+    if (m_phase != ModelLoadPhase::VertexArrays || m_layouts.empty())
+        return m_phase == ModelLoadPhase::Ready ? 1.0f : 0.0f;
+    return static_cast<float>(m_nextMesh) / m_layouts.size();
+}
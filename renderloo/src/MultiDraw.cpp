@@ -0,0 +1,451 @@
+#include "core/MultiDraw.hpp"
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cstring>
+#include <loo/glError.hpp>
+#include <map>
+#include <tuple>
+#include <type_traits>
+#include "core/GeometryArena.hpp"
+#include "core/Instancing.hpp"
+#include "core/constants.hpp"
+
+using namespace loo;
+using namespace std;
+
+MultiDrawScene::~MultiDrawScene() {
+    release();
+}
+
+void MultiDrawScene::release() {
+    if (m_vao) {
+        glDeleteVertexArrays(1, &m_vao);
+        GLuint buffers[] = {m_vertexBuffer,      m_skinBuffer,
+                            m_indexBuffer,       m_clusterIndexBuffer,
+                            m_materialBuffer,    m_boundsBuffer,
+                            m_clusterBuffer,     m_meshClusterBuffer};
+        glDeleteBuffers(8, buffers);
+    }
+    m_vao = m_vertexBuffer = m_skinBuffer = m_indexBuffer =
+        m_clusterIndexBuffer = m_materialBuffer = m_boundsBuffer =
+            m_clusterBuffer = m_meshClusterBuffer = 0;
+    m_indexType = GL_UNSIGNED_INT;
+    m_maxClusters = 0;
+    m_meshes.clear();
+    m_meshIndices.clear();
+    m_opaqueDraws.clear();
+    m_blendDraws.clear();
+    m_drawData.clear();
+    m_drawDataEpoch = 0;
+}
+
+void MultiDrawScene::build(const Scene& scene,
+                           const std::vector<MeshLODs>* lods,
+                           const std::vector<std::vector<Meshlet>>* meshlets,
+                           const MeshInstancing* instancing) {
+    release();
+    const auto& meshes = scene.getMeshes();
+    if (meshes.empty())
+        return;
+    if (lods && lods->size() != meshes.size())
+        lods = nullptr;
+    if (meshlets && meshlets->size() != meshes.size())
+        meshlets = nullptr;
+    using Vertex =
+        std::decay_t<decltype(meshes.front()->vertices)>::value_type;
+    // float vertices are the fallback for unexpected layouts
+    auto source = getSourceVertexLayout(meshes.front()->vao, sizeof(Vertex));
+    if (!source)
+        LOG(WARNING) << "Unexpected vertex layout, multi draw vertices are "
+                        "not packed";
+    std::vector<Vertex> vertices;
+    std::vector<PackedVertex> packed;
+    std::vector<PackedSkin> skins;
+    size_t vertexCount = 0;
+    bool skinned = false;
+    std::vector<GLuint> indices;
+    std::vector<ShaderPBRMetallicMaterial> materials;
+    std::vector<ShaderMeshBounds> bounds;
+    std::vector<ShaderCluster> clusters;
+    std::vector<ShaderMeshClusters> meshClusters;
+    std::map<const PBRMetallicMaterial*, int> materialIndices;
+    std::map<std::array<const Texture2D*, 6>, int> bindGroups;
+    for (size_t meshIndex = 0; meshIndex < meshes.size(); meshIndex++) {
+        auto& mesh = meshes[meshIndex];
+        auto material =
+            dynamic_cast<PBRMetallicMaterial*>(mesh->material.get());
+        if (!material) {
+            LOG(WARNING) << "Multi draw needs PBR materials on every mesh, "
+                            "falling back to per mesh draws";
+            release();
+            return;
+        }
+        auto [materialIt, newMaterial] = materialIndices.try_emplace(
+            material, static_cast<int>(materials.size()));
+        if (newMaterial)
+            materials.push_back(material->getShaderMaterial());
+        std::array<const Texture2D*, 6> textures{
+            material->baseColorTex.get(), material->occlusionTex.get(),
+            material->metallicTex.get(),  material->roughnessTex.get(),
+            material->normalTex.get(),    material->emissiveTex.get()};
+        int bindGroup = static_cast<int>(bindGroups.size());
+        auto groupIt = bindGroups.try_emplace(textures, bindGroup).first;
+
+        MeshEntry entry{};
+        entry.levels[0] = {static_cast<GLuint>(mesh->indices.size()),
+                           static_cast<GLuint>(indices.size())};
+        entry.levelCount = 1;
+        entry.baseVertex = static_cast<GLint>(vertexCount);
+        entry.materialIndex = materialIt->second;
+        entry.bindGroup = groupIt->second;
+        entry.doubleSided = mesh->isDoubleSided();
+        entry.alphaBlend = mesh->needAlphaBlend();
+        entry.material = material;
+        bounds.push_back(
+            ShaderMeshBounds{glm::vec4(mesh->aabb.getCenter(), 0.0f),
+                             glm::vec4(mesh->aabb.getDiagonal() * 0.5f, 0.0f)});
+        size_t prototype =
+            instancing ? instancing->getPrototype(meshIndex) : meshIndex;
+        if (prototype != meshIndex) {
+            // the geometry of an earlier copy, the compaction region is
+            // still per mesh
+            const MeshEntry& shared = m_meshes[prototype];
+            std::copy(std::begin(shared.levels), std::end(shared.levels),
+                      std::begin(entry.levels));
+            entry.levelCount = shared.levelCount;
+            entry.baseVertex = shared.baseVertex;
+            entry.vertexFlags = shared.vertexFlags;
+            entry.quantization = shared.quantization;
+            entry.clusterCount = shared.clusterCount;
+            meshClusters.push_back(meshClusters[prototype]);
+            meshClusters.back().info.z = entry.doubleSided;
+            m_meshIndices[mesh.get()] = static_cast<int>(m_meshes.size());
+            m_meshes.push_back(entry);
+            continue;
+        }
+        size_t count = mesh->vertices.size();
+        if (source) {
+            glm::vec3 min(FLT_MAX), max(-FLT_MAX);
+            for (auto& vertex : mesh->vertices) {
+                min = glm::min(min, vertex.position);
+                max = glm::max(max, vertex.position);
+            }
+            entry.quantization = getPositionQuantization(min, max);
+            packed.resize(vertexCount + count);
+            skins.resize(vertexCount + count);
+            bool meshSkinned = packVertices(
+                reinterpret_cast<const uint8_t*>(mesh->vertices.data()),
+                count, *source, entry.quantization,
+                packed.data() + vertexCount, skins.data() + vertexCount);
+            entry.vertexFlags =
+                VERTEX_FLAG_PACKED | (meshSkinned ? VERTEX_FLAG_SKINNED : 0);
+            skinned = skinned || meshSkinned;
+        } else {
+            vertices.insert(vertices.end(), mesh->vertices.begin(),
+                            mesh->vertices.end());
+        }
+        vertexCount += count;
+        indices.insert(indices.end(), mesh->indices.begin(),
+                       mesh->indices.end());
+        if (lods) {
+            // the levels index the same vertices
+            const MeshLODs& meshLODs = (*lods)[meshIndex];
+            auto lodFirstIndex = static_cast<GLuint>(indices.size());
+            for (auto& level : meshLODs.levels) {
+                if (entry.levelCount == MESH_LOD_COUNT)
+                    break;
+                entry.levels[entry.levelCount++] = {
+                    level.indexCount, lodFirstIndex + level.firstIndex};
+            }
+            indices.insert(indices.end(), meshLODs.indices.begin(),
+                           meshLODs.indices.end());
+        }
+        meshClusters.push_back(ShaderMeshClusters{
+            glm::uvec4(clusters.size(), 0, entry.doubleSided, 0)});
+        // skinned vertices leave the meshlet bounds
+        if (meshlets && entry.vertexFlags == VERTEX_FLAG_PACKED) {
+            for (auto& meshlet : (*meshlets)[meshIndex]) {
+                clusters.push_back(ShaderCluster{
+                    glm::vec4(meshlet.center, meshlet.radius),
+                    glm::vec4(meshlet.coneAxis, meshlet.coneCutoff),
+                    glm::uvec4(entry.levels[0].firstIndex + meshlet.firstIndex,
+                               meshlet.indexCount, 0, 0)});
+            }
+            entry.clusterCount =
+                static_cast<GLuint>((*meshlets)[meshIndex].size());
+            meshClusters.back().info.y = entry.clusterCount;
+            m_maxClusters =
+                std::max(m_maxClusters, static_cast<int>(entry.clusterCount));
+        }
+        m_meshIndices[mesh.get()] = static_cast<int>(m_meshes.size());
+        m_meshes.push_back(entry);
+    }
+    // skinning is unknown for unpacked vertices
+    for (size_t i = 0; i < m_meshes.size(); i++) {
+        if ((m_meshes[i].vertexFlags & VERTEX_FLAG_SKINNED) ||
+            (!source && scene.animation))
+            bounds[i].center.w = 1.0f;
+    }
+
+    glCreateBuffers(1, &m_vertexBuffer);
+    glCreateVertexArrays(1, &m_vao);
+    if (source) {
+        glNamedBufferStorage(m_vertexBuffer,
+                             packed.size() * sizeof(PackedVertex),
+                             packed.data(), 0);
+        // static scenes skip the skin stream
+        if (skinned) {
+            glCreateBuffers(1, &m_skinBuffer);
+            glNamedBufferStorage(m_skinBuffer,
+                                 skins.size() * sizeof(PackedSkin),
+                                 skins.data(), 0);
+        }
+        setupPackedVertexArray(m_vao, m_vertexBuffer, m_skinBuffer);
+    } else {
+        glNamedBufferStorage(m_vertexBuffer, vertices.size() * sizeof(Vertex),
+                             vertices.data(), 0);
+        copyVertexLayout(meshes.front()->vao, m_vao);
+        glVertexArrayVertexBuffer(m_vao, 0, m_vertexBuffer, 0,
+                                  sizeof(Vertex));
+    }
+    // indices are relative to the base vertex, 16 bit if every mesh has few
+    // enough vertices
+    bool shortIndices = true;
+    for (size_t i = 0; i < meshes.size(); i++) {
+        if (!instancing || instancing->getPrototype(i) == i)
+            shortIndices =
+                shortIndices && useShortIndices(meshes[i]->vertices.size());
+    }
+    m_indexType = shortIndices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    glCreateBuffers(1, &m_indexBuffer);
+    if (shortIndices) {
+        // cluster culling reads the buffer as uints, the size is padded
+        std::vector<uint16_t> narrow((indices.size() + 1) / 2 * 2, 0);
+        narrowIndices(indices.data(), indices.size(), narrow.data());
+        glNamedBufferStorage(m_indexBuffer, narrow.size() * sizeof(uint16_t),
+                             narrow.data(), 0);
+    } else {
+        glNamedBufferStorage(m_indexBuffer, indices.size() * sizeof(GLuint),
+                             indices.data(), 0);
+    }
+    // cluster culling compacts the visible meshlets into 32 bit regions of
+    // a buffer of their own
+    size_t clusterIndexCount = 0;
+    for (auto& entry : m_meshes) {
+        if (entry.clusterCount) {
+            entry.clusterFirstIndex = static_cast<GLuint>(clusterIndexCount);
+            clusterIndexCount += entry.levels[0].count;
+        }
+    }
+    if (clusterIndexCount) {
+        glCreateBuffers(1, &m_clusterIndexBuffer);
+        glNamedBufferStorage(m_clusterIndexBuffer,
+                             clusterIndexCount * sizeof(GLuint), nullptr, 0);
+    }
+    glCreateBuffers(1, &m_materialBuffer);
+    glNamedBufferStorage(m_materialBuffer,
+                         materials.size() * sizeof(ShaderPBRMetallicMaterial),
+                         materials.data(), 0);
+    glCreateBuffers(1, &m_boundsBuffer);
+    glNamedBufferStorage(m_boundsBuffer,
+                         bounds.size() * sizeof(ShaderMeshBounds),
+                         bounds.data(), 0);
+    glCreateBuffers(1, &m_meshClusterBuffer);
+    glNamedBufferStorage(m_meshClusterBuffer,
+                         meshClusters.size() * sizeof(ShaderMeshClusters),
+                         meshClusters.data(), 0);
+    if (!clusters.empty()) {
+        glCreateBuffers(1, &m_clusterBuffer);
+        glNamedBufferStorage(m_clusterBuffer,
+                             clusters.size() * sizeof(ShaderCluster),
+                             clusters.data(), 0);
+    }
+    panicPossibleGLError();
+
+    for (int i = 0; i < static_cast<int>(m_meshes.size()); i++)
+        (m_meshes[i].alphaBlend ? m_blendDraws : m_opaqueDraws).push_back(i);
+    auto byState = [this](int a, int b) {
+        const MeshEntry &ea = m_meshes[a], &eb = m_meshes[b];
+        return std::tie(ea.doubleSided, ea.bindGroup) <
+               std::tie(eb.doubleSided, eb.bindGroup);
+    };
+    std::stable_sort(m_opaqueDraws.begin(), m_opaqueDraws.end(), byState);
+    std::stable_sort(m_blendDraws.begin(), m_blendDraws.end(), byState);
+    m_drawData.resize(m_meshes.size());
+    LOG(INFO) << "Packed " << m_meshes.size() << " meshes(" << materials.size()
+              << " materials, " << bindGroups.size()
+              << " texture sets) for multi draw indirect, "
+              << (source ? sizeof(PackedVertex) +
+                               (skinned ? sizeof(PackedSkin) : 0)
+                         : sizeof(Vertex))
+              << " bytes per vertex, " << (shortIndices ? 16 : 32)
+              << " bit indices, " << clusters.size() << " meshlets";
+}
+
+int MultiDrawScene::getLevelIndex(int mesh) const {
+    int level = m_lodLevels ? (*m_lodLevels)[mesh] : 0;
+    return std::min(level, m_meshes[mesh].levelCount - 1);
+}
+
+int MultiDrawScene::getIndex(const Mesh* mesh) const {
+    auto it = m_meshIndices.find(mesh);
+    return it == m_meshIndices.end() ? -1 : it->second;
+}
+
+void MultiDrawScene::update(const TransformCache& transforms) {
+    m_draws = m_drawCalls = m_triangles = 0;
+    if (empty())
+        return;
+    for (size_t i = 0; i < m_meshes.size(); i++) {
+        ShaderDrawData& data = m_drawData[i];
+        data.model = transforms.getWorld(i);
+        data.prevModel = transforms.getPreviousWorld(i);
+        data.normalMatrix = transforms.getNormal(i);
+        data.info = glm::uvec4(m_meshes[i].materialIndex,
+                               m_meshes[i].vertexFlags, 0, 0);
+        data.positionOffset =
+            glm::vec4(m_meshes[i].quantization.offset, 0.0f);
+        data.positionScale = glm::vec4(m_meshes[i].quantization.scale, 0.0f);
+    }
+    uploadDrawData();
+}
+
+void MultiDrawScene::uploadDrawData() {
+    void* data = nullptr;
+    GLsizeiptr size = m_drawData.size() * sizeof(ShaderDrawData);
+    m_drawDataRange = UniformRing::allocate(size, &data);
+    memcpy(data, m_drawData.data(), size);
+    m_drawDataEpoch = UniformRing::getEpoch();
+}
+
+// commands followed by the mesh index of every command
+static size_t commandBytes(size_t count) {
+    return (count * sizeof(DrawElementsIndirectCommand) + 15) / 16 * 16;
+}
+
+void MultiDrawScene::draw(const std::vector<int>& draws,
+                          ShaderProgram& sp, bool cullBackFaces,
+                          bool bindMaterial) {
+    if (draws.empty() || empty())
+        return;
+    UniformRange commands = writeCommands(draws, false, bindMaterial);
+    submitCommands(draws, commands, sp, cullBackFaces, bindMaterial);
+}
+
+UniformRange MultiDrawScene::writeCommands(const std::vector<int>& draws,
+                                           bool clusterOutput,
+                                           bool bindMaterial) {
+    const size_t count = draws.size();
+    const size_t meshIndexOffset = commandBytes(count);
+    UniformRange commands;
+    do {
+        // per draw data of an older buffer if the ring grew this frame
+        if (m_drawDataEpoch != UniformRing::getEpoch())
+            uploadDrawData();
+        // submitCommands binds them without allocating
+        if (bindMaterial) {
+            for (int draw : draws)
+                m_meshes[draw].material->getUniformRange();
+        }
+        void* data = nullptr;
+        commands = UniformRing::allocate(
+            meshIndexOffset + count * sizeof(GLuint), &data);
+        auto command = static_cast<DrawElementsIndirectCommand*>(data);
+        auto meshIndex = reinterpret_cast<GLuint*>(
+            static_cast<unsigned char*>(data) + meshIndexOffset);
+        for (size_t i = 0; i < count; i++) {
+            const MeshEntry& entry = m_meshes[draws[i]];
+            const MeshEntry::Level& level = getLevel(draws[i]);
+            command[i] =
+                clusterOutput
+                    ? DrawElementsIndirectCommand{0, 1,
+                                                  entry.clusterFirstIndex,
+                                                  entry.baseVertex, 0}
+                    : DrawElementsIndirectCommand{level.count, 1,
+                                                  level.firstIndex,
+                                                  entry.baseVertex, 0};
+            meshIndex[i] = static_cast<GLuint>(draws[i]);
+        }
+    } while (m_drawDataEpoch != UniformRing::getEpoch());
+    m_commandsEpoch = UniformRing::getEpoch();
+    m_commandsClusterOutput = clusterOutput;
+    bindCommandInputs(commands, count);
+    return commands;
+}
+
+void MultiDrawScene::bindCommandInputs(const UniformRange& commands,
+                                       size_t count) const {
+    UniformRing::bindStorage(SHADER_SSBO_PORT_DRAW_DATA, m_drawDataRange);
+    UniformRing::bindStorage(
+        SHADER_SSBO_PORT_DRAW_INDICES,
+        UniformRange{commands.buffer,
+                     commands.offset +
+                         static_cast<GLintptr>(commandBytes(count)),
+                     static_cast<GLsizeiptr>(count * sizeof(GLuint))});
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SHADER_SSBO_PORT_MATERIALS,
+                     m_materialBuffer);
+}
+
+void MultiDrawScene::submitCommands(const std::vector<int>& draws,
+                                    const UniformRange& commands,
+                                    ShaderProgram& sp, bool cullBackFaces,
+                                    bool bindMaterial, bool countStatistics) {
+    if (draws.empty() || empty())
+        return;
+    DCHECK_EQ(m_commandsEpoch, UniformRing::getEpoch())
+        << "Uniform ring allocation between writeCommands and "
+           "submitCommands";
+    const size_t count = draws.size();
+    bindCommandInputs(commands, count);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commands.buffer);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    // compaction regions are 32 bit whatever the static indices are
+    GLenum indexType =
+        m_commandsClusterOutput ? GL_UNSIGNED_INT : m_indexType;
+    glVertexArrayElementBuffer(
+        m_vao, m_commandsClusterOutput ? m_clusterIndexBuffer : m_indexBuffer);
+    glBindVertexArray(m_vao);
+    sp.setUniform("multiDraw", true);
+    auto sameState = [&](int a, int b) {
+        const MeshEntry &ea = m_meshes[a], &eb = m_meshes[b];
+        return (!cullBackFaces || ea.doubleSided == eb.doubleSided) &&
+               (!bindMaterial || ea.bindGroup == eb.bindGroup);
+    };
+    size_t first = 0;
+    for (size_t i = 1; i <= count; i++) {
+        if (i < count && sameState(draws[first], draws[i]))
+            continue;
+        const MeshEntry& entry = m_meshes[draws[first]];
+        if (cullBackFaces && !entry.doubleSided) {
+            glEnable(GL_CULL_FACE);
+            glCullFace(GL_BACK);
+        } else {
+            glDisable(GL_CULL_FACE);
+        }
+        if (bindMaterial)
+            entry.material->bind(sp);
+        sp.setUniform("drawOffset", static_cast<int>(first));
+        glMultiDrawElementsIndirect(
+            GL_TRIANGLES, indexType,
+            reinterpret_cast<const void*>(
+                commands.offset +
+                first * sizeof(DrawElementsIndirectCommand)),
+            static_cast<GLsizei>(i - first), 0);
+        if (countStatistics)
+            m_drawCalls++;
+        first = i;
+    }
+    if (countStatistics) {
+        m_draws += static_cast<int>(count);
+        for (int draw : draws)
+            m_triangles += static_cast<int>(getLevel(draw).count / 3);
+    }
+
+    sp.setUniform("multiDraw", false);
+    glBindVertexArray(0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    logPossibleGLError();
+}
@@ -1,8 +1,10 @@
 #include "core/PBRMaterials.hpp"
 #include <glog/logging.h>
 #include <loo/Material.hpp>
+#include "core/UniformRing.hpp"
 #include "core/constants.hpp"
 
+#include <cstring>
 #include <memory>
 #include <string>
 
@@ -15,12 +17,20 @@ using namespace std;
 using namespace glm;
 using namespace loo;
 
+const UniformRange& PBRMetallicMaterial::getUniformRange() {
+    // parameters are uploaded once per frame and shared by every pass
+    if (m_uniformEpoch != UniformRing::getEpoch()) {
+        void* data = nullptr;
+        m_uniformRange =
+            UniformRing::allocate(sizeof(m_shadermaterial), &data);
+        memcpy(data, &m_shadermaterial, sizeof(m_shadermaterial));
+        m_uniformEpoch = UniformRing::getEpoch();
+    }
+    return m_uniformRange;
+}
+
 void PBRMetallicMaterial::bind(const ShaderProgram& sp) {
-    ShaderProgram::getUniformBlock(SHADER_UB_PORT_MR_PARAM)
-        .mapBufferScoped<ShaderPBRMetallicMaterial>(
-            [&](ShaderPBRMetallicMaterial& material) {
-                material = m_shadermaterial;
-            });
+    UniformRing::bind(SHADER_UB_PORT_MR_PARAM, getUniformRange());
     sp.setTexture(SHADER_BINDING_PORT_MR_BASECOLOR,
                   baseColorTex ? *baseColorTex : Texture2D::getWhiteTexture());
     sp.setTexture(SHADER_BINDING_PORT_MATERIAL_NORMAL,
@@ -34,9 +44,22 @@ void PBRMetallicMaterial::bind(const ShaderProgram& sp) {
     sp.setTexture(SHADER_BINDING_PORT_MR_EMISSIVE,
                   emissiveTex ? *emissiveTex : Texture2D::getBlackTexture());
 }
+MaterialContentKey PBRMetallicMaterial::getContentKey() const {
+    static_assert(sizeof(ShaderPBRMetallicMaterial) ==
+                      sizeof(MaterialContentKey::parameters),
+                  "parameters are compared as raw bits");
+    MaterialContentKey key{};
+    std::memcpy(key.parameters.data(), &m_shadermaterial,
+                sizeof(m_shadermaterial));
+    key.flags = m_flags;
+    key.textures = {baseColorTex.get(), occlusionTex.get(),
+                    metallicTex.get(),  roughnessTex.get(),
+                    normalTex.get(),    emissiveTex.get()};
+    return key;
+}
 void PBRMetallicMaterial::init() {
-    ShaderProgram::initUniformBlock(make_unique<UniformBuffer>(
-        SHADER_UB_PORT_MR_PARAM, sizeof(ShaderPBRMetallicMaterial)));
+    // the parameter block lives in the uniform ring
+    UniformRing::init();
 }
 
 shared_ptr<PBRMetallicMaterial> PBRMetallicMaterial::defaultMaterial = nullptr;
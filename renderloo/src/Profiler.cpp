@@ -0,0 +1,206 @@
+#include "core/Profiler.hpp"
+#include <glad/glad.h>
+#include <glog/logging.h>
+
+#include <array>
+#include <fstream>
+#include <loo/Application.hpp>
+#include <vector>
+
+using namespace loo;
+using namespace std;
+namespace fs = std::filesystem;
+
+namespace {
+struct Scope {
+    std::string name;
+    int depth;
+    int beginQuery, endQuery;
+};
+struct FrameSlot {
+    unsigned int frame{0};
+    bool pending{false};
+    std::vector<GLuint> queries;
+    int queryUsed{0};
+    std::vector<Scope> scopes;
+
+    int allocQuery() {
+        if (queryUsed == static_cast<int>(queries.size())) {
+            // grow by a batch, the pass count is stable between frames
+            size_t oldSize = queries.size();
+            queries.resize(oldSize + 32);
+            glCreateQueries(GL_TIMESTAMP, 32, queries.data() + oldSize);
+        }
+        return queryUsed++;
+    }
+};
+struct ProfilerState {
+    bool enabled{true};
+    // recording state of the current frame, toggling only applies to the
+    // next frame so that scopes stay balanced
+    bool recording{false};
+    unsigned int frameIndex{0};
+    std::array<FrameSlot, GPU_PROFILER_FRAMES_IN_FLIGHT> slots;
+    std::vector<int> scopeStack;
+    GPUFrameTimings latest;
+    std::deque<GPUFrameTimings> history;
+    int droppedFrames{0};
+
+    FrameSlot& current() {
+        return slots[frameIndex % GPU_PROFILER_FRAMES_IN_FLIGHT];
+    }
+};
+ProfilerState profiler;
+
+// returns false if the results are not ready yet
+bool resolveSlot(FrameSlot& slot, GPUFrameTimings& timings) {
+    if (slot.queryUsed == 0)
+        return false;
+    // queries complete in submission order, the last one implies all
+    GLint available = 0;
+    glGetQueryObjectiv(slot.queries[slot.queryUsed - 1],
+                       GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available)
+        return false;
+    timings.frame = slot.frame;
+    timings.passes.clear();
+    timings.passes.reserve(slot.scopes.size());
+    for (auto& scope : slot.scopes) {
+        if (scope.endQuery < 0)
+            continue;
+        GLuint64 begin = 0, end = 0;
+        glGetQueryObjectui64v(slot.queries[scope.beginQuery], GL_QUERY_RESULT,
+                              &begin);
+        glGetQueryObjectui64v(slot.queries[scope.endQuery], GL_QUERY_RESULT,
+                              &end);
+        timings.passes.push_back(
+            GPUPassTiming{scope.name, scope.depth, (end - begin) / 1e6});
+    }
+    return true;
+}
+
+std::string escapeJSON(const std::string& s) {
+    std::string result;
+    for (char c : s) {
+        if (c == '"' || c == '\\')
+            result += '\\';
+        result += c;
+    }
+    return result;
+}
+}  // namespace
+
+void GPUProfiler::newFrame() {
+    auto& previous = profiler.current();
+    // unbalanced scopes of the last frame are discarded
+    profiler.scopeStack.clear();
+    previous.pending = profiler.recording && previous.queryUsed > 0;
+
+    profiler.frameIndex++;
+    auto& slot = profiler.current();
+    if (slot.pending) {
+        GPUFrameTimings timings;
+        if (resolveSlot(slot, timings)) {
+            profiler.latest = timings;
+            profiler.history.push_back(std::move(timings));
+            if (profiler.history.size() > GPU_PROFILER_HISTORY_SIZE)
+                profiler.history.pop_front();
+        } else {
+            profiler.droppedFrames++;
+        }
+    }
+    slot.pending = false;
+    slot.frame = profiler.frameIndex;
+    slot.queryUsed = 0;
+    slot.scopes.clear();
+    profiler.recording = profiler.enabled;
+}
+
+void GPUProfiler::flush() {
+    for (int i = 0; i < GPU_PROFILER_FRAMES_IN_FLIGHT; i++)
+        newFrame();
+}
+
+void GPUProfiler::beginEvent(const std::string& name) {
+    Application::beginEvent(name);
+    if (!profiler.recording)
+        return;
+    auto& slot = profiler.current();
+    int begin = slot.allocQuery();
+    glQueryCounter(slot.queries[begin], GL_TIMESTAMP);
+    profiler.scopeStack.push_back(static_cast<int>(slot.scopes.size()));
+    slot.scopes.push_back(
+        Scope{name, static_cast<int>(profiler.scopeStack.size()) - 1, begin,
+              -1});
+}
+
+void GPUProfiler::endEvent() {
+    if (profiler.recording && !profiler.scopeStack.empty()) {
+        auto& slot = profiler.current();
+        int end = slot.allocQuery();
+        glQueryCounter(slot.queries[end], GL_TIMESTAMP);
+        slot.scopes[profiler.scopeStack.back()].endQuery = end;
+        profiler.scopeStack.pop_back();
+    }
+    Application::endEvent();
+}
+
+const GPUFrameTimings& GPUProfiler::getLatest() {
+    return profiler.latest;
+}
+const std::deque<GPUFrameTimings>& GPUProfiler::getHistory() {
+    return profiler.history;
+}
+void GPUProfiler::clearHistory() {
+    profiler.history.clear();
+    profiler.droppedFrames = 0;
+}
+int GPUProfiler::getDroppedFrames() {
+    return profiler.droppedFrames;
+}
+void GPUProfiler::setEnabled(bool enabled) {
+    profiler.enabled = enabled;
+}
+bool GPUProfiler::isEnabled() {
+    return profiler.enabled;
+}
+
+bool GPUProfiler::exportCSV(const fs::path& filename) {
+    ofstream file(filename);
+    if (!file) {
+        LOG(ERROR) << "Failed to open " << filename.string();
+        return false;
+    }
+    file << "frame,pass,depth,ms\n";
+    for (auto& frame : profiler.history) {
+        for (auto& pass : frame.passes) {
+            file << frame.frame << ",\"" << pass.name << "\"," << pass.depth
+                 << "," << pass.milliseconds << "\n";
+        }
+    }
+    LOG(INFO) << "GPU timings exported to " << filename.string();
+    return true;
+}
+
+bool GPUProfiler::exportJSON(const fs::path& filename) {
+    ofstream file(filename);
+    if (!file) {
+        LOG(ERROR) << "Failed to open " << filename.string();
+        return false;
+    }
+    file << "[\n";
+    for (size_t i = 0; i < profiler.history.size(); i++) {
+        auto& frame = profiler.history[i];
+        file << "  {\"frame\": " << frame.frame << ", \"passes\": [";
+        for (size_t j = 0; j < frame.passes.size(); j++) {
+            auto& pass = frame.passes[j];
+            file << (j ? ", " : "") << "{\"name\": \""
+                 << escapeJSON(pass.name) << "\", \"depth\": " << pass.depth
+                 << ", \"ms\": " << pass.milliseconds << "}";
+        }
+        file << "]}" << (i + 1 < profiler.history.size() ? "," : "") << "\n";
+    }
+    file << "]\n";
+    LOG(INFO) << "GPU timings exported to " << filename.string();
+    return true;
+}
@@ -3,6 +3,7 @@
 #include <GLFW/glfw3.h>
 #include <imgui.h>
 
+#include <cmath>
 #include <ctime>
 #include <filesystem>
 #include <fstream>
@@ -17,9 +18,15 @@
 #include <stb_image_write.h>
 #include <functional>
 #include <glm/gtx/hash.hpp>
+#include "core/ContentRegistry.hpp"
 #include "core/Graphics.hpp"
+#include "core/JobSystem.hpp"
+#include "core/MultiDraw.hpp"
 #include "core/PBRMaterials.hpp"
+#include "core/Profiler.hpp"
+#include "core/SceneCache.hpp"
 #include "core/Transforms.hpp"
+#include "core/UniformRing.hpp"
 
 #include <imgui_impl_glfw.h>
 #include "glog/logging.h"
@@ -39,6 +46,7 @@ using namespace glm;
 namespace fs = std::filesystem;
 
 static constexpr int SHADOWMAP_RESOLUION[2]{2048, 2048};
+static constexpr float CAMERA_PATH_RECORD_INTERVAL = 0.25f;
 
 static void mouseCallback(GLFWwindow* window, double xposIn, double yposIn) {
     ImGui_ImplGlfw_CursorPosCallback(window, xposIn, yposIn);
@@ -101,6 +109,18 @@ static void scrollCallback(GLFWwindow* window, double xOffset, double yOffset) {
     auto myapp = static_cast<RenderLoo*>(glfwGetWindowUserPointer(window));
     myapp->getMainCamera().zoomCamera(yOffset);
 }
+static std::unique_ptr<loo::PerspectiveCamera> createCamera(
+    CameraMode mode, const vec3& pos, const vec3& center, float zNear,
+    float zFar, float fov) {
+    if (mode == CameraMode::FPS)
+        return std::make_unique<FPSCamera>(pos, center, vec3(0, 1, 0), zNear,
+                                           zFar, fov);
+    else if (mode == CameraMode::ArcBall)
+        return std::make_unique<ArcBallCamera>(pos, center, vec3(0, 1, 0),
+                                               zNear, zFar, fov);
+    else
+        return nullptr;
+}
 static std::unique_ptr<loo::PerspectiveCamera> placeCameraBySceneAABB(
     const AABB& aabb, CameraMode mode) {
     vec3 center = aabb.getCenter();
@@ -111,16 +131,8 @@ static std::unique_ptr<loo::PerspectiveCamera> placeCameraBySceneAABB(
     float overlookAngle = glm::radians(45.f);
     float y = dist * tan(overlookAngle);
     vec3 pos = center + vec3(0, y, dist);
-    if (mode == CameraMode::FPS)
-        return std::make_unique<FPSCamera>(pos, center, vec3(0, 1, 0), ZNEAR,
-                                           std::max(ZFAR, dist + r),
-                                           EXPECTED_FOV);
-    else if (mode == CameraMode::ArcBall)
-        return std::make_unique<ArcBallCamera>(pos, center, vec3(0, 1, 0),
-                                               ZNEAR, std::max(ZFAR, dist + r),
-                                               EXPECTED_FOV);
-    else
-        return nullptr;
+    return createCamera(mode, pos, center, ZNEAR, std::max(ZFAR, dist + r),
+                        EXPECTED_FOV);
 }
 
 static void drop_callback(GLFWwindow* window, int count, const char** paths) {
@@ -134,7 +146,27 @@ static void drop_callback(GLFWwindow* window, int count, const char** paths) {
 void RenderLoo::loadModel(const std::string& filename) {
     pauseTime();
     LOG(INFO) << "Loading model from " << filename << endl;
-    m_scene = createSceneFromFile(filename);
+    SceneMeshData meshData;
+    Scene scene = importScene(filename, &meshData);
+    convertMaterial(scene);
+    setScene(std::move(scene), std::move(meshData));
+    resumeTime();
+}
+
+void RenderLoo::loadModelAsync(const std::string& filename) {
+    if (!m_modelLoader.isAvailable()) {
+        loadModel(filename);
+        return;
+    }
+    if (!m_modelLoader.start(filename, convertMaterial)) {
+        LOG(WARNING) << "Still loading " << m_modelLoader.getFilename()
+                     << ", ignored " << filename;
+    }
+}
+
+void RenderLoo::setScene(loo::Scene&& scene, SceneMeshData&& meshData) {
+    auto start = std::chrono::steady_clock::now();
+    m_scene = std::move(scene);
     AABB sceneAABB = m_scene.computeAABBWorldSpace();
     glm::vec3 diagonal = sceneAABB.getDiagonal();
     LOG(INFO) << "diagnal: " << glm::to_string(diagonal) << endl;
@@ -148,9 +180,27 @@ void RenderLoo::loadModel(const std::string& filename) {
     LOG(INFO) << "Load done" << endl;
 
     m_animator.resetAnimation(m_scene.animation);
-    convertMaterial();
+    // the occluders are ranked by their world bounds
+    m_transforms.update(m_scene);
+    m_lodSelector.setScene(m_scene, std::move(meshData.lods));
+    // after convertMaterial(), materials are compared by their parameters
+    m_instancing.build(m_scene, meshData.geometryHashes);
+    m_multiDraw.build(m_scene, m_lodSelector.getLODs(), &meshData.meshlets,
+                      &m_instancing);
+    m_geometryArena.build(m_scene, m_lodSelector.getLODs(), &m_instancing);
+    m_renderQueue.setScene(m_scene, m_transforms, &m_geometryArena,
+                           &m_instancing);
+    // bounds of skinned meshes are in bind pose, every culler keeps them
+    std::vector<uint8_t> skinned = findSkinnedMeshes(m_scene);
+    m_frustumCuller.setAlwaysVisible(skinned);
+    m_shadowMapPass.setAlwaysVisible(skinned);
+    m_softwareOcclusion.setScene(m_scene, m_transforms, skinned);
+    m_occlusionCullingPass.invalidate();
     frameCount = 0;
-    resumeTime();
+    m_modelLoader.getLastTimes().setup =
+        std::chrono::duration<float, std::milli>(
+            std::chrono::steady_clock::now() - start)
+            .count();
 }
 std::vector<const char*> CommonModelExtensions{
     ".gltf", ".glb",   ".obj", ".fbx", ".dae",
@@ -160,7 +210,7 @@ void RenderLoo::handleDrop(const string& path) {
     fs::path fp(path);
     for (auto& ext : CommonModelExtensions) {
         if (fp.extension() == ext) {
-            loadModel(path);
+            loadModelAsync(path);
             return;
         }
     }
@@ -191,6 +241,7 @@ RenderLoo::RenderLoo(int width, int height)
       m_smaa(getWidth(), getHeight()),
       m_finalprocess(getWidth(), getHeight()) {
 
+    JobSystem::init();
     PBRMetallicMaterial::init();
 
     initVelocity();
@@ -215,9 +266,8 @@ RenderLoo::RenderLoo(int width, int height)
     // init lights buffer
     ShaderProgram::initUniformBlock(std::make_unique<UniformBuffer>(
         SHADER_UB_PORT_LIGHTS, sizeof(ShaderLightBlock)));
-    // init mvp uniform buffer
-    ShaderProgram::initUniformBlock(
-        std::make_unique<UniformBuffer>(SHADER_UB_PORT_MVP, sizeof(MVP)));
+    // mvp blocks are sub-allocated from the uniform ring per draw
+    UniformRing::init();
     panicPossibleGLError();
 
     // init bone uniform buffer
@@ -232,6 +282,7 @@ RenderLoo::RenderLoo(int width, int height)
 
     glfwSetDropCallback(getWindow(), drop_callback);
     NFD_Init();
+    m_modelLoader.init(getWindow());
 }
 void RenderLoo::initGBuffers() {
     m_gbufferfb.init();
@@ -266,23 +317,80 @@ void RenderLoo::initVelocity() {
     m_velocityTexture->setupStorage(getWidth(), getHeight(), GL_RG16F, 1);
     m_velocityTexture->setSizeFilter(GL_LINEAR, GL_LINEAR);
     m_velocityTexture->setWrapFilter(GL_CLAMP_TO_EDGE);
-
-    ShaderProgram::initUniformBlock(std::make_unique<UniformBuffer>(
-        SHADER_UB_PORT_PREVIOUS_FRAME_MVP, sizeof(MVP)));
     panicPossibleGLError();
 }
 
-void RenderLoo::saveScreenshot(fs::path filename) const {
-    std::vector<unsigned char> pixels(getWidth() * getHeight() * 3);
-    glReadPixels(0, 0, getWidth(), getHeight(), GL_RGB, GL_UNSIGNED_BYTE,
-                 pixels.data());
-    stbi_flip_vertically_on_write(true);
-    stbi_write_png(filename.string().c_str(), getWidth(), getHeight(), 3,
-                   pixels.data(), getWidth() * 3);
-    stbi_flip_vertically_on_write(false);
+void RenderLoo::initOffscreenOutput() {
+    if (m_offscreenOutput)
+        return;
+    m_offscreenfb.init();
+    m_offscreenOutput = make_unique<Texture2D>();
+    m_offscreenOutput->init();
+    m_offscreenOutput->setupStorage(getWidth(), getHeight(), GL_RGBA8, 1);
+    m_offscreenOutput->setSizeFilter(GL_LINEAR, GL_LINEAR);
+    m_offscreenfb.attachTexture(*m_offscreenOutput, GL_COLOR_ATTACHMENT0, 0);
     panicPossibleGLError();
 }
 
+void RenderLoo::setCameraPose(const CameraPose& pose, float fov, float zNear,
+                              float zFar) {
+    // assigned in place, no allocation per frame and references from
+    // getMainCamera() stay valid. The aspect is set every frame.
+    const vec3 up(0, 1, 0);
+    auto fps = dynamic_cast<FPSCamera*>(m_mainCamera.get());
+    auto arcBall = dynamic_cast<ArcBallCamera*>(m_mainCamera.get());
+    if (m_cameraMode == CameraMode::FPS && fps) {
+        *fps = FPSCamera(pose.position, pose.target, up, zNear, zFar, fov);
+    } else if (m_cameraMode == CameraMode::ArcBall && arcBall) {
+        *arcBall =
+            ArcBallCamera(pose.position, pose.target, up, zNear, zFar, fov);
+    } else {
+        m_mainCamera = createCamera(m_cameraMode, pose.position, pose.target,
+                                    zNear, zFar, fov);
+    }
+}
+
+void RenderLoo::saveScreenshot(const fs::path& filename) {
+    m_frameCapture.captureFramebuffer(0, getWidth(), getHeight(), filename);
+    LOG(INFO) << "Screenshot queued to " << filename.string();
+}
+
+void RenderLoo::startRecording(const fs::path& path, SequenceFormat format,
+                               int fps) {
+    m_sequenceFormat = format;
+    m_sequenceFPS = fps;
+    m_frameSequence = make_shared<FrameSequenceWriter>(path, format, fps);
+    LOG(INFO) << "Recording frames to " << path.string();
+}
+
+void RenderLoo::stopRecording() {
+    // pending readbacks keep the writer alive until they are encoded
+    m_frameSequence.reset();
+}
+
+float RenderLoo::frameDeltaTime() {
+    return isRecording() ? 1.0f / m_sequenceFPS : getDeltaTime();
+}
+
+void RenderLoo::recordFrame() {
+    if (m_frameSequence->isHDR())
+        m_frameCapture.captureTexture(*m_deferredResult, m_frameSequence);
+    else if (m_offscreenOutput)
+        m_frameCapture.captureTexture(*m_offscreenOutput, m_frameSequence);
+    else
+        m_frameCapture.captureFramebuffer(0, getWidth(), getHeight(),
+                                          m_frameSequence);
+}
+
+// current directory, file named by datetime
+static fs::path timestampedPath(const string& extension) {
+    time_t now = time(0);
+    tm* ltm = localtime(&now);
+    char buffer[80];
+    strftime(buffer, 80, "%Y-%m-%d_%H-%M-%S", ltm);
+    return fs::current_path() / (string(buffer) + extension);
+}
+
 static void popupFileSelector(
     const std::vector<nfdfilteritem_t>& filter, const nfdchar_t* defaultPath,
     std::function<void(const std::string&)> cb,
@@ -299,7 +407,7 @@ static void popupFileSelector(
 }
 
 void RenderLoo::gui() {
-    beginEvent("GUI");
+    GPUProfiler::beginEvent("GUI");
     auto& io = ImGui::GetIO();
     float h = io.DisplaySize.y;
     ImGuiWindowFlags windowFlags =
@@ -343,6 +451,123 @@ void RenderLoo::gui() {
                     ImVec4(hasAnimation ? 0.0f : 1.0f,
                            hasAnimation ? 1.0f : 0.0f, 0.0f, 1.0f),
                     "Animation: %s", hasAnimation ? "Yes" : "No");
+                ImGui::Checkbox("Frustum culling", &m_enableFrustumCulling);
+                if (m_enableFrustumCulling) {
+                    ImGui::Text("Visible meshes: %d/%d",
+                                m_frustumCuller.getVisible(),
+                                m_frustumCuller.getTotal());
+                }
+                ImGui::Checkbox("Software occlusion(CPU)",
+                                &m_enableSoftwareOcclusion);
+                if (m_enableSoftwareOcclusion) {
+                    const SoftwareOcclusionStatistics& software =
+                        m_softwareOcclusion.getStatistics();
+                    ImGui::Text("Occluders: %d(%d triangles)",
+                                software.occluders, software.triangles);
+                    ImGui::Text("Occluded: %d/%d in %.2f ms",
+                                software.occluded, software.tested,
+                                software.milliseconds);
+                }
+                ImGui::Checkbox("Multi draw indirect", &m_enableMultiDraw);
+                if (multiDraw()) {
+                    ImGui::Text("Draws: %d in %d calls",
+                                m_multiDraw.getDraws(),
+                                m_multiDraw.getDrawCalls());
+                    // the pyramid is stale after frames without culling
+                    if (ImGui::Checkbox("Occlusion culling(Hi-Z)",
+                                        &m_enableOcclusionCulling))
+                        m_occlusionCullingPass.invalidate();
+                    if (m_enableOcclusionCulling) {
+                        const OcclusionStatistics& occlusion =
+                            m_occlusionCullingPass.getStatistics();
+                        ImGui::Text(
+                            "Occlusion: %d + %d visible, %d culled",
+                            occlusion.firstPhase, occlusion.secondPhase,
+                            occlusion.occluded);
+                    }
+                    ImGui::Checkbox("Cluster culling", &m_enableClusterCulling);
+                    if (m_enableClusterCulling) {
+                        ImGui::Checkbox("Cluster occlusion(last frame)",
+                                        &m_enableClusterOcclusion);
+                        const ClusterStatistics& clusters =
+                            m_clusterCullingPass.getStatistics();
+                        ImGui::Text(
+                            "Meshlets: %d tested, %d frustum, %d backface, "
+                            "%d occluded",
+                            clusters.tested, clusters.frustumCulled,
+                            clusters.backfaceCulled, clusters.occluded);
+                        ImGui::Text("Meshlet triangles: %.1fk of %.1fk",
+                                    clusters.drawnTriangles / 1000.0f,
+                                    clusters.testedTriangles / 1000.0f);
+                    }
+                } else {
+                    const RenderStateCounters& counters =
+                        m_renderQueue.getLastFrameCounters();
+                    ImGui::Text(
+                        "Draws: %d, state changes: %d issued, %d skipped",
+                        counters.draws,
+                        counters.cullChanges + counters.vertexArrayBinds +
+                            counters.materialBinds,
+                        counters.skipped());
+                    if (m_instancing.getGroups() > 0) {
+                        if (ImGui::Checkbox("Instancing", &m_enableInstancing))
+                            m_renderQueue.setInstancing(m_enableInstancing);
+                        ImGui::Text("Instanced: %d meshes in %d groups, "
+                                    "%d drawn as instances",
+                                    m_instancing.getInstancedMeshes(),
+                                    m_instancing.getGroups(),
+                                    counters.instancedMeshes);
+                    }
+                }
+                if (m_lodSelector.getLODs()) {
+                    ImGui::Checkbox("Mesh LOD", &m_lodSelector.enabled);
+                    if (m_lodSelector.enabled)
+                        ImGui::SliderFloat("LOD pixel error",
+                                           &m_lodSelector.pixelError, 0.25f,
+                                           16.0f, "%.2f");
+                }
+                // every pass, shadows included
+                int submitted =
+                    multiDraw()
+                        ? m_multiDraw.getTriangles()
+                        : m_renderQueue.getLastFrameCounters().triangles;
+                ImGui::Text("Submitted triangles: %.1fk", submitted / 1000.0f);
+                ImGui::Text("Transforms updated: %d/%d",
+                            m_transforms.getUpdated(),
+                            (int)m_transforms.size());
+                const JobStatistics& jobs = JobSystem::getStatistics();
+                ImGui::Text("Jobs: %d on %d workers, %.0f%% stolen",
+                            jobs.jobs, jobs.workers, jobs.stealRate * 100.f);
+                ImGui::Text("Job utilization: %.1f%%",
+                            jobs.utilization * 100.f);
+                ImGui::Text("Uniform ring: %d/%d KB, %d stalls",
+                            (int)(UniformRing::getFrameBytes() / 1024),
+                            (int)(UniformRing::getFrameCapacity() / 1024),
+                            UniformRing::getStalls());
+            }
+            if (ImGui::CollapsingHeader("GPU timings")) {
+                bool profilerEnabled = GPUProfiler::isEnabled();
+                if (ImGui::Checkbox("Enable", &profilerEnabled))
+                    GPUProfiler::setEnabled(profilerEnabled);
+                const auto& timings = GPUProfiler::getLatest();
+                ImGui::Text("Frame %u, dropped %d", timings.frame,
+                            GPUProfiler::getDroppedFrames());
+                for (auto& pass : timings.passes) {
+                    ImGui::Text("%*s%-32s %7.3f ms", pass.depth * 2, "",
+                                pass.name.c_str(), pass.milliseconds);
+                }
+                // encode datetime
+                time_t now = time(0);
+                char buffer[80];
+                strftime(buffer, 80, "gpu_timings_%Y-%m-%d_%H-%M",
+                         localtime(&now));
+                if (ImGui::Button("Export CSV"))
+                    GPUProfiler::exportCSV(fs::current_path() /
+                                           (string(buffer) + ".csv"));
+                ImGui::SameLine();
+                if (ImGui::Button("Export JSON"))
+                    GPUProfiler::exportJSON(fs::current_path() /
+                                            (string(buffer) + ".json"));
             }
         }
     }
@@ -371,6 +596,14 @@ void RenderLoo::gui() {
                                  (int*)(&m_shadowMapPass.transparentShadowMode),
                                  transparentMode,
                                  IM_ARRAYSIZE(transparentMode));
+                    ImGui::Checkbox("Cull casters",
+                                    &m_shadowMapPass.enableCasterCulling);
+                    if (m_shadowMapPass.enableCasterCulling) {
+                        const FrustumCuller& casters =
+                            m_shadowMapPass.getCasterCuller();
+                        ImGui::Text("Shadow casters: %d/%d",
+                                    casters.getVisible(), casters.getTotal());
+                    }
                 }
             }
 
@@ -392,7 +625,7 @@ void RenderLoo::gui() {
                 }
                 if (m_cameraMode == CameraMode::ArcBall) {
                     static float rotationDPS = 0.f;
-                    float deltaTime = getDeltaTime();
+                    float deltaTime = frameDeltaTime();
                     ImGui::SliderFloat("Rot(°/s)", &rotationDPS, 0, 360);
                     dynamic_cast<ArcBallCamera&>(*m_mainCamera)
                         .orbitCameraAroundWorldUp(rotationDPS * deltaTime);
@@ -405,26 +638,62 @@ void RenderLoo::gui() {
                     m_mainCamera->getDirection().y,
                     m_mainCamera->getDirection().z,
                     glm::degrees(m_mainCamera->getFov()));
+                if (ImGui::Checkbox("Record path", &m_recordingCameraPath)) {
+                    if (m_recordingCameraPath) {
+                        m_recordedCameraPath.clear();
+                        m_cameraPathTimer = 0.f;
+                    } else {
+                        saveCameraPath(fs::current_path() / "camera_path.json",
+                                       m_recordedCameraPath);
+                    }
+                }
+                if (m_recordingCameraPath) {
+                    // one keyframe every CAMERA_PATH_RECORD_INTERVAL secs
+                    m_cameraPathTimer -= getDeltaTime();
+                    if (m_cameraPathTimer <= 0.f) {
+                        m_recordedCameraPath.push_back(CameraPose{
+                            m_mainCamera->position,
+                            m_mainCamera->position +
+                                m_mainCamera->getDirection()});
+                        m_cameraPathTimer = CAMERA_PATH_RECORD_INTERVAL;
+                    }
+                    ImGui::SameLine();
+                    ImGui::Text("%d keyframes",
+                                (int)m_recordedCameraPath.size());
+                }
                 if (ImGui::Button("Screenshot")) {
-                    Framebuffer fbo;
-                    fbo.init();
-                    Texture2D tex;
-                    tex.init();
-                    tex.setupStorage(getWidth(), getHeight(), GL_RGB8, 1);
-                    fbo.attachTexture(tex, GL_COLOR_ATTACHMENT0, 0);
-                    glBlitNamedFramebuffer(0, fbo.getId(), 0, 0, getWidth(),
-                                           getHeight(), 0, 0, getWidth(),
-                                           getHeight(), GL_COLOR_BUFFER_BIT,
-                                           GL_LINEAR);
-                    // encode datetime
-                    time_t now = time(0);
-                    tm* ltm = localtime(&now);
-                    char buffer[80];
-                    strftime(buffer, 80, "%Y-%m-%d_%H-%M", ltm);
-                    string filename = string(buffer) + ".png";
-                    fs::path path = fs::current_path() / filename;
-                    tex.save(path.string());
-                    LOG(INFO) << "Screenshot saved to " << path.string();
+                    saveScreenshot(timestampedPath(".png"));
+                }
+                ImGui::SameLine();
+                // linear HDR color before bloom and tone mapping
+                if (ImGui::Button("HDR Screenshot")) {
+                    m_frameCapture.captureTexture(*m_deferredResult,
+                                                  timestampedPath(".exr"));
+                }
+                // frame sequence, e.g. turntables with Rot(°/s)
+                const char* sequenceFormat[] = {"Y4M", "Raw RGB", "EXR"};
+                const char* sequenceExtension[] = {".y4m", ".rgb", ""};
+                bool recording = isRecording();
+                if (!recording) {
+                    ImGui::Combo("Format", (int*)(&m_sequenceFormat),
+                                 sequenceFormat, IM_ARRAYSIZE(sequenceFormat));
+                    ImGui::SliderInt("FPS", &m_sequenceFPS, 24, 120);
+                }
+                if (ImGui::Checkbox("Record frames", &recording)) {
+                    if (recording) {
+                        startRecording(
+                            timestampedPath(
+                                sequenceExtension[(int)m_sequenceFormat]),
+                            m_sequenceFormat, m_sequenceFPS);
+                    } else {
+                        stopRecording();
+                    }
+                }
+                if (recording) {
+                    ImGui::SameLine();
+                    ImGui::Text("stalls: %d gpu, %d disk",
+                                m_frameCapture.getStalls(),
+                                m_frameCapture.getEncoderStalls());
                 }
             }
             // Model
@@ -517,46 +786,98 @@ void RenderLoo::gui() {
                         popupFileSelector({{"Model Files", "glb,gltf,obj,fbx"}},
                                           nullptr,
                                           [this](const string& outPath) {
-                                              loadModel(outPath);
+                                              loadModelAsync(outPath);
                                           });
                     }
+                    if (m_modelLoader.isLoading()) {
+                        ImGui::Text("Loading %s: %.1f s",
+                                    m_modelLoader.getFilename().c_str(),
+                                    m_modelLoader.getElapsedSeconds());
+                        float progress = m_modelLoader.getProgress();
+                        bool importing = m_modelLoader.getPhase() ==
+                                         ModelLoadPhase::Import;
+                        // parsing reports no progress, cache loads do
+                        if (importing && progress == 0.0f)
+                            ImGui::Text("Importing...");
+                        else
+                            ImGui::ProgressBar(
+                                progress, ImVec2(-1, 0),
+                                importing ? "Importing" : nullptr);
+                    }
+                    const ModelLoadTimes& times =
+                        m_modelLoader.getLastTimes();
+                    ImGui::Text(
+                        "Last load(ms): import %.0f, materials %.0f,\n"
+                        "vertex arrays %.1f, setup %.1f",
+                        times.import, times.prepare, times.vertexArrays,
+                        times.setup);
+                    if (times.cacheMapping > 0.f)
+                        ImGui::Text(
+                            "Scene cache(ms): mapping %.1f, textures %.0f,\n"
+                            "buffers %.1f",
+                            times.cacheMapping, times.cacheTextures,
+                            times.cacheBuffers);
                 }
             }
         }
     }
-    endEvent();
+    GPUProfiler::endEvent();
 }
 
 void RenderLoo::finalScreenPass(const loo::Texture2D& texture) {
-    beginEvent("Final Screen Pass");
-    m_finalprocess.render(texture);
-    endEvent();
+    GPUProfiler::beginEvent("Final Screen Pass");
+    m_finalprocess.render(texture,
+                          m_offscreenOutput ? &m_offscreenfb : nullptr);
+    GPUProfiler::endEvent();
 }
 
-void RenderLoo::convertMaterial() {
-    int cnt = 0;
-    for (auto& mesh : m_scene.getMeshes()) {
-        // Now default material is PBR material
-        if (mesh->material) {
+void RenderLoo::convertMaterial(loo::Scene& scene) {
+    std::atomic<int> cnt{0};
+    const auto& meshes = scene.getMeshes();
+    // every mesh owns its material pointer, no GL calls involved
+    JobSystem::parallelFor(
+        static_cast<int>(meshes.size()), 64, [&](int first, int last) {
+            for (int i = first; i < last; i++) {
+                auto& mesh = meshes[i];
+                // Now default material is PBR material
+                if (!mesh->material)
+                    continue;
 #ifdef MATERIAL_PBR
-            if (!dynamic_pointer_cast<PBRMetallicMaterial>(mesh->material)) {
-                auto pbrMaterial = convertPBRMetallicMaterialFromBaseMaterial(
+                if (!dynamic_pointer_cast<PBRMetallicMaterial>(
+                        mesh->material)) {
+                    mesh->material = convertPBRMetallicMaterialFromBaseMaterial(
+                        *static_pointer_cast<BaseMaterial>(mesh->material));
+                    cnt++;
+                }
+#else
+                mesh->material = convertSimpleMaterialFromBaseMaterial(
                     *static_pointer_cast<BaseMaterial>(mesh->material));
-                mesh->material = pbrMaterial;
                 cnt++;
-            }
-#else
-            LOG(INFO) << "Converting material to simple(blinn-phong) material";
-            mesh->material = convertSimpleMaterialFromBaseMaterial(
-                *static_pointer_cast<BaseMaterial>(mesh->material));
 #endif
+            }
+        });
+#ifdef MATERIAL_PBR
+    // every mesh got its own conversion, equal ones share one material so
+    // that draws can be batched by material
+    ContentRegistry<MaterialContentKey, Material> materials;
+    for (auto& mesh : meshes) {
+        if (auto material =
+                dynamic_pointer_cast<PBRMetallicMaterial>(mesh->material)) {
+            mesh->material =
+                materials.intern(material->getContentKey(), mesh->material);
         }
     }
-    LOG(INFO) << "Converted " << cnt << " materials to PBR materials";
+    LOG(INFO) << "Converted " << cnt << " materials to PBR materials, "
+              << materials.size() << " unique("
+              << materials.getDuplicates() << " duplicates shared)";
+#else
+    LOG(INFO) << "Converted " << cnt
+              << " materials to simple(blinn-phong) materials";
+#endif
 }
 
 void RenderLoo::skyboxPass() {
-    Application::beginEvent("Skybox Pass");
+    GPUProfiler::beginEvent("Skybox Pass");
     m_deferredfb.enableAttachments({GL_COLOR_ATTACHMENT0});
     glEnable(GL_DEPTH_TEST);
 
@@ -568,10 +889,10 @@ void RenderLoo::skyboxPass() {
     glEnable(GL_CULL_FACE);
 
     m_deferredfb.unbind();
-    Application::endEvent();
+    GPUProfiler::endEvent();
 }
 void RenderLoo::gbufferPass() {
-    beginEvent("GBuffer Pass");
+    GPUProfiler::beginEvent("GBuffer Pass");
     // render gbuffer here
     m_gbufferfb.bind();
 
@@ -603,11 +924,11 @@ void RenderLoo::gbufferPass() {
     glStencilFunc(GL_EQUAL, 1, 0xFF);
     // disable stencil write
     glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
-    endEvent();
+    GPUProfiler::endEvent();
 }
 
 void RenderLoo::deferredPass() {
-    beginEvent("Deferred Pass");
+    GPUProfiler::beginEvent("Deferred Pass");
 
     m_deferredfb.bind();
     m_deferredfb.enableAttachments({GL_COLOR_ATTACHMENT0});
@@ -643,7 +964,7 @@ void RenderLoo::deferredPass() {
     Quad::globalQuad().draw();
     glEnable(GL_DEPTH_TEST);
 
-    endEvent();
+    GPUProfiler::endEvent();
 }
 
 void RenderLoo::aoPass() {
@@ -656,9 +977,9 @@ void RenderLoo::aoPass() {
 }
 const loo::Texture2D& RenderLoo::smaaPass(const loo::Texture2D& input) {
     if (m_antialiasmethod == AntiAliasMethod::SMAA) {
-        beginEvent("SMAA Pass");
+        GPUProfiler::beginEvent("SMAA Pass");
         const Texture2D& texture = m_smaa.apply(input);
-        endEvent();
+        GPUProfiler::endEvent();
         return texture;
     }
     return input;
@@ -678,20 +999,47 @@ void RenderLoo::scene(loo::ShaderProgram& shader, RenderFlag flag) {
     logPossibleGLError();
     bool renderOpaque = flag & RenderFlag_Opaque,
          renderTransparent = flag & RenderFlag_Transparent;
-    for (auto mesh : m_scene.getMeshes()) {
-        if ((!mesh->needAlphaBlend() && renderOpaque) ||
-            (mesh->needAlphaBlend() && renderTransparent)) {
-            if (mesh->isDoubleSided() || renderTransparent) {
-                glDisable(GL_CULL_FACE);
+    const MeshVisibility* visible = visibility();
+    if (MultiDrawScene* md = multiDraw()) {
+        if (renderOpaque) {
+            const std::vector<int>* draws = &filterVisibleDraws(
+                md->getOpaqueDraws(), visible, m_visibleDraws);
+            glm::mat4 view, projection;
+            m_mainCamera->getViewMatrix(view);
+            m_mainCamera->getProjectionMatrix(projection, true);
+            // dense meshes first, before the pyramid is rebuilt
+            if (m_enableClusterCulling) {
+                const Texture2D* hiZ =
+                    m_enableOcclusionCulling && m_enableClusterOcclusion
+                        ? m_occlusionCullingPass.getPyramid()
+                        : nullptr;
+                draws = &m_clusterCullingPass.render(
+                    *md, *draws, shader, !renderTransparent,
+                    projection * view, m_mainCamera->position, hiZ,
+                    m_prevProjection * m_prevView);
+            }
+            if (m_enableOcclusionCulling) {
+                m_occlusionCullingPass.render(
+                    *md, *draws, shader, !renderTransparent,
+                    *m_gbuffers.depthStencil, projection * view,
+                    m_prevProjection * m_prevView);
             } else {
-                glEnable(GL_CULL_FACE);
-                glCullFace(GL_BACK);
+                md->draw(*draws, shader, !renderTransparent);
             }
-
-            drawMesh(*mesh, m_scene.getModelMatrix(),
-                     m_scene.getPreviousModelMatrix(), m_baseshader);
         }
+        if (renderTransparent) {
+            md->draw(filterVisibleDraws(md->getBlendDraws(), visible,
+                                        m_visibleDraws),
+                     shader, false);
+        }
+        logPossibleGLError();
+        return;
     }
+    // front to back, grouped by cull mode, material and VAO
+    m_renderQueue.build(RenderQueuePass::Opaque, m_mainCamera->position,
+                        m_mainCamera->getDirection(), renderOpaque,
+                        renderTransparent, visible);
+    m_renderQueue.submit(shader, !renderTransparent);
     logPossibleGLError();
 }
 
@@ -711,6 +1059,7 @@ void RenderLoo::keyboard() {
         m_mainCamera->moveCamera(CameraMovement::RIGHT, getDeltaTime());
     if (glfwGetKey(getWindow(), GLFW_KEY_R)) {
         m_mainCamera = placeCameraBySceneAABB(m_scene.aabb, m_cameraMode);
+        m_occlusionCullingPass.invalidate();
     }
 }
 void RenderLoo::mouse() {
@@ -718,6 +1067,24 @@ void RenderLoo::mouse() {
     glfwSetScrollCallback(getWindow(), scrollCallback);
 }
 void RenderLoo::loop() {
+    renderFrame(frameDeltaTime());
+
+    keyboard();
+
+    mouse();
+}
+void RenderLoo::renderFrame(float deltaTime) {
+    GPUProfiler::newFrame();
+    UniformRing::beginFrame();
+    m_renderQueue.newFrame();
+    JobSystem::newFrame();
+    m_frameCapture.update();
+    // the old scene renders until the new one is complete
+    if (m_modelLoader.update()) {
+        SceneMeshData meshData;
+        Scene scene = m_modelLoader.takeScene(&meshData);
+        setScene(std::move(scene), std::move(meshData));
+    }
     m_mainCamera->setAspect(getWindowRatio());
     // render
     glEnable(GL_DEPTH_TEST);
@@ -734,19 +1101,36 @@ void RenderLoo::loop() {
                 info.timeSecs = getFrameTimeFromStart();
                 info.enableTAA = m_antialiasmethod == AntiAliasMethod::TAA;
             });
-        animation();
-
-        // setup camera shader uniform block
-        ShaderProgram::getUniformBlock(SHADER_UB_PORT_MVP)
-            .mapBufferScoped<MVP>([this](MVP& mvp) {
-                m_mainCamera->getViewMatrix(mvp.view);
-                m_mainCamera->getProjectionMatrix(mvp.projection, true);
-            });
+        animation(deltaTime);
+        // world and normal matrices of the meshes moved by the animation
+        m_transforms.update(m_scene);
+
+        // setup camera shader uniform blocks
+        glm::mat4 view, projection;
+        m_mainCamera->getViewMatrix(view);
+        m_mainCamera->getProjectionMatrix(projection, true);
+        setCameraMatrices(view, projection, m_prevView, m_prevProjection);
+        if (m_enableFrustumCulling)
+            m_frustumCuller.cull(m_scene, m_transforms, projection * view);
+        if (m_enableSoftwareOcclusion) {
+            m_softwareOcclusion.cull(
+                m_scene, m_transforms, projection * view,
+                m_enableFrustumCulling ? &m_frustumCuller.getVisibility()
+                                       : nullptr);
+        }
+        m_multiDraw.update(m_transforms);
+        m_lodSelector.select(
+            m_transforms, m_mainCamera->position,
+            getHeight() / (2.f * std::tan(m_mainCamera->getFov() * 0.5f)));
 
+        setLODLevels(m_lodSelector.getLevels());
         gbufferPass();
 
-        m_shadowMapPass.render(m_scene, m_lights,
-                               m_transparentPass.getAlphaTestThreshold());
+        setLODLevels(m_lodSelector.getShadowLevels());
+        m_shadowMapPass.render(m_scene, m_transforms, m_lights,
+                               m_transparentPass.getAlphaTestThreshold(),
+                               m_renderQueue, multiDraw());
+        setLODLevels(m_lodSelector.getLevels());
 
         aoPass();
 
@@ -754,9 +1138,13 @@ void RenderLoo::loop() {
 
         skyboxPass();
 
-        m_transparentPass.render(m_scene, m_skybox, *m_mainCamera,
+        m_transparentPass.render(m_scene, m_transforms, m_skybox,
+                                 *m_mainCamera,
                                  m_shadowMapPass.getDirectionalShadowMap(),
-                                 m_enableDFGCompensation);
+                                 m_enableDFGCompensation, visibility(),
+                                 multiDraw(),
+                                 m_enableInstancing ? &m_instancing : nullptr,
+                                 &m_geometryArena);
         const Texture2D& taaResult = taaPass(*m_deferredResult);
 
         const Texture2D& bloomResult =
@@ -767,31 +1155,32 @@ void RenderLoo::loop() {
         if (m_debugOutputPass.debugOutputOption == DebugOutputOption::None)
             finalScreenPass(smaaResult);
         else
-            m_debugOutputPass.render(m_gbuffers, getAOTexture());
-
-        // update previous frame MVP
-        ShaderProgram::getUniformBlock(SHADER_UB_PORT_PREVIOUS_FRAME_MVP)
-            .mapBufferScoped<MVP>([this](MVP& mvp) {
-                m_mainCamera->getViewMatrix(mvp.view);
-                m_mainCamera->getProjectionMatrix(mvp.projection, true);
-            });
+            m_debugOutputPass.render(
+                m_gbuffers, getAOTexture(),
+                m_offscreenOutput ? &m_offscreenfb : nullptr);
+        if (m_frameSequence)
+            recordFrame();
+
+        // previous frame camera for the next frame
+        m_prevView = view;
+        m_prevProjection = projection;
         m_scene.savePreviousTransform();
     }
-
-    keyboard();
-
-    mouse();
+    UniformRing::endFrame();
 }
 
-void RenderLoo::animation() {
+void RenderLoo::animation(float deltaTime) {
     if (!m_animator.hasAnimation())
         return;
-    m_animator.updateAnimation(getDeltaTime());
+    m_animator.updateAnimation(deltaTime);
     auto& ub = ShaderProgram::getUniformBlock(SHADER_UB_PORT_BONES);
     ub.updateData(m_animator.finalBoneMatrices.data());
     panicPossibleGLError();
 }
 
 void RenderLoo::afterCleanup() {
+    m_modelLoader.shutdown();
+    stopRecording();
+    m_frameCapture.flush();
     NFD_Quit();
 }
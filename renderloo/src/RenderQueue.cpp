@@ -0,0 +1,235 @@
+#include "core/RenderQueue.hpp"
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <limits>
+#include <loo/glError.hpp>
+#include <unordered_map>
+#include "core/Graphics.hpp"
+#include "core/Instancing.hpp"
+
+using namespace loo;
+using namespace std;
+
+void RenderStateCache::reset() {
+    m_cullFace = -1;
+    m_vertexArrayKnown = false;
+    m_material = nullptr;
+}
+
+void RenderStateCache::setCullFace(bool backFaceCulling) {
+    if (m_cullFace == static_cast<int>(backFaceCulling)) {
+        counters.cullSkipped++;
+        return;
+    }
+    if (backFaceCulling) {
+        glEnable(GL_CULL_FACE);
+        glCullFace(GL_BACK);
+    } else {
+        glDisable(GL_CULL_FACE);
+    }
+    m_cullFace = backFaceCulling;
+    counters.cullChanges++;
+}
+
+void RenderStateCache::bindVertexArray(GLuint vao) {
+    if (m_vertexArrayKnown && m_vertexArray == vao) {
+        counters.vertexArraySkipped++;
+        return;
+    }
+    glBindVertexArray(vao);
+    m_vertexArray = vao;
+    m_vertexArrayKnown = true;
+    counters.vertexArrayBinds++;
+}
+
+void RenderStateCache::bindMaterial(Material& material,
+                                    const ShaderProgram& sp) {
+    if (m_material == &material) {
+        counters.materialSkipped++;
+        return;
+    }
+    material.bind(sp);
+    m_material = &material;
+    counters.materialBinds++;
+}
+
+void InstanceGatherer::gather(std::vector<RenderItem>& items,
+                              const std::vector<uint32_t>& prototypes) {
+    constexpr uint64_t depthMask = (uint64_t(1) << SORT_KEY_DEPTH_BITS) - 1;
+    const size_t count = items.size();
+    if (m_firstInstance.size() != prototypes.size())
+        m_firstInstance.assign(prototypes.size(),
+                               FirstInstance{UINT32_MAX, 0});
+    // rank: the first item of the prototype in the run, a stable counting
+    // sort by rank keeps the state order and the front most copy in place
+    m_itemRanks.resize(count);
+    m_rankOffsets.assign(count + 1, 0);
+    uint32_t runStart = 0;
+    for (size_t i = 0; i < count; i++) {
+        if ((items[i].sortKey & ~depthMask) !=
+            (items[runStart].sortKey & ~depthMask))
+            runStart = static_cast<uint32_t>(i);
+        FirstInstance& first = m_firstInstance[prototypes[items[i].meshIndex]];
+        if (first.runStart != runStart)
+            first = FirstInstance{runStart, static_cast<uint32_t>(i)};
+        m_itemRanks[i] = first.item;
+        m_rankOffsets[first.item + 1]++;
+    }
+    for (size_t i = 0; i < count; i++)
+        m_rankOffsets[i + 1] += m_rankOffsets[i];
+    m_gathered.resize(count);
+    for (size_t i = 0; i < count; i++)
+        m_gathered[m_rankOffsets[m_itemRanks[i]]++] = items[i];
+    std::swap(items, m_gathered);
+    // a run may start at the same index in the next call
+    for (auto& item : items)
+        m_firstInstance[prototypes[item.meshIndex]].runStart = UINT32_MAX;
+}
+
+size_t findInstanceRunEnd(const std::vector<RenderItem>& items, size_t first,
+                          const std::vector<uint32_t>& prototypes,
+                          const std::vector<uint8_t>* lodLevels) {
+    auto lodOf = [lodLevels](uint32_t mesh) {
+        return lodLevels ? (*lodLevels)[mesh] : 0;
+    };
+    uint32_t prototype = prototypes[items[first].meshIndex];
+    int lod = lodOf(items[first].meshIndex);
+    size_t end = first + 1;
+    while (end < items.size() &&
+           prototypes[items[end].meshIndex] == prototype &&
+           lodOf(items[end].meshIndex) == lod)
+        end++;
+    return end;
+}
+
+void RenderQueue::setScene(const Scene& scene,
+                           const TransformCache& transforms,
+                           const GeometryArena* geometry,
+                           const MeshInstancing* instancing) {
+    m_transforms = &transforms;
+    m_meshes.clear();
+    m_prototypes.clear();
+    m_hasInstances = instancing && instancing->getGroups() > 0;
+    std::unordered_map<const Material*, uint32_t> materialIds;
+    std::unordered_map<GLuint, uint32_t> vertexArrayIds;
+    for (auto& mesh : scene.getMeshes()) {
+        MeshEntry entry{};
+        entry.mesh = mesh.get();
+        entry.geometry = geometry ? geometry->find(mesh.get()) : nullptr;
+        uint32_t prototypeIndex =
+            instancing ? instancing->getPrototype(m_meshes.size())
+                       : static_cast<uint32_t>(m_meshes.size());
+        m_prototypes.push_back(prototypeIndex);
+        if (mesh->needAlphaBlend())
+            entry.flags |= RenderItem_AlphaBlend;
+        if (mesh->isDoubleSided())
+            entry.flags |= RenderItem_DoubleSided;
+        if (prototypeIndex != m_meshes.size()) {
+            // equal material and geometry, the copy sorts with its prototype
+            const MeshEntry& prototype = m_meshes[prototypeIndex];
+            entry.materialId = prototype.materialId;
+            entry.vertexArrayId = prototype.vertexArrayId;
+            m_meshes.push_back(entry);
+            continue;
+        }
+        entry.materialId =
+            materialIds
+                .try_emplace(mesh->material.get(),
+                             static_cast<uint32_t>(materialIds.size()))
+                .first->second;
+        GLuint vao = entry.geometry ? entry.geometry->vao : mesh->vao;
+        entry.vertexArrayId =
+            vertexArrayIds
+                .try_emplace(vao, static_cast<uint32_t>(vertexArrayIds.size()))
+                .first->second;
+        m_meshes.push_back(entry);
+    }
+    if (materialIds.size() >= (1u << SORT_KEY_MATERIAL_BITS) ||
+        vertexArrayIds.size() >= (1u << SORT_KEY_VERTEX_ARRAY_BITS)) {
+        LOG(WARNING) << "Too many materials or meshes for the sort key, "
+                        "draw order will not be optimal";
+    }
+}
+
+const std::vector<RenderItem>& RenderQueue::build(
+    RenderQueuePass pass, const glm::vec3& viewOrigin,
+    const glm::vec3& viewAxis, bool opaque, bool blend,
+    const MeshVisibility* visibility) {
+    m_items.clear();
+    m_depths.clear();
+    // depth only passes do not care about materials
+    m_bindMaterial = pass != RenderQueuePass::ShadowOpaque;
+    float minDepth = std::numeric_limits<float>::max(),
+          maxDepth = std::numeric_limits<float>::lowest();
+    for (size_t i = 0; i < m_meshes.size(); i++) {
+        const MeshEntry& entry = m_meshes[i];
+        bool isBlend = entry.flags & RenderItem_AlphaBlend;
+        if ((isBlend && !blend) || (!isBlend && !opaque))
+            continue;
+        if (visibility && !(*visibility)[i])
+            continue;
+        glm::vec3 center(m_transforms->getWorld(i) *
+                         glm::vec4(entry.mesh->aabb.getCenter(), 1.0f));
+        float depth = glm::dot(center - viewOrigin, viewAxis);
+        minDepth = std::min(minDepth, depth);
+        maxDepth = std::max(maxDepth, depth);
+        m_depths.push_back(depth);
+        uint64_t sortKey = makeSortKey(
+            static_cast<uint32_t>(pass), entry.flags & RenderItem_DoubleSided,
+            m_bindMaterial ? entry.materialId : 0, entry.vertexArrayId, 0);
+        m_items.push_back(RenderItem{sortKey, entry.mesh,
+                                     static_cast<uint32_t>(i), entry.flags});
+    }
+    // the depth field is the lowest one, fill it in once the range is known
+    float depthScale = maxDepth > minDepth ? 1.0f / (maxDepth - minDepth) : 0;
+    for (size_t i = 0; i < m_items.size(); i++) {
+        m_items[i].sortKey |=
+            quantizeSortDepth((m_depths[i] - minDepth) * depthScale);
+    }
+    std::sort(m_items.begin(), m_items.end(),
+              [](const RenderItem& a, const RenderItem& b) {
+                  return a.sortKey < b.sortKey;
+              });
+    if (m_hasInstances && m_enableInstancing)
+        m_gatherer.gather(m_items, m_prototypes);
+    return m_items;
+}
+
+void RenderQueue::submit(ShaderProgram& sp, bool cullBackFaces) {
+    m_state.reset();
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    for (size_t i = 0; i < m_items.size();) {
+        const RenderItem& item = m_items[i];
+        const MeshEntry& entry = m_meshes[item.meshIndex];
+        int lod = getLODLevel(item.meshIndex);
+        // copies of one prototype at the same level, see InstanceGatherer
+        size_t end = m_enableInstancing
+                         ? findInstanceRunEnd(m_items, i, m_prototypes,
+                                              m_lodLevels)
+                         : i + 1;
+        m_state.setCullFace(cullBackFaces &&
+                            !(item.flags & RenderItem_DoubleSided));
+        if (end - i > 1) {
+            m_instanceMeshes.clear();
+            for (size_t j = i; j < end; j++)
+                m_instanceMeshes.push_back(m_items[j].meshIndex);
+            const MeshEntry& prototype = m_meshes[m_prototypes[item.meshIndex]];
+            drawMeshInstances(*prototype.mesh, *m_transforms,
+                              m_instanceMeshes.data(), m_instanceMeshes.size(),
+                              sp, m_state, m_bindMaterial, prototype.geometry,
+                              lod);
+        } else {
+            drawMesh(*item.mesh, *m_transforms, item.meshIndex, sp, m_state,
+                     m_bindMaterial, entry.geometry, lod);
+        }
+        i = end;
+    }
+    glBindVertexArray(0);
+    logPossibleGLError();
+}
+
+void RenderQueue::newFrame() {
+    m_lastFrameCounters = m_state.counters;
+    m_state.counters = RenderStateCounters{};
+}
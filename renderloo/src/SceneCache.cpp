@@ -0,0 +1,850 @@
+#include "core/SceneCache.hpp"
+#include <glog/logging.h>
+#include <loo/Material.hpp>
+#include <loo/glError.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <set>
+#include <type_traits>
+#include "core/ContentRegistry.hpp"
+#include "core/Instancing.hpp"
+#include "core/JobSystem.hpp"
+#include "core/MappedFile.hpp"
+#include "core/MeshLOD.hpp"
+#include "core/MeshOptimizer.hpp"
+#include "core/ModelLoader.hpp"
+#include "core/TextureCompression.hpp"
+#include "core/TextureLoader.hpp"
+
+using namespace loo;
+using namespace std;
+namespace fs = std::filesystem;
+
+namespace {
+using Vertex = std::decay_t<decltype(Mesh::vertices)>::value_type;
+using Index = std::decay_t<decltype(Mesh::indices)>::value_type;
+static_assert(std::is_trivially_copyable_v<Vertex>,
+              "vertices are stored as raw bytes");
+
+const fs::path SCENE_CACHE_DIRECTORY = fs::path(".cache") / "scenes";
+// the minimum GL_MAX_VERTEX_ATTRIBS, loo uses far fewer
+constexpr uint32_t MAX_VERTEX_ATTRIBUTES = 16;
+
+uint64_t alignOffset(uint64_t offset) {
+    return (offset + SCENE_CACHE_ALIGNMENT - 1) & ~(SCENE_CACHE_ALIGNMENT - 1);
+}
+
+// meshes of a cached scene own their buffers, loo only knows the vertex
+// array of a mesh
+struct CachedMesh : public Mesh {
+    GLuint vertexBuffer{0}, indexBuffer{0};
+    ~CachedMesh() {
+        glDeleteVertexArrays(1, &vao);
+        vao = 0;
+        glDeleteBuffers(1, &vertexBuffer);
+        glDeleteBuffers(1, &indexBuffer);
+    }
+};
+
+struct TextureRecord {
+    int32_t width, height;
+    uint32_t internalFormat, levels;
+    int32_t minFilter, magFilter, wrap;
+    // of the level 0 pixels, keys the compressed textures
+    uint64_t hash;
+    // level 0 and the levels - 1 mips follow
+    uint64_t offset;
+};
+
+struct MeshRecord {
+    uint64_t vertexOffset, vertexCount;
+    uint64_t indexOffset, indexCount;
+    int32_t material;
+    // of the import time reordering, the arrays are stored reordered
+    MeshOptimizationStatistics optimization;
+    // the LOD indices follow the mesh indices
+    uint64_t lodIndexCount;
+    uint32_t lodLevelCount;
+    MeshLODLevel lodLevels[MESH_LOD_COUNT - 1];
+};
+
+class MetaWriter {
+   public:
+    explicit MetaWriter(const std::map<const Texture2D*, int>& textures)
+        : m_textures(textures) {}
+    template <typename T>
+    void pod(const T& value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        auto bytes = reinterpret_cast<const uint8_t*>(&value);
+        m_bytes.insert(m_bytes.end(), bytes, bytes + sizeof(T));
+    }
+    void string(const std::string& value) {
+        pod(static_cast<uint32_t>(value.size()));
+        m_bytes.insert(m_bytes.end(), value.begin(), value.end());
+    }
+    void texture(const std::shared_ptr<Texture2D>& texture, TextureRole) {
+        auto it = m_textures.find(texture.get());
+        pod(static_cast<int32_t>(it == m_textures.end() ? -1 : it->second));
+    }
+    [[nodiscard]] const std::vector<uint8_t>& getBytes() const {
+        return m_bytes;
+    }
+
+   private:
+    const std::map<const Texture2D*, int>& m_textures;
+    std::vector<uint8_t> m_bytes;
+};
+
+// a texture field of a material, filled once the textures exist
+struct TextureBinding {
+    std::shared_ptr<Texture2D>* field;
+    int texture;
+    TextureRole role;
+};
+
+class MetaReader {
+   public:
+    MetaReader(const uint8_t* data, size_t size, uint32_t textureCount)
+        : m_data(data), m_end(data + size), m_textureCount(textureCount) {}
+    template <typename T>
+    void pod(T& value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        if (!check(sizeof(T)))
+            return;
+        std::memcpy(&value, m_data, sizeof(T));
+        m_data += sizeof(T);
+    }
+    void string(std::string& value) {
+        uint32_t size = 0;
+        pod(size);
+        if (!check(size))
+            return;
+        value.assign(reinterpret_cast<const char*>(m_data), size);
+        m_data += size;
+    }
+    void texture(std::shared_ptr<Texture2D>& texture, TextureRole role) {
+        int32_t index = -1;
+        pod(index);
+        if (index >= static_cast<int32_t>(m_textureCount))
+            m_failed = true;
+        else if (index >= 0)
+            m_bindings.push_back(TextureBinding{&texture, index, role});
+    }
+    [[nodiscard]] bool failed() const { return m_failed; }
+    [[nodiscard]] const std::vector<TextureBinding>& getBindings() const {
+        return m_bindings;
+    }
+
+   private:
+    bool check(size_t size) {
+        m_failed = m_failed || static_cast<size_t>(m_end - m_data) < size;
+        return !m_failed;
+    }
+
+    const uint8_t* m_data;
+    const uint8_t* m_end;
+    uint32_t m_textureCount;
+    std::vector<TextureBinding> m_bindings;
+    bool m_failed{false};
+};
+
+// the fields read by the material conversions, the role of a texture
+// picks its compression
+template <typename M, typename Visitor>
+void visitMaterial(M& material, Visitor& visitor) {
+    auto& mr = material.mrWorkFlow;
+    visitor.pod(mr.baseColor);
+    visitor.pod(mr.metallic);
+    visitor.pod(mr.roughness);
+    visitor.texture(mr.baseColorTex, TextureRole::Color);
+    visitor.texture(mr.metallicTex, TextureRole::Metallic);
+    visitor.texture(mr.roughnessTex, TextureRole::Roughness);
+    visitor.texture(mr.occlusionTex, TextureRole::Occlusion);
+    auto& bp = material.bpWorkFlow;
+    visitor.pod(bp.ambient);
+    visitor.pod(bp.diffuse);
+    visitor.pod(bp.specular);
+    visitor.pod(bp.transparent);
+    visitor.pod(bp.ior);
+    visitor.pod(bp.shininess);
+    visitor.pod(material.emissiveFactor);
+    visitor.pod(material.flags);
+    visitor.texture(material.normalTex, TextureRole::Normal);
+    visitor.texture(material.emissiveTex, TextureRole::Color);
+    visitor.texture(material.ambientTex, TextureRole::Other);
+    visitor.texture(material.diffuseTex, TextureRole::Other);
+    visitor.texture(material.displacementTex, TextureRole::Other);
+    visitor.texture(material.specularTex, TextureRole::Other);
+    visitor.texture(material.opacityTex, TextureRole::Other);
+    visitor.texture(material.heightTex, TextureRole::Other);
+}
+
+// calls function on every texture of a material, with its role. The
+// texture fields of a mutable material may be replaced.
+template <typename Function>
+struct TextureVisitor {
+    Function& function;
+    template <typename T>
+    void pod(const T&) {}
+    template <typename Pointer>
+    void texture(Pointer& texture, TextureRole role) {
+        if (texture)
+            function(texture, role);
+    }
+};
+
+TextureRecord describeTexture(const Texture2D& texture) {
+    GLuint id = texture.getId();
+    TextureRecord record{};
+    GLint internalFormat = 0, levels = 0;
+    glGetTextureLevelParameteriv(id, 0, GL_TEXTURE_WIDTH, &record.width);
+    glGetTextureLevelParameteriv(id, 0, GL_TEXTURE_HEIGHT, &record.height);
+    glGetTextureLevelParameteriv(id, 0, GL_TEXTURE_INTERNAL_FORMAT,
+                                 &internalFormat);
+    glGetTextureParameteriv(id, GL_TEXTURE_MIN_FILTER, &record.minFilter);
+    glGetTextureParameteriv(id, GL_TEXTURE_MAG_FILTER, &record.magFilter);
+    glGetTextureParameteriv(id, GL_TEXTURE_WRAP_S, &record.wrap);
+    glGetTextureParameteriv(id, GL_TEXTURE_IMMUTABLE_LEVELS, &levels);
+    bool mipmapped = record.minFilter != GL_NEAREST &&
+                     record.minFilter != GL_LINEAR;
+    if (levels == 0) {
+        levels = mipmapped ? static_cast<GLint>(std::floor(std::log2(
+                                 std::max(record.width, record.height)))) +
+                                 1
+                           : 1;
+    }
+    record.internalFormat = static_cast<uint32_t>(internalFormat);
+    record.levels = static_cast<uint32_t>(levels);
+    return record;
+}
+
+uint64_t texturePixelBytes(const TextureRecord& record) {
+    return static_cast<uint64_t>(record.width) * record.height * 4;
+}
+
+// RGBA8 with every level, what the importer uploads and the cache stores
+uint64_t textureMemoryBytes(const TextureRecord& record) {
+    return mipChainBytes(record.width, record.height,
+                         static_cast<int>(std::max(record.levels, 1u)));
+}
+
+// pixels holds every level
+std::shared_ptr<Texture2D> createTexture(const TextureRecord& record,
+                                         const uint8_t* pixels) {
+    auto texture = createTextureFromLevels(
+        pixels, record.width, record.height, record.internalFormat,
+        static_cast<int>(record.levels));
+    texture->setSizeFilter(record.minFilter, record.magFilter);
+    texture->setWrapFilter(record.wrap);
+    return texture;
+}
+
+// from the texture cache, or compressed and added to it. nullopt for the
+// roles that stay uncompressed.
+std::optional<CompressedTexture> getCompressedTexture(
+    const TextureRecord& record, const uint8_t* pixels, TextureRole role) {
+    auto format =
+        getRoleBlockFormat(role, isSRGBFormat(record.internalFormat));
+    if (!format)
+        return std::nullopt;
+    int channel = getRoleChannel(role);
+    if (auto texture = CompressedTexture::load(record.hash, *format, channel))
+        return texture;
+    MipChain mips = generateMipChain(pixels, record.width, record.height,
+                                     *format == BlockFormat::BC7SRGB,
+                                     MipFilter::Box,
+                                     static_cast<int>(record.levels));
+    auto texture = CompressedTexture::compress(
+        pixels, record.width, record.height, mips, *format, channel);
+    texture.save(record.hash, channel);
+    return texture;
+}
+
+int64_t fileTime(const fs::path& path) {
+    std::error_code error;
+    auto time = fs::last_write_time(path, error);
+    return error ? 0 : static_cast<int64_t>(time.time_since_epoch().count());
+}
+
+// loo does not report the buffers and images a .gltf(or the materials an
+// .obj) refers to, so every file below the source's directory counts, by
+// size and mtime. A .glb holds everything.
+uint64_t hashDependencies(const fs::path& source) {
+    std::string extension = source.extension().u8string();
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    if (extension == ".glb")
+        return 0;
+    fs::path directory = source.parent_path();
+    if (directory.empty())
+        directory = ".";
+    std::vector<std::pair<std::string, fs::path>> files;
+    std::error_code error;
+    for (fs::recursive_directory_iterator
+             it(directory, fs::directory_options::skip_permission_denied,
+                error),
+         end;
+         !error && it != end; it.increment(error)) {
+        // written by the cache itself
+        if (it->path().filename() == SCENE_CACHE_DIRECTORY.parent_path()) {
+            it.disable_recursion_pending();
+            continue;
+        }
+        std::error_code typeError;
+        if (!it->is_regular_file(typeError))
+            continue;
+        fs::path relative = it->path().lexically_relative(directory);
+        if (relative != source.filename())
+            files.emplace_back(relative.generic_u8string(), it->path());
+    }
+    // iteration order is unspecified
+    std::sort(files.begin(), files.end());
+    uint64_t hash = 1;
+    for (auto& [name, path] : files) {
+        uint64_t size = fs::file_size(path, error);
+        int64_t time = fileTime(path);
+        hash = hashBytes(name.data(), name.size() + 1, hash);
+        hash = hashBytes(&size, sizeof(size), hash);
+        hash = hashBytes(&time, sizeof(time), hash);
+    }
+    return hash;
+}
+
+void logMeshOptimization(const MeshOptimizationStatistics& statistics) {
+    LOG(INFO) << "Mesh optimization: ACMR " << statistics.before.getACMR()
+              << " -> " << statistics.after.getACMR() << ", ATVR "
+              << statistics.before.getATVR() << " -> "
+              << statistics.after.getATVR();
+}
+
+void writePadding(std::ofstream& file) {
+    static const char zeros[SCENE_CACHE_ALIGNMENT]{};
+    uint64_t position = static_cast<uint64_t>(file.tellp());
+    file.write(zeros, alignOffset(position) - position);
+}
+}  // namespace
+
+std::optional<SceneCacheKey> makeSceneCacheKey(const fs::path& source) {
+    MappedFile file(source);
+    if (!file.isOpen())
+        return std::nullopt;
+    return SceneCacheKey{hashBytes(file.data(), file.size()), file.size(),
+                         fileTime(source), hashDependencies(source)};
+}
+
+bool isSceneCacheKeyValid(const SceneCacheKey& cached,
+                          const fs::path& source) {
+    std::error_code error;
+    uint64_t size = fs::file_size(source, error);
+    if (error || size != cached.size ||
+        hashDependencies(source) != cached.dependencies)
+        return false;
+    if (fileTime(source) == cached.time)
+        return true;
+    // touched or copied, but maybe not changed
+    auto key = makeSceneCacheKey(source);
+    return key && key->hash == cached.hash;
+}
+
+fs::path getSceneCachePath(const fs::path& source) {
+    std::string absolute =
+        fs::absolute(source).lexically_normal().generic_u8string();
+    char name[17];
+    std::snprintf(name, sizeof(name), "%016llx",
+                  static_cast<unsigned long long>(
+                      hashBytes(absolute.data(), absolute.size())));
+    return SCENE_CACHE_DIRECTORY /
+           (source.stem().u8string() + "-" + name + ".scene");
+}
+
+bool writeSceneCache(const Scene& scene, const fs::path& source,
+                     const std::vector<MeshOptimizationStatistics>& optimized,
+                     const std::vector<MeshLODs>& lods) {
+    const auto& meshes = scene.getMeshes();
+    if (meshes.empty())
+        return false;
+    if (scene.animation) {
+        LOG(INFO) << "Animated scenes are not cached";
+        return false;
+    }
+    auto key = makeSceneCacheKey(source);
+    if (!key)
+        return false;
+    // loo sets up one vertex buffer per mesh, every mesh alike
+    VertexArrayLayout layout = captureVertexArrayLayout(meshes.front()->vao);
+    for (auto& binding : layout.bindings) {
+        if (binding.buffer != layout.bindings.front().buffer ||
+            binding.divisor != 0) {
+            LOG(WARNING) << "Unexpected vertex layout, scene not cached";
+            return false;
+        }
+    }
+
+    std::map<const Texture2D*, int> textureIndices;
+    std::vector<const Texture2D*> textures;
+    std::map<const BaseMaterial*, int> materialIndices;
+    std::vector<const BaseMaterial*> materials;
+    // a texture is compressed once per role it is used for
+    std::set<std::pair<int, TextureRole>> variants;
+    for (auto& mesh : meshes) {
+        auto material =
+            dynamic_cast<const BaseMaterial*>(mesh->material.get());
+        if (!material || materialIndices.count(material))
+            continue;
+        materialIndices[material] = static_cast<int>(materials.size());
+        materials.push_back(material);
+        auto addTexture = [&](const std::shared_ptr<Texture2D>& texture,
+                              TextureRole role) {
+            auto [it, inserted] = textureIndices.try_emplace(
+                texture.get(), static_cast<int>(textures.size()));
+            if (inserted)
+                textures.push_back(texture.get());
+            variants.emplace(it->second, role);
+        };
+        TextureVisitor<decltype(addTexture)> visitor{addTexture};
+        visitMaterial(*static_cast<const BaseMaterial*>(material), visitor);
+    }
+
+    SceneCacheHeader header;
+    header.key = *key;
+    header.vertexSize = sizeof(Vertex);
+    header.meshCount = static_cast<uint32_t>(meshes.size());
+    header.materialCount = static_cast<uint32_t>(materials.size());
+    header.textureCount = static_cast<uint32_t>(textures.size());
+
+    MetaWriter meta(textureIndices);
+    meta.string(scene.modelName);
+    meta.pod(static_cast<uint32_t>(layout.attributes.size()));
+    for (auto& attribute : layout.attributes)
+        meta.pod(attribute);
+    meta.pod(static_cast<uint32_t>(layout.bindings.size()));
+    for (auto& binding : layout.bindings)
+        meta.pod(binding);
+    std::vector<TextureRecord> textureRecords;
+    for (auto texture : textures) {
+        TextureRecord record = describeTexture(*texture);
+        record.levels = std::clamp(
+            record.levels, 1u,
+            static_cast<uint32_t>(countMipLevels(record.width, record.height)));
+        record.offset = header.pixels.size;
+        header.pixels.size += textureMemoryBytes(record);
+        textureRecords.push_back(record);
+    }
+    // read back up front, the records carry the pixel hashes
+    std::vector<uint8_t> pixels(header.pixels.size);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    for (size_t i = 0; i < textures.size(); i++) {
+        TextureRecord& record = textureRecords[i];
+        uint8_t* level = pixels.data() + record.offset;
+        glGetTextureImage(textures[i]->getId(), 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                          static_cast<GLsizei>(texturePixelBytes(record)),
+                          level);
+        record.hash = hashBytes(level, texturePixelBytes(record));
+        meta.pod(record);
+    }
+    logPossibleGLError();
+    // the mips are stored so that loads upload them as they are
+    JobSystem::parallelFor(
+        static_cast<int>(textures.size()), 1, [&](int first, int last) {
+            for (int i = first; i < last; i++) {
+                const TextureRecord& record = textureRecords[i];
+                uint8_t* level = pixels.data() + record.offset;
+                MipChain mips = generateMipChain(
+                    level, record.width, record.height,
+                    isSRGBFormat(record.internalFormat), MipFilter::Box,
+                    static_cast<int>(record.levels));
+                std::copy(mips.pixels.begin(), mips.pixels.end(),
+                          level + texturePixelBytes(record));
+            }
+        });
+    for (auto material : materials)
+        visitMaterial(*material, meta);
+    for (size_t i = 0; i < meshes.size(); i++) {
+        auto& mesh = meshes[i];
+        auto material =
+            dynamic_cast<const BaseMaterial*>(mesh->material.get());
+        MeshRecord record{};
+        record.vertexOffset = header.vertices.size;
+        record.vertexCount = mesh->vertices.size();
+        record.indexOffset = header.indices.size;
+        record.indexCount = mesh->indices.size();
+        record.material = material ? materialIndices[material] : -1;
+        if (i < optimized.size())
+            record.optimization = optimized[i];
+        if (i < lods.size()) {
+            const MeshLODs& meshLODs = lods[i];
+            record.lodIndexCount = meshLODs.indices.size();
+            record.lodLevelCount = static_cast<uint32_t>(
+                std::min<size_t>(meshLODs.levels.size(), MESH_LOD_COUNT - 1));
+            std::copy_n(meshLODs.levels.begin(), record.lodLevelCount,
+                        record.lodLevels);
+        }
+        header.vertices.size += mesh->vertices.size() * sizeof(Vertex);
+        header.indices.size +=
+            (mesh->indices.size() + record.lodIndexCount) * sizeof(Index);
+        meta.pod(record);
+        meta.pod(mesh->aabb);
+        meta.pod(mesh->objectMatrix);
+    }
+    header.meta.size = meta.getBytes().size();
+    header.meta.offset = alignOffset(sizeof(SceneCacheHeader));
+    header.vertices.offset = alignOffset(header.meta.offset + header.meta.size);
+    header.indices.offset =
+        alignOffset(header.vertices.offset + header.vertices.size);
+    header.pixels.offset =
+        alignOffset(header.indices.offset + header.indices.size);
+
+    fs::path path = getSceneCachePath(source);
+    // written aside and renamed, a reader never sees half a file
+    fs::path temporary = path;
+    temporary += ".tmp";
+    std::error_code error;
+    fs::create_directories(path.parent_path(), error);
+    std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        LOG(ERROR) << "Failed to write the scene cache " << path.string();
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    writePadding(file);
+    file.write(reinterpret_cast<const char*>(meta.getBytes().data()),
+               meta.getBytes().size());
+    writePadding(file);
+    for (auto& mesh : meshes)
+        file.write(reinterpret_cast<const char*>(mesh->vertices.data()),
+                   mesh->vertices.size() * sizeof(Vertex));
+    writePadding(file);
+    for (size_t i = 0; i < meshes.size(); i++) {
+        file.write(reinterpret_cast<const char*>(meshes[i]->indices.data()),
+                   meshes[i]->indices.size() * sizeof(Index));
+        if (i < lods.size())
+            file.write(reinterpret_cast<const char*>(lods[i].indices.data()),
+                       lods[i].indices.size() * sizeof(Index));
+    }
+    writePadding(file);
+    file.write(reinterpret_cast<const char*>(pixels.data()), pixels.size());
+    file.close();
+    if (!file) {
+        LOG(ERROR) << "Failed to write the scene cache " << path.string();
+        fs::remove(temporary, error);
+        return false;
+    }
+    fs::rename(temporary, path, error);
+    if (error) {
+        LOG(ERROR) << "Failed to write the scene cache " << path.string()
+                   << ": " << error.message();
+        fs::remove(temporary, error);
+        return false;
+    }
+    LOG(INFO) << "Wrote the scene cache " << path.string();
+
+    // fill the texture cache now, so that the next load skips compression
+    std::vector<std::pair<int, TextureRole>> pending(variants.begin(),
+                                                     variants.end());
+    JobSystem::parallelFor(
+        static_cast<int>(pending.size()), 1, [&](int first, int last) {
+            for (int i = first; i < last; i++) {
+                const TextureRecord& record = textureRecords[pending[i].first];
+                getCompressedTexture(record, pixels.data() + record.offset,
+                                     pending[i].second);
+            }
+        });
+    return true;
+}
+
+std::optional<Scene> loadSceneCache(const fs::path& source,
+                                    std::vector<MeshLODs>* lods,
+                                    SceneCacheLoadStatus* status) {
+    auto stepStart = std::chrono::steady_clock::now();
+    // milliseconds since the last call
+    auto step = [&stepStart] {
+        auto now = std::chrono::steady_clock::now();
+        float elapsed =
+            std::chrono::duration<float, std::milli>(now - stepStart).count();
+        stepStart = now;
+        return elapsed;
+    };
+    SceneCacheLoadStatus ignored;
+    if (!status)
+        status = &ignored;
+    fs::path path = getSceneCachePath(source);
+    MappedFile file(path);
+    if (!file.isOpen() || file.size() < sizeof(SceneCacheHeader))
+        return std::nullopt;
+    SceneCacheHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    auto inFile = [&](const SceneCacheSection& section) {
+        return section.offset <= file.size() &&
+               section.size <= file.size() - section.offset;
+    };
+    if (header.magic != SCENE_CACHE_MAGIC ||
+        header.version != SCENE_CACHE_VERSION ||
+        header.vertexSize != sizeof(Vertex) || !inFile(header.meta) ||
+        !inFile(header.vertices) || !inFile(header.indices) ||
+        !inFile(header.pixels)) {
+        LOG(INFO) << "Ignored the outdated scene cache " << path.string();
+        return std::nullopt;
+    }
+    if (!isSceneCacheKeyValid(header.key, source)) {
+        LOG(INFO) << source.string() << " changed, scene cache ignored";
+        return std::nullopt;
+    }
+
+    const uint8_t* vertices = file.data() + header.vertices.offset;
+    const uint8_t* indices = file.data() + header.indices.offset;
+    const uint8_t* pixels = file.data() + header.pixels.offset;
+    MetaReader meta(file.data() + header.meta.offset, header.meta.size,
+                    header.textureCount);
+    Scene scene;
+    meta.string(scene.modelName);
+    VertexArrayLayout layout;
+    uint32_t attributes = 0, bindings = 0;
+    meta.pod(attributes);
+    layout.attributes.resize(std::min(attributes, MAX_VERTEX_ATTRIBUTES));
+    for (auto& attribute : layout.attributes)
+        meta.pod(attribute);
+    meta.pod(bindings);
+    layout.bindings.resize(std::min(bindings, MAX_VERTEX_ATTRIBUTES));
+    for (auto& binding : layout.bindings)
+        meta.pod(binding);
+    if (attributes > MAX_VERTEX_ATTRIBUTES ||
+        bindings > MAX_VERTEX_ATTRIBUTES) {
+        LOG(ERROR) << "Corrupted scene cache " << path.string();
+        return std::nullopt;
+    }
+    std::vector<TextureRecord> textureRecords(header.textureCount);
+    for (auto& record : textureRecords) {
+        meta.pod(record);
+        if (meta.failed() || record.width <= 0 || record.height <= 0 ||
+            record.levels < 1 ||
+            record.levels > static_cast<uint32_t>(
+                                countMipLevels(record.width, record.height)) ||
+            record.offset + textureMemoryBytes(record) > header.pixels.size) {
+            LOG(ERROR) << "Corrupted scene cache " << path.string();
+            return std::nullopt;
+        }
+    }
+    std::vector<std::shared_ptr<BaseMaterial>> materials;
+    for (uint32_t i = 0; i < header.materialCount && !meta.failed(); i++) {
+        auto material = std::make_shared<BaseMaterial>();
+        visitMaterial(*material, meta);
+        materials.push_back(std::move(material));
+    }
+    if (meta.failed()) {
+        LOG(ERROR) << "Corrupted scene cache " << path.string();
+        return std::nullopt;
+    }
+    // a texture per role it is used for
+    struct TextureVariant {
+        int texture{0};
+        TextureRole role{TextureRole::Other};
+        std::optional<CompressedTexture> compressed;
+        std::shared_ptr<Texture2D> result;
+    };
+    std::vector<TextureVariant> variants;
+    std::map<std::pair<int, TextureRole>, size_t> variantIndices;
+    for (auto& binding : meta.getBindings()) {
+        if (!variantIndices
+                 .try_emplace({binding.texture, binding.role}, variants.size())
+                 .second)
+            continue;
+        TextureVariant& variant = variants.emplace_back();
+        variant.texture = binding.texture;
+        variant.role = binding.role;
+    }
+    status->steps = static_cast<int>(variants.size() + header.meshCount);
+    status->mapping = step();
+    // compressed blocks on the job system, a texture per job, uploads stay
+    // on this thread. The other textures upload their stored mips.
+    JobSystem::parallelFor(
+        static_cast<int>(variants.size()), 1, [&](int first, int last) {
+            for (int i = first; i < last; i++) {
+                TextureVariant& variant = variants[i];
+                const TextureRecord& record = textureRecords[variant.texture];
+                variant.compressed = getCompressedTexture(
+                    record, pixels + record.offset, variant.role);
+                status->stepsDone++;
+            }
+        });
+    for (auto& variant : variants) {
+        const TextureRecord& record = textureRecords[variant.texture];
+        if (variant.compressed) {
+            variant.result = variant.compressed->createTexture(
+                getRoleChannel(variant.role));
+            variant.result->setSizeFilter(record.minFilter, record.magFilter);
+            variant.result->setWrapFilter(record.wrap);
+        } else {
+            variant.result = createTexture(record, pixels + record.offset);
+        }
+        // the blocks are in the texture now
+        variant.compressed.reset();
+    }
+    for (auto& binding : meta.getBindings())
+        *binding.field =
+            variants[variantIndices[{binding.texture, binding.role}]].result;
+    status->textures = step();
+    std::vector<std::shared_ptr<Mesh>> meshes;
+    std::vector<MeshLODs> meshLODs;
+    MeshOptimizationStatistics optimization;
+    for (uint32_t i = 0; i < header.meshCount && !meta.failed(); i++) {
+        MeshRecord record{};
+        auto mesh = std::make_shared<CachedMesh>();
+        meta.pod(record);
+        meta.pod(mesh->aabb);
+        meta.pod(mesh->objectMatrix);
+        uint64_t vertexBytes = record.vertexCount * sizeof(Vertex),
+                 indexBytes = record.indexCount * sizeof(Index),
+                 lodBytes = record.lodIndexCount * sizeof(Index);
+        bool lodsValid = record.lodLevelCount < MESH_LOD_COUNT;
+        for (uint32_t level = 0; lodsValid && level < record.lodLevelCount;
+             level++) {
+            const MeshLODLevel& lod = record.lodLevels[level];
+            lodsValid = static_cast<uint64_t>(lod.firstIndex) +
+                            lod.indexCount <=
+                        record.lodIndexCount;
+        }
+        if (meta.failed() || !lodsValid ||
+            record.vertexOffset + vertexBytes > header.vertices.size ||
+            record.indexOffset + indexBytes + lodBytes > header.indices.size ||
+            record.material >= static_cast<int32_t>(materials.size())) {
+            LOG(ERROR) << "Corrupted scene cache " << path.string();
+            return std::nullopt;
+        }
+        optimization += record.optimization;
+        mesh->objectMatrixPrev = mesh->objectMatrix;
+        mesh->material = record.material < 0 ? nullptr
+                                             : materials[record.material];
+        mesh->vertices.resize(record.vertexCount);
+        std::memcpy(mesh->vertices.data(), vertices + record.vertexOffset,
+                    vertexBytes);
+        mesh->indices.resize(record.indexCount);
+        std::memcpy(mesh->indices.data(), indices + record.indexOffset,
+                    indexBytes);
+        // straight from the mapping, the pages are already resident.
+        // Mutable, GeometryArena releases them once it holds a copy.
+        glCreateBuffers(1, &mesh->vertexBuffer);
+        glNamedBufferData(mesh->vertexBuffer, vertexBytes,
+                          vertices + record.vertexOffset, GL_STATIC_DRAW);
+        glCreateBuffers(1, &mesh->indexBuffer);
+        glNamedBufferData(mesh->indexBuffer, indexBytes,
+                          indices + record.indexOffset, GL_STATIC_DRAW);
+        for (auto& binding : layout.bindings)
+            binding.buffer = mesh->vertexBuffer;
+        layout.elementBuffer = mesh->indexBuffer;
+        mesh->vao = createVertexArray(layout);
+        meshes.push_back(std::move(mesh));
+        MeshLODs& lod = meshLODs.emplace_back();
+        lod.levels.assign(record.lodLevels,
+                          record.lodLevels + record.lodLevelCount);
+        auto lodIndices = reinterpret_cast<const Index*>(
+            indices + record.indexOffset + indexBytes);
+        lod.indices.assign(lodIndices, lodIndices + record.lodIndexCount);
+        status->stepsDone++;
+    }
+    if (meta.failed()) {
+        LOG(ERROR) << "Corrupted scene cache " << path.string();
+        return std::nullopt;
+    }
+    logPossibleGLError();
+    status->buffers = step();
+    logMeshOptimization(optimization);
+    scene.addMeshes(std::move(meshes));
+    if (lods)
+        *lods = std::move(meshLODs);
+    return scene;
+}
+
+static void computeMeshData(const Scene& scene, SceneMeshData* meshData) {
+    if (!meshData)
+        return;
+    meshData->meshlets = buildSceneMeshlets(scene);
+    meshData->geometryHashes = hashSceneGeometry(scene);
+}
+
+void deduplicateSceneTextures(Scene& scene) {
+    TextureRegistry registry;
+    // the result per texture object, materials share them
+    std::map<const Texture2D*, std::shared_ptr<Texture2D>> interned;
+    std::vector<uint8_t> pixels;
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    auto intern = [&](std::shared_ptr<Texture2D>& texture, TextureRole) {
+        auto it = interned.find(texture.get());
+        if (it == interned.end()) {
+            TextureRecord record = describeTexture(*texture);
+            pixels.resize(texturePixelBytes(record));
+            glGetTextureImage(texture->getId(), 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                              static_cast<GLsizei>(pixels.size()),
+                              pixels.data());
+            TextureContentKey key{hashBytes(pixels.data(), pixels.size()),
+                                  record.width,
+                                  record.height,
+                                  record.internalFormat,
+                                  record.levels,
+                                  record.minFilter,
+                                  record.magFilter,
+                                  record.wrap};
+            it = interned
+                     .emplace(texture.get(),
+                              registry.intern(key, texture,
+                                              textureMemoryBytes(record)))
+                     .first;
+        }
+        texture = it->second;
+    };
+    TextureVisitor<decltype(intern)> visitor{intern};
+    std::set<BaseMaterial*> visited;
+    for (auto& mesh : scene.getMeshes()) {
+        auto material = dynamic_cast<BaseMaterial*>(mesh->material.get());
+        if (material && visited.insert(material).second)
+            visitMaterial(*material, visitor);
+    }
+    logPossibleGLError();
+    LOG(INFO) << "Found " << registry.size() << " distinct textures, "
+              << registry.getDuplicates() << " duplicates shared("
+              << registry.getSavedBytes() / 1024 << " KB of VRAM saved)";
+}
+
+Scene importScene(const std::string& filename, SceneMeshData* meshData,
+                  SceneCacheLoadStatus* status) {
+    auto start = std::chrono::steady_clock::now();
+    if (auto scene = loadSceneCache(
+            filename, meshData ? &meshData->lods : nullptr, status)) {
+        LOG(INFO) << "Loaded " << filename << " from the scene cache in "
+                  << std::chrono::duration<float, std::milli>(
+                         std::chrono::steady_clock::now() - start)
+                         .count()
+                  << " ms";
+        computeMeshData(*scene, meshData);
+        return std::move(*scene);
+    }
+    Scene scene = createSceneFromFile(filename);
+    // before caching, so that the cache stores every image once
+    deduplicateSceneTextures(scene);
+    auto optimized = optimizeSceneMeshes(scene);
+    MeshOptimizationStatistics optimization;
+    for (auto& mesh : optimized)
+        optimization += mesh;
+    logMeshOptimization(optimization);
+    // after the reordering, the levels index the reordered vertices
+    auto generated = generateSceneLODs(scene);
+    if (writeSceneCache(scene, filename, optimized, generated)) {
+        // the first import renders like the following ones, with the
+        // compressed textures of the cache rather than loo's
+        if (auto cached = loadSceneCache(
+                filename, meshData ? &meshData->lods : nullptr, status)) {
+            computeMeshData(*cached, meshData);
+            return std::move(*cached);
+        }
+    }
+    if (meshData)
+        meshData->lods = std::move(generated);
+    computeMeshData(scene, meshData);
+    return scene;
+}
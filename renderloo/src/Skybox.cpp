@@ -197,6 +197,7 @@ void Skybox::initBRDFLUT(bool forceRecompute) {
         stbi_flip_vertically_on_write(true);
         stbi_write_png(BRDFLUT_FILENAME, width, height, 2, data.data(),
                        width * 2);
+        stbi_flip_vertically_on_write(false);
     } else {
         m_BRDFLUT->setup(data, width, height, GL_RG16F, GL_RG, GL_UNSIGNED_BYTE,
                          1);
@@ -0,0 +1,361 @@
+#include "core/SoftwareOcclusion.hpp"
+#include <glog/logging.h>
+#include "core/JobSystem.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+using namespace loo;
+using namespace std;
+
+// vertices closer to the camera plane drop their triangle or box
+static constexpr float NEAR_W = 1e-4f;
+// smallest batch of meshes tested by one job
+static constexpr int TEST_CHUNK = 64;
+
+static glm::vec3 toScreen(const glm::vec4& clip) {
+    glm::vec3 ndc = glm::vec3(clip) / clip.w;
+    return glm::vec3((ndc.x * 0.5f + 0.5f) * SOFTWARE_OCCLUSION_WIDTH,
+                     (ndc.y * 0.5f + 0.5f) * SOFTWARE_OCCLUSION_HEIGHT,
+                     ndc.z);
+}
+
+bool setupOcclusionTriangle(const glm::vec3& v0, const glm::vec3& v1,
+                            const glm::vec3& v2,
+                            OcclusionTriangle& triangle) {
+    float area = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+    if (std::abs(area) < 1e-6f)
+        return false;
+    // both facings are rasterized, make the winding counter clockwise
+    const glm::vec3* v[3] = {&v0, &v1, &v2};
+    if (area < 0) {
+        std::swap(v[1], v[2]);
+        area = -area;
+    }
+    float minX = std::min({v0.x, v1.x, v2.x}),
+          maxX = std::max({v0.x, v1.x, v2.x}),
+          minY = std::min({v0.y, v1.y, v2.y}),
+          maxY = std::max({v0.y, v1.y, v2.y});
+    triangle.minX = std::max(static_cast<int>(std::floor(minX)), 0);
+    triangle.minY = std::max(static_cast<int>(std::floor(minY)), 0);
+    triangle.maxX = std::min(static_cast<int>(std::ceil(maxX)),
+                             SOFTWARE_OCCLUSION_WIDTH - 1);
+    triangle.maxY = std::min(static_cast<int>(std::ceil(maxY)),
+                             SOFTWARE_OCCLUSION_HEIGHT - 1);
+    if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+        return false;
+    for (int i = 0; i < 3; i++) {
+        const glm::vec3 &p = *v[i], &q = *v[(i + 1) % 3];
+        triangle.a[i] = p.y - q.y;
+        triangle.b[i] = q.x - p.x;
+        triangle.c[i] = p.x * q.y - q.x * p.y;
+    }
+    const glm::vec3 &p0 = *v[0], &p1 = *v[1], &p2 = *v[2];
+    triangle.zx = ((p1.z - p0.z) * (p2.y - p0.y) -
+                   (p2.z - p0.z) * (p1.y - p0.y)) /
+                  area;
+    triangle.zy = ((p2.z - p0.z) * (p1.x - p0.x) -
+                   (p1.z - p0.z) * (p2.x - p0.x)) /
+                  area;
+    // farthest depth within the pixel, never below the farthest vertex
+    triangle.z0 = p0.z - triangle.zx * p0.x - triangle.zy * p0.y -
+                  0.5f * (std::abs(triangle.zx) + std::abs(triangle.zy));
+    triangle.zMin = std::max(std::min({p0.z, p1.z, p2.z}), 0.0f);
+    return true;
+}
+
+void rasterizeOcclusionTriangle(const OcclusionTriangle& t, int rowBegin,
+                                int rowEnd, float* depth) {
+    int y0 = std::max(t.minY, rowBegin), y1 = std::min(t.maxY + 1, rowEnd);
+    // 4 pixel aligned, the edge functions reject the extra pixels
+    int x0 = t.minX & ~3;
+    for (int y = y0; y < y1; y++) {
+        float py = y + 0.5f;
+        float* row = depth + y * SOFTWARE_OCCLUSION_WIDTH;
+        float e[3];
+        for (int i = 0; i < 3; i++)
+            e[i] = t.b[i] * py + t.c[i];
+        float zRow = t.zy * py + t.z0;
+        int x = x0;
+#if defined(__SSE2__) || defined(_M_X64)
+        const __m128 offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+        const __m128 zMin = _mm_set1_ps(t.zMin), one = _mm_set1_ps(1.0f),
+                     zero = _mm_setzero_ps();
+        for (; x <= t.maxX; x += 4) {
+            __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)),
+                                   offsets);
+            __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+            for (int i = 0; i < 3; i++) {
+                __m128 edge = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(t.a[i]), px),
+                                         _mm_set1_ps(e[i]));
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(edge, zero));
+            }
+            if (_mm_movemask_ps(inside) == 0)
+                continue;
+            __m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(t.zx), px),
+                                  _mm_set1_ps(zRow));
+            z = _mm_min_ps(_mm_max_ps(z, zMin), one);
+            // uncovered lanes become 0, the farthest depth
+            __m128 old = _mm_loadu_ps(row + x);
+            _mm_storeu_ps(row + x, _mm_max_ps(old, _mm_and_ps(inside, z)));
+        }
+#else
+        for (; x <= t.maxX; x++) {
+            float px = x + 0.5f;
+            if (t.a[0] * px + e[0] < 0 || t.a[1] * px + e[1] < 0 ||
+                t.a[2] * px + e[2] < 0)
+                continue;
+            float z =
+                std::min(std::max(t.zx * px + zRow, t.zMin), 1.0f);
+            row[x] = std::max(row[x], z);
+        }
+#endif
+    }
+}
+
+void erodeOcclusionRows(const float* depth, int rowBegin, int rowEnd,
+                        float* scratch) {
+    constexpr int last = SOFTWARE_OCCLUSION_WIDTH - 1;
+    for (int y = rowBegin; y < rowEnd; y++) {
+        const float* row = depth + y * SOFTWARE_OCCLUSION_WIDTH;
+        float* out = scratch + y * SOFTWARE_OCCLUSION_WIDTH;
+        out[0] = std::min(row[0], row[1]);
+        for (int x = 1; x < last; x++)
+            out[x] = std::min({row[x - 1], row[x], row[x + 1]});
+        out[last] = std::min(row[last - 1], row[last]);
+    }
+}
+
+void erodeOcclusionColumns(const float* scratch, int rowBegin, int rowEnd,
+                           float* depth) {
+    for (int y = rowBegin; y < rowEnd; y++) {
+        const float* row = scratch + y * SOFTWARE_OCCLUSION_WIDTH;
+        const float* up = y > 0 ? row - SOFTWARE_OCCLUSION_WIDTH : row;
+        const float* down =
+            y + 1 < SOFTWARE_OCCLUSION_HEIGHT ? row + SOFTWARE_OCCLUSION_WIDTH
+                                              : row;
+        float* out = depth + y * SOFTWARE_OCCLUSION_WIDTH;
+        for (int x = 0; x < SOFTWARE_OCCLUSION_WIDTH; x++)
+            out[x] = std::min({up[x], row[x], down[x]});
+    }
+}
+
+bool isRectOccluded(const float* buffer, int minX, int minY, int maxX,
+                    int maxY, float depth) {
+    for (int y = minY; y <= maxY; y++) {
+        const float* row = buffer + y * SOFTWARE_OCCLUSION_WIDTH;
+        int x = minX;
+#if defined(__SSE2__) || defined(_M_X64)
+        const __m128 d = _mm_set1_ps(depth);
+        for (; x + 3 <= maxX; x += 4) {
+            // any occluder at or behind the box
+            if (_mm_movemask_ps(_mm_cmple_ps(_mm_loadu_ps(row + x), d)))
+                return false;
+        }
+#endif
+        for (; x <= maxX; x++) {
+            if (row[x] <= depth)
+                return false;
+        }
+    }
+    return true;
+}
+
+static bool isBoxOccluded(const float* buffer, const glm::mat4& viewProjection,
+                          const glm::vec3& center, const glm::vec3& extent) {
+    float minX = SOFTWARE_OCCLUSION_WIDTH, minY = SOFTWARE_OCCLUSION_HEIGHT,
+          maxX = 0.0f, maxY = 0.0f, nearest = 0.0f;
+    for (int i = 0; i < 8; i++) {
+        glm::vec3 corner = center + extent * glm::vec3(i & 1 ? 1 : -1,
+                                                       i & 2 ? 1 : -1,
+                                                       i & 4 ? 1 : -1);
+        glm::vec4 clip = viewProjection * glm::vec4(corner, 1.0f);
+        if (clip.w < NEAR_W)
+            return false;
+        glm::vec3 screen = toScreen(clip);
+        minX = std::min(minX, screen.x);
+        minY = std::min(minY, screen.y);
+        maxX = std::max(maxX, screen.x);
+        maxY = std::max(maxY, screen.y);
+        nearest = std::max(nearest, screen.z);
+    }
+    // off screen boxes are left to the frustum test
+    if (maxX < 0 || maxY < 0 || minX >= SOFTWARE_OCCLUSION_WIDTH ||
+        minY >= SOFTWARE_OCCLUSION_HEIGHT)
+        return false;
+    return isRectOccluded(
+        buffer, std::max(static_cast<int>(minX), 0),
+        std::max(static_cast<int>(minY), 0),
+        std::min(static_cast<int>(maxX), SOFTWARE_OCCLUSION_WIDTH - 1),
+        std::min(static_cast<int>(maxY), SOFTWARE_OCCLUSION_HEIGHT - 1),
+        nearest);
+}
+
+SoftwareOcclusionCuller::SoftwareOcclusionCuller()
+    : m_depth(SOFTWARE_OCCLUSION_WIDTH * SOFTWARE_OCCLUSION_HEIGHT, 0.0f),
+      m_erodeScratch(m_depth.size(), 0.0f) {}
+
+void SoftwareOcclusionCuller::setScene(const Scene& scene,
+                                       const TransformCache& transforms,
+                                       const std::vector<uint8_t>& skinned) {
+    m_occluders.clear();
+    m_occluderVertices.clear();
+    m_occluderIndices.clear();
+    const auto& meshes = scene.getMeshes();
+    m_skinned = skinned;
+    m_skinned.resize(meshes.size(), 0);
+    std::vector<std::pair<float, int>> candidates;
+    for (int i = 0; i < static_cast<int>(meshes.size()); i++) {
+        const auto& mesh = meshes[i];
+        size_t triangles = mesh->indices.size() / 3;
+        if (m_skinned[i] || mesh->needAlphaBlend() || triangles == 0 ||
+            triangles > SOFTWARE_OCCLUSION_MAX_OCCLUDER_TRIANGLES)
+            continue;
+        AABBBatch box;
+        box.resize(1);
+        box.setTransformed(0, transforms.getWorld(i), mesh->aabb.getCenter(),
+                           mesh->aabb.getDiagonal() * 0.5f);
+        float x = box.extentX[0], y = box.extentY[0], z = box.extentZ[0];
+        // largest box face rather than the volume so that walls and floors
+        // qualify, cheaper meshes are preferred
+        float area = std::max({x * y, y * z, x * z});
+        candidates.emplace_back(area / (1.0f + triangles / 256.0f), i);
+    }
+    std::sort(candidates.begin(), candidates.end(),
+              [](auto& a, auto& b) { return a.first > b.first; });
+    if (candidates.size() > SOFTWARE_OCCLUSION_MAX_OCCLUDERS)
+        candidates.resize(SOFTWARE_OCCLUSION_MAX_OCCLUDERS);
+    for (auto& [score, index] : candidates) {
+        const auto& mesh = meshes[index];
+        Occluder occluder{index, m_occluderVertices.size(),
+                          mesh->vertices.size(), m_occluderIndices.size(),
+                          mesh->indices.size()};
+        for (auto& vertex : mesh->vertices)
+            m_occluderVertices.push_back(vertex.position);
+        m_occluderIndices.insert(m_occluderIndices.end(),
+                                 mesh->indices.begin(), mesh->indices.end());
+        m_occluders.push_back(occluder);
+    }
+    LOG(INFO) << "Software occlusion: " << m_occluders.size()
+              << " occluders, " << m_occluderIndices.size() / 3
+              << " triangles";
+}
+
+void SoftwareOcclusionCuller::cull(const Scene& scene,
+                                   const TransformCache& transforms,
+                                   const glm::mat4& viewProjection,
+                                   const MeshVisibility* frustum) {
+    auto start = std::chrono::steady_clock::now();
+    const auto& meshes = scene.getMeshes();
+    m_statistics = SoftwareOcclusionStatistics{};
+
+    // transform the occluders and set up their triangles
+    m_triangles.clear();
+    m_clipVertices.resize(m_occluderVertices.size());
+    for (auto& occluder : m_occluders) {
+        if (occluder.mesh >= static_cast<int>(meshes.size()) ||
+            (frustum && !(*frustum)[occluder.mesh]))
+            continue;
+        glm::mat4 mvp = viewProjection * transforms.getWorld(occluder.mesh);
+        glm::vec4* clip = m_clipVertices.data() + occluder.firstVertex;
+        for (size_t i = 0; i < occluder.vertexCount; i++) {
+            clip[i] = mvp * glm::vec4(
+                                m_occluderVertices[occluder.firstVertex + i],
+                                1.0f);
+        }
+        const uint32_t* indices =
+            m_occluderIndices.data() + occluder.firstIndex;
+        for (size_t i = 0; i + 2 < occluder.indexCount; i += 3) {
+            const glm::vec4 &c0 = clip[indices[i]], &c1 = clip[indices[i + 1]],
+                            &c2 = clip[indices[i + 2]];
+            // crossing the camera plane, dropping it is conservative
+            if (c0.w < NEAR_W || c1.w < NEAR_W || c2.w < NEAR_W)
+                continue;
+            OcclusionTriangle triangle;
+            if (setupOcclusionTriangle(toScreen(c0), toScreen(c1),
+                                       toScreen(c2), triangle))
+                m_triangles.push_back(triangle);
+        }
+        m_statistics.occluders++;
+    }
+    m_statistics.triangles = static_cast<int>(m_triangles.size());
+
+    // bin by bands of rows, every band is written by one task only
+    constexpr int bandCount =
+        SOFTWARE_OCCLUSION_HEIGHT / SOFTWARE_OCCLUSION_BAND_HEIGHT;
+    m_bands.resize(bandCount);
+    for (auto& band : m_bands)
+        band.clear();
+    for (uint32_t i = 0; i < m_triangles.size(); i++) {
+        int first = m_triangles[i].minY / SOFTWARE_OCCLUSION_BAND_HEIGHT,
+            last = m_triangles[i].maxY / SOFTWARE_OCCLUSION_BAND_HEIGHT;
+        for (int band = first; band <= last; band++)
+            m_bands[band].push_back(i);
+    }
+    std::fill(m_depth.begin(), m_depth.end(), 0.0f);
+    JobSystem::parallelFor(bandCount, 1, [this](int first, int last) {
+        for (int band = first; band < last; band++) {
+            int rowBegin = band * SOFTWARE_OCCLUSION_BAND_HEIGHT;
+            for (uint32_t i : m_bands[band]) {
+                rasterizeOcclusionTriangle(
+                    m_triangles[i], rowBegin,
+                    rowBegin + SOFTWARE_OCCLUSION_BAND_HEIGHT,
+                    m_depth.data());
+            }
+        }
+    });
+    // the vertical pass reads the rows of the neighbouring bands
+    JobSystem::parallelFor(bandCount, 1, [this](int first, int last) {
+        erodeOcclusionRows(m_depth.data(),
+                           first * SOFTWARE_OCCLUSION_BAND_HEIGHT,
+                           last * SOFTWARE_OCCLUSION_BAND_HEIGHT,
+                           m_erodeScratch.data());
+    });
+    JobSystem::parallelFor(bandCount, 1, [this](int first, int last) {
+        erodeOcclusionColumns(m_erodeScratch.data(),
+                              first * SOFTWARE_OCCLUSION_BAND_HEIGHT,
+                              last * SOFTWARE_OCCLUSION_BAND_HEIGHT,
+                              m_depth.data());
+    });
+
+    // test the world boxes of the remaining meshes
+    if (frustum)
+        m_visibility = *frustum;
+    else
+        m_visibility.assign(meshes.size(), 1);
+    int meshCount = static_cast<int>(meshes.size());
+    m_bounds.resize(meshes.size());
+    JobSystem::parallelFor(meshCount, TEST_CHUNK, [&](int first, int last) {
+        for (int i = first; i < last; i++) {
+            // bind pose bounds of skinned meshes do not hold
+            bool skinned =
+                i < static_cast<int>(m_skinned.size()) && m_skinned[i];
+            if (!m_visibility[i] || skinned)
+                continue;
+            m_bounds.setTransformed(i, transforms.getWorld(i),
+                                    meshes[i]->aabb.getCenter(),
+                                    meshes[i]->aabb.getDiagonal() * 0.5f);
+            glm::vec3 center(m_bounds.centerX[i], m_bounds.centerY[i],
+                             m_bounds.centerZ[i]),
+                extent(m_bounds.extentX[i], m_bounds.extentY[i],
+                       m_bounds.extentZ[i]);
+            if (isBoxOccluded(m_depth.data(), viewProjection, center,
+                              extent))
+                m_visibility[i] = 0;
+        }
+    });
+    for (int i = 0; i < meshCount; i++) {
+        if (frustum && !(*frustum)[i])
+            continue;
+        m_statistics.tested++;
+        m_statistics.occluded += !m_visibility[i];
+    }
+    m_statistics.milliseconds =
+        std::chrono::duration<float, std::milli>(
+            std::chrono::steady_clock::now() - start)
+            .count();
+}
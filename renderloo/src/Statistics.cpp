@@ -0,0 +1,36 @@
+#include "core/Statistics.hpp"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+static double sortedPercentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty())
+        return 0.0;
+    double rank = std::clamp(p, 0.0, 100.0) / 100.0 * (sorted.size() - 1);
+    size_t lower = static_cast<size_t>(std::floor(rank));
+    size_t upper = std::min(lower + 1, sorted.size() - 1);
+    double fraction = rank - static_cast<double>(lower);
+    return sorted[lower] + (sorted[upper] - sorted[lower]) * fraction;
+}
+
+double percentile(std::vector<double> samples, double p) {
+    std::sort(samples.begin(), samples.end());
+    return sortedPercentile(samples, p);
+}
+
+SampleSummary summarize(const std::vector<double>& samples) {
+    SampleSummary summary;
+    if (samples.empty())
+        return summary;
+    std::vector<double> sorted = samples;
+    std::sort(sorted.begin(), sorted.end());
+    summary.count = static_cast<int>(sorted.size());
+    summary.mean =
+        std::accumulate(sorted.begin(), sorted.end(), 0.0) / sorted.size();
+    summary.min = sorted.front();
+    summary.max = sorted.back();
+    summary.p50 = sortedPercentile(sorted, 50.0);
+    summary.p95 = sortedPercentile(sorted, 95.0);
+    summary.p99 = sortedPercentile(sorted, 99.0);
+    return summary;
+}
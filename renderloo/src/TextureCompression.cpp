@@ -0,0 +1,521 @@
+#include "core/TextureCompression.hpp"
+#include <glog/logging.h>
+#include <loo/glError.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include "core/JobSystem.hpp"
+
+using namespace loo;
+using namespace std;
+namespace fs = std::filesystem;
+
+namespace {
+const fs::path TEXTURE_CACHE_DIRECTORY = fs::path(".cache") / "textures";
+constexpr uint32_t TEXTURE_CACHE_MAGIC = 0x5854524c;  // "LRTX"
+// bump on encoder changes, old files are recompressed
+constexpr uint32_t TEXTURE_CACHE_VERSION = 1;
+// block rows per job
+constexpr int COMPRESS_GRAIN = 8;
+
+struct CompressedTextureHeader {
+    uint32_t magic{TEXTURE_CACHE_MAGIC};
+    uint32_t version{TEXTURE_CACHE_VERSION};
+    uint64_t hash{0};
+    uint8_t format{0}, channel{0}, padding[2]{};
+    int32_t width{0}, height{0};
+    uint32_t levels{0};
+};
+
+constexpr int BC7_WEIGHTS[16] = {0,  4,  9,  13, 17, 21, 26, 30,
+                                 34, 38, 43, 47, 51, 55, 60, 64};
+
+// blocks must be zeroed before writing
+class BitWriter {
+   public:
+    explicit BitWriter(uint8_t* bytes) : m_bytes(bytes) {}
+    void write(uint32_t value, int bits) {
+        for (int i = 0; i < bits; i++, m_bit++) {
+            if ((value >> i) & 1)
+                m_bytes[m_bit >> 3] |= static_cast<uint8_t>(1 << (m_bit & 7));
+        }
+    }
+
+   private:
+    uint8_t* m_bytes;
+    int m_bit{0};
+};
+
+class BitReader {
+   public:
+    explicit BitReader(const uint8_t* bytes) : m_bytes(bytes) {}
+    uint32_t read(int bits) {
+        uint32_t value = 0;
+        for (int i = 0; i < bits; i++, m_bit++)
+            value |= ((m_bytes[m_bit >> 3] >> (m_bit & 7)) & 1u) << i;
+        return value;
+    }
+
+   private:
+    const uint8_t* m_bytes;
+    int m_bit{0};
+};
+
+// 7 bit endpoints plus a p bit per endpoint
+struct BC7Candidate {
+    int q[2][4];
+    int p[2];
+    uint8_t indices[16];
+    int error{std::numeric_limits<int>::max()};
+};
+
+void evaluateBC7(const int texels[16][4], const float endpoints[2][4],
+                 int p0, int p1, BC7Candidate& best) {
+    BC7Candidate candidate;
+    candidate.p[0] = p0;
+    candidate.p[1] = p1;
+    int expanded[2][4];
+    for (int e = 0; e < 2; e++) {
+        for (int c = 0; c < 4; c++) {
+            int q = static_cast<int>(
+                std::lround((endpoints[e][c] - candidate.p[e]) * 0.5f));
+            candidate.q[e][c] = std::clamp(q, 0, 127);
+            expanded[e][c] = candidate.q[e][c] * 2 + candidate.p[e];
+        }
+    }
+    int palette[16][4];
+    for (int i = 0; i < 16; i++) {
+        for (int c = 0; c < 4; c++)
+            palette[i][c] = ((64 - BC7_WEIGHTS[i]) * expanded[0][c] +
+                             BC7_WEIGHTS[i] * expanded[1][c] + 32) >>
+                            6;
+    }
+    // project on the endpoint line, then try the neighbours of the nearest
+    // weight, much cheaper than a search of the whole palette
+    int axis[4], axisLength = 0;
+    for (int c = 0; c < 4; c++) {
+        axis[c] = expanded[1][c] - expanded[0][c];
+        axisLength += axis[c] * axis[c];
+    }
+    candidate.error = 0;
+    for (int t = 0; t < 16; t++) {
+        int projection = 0;
+        for (int c = 0; c < 4; c++)
+            projection += (texels[t][c] - expanded[0][c]) * axis[c];
+        int weight = axisLength == 0 ? 0
+                                     : std::clamp(projection * 64 / axisLength,
+                                                  0, 64);
+        int nearest = 0;
+        while (nearest < 15 && BC7_WEIGHTS[nearest + 1] <= weight)
+            nearest++;
+        int bestError = std::numeric_limits<int>::max(), bestIndex = nearest;
+        for (int i = std::max(nearest - 1, 0); i <= std::min(nearest + 2, 15);
+             i++) {
+            int error = 0;
+            for (int c = 0; c < 4; c++) {
+                int d = texels[t][c] - palette[i][c];
+                error += d * d;
+            }
+            if (error < bestError) {
+                bestError = error;
+                bestIndex = i;
+            }
+        }
+        candidate.indices[t] = static_cast<uint8_t>(bestIndex);
+        candidate.error += bestError;
+    }
+    if (candidate.error < best.error)
+        best = candidate;
+}
+
+void searchPBits(const int texels[16][4], const float endpoints[2][4],
+                 BC7Candidate& best) {
+    for (int p0 = 0; p0 < 2; p0++) {
+        for (int p1 = 0; p1 < 2; p1++)
+            evaluateBC7(texels, endpoints, p0, p1, best);
+    }
+}
+
+// least squares endpoints for the chosen indices
+bool refineEndpoints(const int texels[16][4], const uint8_t indices[16],
+                     float endpoints[2][4]) {
+    float a = 0.f, b = 0.f, c = 0.f;
+    float x0[4]{}, x1[4]{};
+    for (int t = 0; t < 16; t++) {
+        float w = BC7_WEIGHTS[indices[t]] / 64.f, v = 1.f - w;
+        a += v * v;
+        b += v * w;
+        c += w * w;
+        for (int ch = 0; ch < 4; ch++) {
+            x0[ch] += v * texels[t][ch];
+            x1[ch] += w * texels[t][ch];
+        }
+    }
+    float det = a * c - b * b;
+    if (std::abs(det) < 1e-6f)
+        return false;
+    for (int ch = 0; ch < 4; ch++) {
+        endpoints[0][ch] =
+            std::clamp((c * x0[ch] - b * x1[ch]) / det, 0.f, 255.f);
+        endpoints[1][ch] =
+            std::clamp((a * x1[ch] - b * x0[ch]) / det, 0.f, 255.f);
+    }
+    return true;
+}
+
+int countTextureLevels(const MipChain& mips) {
+    return 1 + static_cast<int>(mips.levels.size());
+}
+
+size_t levelBlocksSize(int width, int height, BlockFormat format) {
+    return size_t((width + 3) / 4) * ((height + 3) / 4) *
+           getBlockBytes(format);
+}
+
+std::vector<MipLevel> layoutLevels(int width, int height, int count,
+                                   BlockFormat format) {
+    std::vector<MipLevel> levels;
+    size_t offset = 0;
+    for (int i = 0; i < count; i++) {
+        levels.push_back(MipLevel{width, height, offset});
+        offset += levelBlocksSize(width, height, format);
+        width = std::max(width / 2, 1);
+        height = std::max(height / 2, 1);
+    }
+    return levels;
+}
+
+fs::path getCachePath(uint64_t hash, BlockFormat format, int channel) {
+    static const char* FORMAT_NAMES[] = {"bc4", "bc5", "bc7", "bc7s"};
+    char name[48];
+    std::snprintf(name, sizeof(name), "%016llx-%s%d.tex",
+                  static_cast<unsigned long long>(hash),
+                  FORMAT_NAMES[static_cast<int>(format)], channel);
+    return TEXTURE_CACHE_DIRECTORY / name;
+}
+}  // namespace
+
+GLenum getBlockInternalFormat(BlockFormat format) {
+    switch (format) {
+        case BlockFormat::BC4:
+            return GL_COMPRESSED_RED_RGTC1;
+        case BlockFormat::BC5:
+            return GL_COMPRESSED_RG_RGTC2;
+        case BlockFormat::BC7:
+            return GL_COMPRESSED_RGBA_BPTC_UNORM;
+        case BlockFormat::BC7SRGB:
+        default:
+            return GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM;
+    }
+}
+
+std::optional<BlockFormat> getRoleBlockFormat(TextureRole role, bool srgb) {
+    switch (role) {
+        case TextureRole::Color:
+            return srgb ? BlockFormat::BC7SRGB : BlockFormat::BC7;
+        case TextureRole::Normal:
+            return BlockFormat::BC5;
+        case TextureRole::Metallic:
+        case TextureRole::Roughness:
+        case TextureRole::Occlusion:
+            return BlockFormat::BC4;
+        default:
+            return std::nullopt;
+    }
+}
+
+int getRoleChannel(TextureRole role) {
+    switch (role) {
+        case TextureRole::Metallic:
+            return 2;
+        case TextureRole::Roughness:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+void encodeBC4Block(const uint8_t values[16], uint8_t block[8]) {
+    int low = 255, high = 0;
+    for (int i = 0; i < 16; i++) {
+        low = std::min<int>(low, values[i]);
+        high = std::max<int>(high, values[i]);
+    }
+    std::memset(block, 0, 8);
+    // 8 value mode(first > second): 0 and 1 are the ends, 2..7 in between
+    // from high to low
+    block[0] = static_cast<uint8_t>(high);
+    block[1] = static_cast<uint8_t>(low);
+    if (high == low)
+        return;
+    BitWriter writer(block + 2);
+    for (int i = 0; i < 16; i++) {
+        int step = (2 * (values[i] - low) * 7 + (high - low)) /
+                   (2 * (high - low));
+        int index = step == 7 ? 0 : step == 0 ? 1 : 8 - step;
+        writer.write(static_cast<uint32_t>(index), 3);
+    }
+}
+
+void decodeBC4Block(const uint8_t block[8], uint8_t values[16]) {
+    int palette[8];
+    palette[0] = block[0];
+    palette[1] = block[1];
+    if (palette[0] > palette[1]) {
+        for (int i = 2; i < 8; i++)
+            palette[i] = ((8 - i) * palette[0] + (i - 1) * palette[1]) / 7;
+    } else {
+        for (int i = 2; i < 6; i++)
+            palette[i] = ((6 - i) * palette[0] + (i - 1) * palette[1]) / 5;
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+    BitReader reader(block + 2);
+    for (int i = 0; i < 16; i++)
+        values[i] = static_cast<uint8_t>(palette[reader.read(3)]);
+}
+
+void encodeBC7Block(const uint8_t rgba[64], uint8_t block[16]) {
+    int texels[16][4];
+    float mean[4]{};
+    for (int t = 0; t < 16; t++) {
+        for (int c = 0; c < 4; c++) {
+            texels[t][c] = rgba[t * 4 + c];
+            mean[c] += texels[t][c] / 16.f;
+        }
+    }
+    // principal axis by power iteration on the covariance
+    float covariance[4][4]{};
+    for (int t = 0; t < 16; t++) {
+        for (int i = 0; i < 4; i++) {
+            for (int j = 0; j < 4; j++)
+                covariance[i][j] +=
+                    (texels[t][i] - mean[i]) * (texels[t][j] - mean[j]);
+        }
+    }
+    float axis[4] = {1.f, 1.f, 1.f, 1.f};
+    for (int iteration = 0; iteration < 8; iteration++) {
+        float next[4]{};
+        for (int i = 0; i < 4; i++) {
+            for (int j = 0; j < 4; j++)
+                next[i] += covariance[i][j] * axis[j];
+        }
+        float length = std::sqrt(next[0] * next[0] + next[1] * next[1] +
+                                 next[2] * next[2] + next[3] * next[3]);
+        if (length < 1e-6f)
+            break;
+        for (int i = 0; i < 4; i++)
+            axis[i] = next[i] / length;
+    }
+    float low = std::numeric_limits<float>::max(), high = -low;
+    for (int t = 0; t < 16; t++) {
+        float d = 0.f;
+        for (int c = 0; c < 4; c++)
+            d += (texels[t][c] - mean[c]) * axis[c];
+        low = std::min(low, d);
+        high = std::max(high, d);
+    }
+    float endpoints[2][4];
+    for (int c = 0; c < 4; c++) {
+        endpoints[0][c] = std::clamp(mean[c] + axis[c] * low, 0.f, 255.f);
+        endpoints[1][c] = std::clamp(mean[c] + axis[c] * high, 0.f, 255.f);
+    }
+    BC7Candidate best;
+    searchPBits(texels, endpoints, best);
+    if (best.error > 0 && refineEndpoints(texels, best.indices, endpoints))
+        searchPBits(texels, endpoints, best);
+
+    // the anchor(texel 0) index has an implicit 0 high bit
+    if (best.indices[0] >= 8) {
+        for (int c = 0; c < 4; c++)
+            std::swap(best.q[0][c], best.q[1][c]);
+        std::swap(best.p[0], best.p[1]);
+        for (auto& index : best.indices)
+            index = static_cast<uint8_t>(15 - index);
+    }
+    std::memset(block, 0, 16);
+    BitWriter writer(block);
+    writer.write(1u << 6, 7);
+    for (int c = 0; c < 4; c++) {
+        writer.write(static_cast<uint32_t>(best.q[0][c]), 7);
+        writer.write(static_cast<uint32_t>(best.q[1][c]), 7);
+    }
+    writer.write(static_cast<uint32_t>(best.p[0]), 1);
+    writer.write(static_cast<uint32_t>(best.p[1]), 1);
+    for (int t = 0; t < 16; t++)
+        writer.write(best.indices[t], t == 0 ? 3 : 4);
+}
+
+bool decodeBC7Block(const uint8_t block[16], uint8_t rgba[64]) {
+    BitReader reader(block);
+    if (reader.read(7) != (1u << 6)) {
+        std::memset(rgba, 0, 64);
+        return false;
+    }
+    int q[2][4], p[2];
+    for (int c = 0; c < 4; c++) {
+        q[0][c] = static_cast<int>(reader.read(7));
+        q[1][c] = static_cast<int>(reader.read(7));
+    }
+    p[0] = static_cast<int>(reader.read(1));
+    p[1] = static_cast<int>(reader.read(1));
+    for (int t = 0; t < 16; t++) {
+        int w = BC7_WEIGHTS[reader.read(t == 0 ? 3 : 4)];
+        for (int c = 0; c < 4; c++) {
+            int e0 = q[0][c] * 2 + p[0], e1 = q[1][c] * 2 + p[1];
+            rgba[t * 4 + c] =
+                static_cast<uint8_t>(((64 - w) * e0 + w * e1 + 32) >> 6);
+        }
+    }
+    return true;
+}
+
+void compressLevel(const uint8_t* pixels, int width, int height,
+                   BlockFormat format, int channel, uint8_t* blocks) {
+    int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+    size_t blockBytes = getBlockBytes(format);
+    JobSystem::parallelFor(blocksY, COMPRESS_GRAIN, [&](int first,
+                                                        int last) {
+        uint8_t texels[64], values[16];
+        for (int by = first; by < last; by++) {
+            for (int bx = 0; bx < blocksX; bx++) {
+                for (int t = 0; t < 16; t++) {
+                    int x = std::min(bx * 4 + t % 4, width - 1),
+                        y = std::min(by * 4 + t / 4, height - 1);
+                    std::memcpy(texels + t * 4,
+                                pixels + (size_t(y) * width + x) * 4, 4);
+                }
+                uint8_t* block =
+                    blocks + (size_t(by) * blocksX + bx) * blockBytes;
+                if (format == BlockFormat::BC7 ||
+                    format == BlockFormat::BC7SRGB) {
+                    encodeBC7Block(texels, block);
+                    continue;
+                }
+                int channels = format == BlockFormat::BC5 ? 2 : 1;
+                for (int c = 0; c < channels; c++) {
+                    for (int t = 0; t < 16; t++)
+                        values[t] = texels[t * 4 + (channels == 2 ? c
+                                                                  : channel)];
+                    encodeBC4Block(values, block + c * 8);
+                }
+            }
+        }
+    });
+}
+
+CompressedTexture CompressedTexture::compress(const uint8_t* pixels,
+                                              int width, int height,
+                                              const MipChain& mips,
+                                              BlockFormat format,
+                                              int channel) {
+    CompressedTexture texture;
+    texture.m_format = format;
+    texture.m_levels =
+        layoutLevels(width, height, countTextureLevels(mips), format);
+    const MipLevel& last = texture.m_levels.back();
+    texture.m_blocks.resize(last.offset +
+                            levelBlocksSize(last.width, last.height, format));
+    for (size_t i = 0; i < texture.m_levels.size(); i++) {
+        const MipLevel& level = texture.m_levels[i];
+        compressLevel(i == 0 ? pixels : mips.getLevel(i - 1), level.width,
+                      level.height, format, channel,
+                      texture.m_blocks.data() + level.offset);
+    }
+    return texture;
+}
+
+std::optional<CompressedTexture> CompressedTexture::load(uint64_t hash,
+                                                         BlockFormat format,
+                                                         int channel) {
+    CompressedTexture texture;
+    if (!texture.m_file.open(getCachePath(hash, format, channel)) ||
+        texture.m_file.size() < sizeof(CompressedTextureHeader))
+        return std::nullopt;
+    CompressedTextureHeader header;
+    std::memcpy(&header, texture.m_file.data(), sizeof(header));
+    if (header.magic != TEXTURE_CACHE_MAGIC ||
+        header.version != TEXTURE_CACHE_VERSION || header.hash != hash ||
+        header.format != static_cast<uint8_t>(format) ||
+        header.channel != channel || header.width <= 0 ||
+        header.height <= 0 || header.levels == 0 || header.levels > 32)
+        return std::nullopt;
+    texture.m_format = format;
+    texture.m_levels = layoutLevels(header.width, header.height,
+                                    static_cast<int>(header.levels), format);
+    texture.m_fileOffset = sizeof(header);
+    if (texture.m_fileOffset + texture.m_levels.back().offset +
+            texture.getLevelSize(texture.m_levels.size() - 1) >
+        texture.m_file.size())
+        return std::nullopt;
+    return texture;
+}
+
+bool CompressedTexture::save(uint64_t hash, int channel) const {
+    fs::path path = getCachePath(hash, m_format, channel);
+    fs::path temporary = path;
+    temporary += ".tmp";
+    std::error_code error;
+    fs::create_directories(path.parent_path(), error);
+    CompressedTextureHeader header;
+    header.hash = hash;
+    header.format = static_cast<uint8_t>(m_format);
+    header.channel = static_cast<uint8_t>(channel);
+    header.width = m_levels.front().width;
+    header.height = m_levels.front().height;
+    header.levels = static_cast<uint32_t>(m_levels.size());
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(getLevel(0)),
+                   m_levels.back().offset + getLevelSize(m_levels.size() - 1));
+        if (!file) {
+            LOG(ERROR) << "Failed to write " << temporary.string();
+            fs::remove(temporary, error);
+            return false;
+        }
+    }
+    fs::rename(temporary, path, error);
+    if (error) {
+        fs::remove(temporary, error);
+        return false;
+    }
+    return true;
+}
+
+std::shared_ptr<Texture2D> CompressedTexture::createTexture(
+    int channel) const {
+    GLenum internalFormat = getBlockInternalFormat(m_format);
+    auto texture = std::make_shared<Texture2D>();
+    texture->init();
+    texture->setupStorage(m_levels.front().width, m_levels.front().height,
+                          internalFormat, static_cast<int>(m_levels.size()));
+    for (size_t i = 0; i < m_levels.size(); i++) {
+        glCompressedTextureSubImage2D(
+            texture->getId(), static_cast<GLint>(i), 0, 0, m_levels[i].width,
+            m_levels[i].height, internalFormat,
+            static_cast<GLsizei>(getLevelSize(i)), getLevel(i));
+    }
+    if (m_format == BlockFormat::BC4 && channel > 0) {
+        static const GLenum SWIZZLES[] = {GL_TEXTURE_SWIZZLE_R,
+                                          GL_TEXTURE_SWIZZLE_G,
+                                          GL_TEXTURE_SWIZZLE_B};
+        glTextureParameteri(texture->getId(), SWIZZLES[channel], GL_RED);
+    }
+    logPossibleGLError();
+    return texture;
+}
+
+const uint8_t* CompressedTexture::getLevel(size_t i) const {
+    const uint8_t* base = m_file.isOpen() ? m_file.data() + m_fileOffset
+                                          : m_blocks.data();
+    return base + m_levels[i].offset;
+}
+
+size_t CompressedTexture::getLevelSize(size_t i) const {
+    return levelBlocksSize(m_levels[i].width, m_levels[i].height, m_format);
+}
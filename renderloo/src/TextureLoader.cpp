@@ -0,0 +1,352 @@
+#include "core/TextureLoader.hpp"
+#include <glog/logging.h>
+#include <loo/glError.hpp>
+#include <stb/stb_image.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include "core/JobSystem.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+using namespace loo;
+using namespace std;
+namespace fs = std::filesystem;
+
+namespace {
+constexpr int LINEAR_TO_SRGB_SIZE = 4096;
+constexpr int KAISER_TAPS = 8;
+constexpr double PI = 3.14159265358979323846;
+
+struct ColorTables {
+    float toLinear[256];
+    // indexed by the linear value in 1/4095 steps
+    uint8_t toSRGB[LINEAR_TO_SRGB_SIZE];
+    ColorTables() {
+        for (int i = 0; i < 256; i++) {
+            float c = i / 255.f;
+            toLinear[i] = c <= 0.04045f ? c / 12.92f
+                                        : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        for (int i = 0; i < LINEAR_TO_SRGB_SIZE; i++) {
+            float l = static_cast<float>(i) / (LINEAR_TO_SRGB_SIZE - 1);
+            float c = l <= 0.0031308f
+                          ? l * 12.92f
+                          : 1.055f * std::pow(l, 1.f / 2.4f) - 0.055f;
+            toSRGB[i] = static_cast<uint8_t>(c * 255.f + 0.5f);
+        }
+    }
+};
+const ColorTables& getColorTables() {
+    static const ColorTables tables;
+    return tables;
+}
+
+double besselI0(double x) {
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 32; k++) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+// taps at source offsets -3..4 around 2 * x, the output texel is centered
+// between source texels 2 * x and 2 * x + 1
+std::array<float, KAISER_TAPS> computeKaiserWeights() {
+    constexpr double ALPHA = 4.0, RADIUS = KAISER_TAPS / 2;
+    std::array<float, KAISER_TAPS> weights;
+    double sum = 0.0;
+    for (int i = 0; i < KAISER_TAPS; i++) {
+        // in source texels
+        double d = i - (KAISER_TAPS / 2 - 1) - 0.5;
+        // sinc at the destination rate
+        double x = d * 0.5 * PI;
+        double sinc = std::abs(x) < 1e-6 ? 1.0 : std::sin(x) / x;
+        double r = d / RADIUS;
+        double window =
+            besselI0(ALPHA * std::sqrt(std::max(0.0, 1.0 - r * r))) /
+            besselI0(ALPHA);
+        weights[i] = static_cast<float>(sinc * window);
+        sum += weights[i];
+    }
+    for (auto& w : weights)
+        w = static_cast<float>(w / sum);
+    return weights;
+}
+
+// one RGBA texel in linear float, the filters only add and scale
+#if defined(__SSE2__) || defined(_M_X64)
+// wrapped, __m128 loses its alignment attribute as a template argument
+struct Texel {
+    __m128 v;
+};
+inline Texel zeroTexel() {
+    return Texel{_mm_setzero_ps()};
+}
+inline Texel loadTexel(const uint8_t* p, bool srgb, const ColorTables& t) {
+    if (srgb) {
+        return Texel{_mm_setr_ps(t.toLinear[p[0]], t.toLinear[p[1]],
+                                 t.toLinear[p[2]], p[3] * (1.f / 255.f))};
+    }
+    int32_t bits;
+    std::memcpy(&bits, p, 4);
+    __m128i zero = _mm_setzero_si128();
+    __m128i v = _mm_unpacklo_epi16(
+        _mm_unpacklo_epi8(_mm_cvtsi32_si128(bits), zero), zero);
+    return Texel{_mm_mul_ps(_mm_cvtepi32_ps(v), _mm_set1_ps(1.f / 255.f))};
+}
+inline Texel addTexel(Texel a, Texel b) {
+    return Texel{_mm_add_ps(a.v, b.v)};
+}
+inline Texel scaleTexel(Texel a, float s) {
+    return Texel{_mm_mul_ps(a.v, _mm_set1_ps(s))};
+}
+inline void storeTexel(Texel texel, uint8_t* p, bool srgb,
+                       const ColorTables& t) {
+    __m128 v =
+        _mm_min_ps(_mm_max_ps(texel.v, _mm_setzero_ps()), _mm_set1_ps(1.f));
+    if (srgb) {
+        alignas(16) float f[4];
+        _mm_store_ps(f, v);
+        for (int c = 0; c < 3; c++)
+            p[c] = t.toSRGB[static_cast<int>(
+                f[c] * (LINEAR_TO_SRGB_SIZE - 1) + 0.5f)];
+        p[3] = static_cast<uint8_t>(f[3] * 255.f + 0.5f);
+        return;
+    }
+    __m128i i = _mm_cvtps_epi32(_mm_mul_ps(v, _mm_set1_ps(255.f)));
+    i = _mm_packs_epi32(i, i);
+    i = _mm_packus_epi16(i, i);
+    int32_t bits = _mm_cvtsi128_si32(i);
+    std::memcpy(p, &bits, 4);
+}
+#else
+struct Texel {
+    float v[4];
+};
+inline Texel zeroTexel() {
+    return Texel{};
+}
+inline Texel loadTexel(const uint8_t* p, bool srgb, const ColorTables& t) {
+    Texel texel;
+    for (int c = 0; c < 3; c++)
+        texel.v[c] = srgb ? t.toLinear[p[c]] : p[c] * (1.f / 255.f);
+    texel.v[3] = p[3] * (1.f / 255.f);
+    return texel;
+}
+inline Texel addTexel(Texel a, Texel b) {
+    for (int c = 0; c < 4; c++)
+        a.v[c] += b.v[c];
+    return a;
+}
+inline Texel scaleTexel(Texel a, float s) {
+    for (int c = 0; c < 4; c++)
+        a.v[c] *= s;
+    return a;
+}
+inline void storeTexel(Texel v, uint8_t* p, bool srgb, const ColorTables& t) {
+    for (int c = 0; c < 4; c++) {
+        float f = std::min(std::max(v.v[c], 0.f), 1.f);
+        p[c] = srgb && c < 3 ? t.toSRGB[static_cast<int>(
+                                   f * (LINEAR_TO_SRGB_SIZE - 1) + 0.5f)]
+                             : static_cast<uint8_t>(f * 255.f + 0.5f);
+    }
+}
+#endif
+
+void downsampleBox(const uint8_t* source, int width, int height,
+                   uint8_t* destination, bool srgb) {
+    const ColorTables& tables = getColorTables();
+    int dw = std::max(width / 2, 1), dh = std::max(height / 2, 1);
+    for (int y = 0; y < dh; y++) {
+        const uint8_t* row0 = source + size_t(std::min(2 * y, height - 1)) *
+                                           width * 4;
+        const uint8_t* row1 = source + size_t(std::min(2 * y + 1, height - 1)) *
+                                           width * 4;
+        uint8_t* out = destination + size_t(y) * dw * 4;
+        for (int x = 0; x < dw; x++) {
+            int x0 = std::min(2 * x, width - 1) * 4,
+                x1 = std::min(2 * x + 1, width - 1) * 4;
+            Texel sum = addTexel(addTexel(loadTexel(row0 + x0, srgb, tables),
+                                          loadTexel(row0 + x1, srgb, tables)),
+                                 addTexel(loadTexel(row1 + x0, srgb, tables),
+                                          loadTexel(row1 + x1, srgb, tables)));
+            storeTexel(scaleTexel(sum, 0.25f), out + x * 4, srgb, tables);
+        }
+    }
+}
+
+// horizontal pass per source row into a ring of KAISER_TAPS rows, then the
+// vertical pass per destination row
+void downsampleKaiser(const uint8_t* source, int width, int height,
+                      uint8_t* destination, bool srgb) {
+    static const std::array<float, KAISER_TAPS> weights =
+        computeKaiserWeights();
+    const ColorTables& tables = getColorTables();
+    int dw = std::max(width / 2, 1), dh = std::max(height / 2, 1);
+    std::vector<Texel> ring(size_t(KAISER_TAPS) * dw);
+    std::array<int, KAISER_TAPS> ringRows;
+    ringRows.fill(std::numeric_limits<int>::min());
+    auto filteredRow = [&](int sy) -> const Texel* {
+        int slot = ((sy % KAISER_TAPS) + KAISER_TAPS) % KAISER_TAPS;
+        Texel* row = ring.data() + size_t(slot) * dw;
+        if (ringRows[slot] == sy)
+            return row;
+        ringRows[slot] = sy;
+        const uint8_t* src =
+            source + size_t(std::clamp(sy, 0, height - 1)) * width * 4;
+        for (int x = 0; x < dw; x++) {
+            Texel sum = zeroTexel();
+            for (int i = 0; i < KAISER_TAPS; i++) {
+                int sx = std::clamp(2 * x + i - (KAISER_TAPS / 2 - 1), 0,
+                                    width - 1);
+                sum = addTexel(sum, scaleTexel(loadTexel(src + sx * 4, srgb,
+                                                         tables),
+                                               weights[i]));
+            }
+            row[x] = sum;
+        }
+        return row;
+    };
+    std::array<const Texel*, KAISER_TAPS> rows;
+    for (int y = 0; y < dh; y++) {
+        for (int i = 0; i < KAISER_TAPS; i++)
+            rows[i] = filteredRow(2 * y + i - (KAISER_TAPS / 2 - 1));
+        uint8_t* out = destination + size_t(y) * dw * 4;
+        for (int x = 0; x < dw; x++) {
+            Texel sum = zeroTexel();
+            for (int i = 0; i < KAISER_TAPS; i++)
+                sum = addTexel(sum, scaleTexel(rows[i][x], weights[i]));
+            storeTexel(sum, out + x * 4, srgb, tables);
+        }
+    }
+}
+}  // namespace
+
+int countMipLevels(int width, int height) {
+    int levels = 1;
+    while (width > 1 || height > 1) {
+        width = std::max(width / 2, 1);
+        height = std::max(height / 2, 1);
+        levels++;
+    }
+    return levels;
+}
+
+bool isSRGBFormat(GLenum internalFormat) {
+    return internalFormat == GL_SRGB8 || internalFormat == GL_SRGB8_ALPHA8 ||
+           internalFormat == GL_SRGB || internalFormat == GL_SRGB_ALPHA;
+}
+
+void downsampleRGBA8(const uint8_t* source, int width, int height,
+                     uint8_t* destination, bool srgb, MipFilter filter) {
+    if (filter == MipFilter::Kaiser)
+        downsampleKaiser(source, width, height, destination, srgb);
+    else
+        downsampleBox(source, width, height, destination, srgb);
+}
+
+MipChain generateMipChain(const uint8_t* pixels, int width, int height,
+                          bool srgb, MipFilter filter, int levels) {
+    int maxLevels = countMipLevels(width, height);
+    levels = levels <= 0 ? maxLevels : std::min(levels, maxLevels);
+    MipChain chain;
+    size_t size = 0;
+    for (int i = 1, w = width, h = height; i < levels; i++) {
+        w = std::max(w / 2, 1);
+        h = std::max(h / 2, 1);
+        chain.levels.push_back(MipLevel{w, h, size});
+        size += size_t(w) * h * 4;
+    }
+    chain.pixels.resize(size);
+    const uint8_t* source = pixels;
+    int sw = width, sh = height;
+    for (auto& level : chain.levels) {
+        uint8_t* destination = chain.pixels.data() + level.offset;
+        downsampleRGBA8(source, sw, sh, destination, srgb, filter);
+        source = destination;
+        sw = level.width;
+        sh = level.height;
+    }
+    return chain;
+}
+
+std::vector<DecodedImage> decodeImages(const std::vector<fs::path>& paths) {
+    std::vector<DecodedImage> images(paths.size());
+    // stbi_load is reentrant, its flip setting is global
+    JobSystem::parallelFor(
+        static_cast<int>(paths.size()), 1, [&](int first, int last) {
+            for (int i = first; i < last; i++) {
+                int width, height, channels;
+                stbi_uc* data = stbi_load(paths[i].string().c_str(), &width,
+                                          &height, &channels, 4);
+                if (!data) {
+                    LOG(ERROR) << "Failed to decode " << paths[i].string()
+                               << ": " << stbi_failure_reason();
+                    continue;
+                }
+                images[i].width = width;
+                images[i].height = height;
+                images[i].pixels.assign(data,
+                                        data + size_t(width) * height * 4);
+                stbi_image_free(data);
+            }
+        });
+    return images;
+}
+
+std::shared_ptr<Texture2D> createTextureFromPixels(const uint8_t* pixels,
+                                                   int width, int height,
+                                                   GLenum internalFormat,
+                                                   const MipChain& mips) {
+    auto texture = std::make_shared<Texture2D>();
+    texture->init();
+    texture->setupStorage(width, height, internalFormat,
+                          1 + static_cast<int>(mips.levels.size()));
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTextureSubImage2D(texture->getId(), 0, 0, 0, width, height, GL_RGBA,
+                        GL_UNSIGNED_BYTE, pixels);
+    for (size_t i = 0; i < mips.levels.size(); i++) {
+        const MipLevel& level = mips.levels[i];
+        glTextureSubImage2D(texture->getId(), static_cast<GLint>(i + 1), 0, 0,
+                            level.width, level.height, GL_RGBA,
+                            GL_UNSIGNED_BYTE, mips.getLevel(i));
+    }
+    logPossibleGLError();
+    return texture;
+}
+
+size_t mipChainBytes(int width, int height, int levels) {
+    size_t bytes = 0;
+    for (int i = 0; i < levels; i++) {
+        bytes += size_t(width) * height * 4;
+        width = std::max(width / 2, 1);
+        height = std::max(height / 2, 1);
+    }
+    return bytes;
+}
+
+std::shared_ptr<Texture2D> createTextureFromLevels(const uint8_t* pixels,
+                                                   int width, int height,
+                                                   GLenum internalFormat,
+                                                   int levels) {
+    auto texture = std::make_shared<Texture2D>();
+    texture->init();
+    texture->setupStorage(width, height, internalFormat, levels);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    for (int i = 0; i < levels; i++) {
+        glTextureSubImage2D(texture->getId(), i, 0, 0, width, height,
+                            GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+        pixels += size_t(width) * height * 4;
+        width = std::max(width / 2, 1);
+        height = std::max(height / 2, 1);
+    }
+    logPossibleGLError();
+    return texture;
+}
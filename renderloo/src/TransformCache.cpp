@@ -0,0 +1,137 @@
+#include "core/TransformCache.hpp"
+#include "core/JobSystem.hpp"
+
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+using namespace loo;
+using namespace std;
+
+#if defined(__SSE2__) || defined(_M_X64)
+// a * b.yzx - a.yzx * b is the cross product in yzx order
+static __m128 cross(__m128 a, __m128 b) {
+    __m128 aYZX = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+    __m128 bYZX = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+    __m128 c = _mm_sub_ps(_mm_mul_ps(a, bYZX), _mm_mul_ps(aYZX, b));
+    return _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1));
+}
+
+void multiplyTransforms(const glm::mat4& a, const glm::mat4& b,
+                        glm::mat4& out) {
+    const float* pa = &a[0][0];
+    const float* pb = &b[0][0];
+    __m128 a0 = _mm_loadu_ps(pa), a1 = _mm_loadu_ps(pa + 4),
+           a2 = _mm_loadu_ps(pa + 8), a3 = _mm_loadu_ps(pa + 12);
+    // b may alias out
+    __m128 result[4];
+    for (int i = 0; i < 4; i++) {
+        const float* column = pb + i * 4;
+        __m128 r = _mm_mul_ps(a0, _mm_set1_ps(column[0]));
+        r = _mm_add_ps(r, _mm_mul_ps(a1, _mm_set1_ps(column[1])));
+        r = _mm_add_ps(r, _mm_mul_ps(a2, _mm_set1_ps(column[2])));
+        r = _mm_add_ps(r, _mm_mul_ps(a3, _mm_set1_ps(column[3])));
+        result[i] = r;
+    }
+    float* po = &out[0][0];
+    for (int i = 0; i < 4; i++)
+        _mm_storeu_ps(po + i * 4, result[i]);
+}
+
+void computeNormalMatrix(const glm::mat4& world, glm::mat4& out) {
+    // the w lanes of the upper 3x3 columns are 0, so are the products
+    const float* p = &world[0][0];
+    const __m128 mask = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+    __m128 c0 = _mm_and_ps(_mm_loadu_ps(p), mask),
+           c1 = _mm_and_ps(_mm_loadu_ps(p + 4), mask),
+           c2 = _mm_and_ps(_mm_loadu_ps(p + 8), mask);
+    // cofactor columns, transpose(inverse(m)) = cofactor(m) / det(m)
+    __m128 r0 = cross(c1, c2), r1 = cross(c2, c0), r2 = cross(c0, c1);
+    alignas(16) float d[4];
+    _mm_store_ps(d, _mm_mul_ps(c0, r0));
+    float det = d[0] + d[1] + d[2];
+    if (std::abs(det) < 1e-20f) {
+        out = glm::transpose(glm::inverse(world));
+        return;
+    }
+    __m128 inverseDet = _mm_set1_ps(1.0f / det);
+    float* po = &out[0][0];
+    _mm_storeu_ps(po, _mm_mul_ps(r0, inverseDet));
+    _mm_storeu_ps(po + 4, _mm_mul_ps(r1, inverseDet));
+    _mm_storeu_ps(po + 8, _mm_mul_ps(r2, inverseDet));
+    _mm_storeu_ps(po + 12, _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f));
+}
+#else
+void multiplyTransforms(const glm::mat4& a, const glm::mat4& b,
+                        glm::mat4& out) {
+    out = a * b;
+}
+
+void computeNormalMatrix(const glm::mat4& world, glm::mat4& out) {
+    glm::vec3 c0(world[0]), c1(world[1]), c2(world[2]);
+    glm::vec3 r0 = glm::cross(c1, c2), r1 = glm::cross(c2, c0),
+              r2 = glm::cross(c0, c1);
+    float det = glm::dot(c0, r0);
+    if (std::abs(det) < 1e-20f) {
+        out = glm::transpose(glm::inverse(world));
+        return;
+    }
+    out = glm::mat4(glm::vec4(r0 / det, 0.0f), glm::vec4(r1 / det, 0.0f),
+                    glm::vec4(r2 / det, 0.0f), glm::vec4(0, 0, 0, 1));
+}
+#endif
+
+// smallest batch of meshes per job
+static constexpr int TRANSFORM_CACHE_GRAIN = 256;
+
+static bool sameMatrix(const glm::mat4& a, const glm::mat4& b) {
+    return std::memcmp(&a, &b, sizeof(glm::mat4)) == 0;
+}
+
+void TransformCache::update(const Scene& scene) {
+    const auto& meshes = scene.getMeshes();
+    glm::mat4 model = scene.getModelMatrix(),
+              prevModel = scene.getPreviousModelMatrix();
+    bool resized = meshes.size() != m_world.size();
+    if (resized) {
+        m_objectMatrices.resize(meshes.size());
+        m_prevObjectMatrices.resize(meshes.size());
+        m_world.resize(meshes.size());
+        m_prevWorld.resize(meshes.size());
+        m_normal.resize(meshes.size());
+        m_prevNormal.resize(meshes.size());
+    }
+    bool modelChanged = resized || !sameMatrix(model, m_model);
+    bool prevModelChanged = resized || !sameMatrix(prevModel, m_prevModel);
+    m_model = model;
+    m_prevModel = prevModel;
+    std::atomic<int> updated{0};
+    JobSystem::parallelFor(
+        static_cast<int>(meshes.size()), TRANSFORM_CACHE_GRAIN,
+        [&](int first, int last) {
+            int count = 0;
+            for (int i = first; i < last; i++) {
+                const Mesh& mesh = *meshes[i];
+                if (modelChanged ||
+                    !sameMatrix(mesh.objectMatrix, m_objectMatrices[i])) {
+                    m_objectMatrices[i] = mesh.objectMatrix;
+                    multiplyTransforms(model, mesh.objectMatrix, m_world[i]);
+                    computeNormalMatrix(m_world[i], m_normal[i]);
+                    count++;
+                }
+                if (prevModelChanged ||
+                    !sameMatrix(mesh.objectMatrixPrev,
+                                m_prevObjectMatrices[i])) {
+                    m_prevObjectMatrices[i] = mesh.objectMatrixPrev;
+                    multiplyTransforms(prevModel, mesh.objectMatrixPrev,
+                                       m_prevWorld[i]);
+                    computeNormalMatrix(m_prevWorld[i], m_prevNormal[i]);
+                }
+            }
+            updated += count;
+        });
+    m_updated = updated;
+}
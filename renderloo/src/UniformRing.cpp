@@ -0,0 +1,167 @@
+#include "core/UniformRing.hpp"
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <array>
+#include <loo/glError.hpp>
+#include <vector>
+
+using namespace loo;
+using namespace std;
+
+namespace {
+// a buffer replaced by grow(), deleted once the frame that last used it
+// has retired
+struct RetiredBuffer {
+    GLuint buffer;
+    unsigned int frameIndex;
+};
+
+struct RingState {
+    GLuint buffer{0};
+    unsigned char* mapped{nullptr};
+    GLsizeiptr frameSize{0};
+    GLint alignment{256};
+    unsigned int frameIndex{0};
+    GLsizeiptr offset{0};
+    std::array<GLsync, UNIFORM_RING_FRAMES_IN_FLIGHT> fences{};
+    uint64_t epoch{0};
+    // allocated this frame including alignment, not reset by grow()
+    GLsizeiptr frameBytes{0};
+    GLsizeiptr lastFrameBytes{0};
+    int stalls{0};
+    std::vector<RetiredBuffer> retired;
+
+    GLsync& fence() {
+        return fences[frameIndex % UNIFORM_RING_FRAMES_IN_FLIGHT];
+    }
+    [[nodiscard]] GLsizeiptr regionBase() const {
+        return (frameIndex % UNIFORM_RING_FRAMES_IN_FLIGHT) * frameSize;
+    }
+};
+RingState ring;
+
+void createBuffer(GLsizeiptr frameSize) {
+    ring.frameSize = frameSize;
+    GLsizeiptr size = frameSize * UNIFORM_RING_FRAMES_IN_FLIGHT;
+    constexpr GLbitfield flags =
+        GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glCreateBuffers(1, &ring.buffer);
+    glNamedBufferStorage(ring.buffer, size, nullptr, flags);
+    ring.mapped = static_cast<unsigned char*>(
+        glMapNamedBufferRange(ring.buffer, 0, size, flags));
+    if (!ring.mapped)
+        LOG(FATAL) << "Failed to map the uniform ring buffer";
+    ring.epoch++;
+    panicPossibleGLError();
+}
+
+// only happens while the scene grows. Ranges handed out earlier this frame
+// stay bound and are read by draws already issued, so the old buffer is
+// orphaned instead of deleted: it stays mapped and alive until the fence of
+// this frame signaled. The fences are kept, a region of the new buffer
+// waits for the same frame as the region it replaces.
+void grow(GLsizeiptr required) {
+    GLsizeiptr frameSize = ring.frameSize;
+    while (frameSize < required)
+        frameSize *= 2;
+    LOG(INFO) << "Uniform ring grows to " << frameSize / 1024
+              << "KB per frame";
+    ring.retired.push_back(RetiredBuffer{ring.buffer, ring.frameIndex});
+    createBuffer(frameSize);
+    ring.offset = 0;
+}
+
+// called after the fence of frameIndex - UNIFORM_RING_FRAMES_IN_FLIGHT
+// signaled
+void releaseRetired() {
+    auto end = std::remove_if(
+        ring.retired.begin(), ring.retired.end(), [](RetiredBuffer& retired) {
+            if (ring.frameIndex - retired.frameIndex <
+                UNIFORM_RING_FRAMES_IN_FLIGHT)
+                return false;
+            glUnmapNamedBuffer(retired.buffer);
+            glDeleteBuffers(1, &retired.buffer);
+            return true;
+        });
+    ring.retired.erase(end, ring.retired.end());
+}
+}  // namespace
+
+void UniformRing::init() {
+    if (ring.buffer)
+        return;
+    GLint uniformAlignment = 0, storageAlignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT,
+                  &storageAlignment);
+    // both are powers of two
+    ring.alignment = std::max({uniformAlignment, storageAlignment, 16});
+    createBuffer(UNIFORM_RING_INITIAL_FRAME_SIZE);
+}
+
+void UniformRing::beginFrame() {
+    ring.frameIndex++;
+    GLsync& fence = ring.fence();
+    if (fence) {
+        GLenum status = glClientWaitSync(fence, 0, 0);
+        if (status == GL_TIMEOUT_EXPIRED) {
+            ring.stalls++;
+            glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                             GL_TIMEOUT_IGNORED);
+        }
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+    releaseRetired();
+    ring.offset = 0;
+    ring.frameBytes = 0;
+    ring.epoch++;
+}
+
+void UniformRing::endFrame() {
+    ring.lastFrameBytes = ring.frameBytes;
+    ring.fence() = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+UniformRange UniformRing::allocate(GLsizeiptr size, void** data) {
+    GLsizeiptr offset =
+        (ring.offset + ring.alignment - 1) / ring.alignment * ring.alignment;
+    if (offset + size > ring.frameSize) {
+        grow(std::max(ring.frameSize * 2, size));
+        offset = 0;
+        ring.frameBytes += size;
+    } else {
+        ring.frameBytes += offset + size - ring.offset;
+    }
+    ring.offset = offset + size;
+    offset += ring.regionBase();
+    *data = ring.mapped + offset;
+    return UniformRange{ring.buffer, offset, size};
+}
+
+void UniformRing::bind(int port, const UniformRange& range) {
+    glBindBufferRange(GL_UNIFORM_BUFFER, port, range.buffer, range.offset,
+                      range.size);
+}
+
+void UniformRing::bindStorage(int port, const UniformRange& range) {
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, port, range.buffer,
+                      range.offset, range.size);
+}
+
+uint64_t UniformRing::getEpoch() {
+    return ring.epoch;
+}
+
+GLsizeiptr UniformRing::getFrameBytes() {
+    return ring.lastFrameBytes;
+}
+
+GLsizeiptr UniformRing::getFrameCapacity() {
+    return ring.frameSize;
+}
+
+int UniformRing::getStalls() {
+    return ring.stalls;
+}
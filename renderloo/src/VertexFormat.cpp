@@ -0,0 +1,253 @@
+#include "core/VertexFormat.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <glm/gtc/packing.hpp>
+
+using namespace std;
+
+namespace {
+float signNotZero(float value) {
+    return value >= 0.f ? 1.f : -1.f;
+}
+
+template <typename T>
+T readAttribute(const uint8_t* vertex, int offset, const T& fallback) {
+    if (offset < 0)
+        return fallback;
+    T value;
+    std::memcpy(&value, vertex + offset, sizeof(T));
+    return value;
+}
+
+struct ExpectedAttribute {
+    GLint size;
+    GLenum type;
+};
+// what loo sets up, by location
+constexpr ExpectedAttribute EXPECTED_ATTRIBUTES[VERTEX_ATTRIBUTE_COUNT] = {
+    {3, GL_FLOAT}, {3, GL_FLOAT}, {2, GL_FLOAT}, {3, GL_FLOAT},
+    {3, GL_FLOAT}, {4, GL_INT},   {4, GL_FLOAT}};
+}  // namespace
+
+PositionQuantization getPositionQuantization(const glm::vec3& min,
+                                             const glm::vec3& max) {
+    PositionQuantization quantization;
+    quantization.offset = min;
+    for (int i = 0; i < 3; i++) {
+        float extent = max[i] - min[i];
+        quantization.scale[i] = extent > 0.f ? extent : 1.f;
+    }
+    return quantization;
+}
+
+glm::vec2 encodeOctahedral(const glm::vec3& n) {
+    float l1 = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+    if (l1 == 0.f)
+        return glm::vec2(0.f, 0.f);
+    glm::vec2 e(n.x / l1, n.y / l1);
+    if (n.z < 0.f) {
+        // fold the lower half over the diagonals
+        e = glm::vec2((1.f - std::abs(e.y)) * signNotZero(e.x),
+                      (1.f - std::abs(e.x)) * signNotZero(e.y));
+    }
+    return e;
+}
+
+glm::vec3 decodeOctahedral(const glm::vec2& e) {
+    glm::vec3 n(e.x, e.y, 1.f - std::abs(e.x) - std::abs(e.y));
+    float t = std::max(-n.z, 0.f);
+    n.x += n.x >= 0.f ? -t : t;
+    n.y += n.y >= 0.f ? -t : t;
+    return glm::normalize(n);
+}
+
+PackedVertex packVertex(const glm::vec3& position, const glm::vec3& normal,
+                        const glm::vec2& texCoord, const glm::vec3& tangent,
+                        const glm::vec3& bitangent,
+                        const PositionQuantization& quantization) {
+    PackedVertex packed;
+    for (int i = 0; i < 3; i++)
+        packed.position[i] = glm::packUnorm1x16(
+            (position[i] - quantization.offset[i]) / quantization.scale[i]);
+    bool rightHanded =
+        glm::dot(glm::cross(normal, tangent), bitangent) >= 0.f;
+    packed.position[3] = rightHanded ? 0xffff : 0;
+    glm::vec2 n = encodeOctahedral(normal), t = encodeOctahedral(tangent);
+    float octahedral[4] = {n.x, n.y, t.x, t.y};
+    for (int i = 0; i < 4; i++)
+        packed.normalTangent[i] =
+            static_cast<int16_t>(glm::packSnorm1x16(octahedral[i]));
+    packed.texCoord[0] = glm::packHalf1x16(texCoord.x);
+    packed.texCoord[1] = glm::packHalf1x16(texCoord.y);
+    return packed;
+}
+
+PackedSkin packSkin(const glm::ivec4& boneIDs, const glm::vec4& weights) {
+    PackedSkin skin{};
+    float sum = 0.f;
+    for (int i = 0; i < 4; i++) {
+        if (boneIDs[i] >= 0 && boneIDs[i] < PACKED_NO_BONE)
+            sum += std::max(weights[i], 0.f);
+    }
+    int total = 0, largest = -1;
+    for (int i = 0; i < 4; i++) {
+        bool used = sum > 0.f && boneIDs[i] >= 0 &&
+                    boneIDs[i] < PACKED_NO_BONE;
+        skin.boneIDs[i] = used ? static_cast<uint8_t>(boneIDs[i])
+                               : PACKED_NO_BONE;
+        int weight = used ? static_cast<int>(std::lround(
+                                std::max(weights[i], 0.f) / sum * 255.f))
+                          : 0;
+        skin.weights[i] = static_cast<uint8_t>(weight);
+        total += weight;
+        if (used && (largest < 0 || weight > skin.weights[largest]))
+            largest = i;
+    }
+    // rounding error onto the largest weight, the sum stays exact
+    if (largest >= 0)
+        skin.weights[largest] =
+            static_cast<uint8_t>(skin.weights[largest] + 255 - total);
+    return skin;
+}
+
+std::optional<SourceVertexLayout> getSourceVertexLayout(GLuint vao,
+                                                        size_t stride) {
+    SourceVertexLayout layout;
+    layout.stride = stride;
+    for (GLuint i = 0; i < VERTEX_ATTRIBUTE_COUNT; i++) {
+        layout.offsets[i] = -1;
+        GLint enabled = 0;
+        glGetVertexArrayIndexediv(vao, i, GL_VERTEX_ATTRIB_ARRAY_ENABLED,
+                                  &enabled);
+        if (!enabled)
+            continue;
+        GLint size, type, relativeOffset;
+        GLint64 bindingOffset = 0;
+        glGetVertexArrayIndexediv(vao, i, GL_VERTEX_ATTRIB_ARRAY_SIZE, &size);
+        glGetVertexArrayIndexediv(vao, i, GL_VERTEX_ATTRIB_ARRAY_TYPE, &type);
+        glGetVertexArrayIndexediv(vao, i, GL_VERTEX_ATTRIB_RELATIVE_OFFSET,
+                                  &relativeOffset);
+        glGetVertexArrayIndexed64iv(vao, i, GL_VERTEX_BINDING_OFFSET,
+                                    &bindingOffset);
+        const ExpectedAttribute& expected = EXPECTED_ATTRIBUTES[i];
+        GLint64 offset = bindingOffset + relativeOffset;
+        size_t bytes = 4 * static_cast<size_t>(expected.size);
+        if (size != expected.size ||
+            static_cast<GLenum>(type) != expected.type || offset < 0 ||
+            static_cast<size_t>(offset) + bytes > stride)
+            return std::nullopt;
+        layout.offsets[i] = static_cast<int>(offset);
+    }
+    if (layout.offsets[VERTEX_POSITION] < 0)
+        return std::nullopt;
+    return layout;
+}
+
+void copyVertexLayout(GLuint source, GLuint target) {
+    GLint maxAttribs = 0;
+    glGetIntegerv(GL_MAX_VERTEX_ATTRIBS, &maxAttribs);
+    for (GLuint i = 0; i < static_cast<GLuint>(maxAttribs); i++) {
+        GLint enabled = 0;
+        glGetVertexArrayIndexediv(source, i, GL_VERTEX_ATTRIB_ARRAY_ENABLED,
+                                  &enabled);
+        if (!enabled)
+            continue;
+        GLint size, type, normalized, integer, relativeOffset;
+        GLint64 bindingOffset = 0;
+        glGetVertexArrayIndexediv(source, i, GL_VERTEX_ATTRIB_ARRAY_SIZE,
+                                  &size);
+        glGetVertexArrayIndexediv(source, i, GL_VERTEX_ATTRIB_ARRAY_TYPE,
+                                  &type);
+        glGetVertexArrayIndexediv(source, i, GL_VERTEX_ATTRIB_ARRAY_NORMALIZED,
+                                  &normalized);
+        glGetVertexArrayIndexediv(source, i, GL_VERTEX_ATTRIB_ARRAY_INTEGER,
+                                  &integer);
+        glGetVertexArrayIndexediv(source, i, GL_VERTEX_ATTRIB_RELATIVE_OFFSET,
+                                  &relativeOffset);
+        glGetVertexArrayIndexed64iv(source, i, GL_VERTEX_BINDING_OFFSET,
+                                    &bindingOffset);
+        auto offset = static_cast<GLuint>(bindingOffset + relativeOffset);
+        glEnableVertexArrayAttrib(target, i);
+        if (integer)
+            glVertexArrayAttribIFormat(target, i, size, type, offset);
+        else
+            glVertexArrayAttribFormat(target, i, size, type, normalized,
+                                      offset);
+        glVertexArrayAttribBinding(target, i, 0);
+    }
+}
+
+bool packVertices(const uint8_t* vertices, size_t count,
+                  const SourceVertexLayout& layout,
+                  const PositionQuantization& quantization,
+                  PackedVertex* packed, PackedSkin* skins) {
+    const int* offsets = layout.offsets;
+    bool skinned = false;
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t* vertex = vertices + i * layout.stride;
+        packed[i] = packVertex(
+            readAttribute(vertex, offsets[VERTEX_POSITION], glm::vec3(0.f)),
+            readAttribute(vertex, offsets[VERTEX_NORMAL],
+                          glm::vec3(0.f, 0.f, 1.f)),
+            readAttribute(vertex, offsets[VERTEX_TEXCOORD], glm::vec2(0.f)),
+            readAttribute(vertex, offsets[VERTEX_TANGENT],
+                          glm::vec3(1.f, 0.f, 0.f)),
+            readAttribute(vertex, offsets[VERTEX_BITANGENT],
+                          glm::vec3(0.f, 1.f, 0.f)),
+            quantization);
+        glm::ivec4 boneIDs =
+            readAttribute(vertex, offsets[VERTEX_BONE_IDS], glm::ivec4(-1));
+        skinned = skinned || boneIDs.x >= 0 || boneIDs.y >= 0 ||
+                  boneIDs.z >= 0 || boneIDs.w >= 0;
+        if (skins)
+            skins[i] = packSkin(boneIDs, readAttribute(
+                                             vertex, offsets[VERTEX_WEIGHTS],
+                                             glm::vec4(0.f)));
+    }
+    return skinned;
+}
+
+bool hasBoneInfluence(const uint8_t* vertices, size_t count,
+                      const SourceVertexLayout& layout) {
+    int offset = layout.offsets[VERTEX_BONE_IDS];
+    if (offset < 0)
+        return false;
+    for (size_t i = 0; i < count; i++) {
+        glm::ivec4 boneIDs = readAttribute(vertices + i * layout.stride,
+                                           offset, glm::ivec4(-1));
+        if (boneIDs.x >= 0 || boneIDs.y >= 0 || boneIDs.z >= 0 ||
+            boneIDs.w >= 0)
+            return true;
+    }
+    return false;
+}
+
+void setupPackedVertexArray(GLuint vao, GLuint vertexBuffer,
+                            GLuint skinBuffer) {
+    auto attribute = [vao](GLuint index, GLint size, GLenum type,
+                           GLboolean normalized, size_t offset,
+                           GLuint binding) {
+        glEnableVertexArrayAttrib(vao, index);
+        glVertexArrayAttribFormat(vao, index, size, type, normalized,
+                                  static_cast<GLuint>(offset));
+        glVertexArrayAttribBinding(vao, index, binding);
+    };
+    attribute(VERTEX_POSITION, 4, GL_UNSIGNED_SHORT, GL_TRUE,
+              offsetof(PackedVertex, position), 0);
+    attribute(VERTEX_NORMAL, 4, GL_SHORT, GL_TRUE,
+              offsetof(PackedVertex, normalTangent), 0);
+    attribute(VERTEX_TEXCOORD, 2, GL_HALF_FLOAT, GL_FALSE,
+              offsetof(PackedVertex, texCoord), 0);
+    glVertexArrayVertexBuffer(vao, 0, vertexBuffer, 0, sizeof(PackedVertex));
+    if (!skinBuffer)
+        return;
+    glEnableVertexArrayAttrib(vao, VERTEX_BONE_IDS);
+    glVertexArrayAttribIFormat(vao, VERTEX_BONE_IDS, 4, GL_UNSIGNED_BYTE,
+                               offsetof(PackedSkin, boneIDs));
+    glVertexArrayAttribBinding(vao, VERTEX_BONE_IDS, 1);
+    attribute(VERTEX_WEIGHTS, 4, GL_UNSIGNED_BYTE, GL_TRUE,
+              offsetof(PackedSkin, weights), 1);
+    glVertexArrayVertexBuffer(vao, 1, skinBuffer, 0, sizeof(PackedSkin));
+}
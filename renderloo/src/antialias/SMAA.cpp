@@ -2,6 +2,7 @@
 #include <loo/Quad.hpp>
 #include "antialias/SMAAAreaTex.h"
 #include "antialias/SMAASearchTex.h"
+#include "core/Profiler.hpp"
 #include "shaders/SMAABlendingWeight.frag.hpp"
 #include "shaders/SMAABlendingWeight.vert.hpp"
 #include "shaders/SMAAEdgeDetection.frag.hpp"
@@ -67,7 +68,7 @@ const loo::Texture2D& SMAA::apply(const loo::Texture2D& src) {
     glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
     glClearStencil(0);
 
-    Application::beginEvent("SMAA Edge Detection");
+    GPUProfiler::beginEvent("SMAA Edge Detection");
     // pass 1: edge detection
     m_fb.attachTexture(*m_edges, GL_COLOR_ATTACHMENT0, 0);
     m_fb.enableAttachments({GL_COLOR_ATTACHMENT0});
@@ -76,9 +77,9 @@ const loo::Texture2D& SMAA::apply(const loo::Texture2D& src) {
     m_shaderpass1.setUniform("rt_metrics", metrics);
     m_shaderpass1.setTexture(0, src);
     Quad::globalQuad().draw();
-    Application::endEvent();
+    GPUProfiler::endEvent();
 
-    Application::beginEvent("SMAA Blending Weight Calculation");
+    GPUProfiler::beginEvent("SMAA Blending Weight Calculation");
     // pass 2: blending weight calculation
     // disable stencil write
     glStencilFunc(GL_EQUAL, 1, 0xFF);
@@ -91,9 +92,9 @@ const loo::Texture2D& SMAA::apply(const loo::Texture2D& src) {
     m_shaderpass2.setTexture(1, *m_area);
     m_shaderpass2.setTexture(2, *m_search);
     Quad::globalQuad().draw();
-    Application::endEvent();
+    GPUProfiler::endEvent();
 
-    Application::beginEvent("SMAA Neighborhood Blending");
+    GPUProfiler::beginEvent("SMAA Neighborhood Blending");
     // pass 3: neighborhood blending
     m_fb.attachTexture(*m_output, GL_COLOR_ATTACHMENT0, 0);
     // disable stencil test
@@ -103,7 +104,7 @@ const loo::Texture2D& SMAA::apply(const loo::Texture2D& src) {
     m_shaderpass3.setTexture(0, src);
     m_shaderpass3.setTexture(1, *m_blend);
     Quad::globalQuad().draw();
-    Application::endEvent();
+    GPUProfiler::endEvent();
 
     m_fb.unbind();
     glEnable(GL_DEPTH_TEST);
@@ -1,5 +1,6 @@
 #include "antialias/TAA.hpp"
 #include <loo/Application.hpp>
+#include "core/Profiler.hpp"
 #include "shaders/TAABlending.comp.hpp"
 using namespace loo;
 TAA::TAA() : m_blendingShader{Shader(TAABLENDING_COMP, ShaderType::Compute)} {}
@@ -19,7 +20,7 @@ void TAA::init(int width, int height) {
 constexpr int GROUP_SIZE = 32;
 const Texture2D& TAA::apply(Texture2D& currentFrame, Texture2D& velocity,
                             Texture2D& depthStencil) {
-    Application::beginEvent("TAA");
+    GPUProfiler::beginEvent("TAA");
 
     m_blendingShader.use();
     // use nearest sampler for current frame, depth and velocity to avoid blur due to blending
@@ -42,7 +43,7 @@ const Texture2D& TAA::apply(Texture2D& currentFrame, Texture2D& velocity,
         std::ceil((float)currentFrame.getWidth() / GROUP_SIZE),
         std::ceil((float)currentFrame.getHeight() / GROUP_SIZE));
     m_blendingShader.wait();
-    Application::endEvent();
+    GPUProfiler::endEvent();
     m_writeInIndex = getPreviousFrameIndex();
     // reset sampler to linear
     currentFrame.setSizeFilter(GL_LINEAR, GL_LINEAR);
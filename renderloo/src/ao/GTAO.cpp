@@ -4,6 +4,7 @@
 #include <memory>
 #include <random>
 #include "ao/AOHelper.hpp"
+#include "core/Profiler.hpp"
 #include "shaders/GTAOPass1.comp.hpp"
 #include "shaders/GTAOPass2.comp.hpp"
 using namespace loo;
@@ -30,9 +31,9 @@ constexpr int GROUP_SIZE = 1, N_SLICE = 2;
 void GTAO::render(const loo::Texture2D& position, const loo::Texture2D& normal,
                   const loo::Texture2D& albedo,
                   const loo::Texture2D& depthStencil) {
-    Application::beginEvent("GTAO");
+    GPUProfiler::beginEvent("GTAO");
     int width = position.getWidth() / 2, height = position.getHeight() / 2;
-    Application::beginEvent("GTAO Pass 1 - Horizontal Slice Based Integral");
+    GPUProfiler::beginEvent("GTAO Pass 1 - Horizontal Slice Based Integral");
     m_gtaoPass1Shader.use();
     m_gtaoPass1Shader.setUniform("NumSlices", N_SLICE);
     float sinDeltaAngle = std::sin(M_PI / N_SLICE),
@@ -47,16 +48,16 @@ void GTAO::render(const loo::Texture2D& position, const loo::Texture2D& normal,
 
     m_gtaoPass1Shader.dispatch(width / GROUP_SIZE, height / GROUP_SIZE);
     m_gtaoPass1Shader.wait();
-    Application::endEvent();
+    GPUProfiler::endEvent();
 
-    Application::beginEvent("GTAO Pass 1 - Horizontal Slice Based Integral");
+    GPUProfiler::beginEvent("GTAO Pass 1 - Horizontal Slice Based Integral");
     m_gtaoPass2Shader.use();
     m_gtaoPass2Shader.setRegularTexture(0, *m_blurSource);
     m_gtaoPass2Shader.setTexture(1, *m_result, 0, GL_WRITE_ONLY, GL_R16F);
 
     m_gtaoPass2Shader.dispatch(width / GROUP_SIZE, height / GROUP_SIZE);
     m_gtaoPass2Shader.wait();
-    Application::endEvent();
+    GPUProfiler::endEvent();
 
-    Application::endEvent();
+    GPUProfiler::endEvent();
 }
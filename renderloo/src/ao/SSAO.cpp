@@ -4,6 +4,7 @@
 #include <memory>
 #include <random>
 #include "ao/AOHelper.hpp"
+#include "core/Profiler.hpp"
 #include "shaders/SSAOPass1.frag.hpp"
 #include "shaders/SSAOPass2.frag.hpp"
 #include "shaders/finalScreen.vert.hpp"
@@ -35,8 +36,8 @@ void SSAO::init() {
 
 void SSAO::render(const Texture2D& position, const Texture2D& normal,
                   const Texture2D& depthStencil) {
-    Application::beginEvent("SSAO");
-    Application::beginEvent("Pass 1 - kernel sampling");
+    GPUProfiler::beginEvent("SSAO");
+    GPUProfiler::beginEvent("Pass 1 - kernel sampling");
     m_fb.bind();
     m_fb.attachTexture(depthStencil, GL_STENCIL_ATTACHMENT, 0);
     m_fb.attachTexture(*m_blurSource, GL_COLOR_ATTACHMENT0, 0);
@@ -65,19 +66,19 @@ void SSAO::render(const Texture2D& position, const Texture2D& normal,
     m_ssaoPass1Shader.setUniform("radius", radius);
     Quad::globalQuad().draw();
 
-    Application::endEvent();
+    GPUProfiler::endEvent();
 
-    Application::beginEvent("Pass 2 - blur");
+    GPUProfiler::beginEvent("Pass 2 - blur");
     m_ssaoPass2Shader.use();
     m_fb.attachTexture(*m_result, GL_COLOR_ATTACHMENT0, 0);
     glClear(GL_COLOR_BUFFER_BIT);
     m_ssaoPass2Shader.setTexture(0, *m_blurSource);
     Quad::globalQuad().draw();
-    Application::endEvent();
+    GPUProfiler::endEvent();
 
     glEnable(GL_DEPTH_TEST);
     glDisable(GL_STENCIL_TEST);
     // enable stencil write
     glStencilMask(0xFF);
-    Application::endEvent();
+    GPUProfiler::endEvent();
 }
\ No newline at end of file
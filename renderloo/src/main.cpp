@@ -27,6 +27,48 @@ static glm::vec3 parseVec3(const json& j, const string& key,
     }
 }
 
+static CameraPose parseCameraPose(const json& j, const CameraPose& defaultVal) {
+    return CameraPose{parseVec3(j, "position", defaultVal.position),
+                      parseVec3(j, "lookat", defaultVal.target)};
+}
+
+// headless options come from the "headless" section of config.json
+static HeadlessOptions parseHeadlessOptions(const json& config,
+                                            RenderLoo& app) {
+    HeadlessOptions options;
+    // start from the camera placed by the model loader
+    CameraPose start{app.getMainCamera().position,
+                     app.getScene().computeAABBWorldSpace().getCenter()};
+    options.fov = glm::degrees(app.getMainCamera().getFov());
+    if (config.contains("camera")) {
+        auto& camera = config["camera"];
+        options.fov = camera.value("fov", options.fov);
+        options.zNear = camera.value("znear", options.zNear);
+        options.zFar = camera.value("zfar", options.zFar);
+    }
+    options.cameraPath = CameraPath::orbit(start, 360.f);
+    if (!config.contains("headless"))
+        return options;
+    auto& headless = config["headless"];
+    options.frames = headless.value("frames", options.frames);
+    options.deltaTime = headless.value("deltaTime", options.deltaTime);
+    options.outputDir = headless.value("output", string());
+    options.recordPath = headless.value("record", string());
+    if (headless.contains("cameraPath")) {
+        auto& path = headless["cameraPath"];
+        if (path.value("type", string("orbit")) == "spline") {
+            vector<CameraPose> keyframes;
+            for (auto& key : path["keyframes"])
+                keyframes.push_back(parseCameraPose(key, start));
+            options.cameraPath = CameraPath::spline(std::move(keyframes));
+        } else {
+            options.cameraPath = CameraPath::orbit(
+                parseCameraPose(path, start), path.value("degrees", 360.f));
+        }
+    }
+    return options;
+}
+
 void loadScene(RenderLoo& app, const char* filename) {
     using namespace std;
     fs::path p(filename);
@@ -48,6 +90,22 @@ int main(int argc, char* argv[]) {
         .nargs(2)
         .default_value(vector<int>{1600, 1600})
         .scan<'i', int>();
+    program.add_argument("-c", "--config")
+        .help("Config file path")
+        .default_value(string("config.json"));
+    program.add_argument("--headless")
+        .help("Render frames offscreen without opening a window")
+        .default_value(false)
+        .implicit_value(true);
+    program.add_argument("-n", "--frames")
+        .help("Headless frame count, overrides config")
+        .scan<'i', int>();
+    program.add_argument("-o", "--output")
+        .help("Headless output directory, overrides config");
+    program.add_argument("-r", "--record")
+        .help(
+            "Headless frame sequence(.y4m, .rgb or EXR directory), "
+            "overrides config");
 
     try {
         program.parse_args(argc, argv);
@@ -66,11 +124,38 @@ int main(int argc, char* argv[]) {
     if (auto path = program.present<string>("-b")) {
         skyboxDir = *path;
     }
+    json config;
+    if (ifstream configFile(program.get<string>("-c")); configFile) {
+        config = json::parse(configFile, nullptr, false);
+        if (config.is_discarded()) {
+            LOG(ERROR) << "Failed to parse config "
+                       << program.get<string>("-c");
+            config = json::object();
+        }
+    }
+    bool headless = program.get<bool>("--headless");
+    if (headless) {
+        prepareHeadlessContext();
+    }
     auto size = program.get<vector<int>>("-s");
     RenderLoo app(size[0], size[1]);
     loadScene(app, modelPath.c_str());
     if (!skyboxDir.empty()) {
         app.loadSkybox(skyboxDir);
     }
-    app.run();
+    if (headless) {
+        HeadlessOptions options = parseHeadlessOptions(config, app);
+        if (auto frames = program.present<int>("-n")) {
+            options.frames = *frames;
+        }
+        if (auto output = program.present<string>("-o")) {
+            options.outputDir = *output;
+        }
+        if (auto record = program.present<string>("-r")) {
+            options.recordPath = *record;
+        }
+        app.runHeadless(options);
+    } else {
+        app.run();
+    }
 }
\ No newline at end of file
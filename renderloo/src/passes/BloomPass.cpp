@@ -1,5 +1,6 @@
 #include "passes/BloomPass.hpp"
 #include <memory>
+#include "core/Profiler.hpp"
 #include "shaders/bloomAdditiveBlending.comp.hpp"
 #include "shaders/bloomPixelPicker.comp.hpp"
 #include "shaders/bloomUpSampling.comp.hpp"
@@ -52,9 +53,9 @@ int BloomPass::setBloomRange(int range) {
     return m_mipLevelDownSample;
 }
 const Texture2D& BloomPass::render(const Texture2D& input) {
-    Application::beginEvent("Bloom Pass");
+    GPUProfiler::beginEvent("Bloom Pass");
     // pick bright pixels, gaussian blur it into the mipmap level 0
-    Application::beginEvent("Bloom Pass 1 - Pixel Picker");
+    GPUProfiler::beginEvent("Bloom Pass 1 - Pixel Picker");
     m_pixelPickerShader.use();
     m_pixelPickerShader.setUniform("brightnessThreshold", brightnessThreshold);
     m_pixelPickerShader.setRegularTexture(0, input);
@@ -64,10 +65,10 @@ const Texture2D& BloomPass::render(const Texture2D& input) {
     m_pixelPickerShader.dispatch(m_width / GROUP_SIZE, m_height / GROUP_SIZE);
     panicPossibleGLError();
     m_pixelPickerShader.wait();
-    Application::endEvent();
+    GPUProfiler::endEvent();
 
     // forward blur the mipmap level x - 1 to level x
-    Application::beginEvent("Bloom Pass 2 - Down Sampling");
+    GPUProfiler::beginEvent("Bloom Pass 2 - Down Sampling");
     int width = m_width, height = m_height;
     for (int i = 1; i < m_mipLevelDownSample; ++i) {
         width /= 2;
@@ -80,12 +81,12 @@ const Texture2D& BloomPass::render(const Texture2D& input) {
         m_downSamplingShader.dispatch(width / GROUP_SIZE, height / GROUP_SIZE);
         m_downSamplingShader.wait();
     }
-    Application::endEvent();
+    GPUProfiler::endEvent();
 
     // reversely upsampling the mipmap level x to level x - 1
     // upSampleLevel[MAX] = blur(downSampleLevel[MAX + 1])
     // upSampleLevel[i] = blur(upSampleLevel[i+1]) + blur(downSampleLevel[i])
-    Application::beginEvent("Bloom Pass 3 - Up Sampling");
+    GPUProfiler::beginEvent("Bloom Pass 3 - Up Sampling");
     for (int i = m_mipLevelDownSample - 2; i >= 0; i--) {
         width *= 2;
         height *= 2;
@@ -103,9 +104,9 @@ const Texture2D& BloomPass::render(const Texture2D& input) {
         m_upSamplingShader.dispatch(width / GROUP_SIZE, height / GROUP_SIZE);
         m_upSamplingShader.wait();
     }
-    Application::endEvent();
+    GPUProfiler::endEvent();
 
-    Application::beginEvent("Bloom Pass 4 - Additive Blending");
+    GPUProfiler::beginEvent("Bloom Pass 4 - Additive Blending");
     m_additiveBlendingShader.use();
     m_additiveBlendingShader.setRegularTexture(0, input);
     m_additiveBlendingShader.setRegularTexture(1, *m_upSample);
@@ -114,8 +115,8 @@ const Texture2D& BloomPass::render(const Texture2D& input) {
     m_additiveBlendingShader.dispatch(m_result->getWidth() / GROUP_SIZE,
                                       m_result->getHeight() / GROUP_SIZE);
     m_additiveBlendingShader.wait();
-    Application::endEvent();
+    GPUProfiler::endEvent();
 
-    Application::endEvent();
+    GPUProfiler::endEvent();
     return *m_result;
 }
\ No newline at end of file
@@ -0,0 +1,114 @@
+#include "passes/ClusterCullingPass.hpp"
+
+#include <algorithm>
+#include <loo/glError.hpp>
+#include <string>
+#include "core/Culling.hpp"
+#include "core/Profiler.hpp"
+#include "core/constants.hpp"
+#include "shaders/clusterCull.comp.hpp"
+
+using namespace loo;
+using namespace std;
+
+constexpr int STATISTICS_SLOT_SIZE = 8 * sizeof(GLuint);
+// dispatch limit of a dimension, larger meshes loop in the shader
+constexpr int MAX_CLUSTER_GROUPS = 65535;
+
+ClusterCullingPass::ClusterCullingPass()
+    : m_cullShader{Shader(CLUSTERCULL_COMP, ShaderType::Compute)} {}
+
+ClusterCullingPass::~ClusterCullingPass() {
+    if (m_statisticsBuffer)
+        glDeleteBuffers(1, &m_statisticsBuffer);
+}
+
+void ClusterCullingPass::readStatistics() {
+    if (!m_statisticsBuffer) {
+        glCreateBuffers(1, &m_statisticsBuffer);
+        glNamedBufferStorage(
+            m_statisticsBuffer,
+            STATISTICS_SLOT_SIZE * UNIFORM_RING_FRAMES_IN_FLIGHT, nullptr,
+            GL_DYNAMIC_STORAGE_BIT);
+        glClearNamedBufferData(m_statisticsBuffer, GL_R32UI, GL_RED_INTEGER,
+                               GL_UNSIGNED_INT, nullptr);
+    }
+    // the slot of this frame was last written UNIFORM_RING_FRAMES_IN_FLIGHT
+    // frames ago, UniformRing::beginFrame() already waited for that frame
+    m_frame++;
+    GLintptr slot =
+        (m_frame % UNIFORM_RING_FRAMES_IN_FLIGHT) * STATISTICS_SLOT_SIZE;
+    GLuint counters[8]{};
+    glGetNamedBufferSubData(m_statisticsBuffer, slot, sizeof(counters),
+                            counters);
+    m_statistics = ClusterStatistics{
+        static_cast<int>(counters[0]), static_cast<int>(counters[1]),
+        static_cast<int>(counters[2]), static_cast<int>(counters[3]),
+        static_cast<int>(counters[4]), static_cast<int>(counters[5])};
+    glClearNamedBufferSubData(m_statisticsBuffer, GL_R32UI, slot,
+                              STATISTICS_SLOT_SIZE, GL_RED_INTEGER,
+                              GL_UNSIGNED_INT, nullptr);
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER,
+                      SHADER_SSBO_PORT_CLUSTER_STATISTICS, m_statisticsBuffer,
+                      slot, STATISTICS_SLOT_SIZE);
+}
+
+const std::vector<int>& ClusterCullingPass::render(
+    MultiDrawScene& multiDraw, const std::vector<int>& draws,
+    ShaderProgram& sp, bool cullBackFaces, const glm::mat4& viewProjection,
+    const glm::vec3& cameraPosition, const Texture2D* hiZ,
+    const glm::mat4& prevViewProjection) {
+    m_clusterDraws.clear();
+    m_meshDraws.clear();
+    for (int draw : draws) {
+        (multiDraw.drawsClusters(draw) ? m_clusterDraws : m_meshDraws)
+            .push_back(draw);
+    }
+    if (m_clusterDraws.empty())
+        return m_meshDraws;
+    GPUProfiler::beginEvent("Cluster Culling");
+    readStatistics();
+
+    UniformRange commands = multiDraw.writeCommands(m_clusterDraws, true);
+    int count = static_cast<int>(m_clusterDraws.size());
+    m_cullShader.use();
+    Frustum frustum = extractFrustum(viewProjection);
+    for (int i = 0; i < 6; i++) {
+        m_cullShader.setUniform("frustumPlanes[" + std::to_string(i) + "]",
+                                frustum.planes[i]);
+    }
+    m_cullShader.setUniform("cameraPosition", cameraPosition);
+    m_cullShader.setUniform("cullBackFaces", cullBackFaces);
+    m_cullShader.setUniform("cullOcclusion", hiZ != nullptr);
+    m_cullShader.setUniform("prevViewProjection", prevViewProjection);
+    m_cullShader.setUniform("shortIndices",
+                            multiDraw.getIndexType() == GL_UNSIGNED_SHORT);
+    if (hiZ)
+        m_cullShader.setRegularTexture(0, *hiZ);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SHADER_SSBO_PORT_CLUSTERS,
+                     multiDraw.getClusterBuffer());
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SHADER_SSBO_PORT_MESH_CLUSTERS,
+                     multiDraw.getMeshClusterBuffer());
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER,
+                     SHADER_SSBO_PORT_CLUSTER_INDICES,
+                     multiDraw.getIndexBuffer());
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER,
+                     SHADER_SSBO_PORT_CLUSTER_OUTPUT,
+                     multiDraw.getClusterIndexBuffer());
+    UniformRing::bindStorage(
+        SHADER_SSBO_PORT_DRAW_COMMANDS,
+        UniformRange{
+            commands.buffer, commands.offset,
+            static_cast<GLsizeiptr>(count *
+                                    sizeof(DrawElementsIndirectCommand))});
+    m_cullShader.dispatch(
+        std::min(multiDraw.getMaxClusters(), MAX_CLUSTER_GROUPS), count);
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_ELEMENT_ARRAY_BARRIER_BIT |
+                    GL_SHADER_STORAGE_BARRIER_BIT);
+
+    sp.use();
+    multiDraw.submitCommands(m_clusterDraws, commands, sp, cullBackFaces);
+    logPossibleGLError();
+    GPUProfiler::endEvent();
+    return m_meshDraws;
+}
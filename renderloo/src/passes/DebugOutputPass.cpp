@@ -1,4 +1,5 @@
 #include "passes/DebugOutputPass.hpp"
+#include "core/Profiler.hpp"
 #include "shaders/debugOutput.frag.hpp"
 #include "shaders/finalScreen.vert.hpp"
 using namespace loo;
@@ -19,8 +20,9 @@ void DebugOutputPass::init(int width, int height) {
     panicPossibleGLError();
 }
 
-void DebugOutputPass::render(const GBuffer& gbuffer, const loo::Texture2D& ao) {
-    Application::beginEvent("DebugOutputPass");
+void DebugOutputPass::render(const GBuffer& gbuffer, const loo::Texture2D& ao,
+                             loo::Framebuffer* target) {
+    GPUProfiler::beginEvent("DebugOutputPass");
     m_fb.bind();
     m_fb.attachTexture(*gbuffer.depthStencil, GL_DEPTH_STENCIL_ATTACHMENT, 0);
 
@@ -40,10 +42,11 @@ void DebugOutputPass::render(const GBuffer& gbuffer, const loo::Texture2D& ao) {
 
     Quad::globalQuad().draw();
 
-    glBlitNamedFramebuffer(m_fb.getId(), 0, 0, 0, m_width, m_height, 0, 0,
-                           m_width, m_height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    glBlitNamedFramebuffer(m_fb.getId(), target ? target->getId() : 0, 0, 0,
+                           m_width, m_height, 0, 0, m_width, m_height,
+                           GL_COLOR_BUFFER_BIT, GL_LINEAR);
 
     logPossibleGLError();
     m_fb.unbind();
-    Application::endEvent();
+    GPUProfiler::endEvent();
 }
\ No newline at end of file
@@ -0,0 +1,148 @@
+#include "passes/OcclusionCullingPass.hpp"
+
+#include <algorithm>
+#include <loo/glError.hpp>
+#include "core/Profiler.hpp"
+#include "core/constants.hpp"
+#include "shaders/hiZBuild.comp.hpp"
+#include "shaders/occlusionCull.comp.hpp"
+
+using namespace loo;
+using namespace std;
+
+constexpr int PYRAMID_GROUP_SIZE = 16, CULL_GROUP_SIZE = 64;
+constexpr int STATISTICS_SLOT_SIZE = 4 * sizeof(GLuint);
+
+OcclusionCullingPass::OcclusionCullingPass()
+    : m_hiZBuildShader{Shader(HIZBUILD_COMP, ShaderType::Compute)},
+      m_cullShader{Shader(OCCLUSIONCULL_COMP, ShaderType::Compute)} {}
+
+OcclusionCullingPass::~OcclusionCullingPass() {
+    if (m_drawnBuffer)
+        glDeleteBuffers(1, &m_drawnBuffer);
+    if (m_statisticsBuffer)
+        glDeleteBuffers(1, &m_statisticsBuffer);
+}
+
+void OcclusionCullingPass::prepareBuffers(int meshCount) {
+    if (!m_statisticsBuffer) {
+        glCreateBuffers(1, &m_statisticsBuffer);
+        glNamedBufferStorage(
+            m_statisticsBuffer,
+            STATISTICS_SLOT_SIZE * UNIFORM_RING_FRAMES_IN_FLIGHT, nullptr,
+            GL_DYNAMIC_STORAGE_BIT);
+        glClearNamedBufferData(m_statisticsBuffer, GL_R32UI, GL_RED_INTEGER,
+                               GL_UNSIGNED_INT, nullptr);
+    }
+    if (meshCount > m_drawnCapacity) {
+        if (m_drawnBuffer)
+            glDeleteBuffers(1, &m_drawnBuffer);
+        glCreateBuffers(1, &m_drawnBuffer);
+        glNamedBufferStorage(m_drawnBuffer, meshCount * sizeof(GLuint),
+                             nullptr, 0);
+        m_drawnCapacity = meshCount;
+    }
+}
+
+void OcclusionCullingPass::buildPyramid(const Texture2D& depth) {
+    int width = depth.getWidth(), height = depth.getHeight();
+    if (!m_pyramid || m_pyramid->getWidth() != width ||
+        m_pyramid->getHeight() != height) {
+        m_pyramidLevels = mipmapLevelFromSize(width, height);
+        m_pyramid = make_unique<Texture2D>();
+        m_pyramid->init();
+        m_pyramid->setupStorage(width, height, GL_R32F, m_pyramidLevels);
+        m_pyramid->setSizeFilter(GL_NEAREST, GL_NEAREST);
+        panicPossibleGLError();
+    }
+    GPUProfiler::beginEvent("Hi-Z Pyramid");
+    m_hiZBuildShader.use();
+    m_hiZBuildShader.setRegularTexture(0, depth);
+    for (int level = 0; level < m_pyramidLevels; level++) {
+        int levelWidth = std::max(width >> level, 1),
+            levelHeight = std::max(height >> level, 1);
+        m_hiZBuildShader.setUniform("copyDepth", level == 0);
+        m_hiZBuildShader.setTexture(1, *m_pyramid, std::max(level - 1, 0),
+                                    GL_READ_ONLY, GL_R32F);
+        m_hiZBuildShader.setTexture(2, *m_pyramid, level, GL_WRITE_ONLY,
+                                    GL_R32F);
+        m_hiZBuildShader.dispatch(
+            (levelWidth + PYRAMID_GROUP_SIZE - 1) / PYRAMID_GROUP_SIZE,
+            (levelHeight + PYRAMID_GROUP_SIZE - 1) / PYRAMID_GROUP_SIZE);
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    }
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    GPUProfiler::endEvent();
+    m_pyramidValid = true;
+}
+
+void OcclusionCullingPass::cull(int phase, const UniformRange& commands,
+                                int count, const glm::mat4& viewProjection) {
+    m_cullShader.use();
+    m_cullShader.setUniform("phase", phase);
+    m_cullShader.setUniform("commandCount", count);
+    m_cullShader.setUniform("viewProjection", viewProjection);
+    m_cullShader.setUniform("hiZValid", m_pyramidValid);
+    if (m_pyramid)
+        m_cullShader.setRegularTexture(0, *m_pyramid);
+    UniformRing::bindStorage(
+        SHADER_SSBO_PORT_DRAW_COMMANDS,
+        UniformRange{
+            commands.buffer, commands.offset,
+            static_cast<GLsizeiptr>(count *
+                                    sizeof(DrawElementsIndirectCommand))});
+    m_cullShader.dispatch((count + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1);
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void OcclusionCullingPass::render(MultiDrawScene& multiDraw,
+                                  const std::vector<int>& draws,
+                                  ShaderProgram& sp, bool cullBackFaces,
+                                  const Texture2D& depth,
+                                  const glm::mat4& viewProjection,
+                                  const glm::mat4& prevViewProjection) {
+    if (draws.empty() || multiDraw.empty())
+        return;
+    GPUProfiler::beginEvent("Occlusion Culling");
+    prepareBuffers(multiDraw.getMeshCount());
+    // the slot of this frame was last written UNIFORM_RING_FRAMES_IN_FLIGHT
+    // frames ago, UniformRing::beginFrame() already waited for that frame
+    m_frame++;
+    GLintptr slot =
+        (m_frame % UNIFORM_RING_FRAMES_IN_FLIGHT) * STATISTICS_SLOT_SIZE;
+    GLuint counters[4]{};
+    glGetNamedBufferSubData(m_statisticsBuffer, slot, sizeof(counters),
+                            counters);
+    m_statistics = OcclusionStatistics{static_cast<int>(counters[0]),
+                                       static_cast<int>(counters[1]),
+                                       static_cast<int>(counters[2])};
+    glClearNamedBufferSubData(m_statisticsBuffer, GL_R32UI, slot,
+                              STATISTICS_SLOT_SIZE, GL_RED_INTEGER,
+                              GL_UNSIGNED_INT, nullptr);
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER,
+                      SHADER_SSBO_PORT_OCCLUSION_STATISTICS,
+                      m_statisticsBuffer, slot, STATISTICS_SLOT_SIZE);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER,
+                     SHADER_SSBO_PORT_OCCLUSION_DRAWN, m_drawnBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SHADER_SSBO_PORT_MESH_BOUNDS,
+                     multiDraw.getBoundsBuffer());
+    int count = static_cast<int>(draws.size());
+
+    // phase 1: visible last frame
+    UniformRange commands = multiDraw.writeCommands(draws);
+    cull(1, commands, count, prevViewProjection);
+    sp.use();
+    multiDraw.submitCommands(draws, commands, sp, cullBackFaces);
+
+    // phase 2: revealed by this frame's camera or animation
+    buildPyramid(depth);
+    commands = multiDraw.writeCommands(draws);
+    cull(2, commands, count, viewProjection);
+    sp.use();
+    // same draws as phase 1, counted once so the statistics don't depend on
+    // the culling toggle
+    multiDraw.submitCommands(draws, commands, sp, cullBackFaces, true,
+                             false);
+    logPossibleGLError();
+    GPUProfiler::endEvent();
+}
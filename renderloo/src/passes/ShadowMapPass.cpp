@@ -1,7 +1,7 @@
 #include "passes/ShadowMapPass.hpp"
 #include <glog/logging.h>
 #include <loo/Scene.hpp>
-#include "core/Graphics.hpp"
+#include "core/Profiler.hpp"
 #include "core/constants.hpp"
 #include "shaders/shadowmap.frag.hpp"
 #include "shaders/shadowmap.vert.hpp"
@@ -46,21 +46,24 @@ void ShadowMapPass::init() {
         sizeof(ShaderDirectionalShadowMatricesBlock)));
 }
 void ShadowMapPass::render(const loo::Scene& scene,
+                           const TransformCache& transforms,
                            const std::vector<ShaderLight>& lights,
-                           float alphaTestThreshold) {
+                           float alphaTestThreshold,
+                           RenderQueue& renderQueue,
+                           MultiDrawScene* multiDraw) {
 
-    Application::beginEvent("Shadow Map Pass");
+    GPUProfiler::beginEvent("Shadow Map Pass");
     // render shadow map here
     m_fb.bind();
     Application::storeViewport();
     glViewport(0, 0, DIRECTIONAL_SHADOW_MAP_SIZE, DIRECTIONAL_SHADOW_MAP_SIZE);
     glEnable(GL_DEPTH_TEST);
     glDepthFunc(GL_GREATER);
+    glEnable(GL_DEPTH_CLAMP);
     glClearDepth(0.0f);
     glClear(GL_DEPTH_BUFFER_BIT);
 
     ShaderDirectionalShadowMatricesBlock block{};
-    auto sceneModelMatrix = scene.getModelMatrix();
     for (auto& light : lights) {
         if (light.type == static_cast<int>(LightType::DIRECTIONAL) &&
             light.shadowData.strength > 0.f) {
@@ -70,18 +73,41 @@ void ShadowMapPass::render(const loo::Scene& scene,
             glm::mat4 lightSpaceMatrix = light.getLightSpaceMatrix(true);
             block.matrices[tileIndex] = lightSpaceMatrix;
             m_opaqueShader.setUniform("lightSpaceMatrix", lightSpaceMatrix);
-            for (auto mesh : scene.getMeshes()) {
-                if (mesh->needAlphaBlend() &&
-                    transparentShadowMode == TransparentShadowMode::AlphaTest)
-                    continue;
-                if (mesh->isDoubleSided()) {
-                    glDisable(GL_CULL_FACE);
+            glm::vec3 lightAxis = glm::normalize(glm::vec3(light.direction));
+            // one cull per light, shared by both sub passes
+            const MeshVisibility* casters = nullptr;
+            if (enableCasterCulling) {
+                Frustum frustum = extractFrustum(lightSpaceMatrix);
+                // casters between the light and the shadow volume are kept,
+                // depth clamp flattens them onto the near plane
+                frustum.disablePlane(FrustumPlane_DepthOne);
+                m_casterCuller.cull(scene, transforms, frustum);
+                casters = &m_casterCuller.getVisibility();
+            }
+            const std::vector<int>* blendCasters = nullptr;
+            if (multiDraw) {
+                const auto& opaqueCasters = filterVisibleDraws(
+                    multiDraw->getOpaqueDraws(), casters, m_opaqueCasterDraws);
+                blendCasters = &filterVisibleDraws(
+                    multiDraw->getBlendDraws(), casters, m_blendCasterDraws);
+                // depth only, textures do not split the draw calls
+                if (transparentShadowMode == TransparentShadowMode::Solid) {
+                    std::vector<int> draws = opaqueCasters;
+                    draws.insert(draws.end(), blendCasters->begin(),
+                                 blendCasters->end());
+                    multiDraw->draw(draws, m_opaqueShader, true, false);
                 } else {
-                    glEnable(GL_CULL_FACE);
-                    glCullFace(GL_BACK);
+                    multiDraw->draw(opaqueCasters, m_opaqueShader, true,
+                                    false);
                 }
-                drawMesh(*mesh, sceneModelMatrix,
-                         scene.getPreviousModelMatrix(), m_opaqueShader);
+            } else {
+                // front to back from the light, materials are not bound
+                renderQueue.build(RenderQueuePass::ShadowOpaque,
+                                  glm::vec3(0.0f), lightAxis, true,
+                                  transparentShadowMode ==
+                                      TransparentShadowMode::Solid,
+                                  casters);
+                renderQueue.submit(m_opaqueShader);
             }
             // if we render in solid mode, no need for special treatment of transparency
             if (transparentShadowMode == TransparentShadowMode::Solid)
@@ -92,18 +118,14 @@ void ShadowMapPass::render(const loo::Scene& scene,
             m_transparentShader.setUniform("alphaTestThreshold",
                                            alphaTestThreshold);
             // second pass render transparent objects using alpha test
-            for (auto mesh : scene.getMeshes()) {
-                if (!mesh->needAlphaBlend())
-                    continue;
-                if (mesh->isDoubleSided()) {
-                    glDisable(GL_CULL_FACE);
-                } else {
-                    glEnable(GL_CULL_FACE);
-                    glCullFace(GL_BACK);
-                }
-                drawMesh(*mesh, sceneModelMatrix,
-                         scene.getPreviousModelMatrix(), m_transparentShader);
+            if (multiDraw) {
+                multiDraw->draw(*blendCasters, m_transparentShader);
+                continue;
             }
+            renderQueue.build(RenderQueuePass::ShadowAlphaTest,
+                              glm::vec3(0.0f), lightAxis, false, true,
+                              casters);
+            renderQueue.submit(m_transparentShader);
         }
     }
     // update shadow matrices
@@ -111,9 +133,10 @@ void ShadowMapPass::render(const loo::Scene& scene,
         .updateData(&block);
     // first pass: render opaque objects
 
+    glDisable(GL_DEPTH_CLAMP);
     m_fb.unbind();
     Application::restoreViewport();
-    Application::endEvent();
+    GPUProfiler::endEvent();
 
     glDepthFunc(GL_LESS);
     glClearDepth(1.0f);
@@ -2,6 +2,8 @@
 #include <loo/Camera.hpp>
 #include <loo/Scene.hpp>
 #include "core/Graphics.hpp"
+#include "core/JobSystem.hpp"
+#include "core/Profiler.hpp"
 #include "shaders/gbuffer.vert.hpp"
 #include "shaders/transparent.frag.hpp"
 
@@ -20,29 +22,94 @@ void TransparentPass::init(const Texture2D& depthStencil,
     m_transparentfb.attachTexture(depthStencil, GL_DEPTH_ATTACHMENT, 0);
     panicPossibleGLError();
 }
-void TransparentPass::render(const Scene& scene, const Skybox& skybox,
+void TransparentPass::render(const Scene& scene,
+                             const TransformCache& transforms,
+                             const Skybox& skybox,
                              const Camera& camera,
                              const Texture2D& mainLightShadowMap,
-                             bool enableCompensation) {
-    Application::beginEvent("Transparent Pass");
+                             bool enableCompensation,
+                             const MeshVisibility* visibility,
+                             MultiDrawScene* multiDraw,
+                             const MeshInstancing* instancing,
+                             const GeometryArena* geometry) {
+    GPUProfiler::beginEvent("Transparent Pass");
     m_transparentfb.bind();
     glEnable(GL_BLEND);
     glDisable(GL_STENCIL_TEST);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    std::vector<std::pair<Mesh*, float>> meshes;
+    // scene mesh index and distance
+    std::vector<std::pair<size_t, float>> meshes;
 
-    for (auto mesh : scene.getMeshes()) {
-        if (mesh->needAlphaBlend()) {
-            glm::vec4 c = glm::vec4(mesh->aabb.getCenter(), 1);
-            c = scene.getModelMatrix() * mesh->objectMatrix * c;
-            float dist = glm::distance(camera.position, glm::vec3(c));
-            meshes.emplace_back(mesh.get(), dist);
-        }
+    const auto& sceneMeshes = scene.getMeshes();
+    // negative for meshes that are not drawn
+    m_distances.resize(sceneMeshes.size());
+    JobSystem::parallelFor(
+        static_cast<int>(sceneMeshes.size()), 256, [&](int first, int last) {
+            for (int i = first; i < last; i++) {
+                const auto& mesh = sceneMeshes[i];
+                m_distances[i] = -1.0f;
+                if ((visibility && !(*visibility)[i]) ||
+                    !mesh->needAlphaBlend())
+                    continue;
+                glm::vec4 c = glm::vec4(mesh->aabb.getCenter(), 1);
+                c = transforms.getWorld(i) * c;
+                m_distances[i] = glm::distance(camera.position, glm::vec3(c));
+            }
+        });
+    for (size_t i = 0; i < sceneMeshes.size(); i++) {
+        if (m_distances[i] >= 0.0f)
+            meshes.emplace_back(i, m_distances[i]);
     }
     // sort transparent meshes, so that further meshes are drawn first
-    std::sort(meshes.begin(), meshes.end(),
-              [](auto& a, auto& b) { return a.second > b.second; });
-    Application::beginEvent("Subpass1 - Alpha Test");
+    JobSystem::parallelSort(
+        meshes.begin(), meshes.end(),
+        [](auto& a, auto& b) { return a.second > b.second; });
+    // back to front order is kept, only neighbours sharing state are merged
+    std::vector<int> draws;
+    if (multiDraw) {
+        draws.reserve(meshes.size());
+        for (auto& p : meshes)
+            draws.push_back(multiDraw->getIndex(sceneMeshes[p.first].get()));
+    }
+    auto prototypeOf = [instancing](size_t mesh) {
+        return instancing ? instancing->getPrototype(mesh)
+                          : static_cast<uint32_t>(mesh);
+    };
+    auto geometryOf = [&](size_t mesh) {
+        return geometry ? geometry->find(sceneMeshes[mesh].get()) : nullptr;
+    };
+    // per mesh path, neighbouring copies of a prototype are drawn instanced
+    auto drawMeshes = [&]() {
+        for (size_t i = 0; i < meshes.size();) {
+            uint32_t prototype = prototypeOf(meshes[i].first);
+            size_t end = i + 1;
+            while (end < meshes.size() &&
+                   prototypeOf(meshes[end].first) == prototype)
+                end++;
+            auto& mesh = sceneMeshes[meshes[i].first];
+            if (mesh->isDoubleSided()) {
+                glDisable(GL_CULL_FACE);
+            } else {
+                glEnable(GL_CULL_FACE);
+                glCullFace(GL_BACK);
+            }
+            if (end - i > 1) {
+                m_instanceMeshes.clear();
+                for (size_t j = i; j < end; j++)
+                    m_instanceMeshes.push_back(
+                        static_cast<uint32_t>(meshes[j].first));
+                drawMeshInstances(*sceneMeshes[prototype], transforms,
+                                  m_instanceMeshes.data(),
+                                  m_instanceMeshes.size(),
+                                  m_transparentShader, geometryOf(prototype));
+            } else {
+                drawMesh(*mesh, transforms, meshes[i].first,
+                         m_transparentShader, geometryOf(meshes[i].first));
+            }
+            i = end;
+        }
+    };
+    GPUProfiler::beginEvent("Subpass1 - Alpha Test");
 
     m_transparentfb.enableAttachments({GL_COLOR_ATTACHMENT0});
 
@@ -63,41 +130,29 @@ void TransparentPass::render(const Scene& scene, const Skybox& skybox,
     m_transparentShader.use();
     // subpass 1: alpha test
     // enable z-write and z-test, discard fragments with alpha < threshold
-    for (auto p : meshes) {
-        auto mesh = p.first;
-        if (mesh->isDoubleSided()) {
-            glDisable(GL_CULL_FACE);
-        } else {
-            glEnable(GL_CULL_FACE);
-            glCullFace(GL_BACK);
-        }
-        drawMesh(*mesh, scene.getModelMatrix(), scene.getPreviousModelMatrix(),
-                 m_transparentShader);
+    if (multiDraw) {
+        multiDraw->draw(draws, m_transparentShader);
+    } else {
+        drawMeshes();
     }
     logPossibleGLError();
 
-    Application::endEvent();
-    Application::beginEvent("Subpass2 - Alpha Blend");
+    GPUProfiler::endEvent();
+    GPUProfiler::beginEvent("Subpass2 - Alpha Blend");
     // subpass 2: alpha blend
     // disable z-write, enable blending
     glDepthMask(GL_FALSE);
     m_transparentShader.setUniform("alphaTest", 0);
-    for (auto p : meshes) {
-        auto mesh = p.first;
-        if (mesh->isDoubleSided()) {
-            glDisable(GL_CULL_FACE);
-        } else {
-            glEnable(GL_CULL_FACE);
-            glCullFace(GL_BACK);
-        }
-        drawMesh(*mesh, scene.getModelMatrix(), scene.getPreviousModelMatrix(),
-                 m_transparentShader);
+    if (multiDraw) {
+        multiDraw->draw(draws, m_transparentShader);
+    } else {
+        drawMeshes();
     }
     logPossibleGLError();
-    Application::endEvent();
+    GPUProfiler::endEvent();
 
     glDepthMask(GL_TRUE);
     glDisable(GL_BLEND);
     glDepthFunc(GL_LESS);
-    Application::endEvent();
+    GPUProfiler::endEvent();
 }
\ No newline at end of file
@@ -0,0 +1,29 @@
+#include <gtest/gtest.h>
+#include "core/CameraPath.hpp"
+
+static void expectNear(const glm::vec3& a, const glm::vec3& b) {
+    EXPECT_NEAR(a.x, b.x, 1e-4f);
+    EXPECT_NEAR(a.y, b.y, 1e-4f);
+    EXPECT_NEAR(a.z, b.z, 1e-4f);
+}
+
+TEST(CameraPathTest, OrbitKeepsRadiusAndTarget) {
+    CameraPose start{glm::vec3(0, 2, 5), glm::vec3(0, 2, 0)};
+    auto path = CameraPath::orbit(start, 360.f);
+    expectNear(path.sample(0.0f).position, start.position);
+    expectNear(path.sample(1.0f).position, start.position);
+    auto half = path.sample(0.5f);
+    expectNear(half.position, glm::vec3(0, 2, -5));
+    expectNear(half.target, start.target);
+}
+
+TEST(CameraPathTest, SplinePassesThroughKeyframes) {
+    std::vector<CameraPose> keys{{glm::vec3(0, 0, 0), glm::vec3(0, 0, -1)},
+                                 {glm::vec3(1, 0, 0), glm::vec3(1, 0, -1)},
+                                 {glm::vec3(2, 1, 0), glm::vec3(2, 0, -1)}};
+    auto path = CameraPath::spline(keys);
+    expectNear(path.sample(0.0f).position, keys[0].position);
+    expectNear(path.sample(0.5f).position, keys[1].position);
+    expectNear(path.sample(1.0f).position, keys[2].position);
+    expectNear(path.sample(1.0f).target, keys[2].target);
+}
@@ -0,0 +1,34 @@
+#include <gtest/gtest.h>
+#include <memory>
+#include "core/ContentRegistry.hpp"
+
+TEST(ContentRegistryTest, SharesDuplicates) {
+    ContentRegistry<int, int> registry;
+    auto a = std::make_shared<int>(1), b = std::make_shared<int>(1),
+         c = std::make_shared<int>(2);
+    EXPECT_EQ(registry.intern(1, a, 100), a);
+    // the same object again is not a duplicate
+    EXPECT_EQ(registry.intern(1, a, 100), a);
+    EXPECT_EQ(registry.getDuplicates(), 0);
+    EXPECT_EQ(registry.intern(1, b, 100), a);
+    EXPECT_EQ(registry.intern(2, c, 50), c);
+    EXPECT_EQ(registry.size(), 2u);
+    EXPECT_EQ(registry.getDuplicates(), 1);
+    EXPECT_EQ(registry.getSavedBytes(), 100u);
+}
+
+TEST(ContentRegistryTest, MaterialKeys) {
+    int texture = 0;
+    MaterialContentKey a{};
+    a.parameters[0] = 0x3f800000;
+    a.textures[0] = &texture;
+    MaterialContentKey b = a;
+    EXPECT_EQ(a, b);
+    // -0.0 and 0.0 compare bitwise
+    b.parameters[1] = 0x80000000;
+    EXPECT_FALSE(a == b);
+    EXPECT_TRUE(a < b || b < a);
+    b = a;
+    b.textures[0] = nullptr;
+    EXPECT_FALSE(a == b);
+}
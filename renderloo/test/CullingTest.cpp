@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include "core/Culling.hpp"
+
+// camera at the origin looking down -z, reverse-Z [0, 1] depth
+static Frustum testFrustum() {
+    glm::mat4 projection =
+        glm::perspectiveRH_ZO(glm::radians(90.0f), 1.0f, 100.0f, 0.1f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0, 0, -1),
+                                 glm::vec3(0, 1, 0));
+    return extractFrustum(projection * view);
+}
+
+TEST(CullingTest, BoxesAgainstFrustum) {
+    AABBBatch boxes;
+    boxes.resize(5);
+    boxes.set(0, {0, 0, -10}, glm::vec3(1));    // in front
+    boxes.set(1, {0, 0, 10}, glm::vec3(1));     // behind
+    boxes.set(2, {-30, 0, -10}, glm::vec3(1));  // left of the frustum
+    boxes.set(3, {0, 0, -200}, glm::vec3(1));   // beyond the far plane
+    boxes.set(4, {-11, 0, -10}, glm::vec3(2));  // crosses the left plane
+    uint8_t visibility[5];
+    cullAABBs(testFrustum(), boxes, visibility);
+    EXPECT_EQ(visibility[0], 1);
+    EXPECT_EQ(visibility[1], 0);
+    EXPECT_EQ(visibility[2], 0);
+    EXPECT_EQ(visibility[3], 0);
+    EXPECT_EQ(visibility[4], 1);
+}
+
+TEST(CullingTest, PartialBatchDoesNotWritePastCount) {
+    AABBBatch boxes;
+    boxes.resize(11);
+    for (size_t i = 0; i < 11; i++)
+        boxes.set(i, {0, 0, -5.0f - i}, glm::vec3(0.5f));
+    std::vector<uint8_t> visibility(16, 7);
+    cullAABBs(testFrustum(), boxes, visibility.data());
+    for (size_t i = 0; i < 11; i++)
+        EXPECT_EQ(visibility[i], 1);
+    for (size_t i = 11; i < 16; i++)
+        EXPECT_EQ(visibility[i], 7);
+}
+
+TEST(CullingTest, TransformedExtent) {
+    AABBBatch boxes;
+    boxes.resize(1);
+    glm::mat4 transform =
+        glm::rotate(glm::translate(glm::mat4(1.0f), glm::vec3(1, 2, 3)),
+                    glm::radians(90.0f), glm::vec3(0, 0, 1));
+    boxes.setTransformed(0, transform, glm::vec3(0), glm::vec3(2, 1, 3));
+    EXPECT_NEAR(boxes.centerX[0], 1.0f, 1e-5f);
+    EXPECT_NEAR(boxes.centerY[0], 2.0f, 1e-5f);
+    EXPECT_NEAR(boxes.centerZ[0], 3.0f, 1e-5f);
+    EXPECT_NEAR(boxes.extentX[0], 1.0f, 1e-5f);
+    EXPECT_NEAR(boxes.extentY[0], 2.0f, 1e-5f);
+    EXPECT_NEAR(boxes.extentZ[0], 3.0f, 1e-5f);
+}
+
+TEST(CullingTest, DisabledNearPlaneKeepsCastersTowardTheLight) {
+    // reverse-Z ortho volume looking down -z, like the directional shadows
+    glm::mat4 lightSpace = glm::ortho(-15.0f, 15.0f, -15.0f, 15.0f, 8.0f,
+                                      -8.0f);
+    AABBBatch boxes;
+    boxes.resize(1);
+    boxes.set(0, {0, 0, 20}, glm::vec3(1));
+    uint8_t visibility[1];
+    Frustum frustum = extractFrustum(lightSpace);
+    cullAABBs(frustum, boxes, visibility);
+    EXPECT_EQ(visibility[0], 0);
+    frustum.disablePlane(FrustumPlane_DepthOne);
+    cullAABBs(frustum, boxes, visibility);
+    EXPECT_EQ(visibility[0], 1);
+}
+
+TEST(CullingTest, FilterVisibleDraws) {
+    MeshVisibility visibility{1, 0, 1, 0};
+    std::vector<int> draws{3, 2, 1, 0}, output;
+    EXPECT_EQ(&filterVisibleDraws(draws, nullptr, output), &draws);
+    EXPECT_EQ(filterVisibleDraws(draws, &visibility, output),
+              (std::vector<int>{2, 0}));
+}
@@ -0,0 +1,56 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "core/FrameSequence.hpp"
+
+namespace fs = std::filesystem;
+
+TEST(FrameSequenceTest, YCbCrLimitedRange) {
+    // black, white, red, blue
+    std::vector<uint8_t> rgb{0, 0, 0, 255, 255, 255, 255, 0, 0, 0, 0, 255};
+    uint8_t y[4], cb[4], cr[4];
+    rgbToYCbCr444(rgb.data(), 4, 1, y, cb, cr);
+    EXPECT_EQ(y[0], 16);
+    EXPECT_EQ(cb[0], 128);
+    EXPECT_EQ(cr[0], 128);
+    EXPECT_EQ(y[1], 235);
+    EXPECT_EQ(cb[1], 128);
+    EXPECT_EQ(cr[1], 128);
+    EXPECT_EQ(y[2], 63);
+    EXPECT_EQ(cr[2], 240);
+    EXPECT_EQ(cb[3], 240);
+}
+
+TEST(FrameSequenceTest, FormatFromPath) {
+    EXPECT_EQ(sequenceFormatFromPath("a.y4m"), SequenceFormat::Y4M);
+    EXPECT_EQ(sequenceFormatFromPath("a.rgb"), SequenceFormat::Raw);
+    EXPECT_EQ(sequenceFormatFromPath("frames"), SequenceFormat::EXR);
+}
+
+TEST(FrameSequenceTest, Y4MStream) {
+    fs::path filename = fs::temp_directory_path() / "renderloo_test.y4m";
+    std::vector<uint8_t> frame(2 * 2 * 3, 255);
+    {
+        FrameSequenceWriter writer(filename, SequenceFormat::Y4M, 30);
+        ASSERT_TRUE(writer.write(2, 2, frame.data()));
+        ASSERT_TRUE(writer.write(2, 2, frame.data()));
+        // size changes are rejected
+        EXPECT_FALSE(writer.write(4, 2, frame.data()));
+    }
+    std::ifstream file(filename, std::ios::binary);
+    std::string bytes((std::istreambuf_iterator<char>(file)),
+                      std::istreambuf_iterator<char>());
+    fs::remove(filename);
+    std::string header =
+        "YUV4MPEG2 W2 H2 F30:1 Ip A1:1 C444 XCOLORRANGE=LIMITED\n";
+    ASSERT_EQ(bytes.size(), header.size() + 2 * (6 + 12));
+    EXPECT_EQ(bytes.substr(0, header.size()), header);
+    EXPECT_EQ(bytes.substr(header.size(), 6), "FRAME\n");
+    // luma plane of a white frame
+    EXPECT_EQ(static_cast<uint8_t>(bytes[header.size() + 6]), 235);
+    EXPECT_EQ(bytes.substr(header.size() + 18, 6), "FRAME\n");
+}
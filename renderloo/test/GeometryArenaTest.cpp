@@ -0,0 +1,38 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include "core/GeometryArena.hpp"
+
+TEST(GeometryArenaTest, ShortIndices) {
+    EXPECT_TRUE(useShortIndices(3));
+    EXPECT_TRUE(useShortIndices(65536));
+    EXPECT_FALSE(useShortIndices(65537));
+    std::vector<uint32_t> indices{0, 1, 65535, 300};
+    std::vector<uint16_t> narrow(indices.size());
+    narrowIndices(indices.data(), indices.size(), narrow.data());
+    EXPECT_EQ(narrow, (std::vector<uint16_t>{0, 1, 65535, 300}));
+}
+
+TEST(GeometryArenaTest, Suballocation) {
+    GeometryAllocator allocator(100, 64);
+    GeometryRange a = allocator.allocate(40, 6, 2);
+    EXPECT_EQ(a.arena, 0u);
+    EXPECT_EQ(a.firstVertex, 0u);
+    EXPECT_EQ(a.indexOffset, 0u);
+    // 32 bit indices start aligned to 4 bytes
+    GeometryRange b = allocator.allocate(50, 12, 4);
+    EXPECT_EQ(b.arena, 0u);
+    EXPECT_EQ(b.firstVertex, 40u);
+    EXPECT_EQ(b.indexOffset, 8u);
+    // out of vertices, opens the next arena
+    GeometryRange c = allocator.allocate(20, 4, 2);
+    EXPECT_EQ(c.arena, 1u);
+    EXPECT_EQ(c.firstVertex, 0u);
+    // larger than the capacity, the arena grows to fit
+    GeometryRange d = allocator.allocate(500, 8, 4);
+    EXPECT_EQ(d.arena, 2u);
+    const auto& arenas = allocator.getArenas();
+    ASSERT_EQ(arenas.size(), 3u);
+    EXPECT_EQ(arenas[0].vertices, 90u);
+    EXPECT_EQ(arenas[0].indexBytes, 20u);
+    EXPECT_EQ(arenas[2].vertexCapacity, 500u);
+}
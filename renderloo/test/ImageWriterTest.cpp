@@ -0,0 +1,51 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <vector>
+#include "core/ImageWriter.hpp"
+
+namespace fs = std::filesystem;
+
+TEST(ImageWriterTest, FlipRows) {
+    std::vector<unsigned char> image{1, 2, 3, 4, 5, 6};
+    flipImageRows(image.data(), 2, 3);
+    EXPECT_EQ(image, (std::vector<unsigned char>{5, 6, 3, 4, 1, 2}));
+}
+
+TEST(ImageWriterTest, EXRLayout) {
+    const int width = 3, height = 2, channels = 3;
+    std::vector<float> pixels(width * height * channels);
+    for (size_t i = 0; i < pixels.size(); i++)
+        pixels[i] = static_cast<float>(i);
+    fs::path filename = fs::temp_directory_path() / "renderloo_test.exr";
+    ASSERT_TRUE(writeEXR(filename, width, height, channels, pixels.data()));
+
+    std::ifstream file(filename, std::ios::binary);
+    std::vector<char> bytes((std::istreambuf_iterator<char>(file)),
+                            std::istreambuf_iterator<char>());
+    fs::remove(filename);
+    ASSERT_GT(bytes.size(), 8u);
+    EXPECT_EQ(static_cast<unsigned char>(bytes[0]), 0x76);
+    EXPECT_EQ(static_cast<unsigned char>(bytes[3]), 0x01);
+
+    const size_t lineBytes = width * channels * 4;
+    const size_t chunks = height * (8 + lineBytes);
+    const size_t chunkStart = bytes.size() - chunks;
+    uint64_t firstOffset = 0;
+    memcpy(&firstOffset, bytes.data() + chunkStart - 8 * height, 8);
+    EXPECT_EQ(firstOffset, chunkStart);
+
+    // channels are stored per line in B, G, R order
+    int32_t y = -1;
+    float firstBlue = -1.f, secondLineRed = -1.f;
+    memcpy(&y, bytes.data() + chunkStart, 4);
+    memcpy(&firstBlue, bytes.data() + chunkStart + 8, 4);
+    memcpy(&secondLineRed,
+           bytes.data() + chunkStart + 8 + lineBytes + 8 + 2 * width * 4, 4);
+    EXPECT_EQ(y, 0);
+    EXPECT_FLOAT_EQ(firstBlue, pixels[2]);
+    EXPECT_FLOAT_EQ(secondLineRed, pixels[width * channels]);
+}
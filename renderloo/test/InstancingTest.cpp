@@ -0,0 +1,44 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include "core/Instancing.hpp"
+#include "core/PBRMaterials.hpp"
+
+TEST(InstancingTest, Groups) {
+    // contents: meshes with the same letter are equal
+    const char contents[] = "abacbad";
+    std::vector<uint64_t> hashes;
+    for (const char* c = contents; *c; c++)
+        hashes.push_back(*c);
+    auto prototypes = groupInstances(
+        hashes, [&](size_t a, size_t b) { return contents[a] == contents[b]; });
+    EXPECT_EQ(prototypes,
+              (std::vector<uint32_t>{0, 1, 0, 3, 1, 0, 6}));
+}
+
+TEST(InstancingTest, HashCollision) {
+    // equal hashes, different content
+    std::vector<uint64_t> hashes(4, 42);
+    const int contents[] = {1, 2, 1, 2};
+    auto prototypes = groupInstances(
+        hashes, [&](size_t a, size_t b) { return contents[a] == contents[b]; });
+    EXPECT_EQ(prototypes, (std::vector<uint32_t>{0, 1, 0, 1}));
+    // nothing equal, every mesh is its own prototype
+    prototypes = groupInstances(hashes, [](size_t, size_t) { return false; });
+    EXPECT_EQ(prototypes, (std::vector<uint32_t>{0, 1, 2, 3}));
+}
+
+TEST(InstancingTest, SameMaterial) {
+    PBRMetallicMaterial a(glm::vec4(1.0f), 0.5f, 0.5f, glm::vec3(0.0f), 0);
+    PBRMetallicMaterial b(glm::vec4(1.0f), 0.5f, 0.5f, glm::vec3(0.0f), 0);
+    PBRMetallicMaterial rougher(glm::vec4(1.0f), 0.5f, 0.75f,
+                                glm::vec3(0.0f), 0);
+    PBRMetallicMaterial doubleSided(glm::vec4(1.0f), 0.5f, 0.5f,
+                                    glm::vec3(0.0f),
+                                    loo::LOO_MATERIAL_FLAG_DOUBLE_SIDED);
+    EXPECT_TRUE(isSameMaterial(&a, &a));
+    EXPECT_TRUE(isSameMaterial(&a, &b));
+    EXPECT_FALSE(isSameMaterial(&a, &rougher));
+    EXPECT_FALSE(isSameMaterial(&a, &doubleSided));
+    EXPECT_TRUE(isSameMaterial(nullptr, nullptr));
+    EXPECT_FALSE(isSameMaterial(&a, nullptr));
+}
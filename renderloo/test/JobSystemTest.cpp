@@ -0,0 +1,93 @@
+#include <gtest/gtest.h>
+#include <numeric>
+#include <random>
+#include "core/JobSystem.hpp"
+
+class JobSystemTest : public ::testing::Test {
+   protected:
+    static void SetUpTestSuite() { JobSystem::init(3); }
+};
+
+TEST_F(JobSystemTest, ParallelForVisitsEveryIndexOnce) {
+    std::vector<std::atomic<int>> visits(10000);
+    JobSystem::parallelFor(static_cast<int>(visits.size()), 64,
+                           [&](int first, int last) {
+                               for (int i = first; i < last; i++)
+                                   visits[i]++;
+                           });
+    for (auto& v : visits)
+        ASSERT_EQ(v.load(), 1);
+}
+
+TEST_F(JobSystemTest, NestedParallelFor) {
+    std::atomic<int> sum{0};
+    JobSystem::parallelFor(16, 1, [&](int first, int last) {
+        for (int i = first; i < last; i++) {
+            JobSystem::parallelFor(100, 10, [&](int begin, int end) {
+                sum += end - begin;
+            });
+        }
+    });
+    EXPECT_EQ(sum.load(), 1600);
+}
+
+TEST_F(JobSystemTest, DependenciesRunInOrder) {
+    std::vector<int> order;
+    std::mutex mutex;
+    auto record = [&](int value) {
+        return [&, value] {
+            std::lock_guard<std::mutex> lock(mutex);
+            order.push_back(value);
+        };
+    };
+    // a -> b, a -> c, (b, c) -> d
+    JobHandle a = JobSystem::createJob(record(0)),
+              b = JobSystem::createJob(record(1)),
+              c = JobSystem::createJob(record(1)),
+              d = JobSystem::createJob(record(2));
+    JobSystem::addDependency(a, b);
+    JobSystem::addDependency(a, c);
+    JobSystem::addDependency(b, d);
+    JobSystem::addDependency(c, d);
+    JobSystem::submit(d);
+    JobSystem::submit(c);
+    JobSystem::submit(b);
+    JobSystem::submit(a);
+    JobSystem::wait(d);
+    ASSERT_EQ(order.size(), 4u);
+    EXPECT_TRUE(std::is_sorted(order.begin(), order.end()));
+}
+
+TEST_F(JobSystemTest, DependencyOnFinishedJob) {
+    JobHandle a = JobSystem::createJob([] {});
+    JobSystem::submit(a);
+    JobSystem::wait(a);
+    bool ran = false;
+    JobHandle b = JobSystem::createJob([&] { ran = true; });
+    JobSystem::addDependency(a, b);
+    JobSystem::submit(b);
+    JobSystem::wait(b);
+    EXPECT_TRUE(ran);
+}
+
+TEST_F(JobSystemTest, ParallelSort) {
+    std::vector<int> values(20000);
+    std::iota(values.begin(), values.end(), 0);
+    std::shuffle(values.begin(), values.end(), std::mt19937(7));
+    JobSystem::parallelSort(values.begin(), values.end(), std::less<int>(),
+                            1000);
+    for (int i = 0; i < static_cast<int>(values.size()); i++)
+        ASSERT_EQ(values[i], i);
+}
+
+TEST_F(JobSystemTest, Statistics) {
+    JobSystem::newFrame();
+    JobSystem::parallelFor(1000, 10, [](int, int) {});
+    JobSystem::newFrame();
+    const JobStatistics& statistics = JobSystem::getStatistics();
+    EXPECT_EQ(statistics.workers, 3);
+    EXPECT_GT(statistics.jobs, 0);
+    EXPECT_GE(statistics.stealRate, 0.f);
+    EXPECT_LE(statistics.stealRate, 1.f);
+    EXPECT_GE(statistics.utilization, 0.f);
+}
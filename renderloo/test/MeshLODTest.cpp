@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <set>
+#include <vector>
+#include "core/MeshLOD.hpp"
+
+// n x n quads on z = height(x, y)
+template <typename Height>
+static void grid(int n, Height height, std::vector<glm::vec3>& positions,
+                 std::vector<uint32_t>& indices) {
+    for (int y = 0; y <= n; y++) {
+        for (int x = 0; x <= n; x++)
+            positions.emplace_back(x, y, height(x, y));
+    }
+    for (int y = 0; y < n; y++) {
+        for (int x = 0; x < n; x++) {
+            uint32_t i = y * (n + 1) + x;
+            indices.insert(indices.end(), {i, i + 1, i + n + 1, i + 1,
+                                           i + n + 2, i + n + 1});
+        }
+    }
+}
+
+TEST(MeshLODTest, FlatGridKeepsBorder) {
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices;
+    const int n = 16;
+    grid(n, [](int, int) { return 0.f; }, positions, indices);
+    MeshSimplifier simplifier(positions, indices);
+    simplifier.simplify(0, 0.01f);
+    const auto& simplified = simplifier.getIndices();
+    EXPECT_LT(simplified.size(), indices.size() / 4);
+    EXPECT_FLOAT_EQ(simplifier.getError(), 0.f);
+    // border vertices are locked
+    std::set<uint32_t> used(simplified.begin(), simplified.end());
+    for (int i = 0; i <= n; i++) {
+        EXPECT_TRUE(used.count(i));
+        EXPECT_TRUE(used.count(n * (n + 1) + i));
+        EXPECT_TRUE(used.count(i * (n + 1)));
+    }
+    // still facing +z
+    for (size_t i = 0; i < simplified.size(); i += 3) {
+        glm::vec3 normal = glm::cross(
+            positions[simplified[i + 1]] - positions[simplified[i]],
+            positions[simplified[i + 2]] - positions[simplified[i]]);
+        EXPECT_GT(normal.z, 0.f);
+    }
+}
+
+TEST(MeshLODTest, Levels) {
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices;
+    grid(
+        48,
+        [](int x, int y) {
+            return 2.f * std::sin(x * 0.2f) * std::cos(y * 0.15f);
+        },
+        positions, indices);
+    MeshLODs lods = generateMeshLODs(positions, indices);
+    ASSERT_GE(lods.getLevelCount(), 3);
+    uint32_t previous = static_cast<uint32_t>(indices.size());
+    float error = 0.f;
+    for (auto& level : lods.levels) {
+        EXPECT_LE(level.indexCount, previous * MESH_LOD_MIN_REDUCTION);
+        EXPECT_GE(level.error, error);
+        EXPECT_LE(level.firstIndex + level.indexCount, lods.indices.size());
+        previous = level.indexCount;
+        error = level.error;
+    }
+    for (uint32_t index : lods.indices)
+        EXPECT_LT(index, positions.size());
+    // small meshes are left alone
+    std::vector<glm::vec3> small;
+    std::vector<uint32_t> smallIndices;
+    grid(4, [](int, int) { return 0.f; }, small, smallIndices);
+    EXPECT_EQ(generateMeshLODs(small, smallIndices).getLevelCount(), 1);
+}
+
+TEST(MeshLODTest, Selection) {
+    MeshLODs lods;
+    lods.levels = {{0, 30, 0.01f}, {30, 15, 0.1f}, {45, 6, 1.f}};
+    EXPECT_EQ(selectMeshLOD(lods, 1000.f, 1.f), 0);
+    EXPECT_EQ(selectMeshLOD(lods, 100.f, 1.f), 1);
+    EXPECT_EQ(selectMeshLOD(lods, 100.f, 10.f), 2);
+    EXPECT_EQ(selectMeshLOD(lods, 0.5f, 1.f), 3);
+    glm::mat4 world(2.f);
+    world[3] = glm::vec4(0.f, 0.f, -10.f, 1.f);
+    // sphere of radius 2 at distance 10, 8 to its surface
+    EXPECT_FLOAT_EQ(getLODPixelScale(world, glm::vec3(0.f), 1.f,
+                                     glm::vec3(0.f), 400.f),
+                    100.f);
+    // inside the sphere
+    EXPECT_GT(getLODPixelScale(world, glm::vec3(0.f), 1.f,
+                               glm::vec3(0.f, 0.f, -9.f), 400.f),
+              1e30f);
+}
@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <array>
+#include <random>
+#include <tuple>
+#include <vector>
+#include "core/MeshOptimizer.hpp"
+
+struct TestVertex {
+    glm::vec3 position;
+};
+
+// n x n quads, triangles shuffled
+static void shuffledGrid(int n, std::vector<TestVertex>& vertices,
+                         std::vector<uint32_t>& indices) {
+    for (int y = 0; y <= n; y++) {
+        for (int x = 0; x <= n; x++)
+            vertices.push_back({glm::vec3(x, y, 0)});
+    }
+    std::vector<std::array<uint32_t, 3>> triangles;
+    for (int y = 0; y < n; y++) {
+        for (int x = 0; x < n; x++) {
+            uint32_t i = y * (n + 1) + x;
+            triangles.push_back({i, i + 1, i + n + 1});
+            triangles.push_back({i + 1, i + n + 2, i + n + 1});
+        }
+    }
+    std::shuffle(triangles.begin(), triangles.end(), std::mt19937(7));
+    for (auto& triangle : triangles)
+        indices.insert(indices.end(), triangle.begin(), triangle.end());
+}
+
+static std::vector<std::array<glm::vec3, 3>> sortedTriangles(
+    const std::vector<TestVertex>& vertices,
+    const std::vector<uint32_t>& indices) {
+    std::vector<std::array<glm::vec3, 3>> triangles;
+    for (size_t i = 0; i < indices.size(); i += 3)
+        triangles.push_back({vertices[indices[i]].position,
+                             vertices[indices[i + 1]].position,
+                             vertices[indices[i + 2]].position});
+    auto less = [](const glm::vec3& a, const glm::vec3& b) {
+        return std::tie(a.x, a.y, a.z) < std::tie(b.x, b.y, b.z);
+    };
+    std::sort(triangles.begin(), triangles.end(),
+              [&](const auto& a, const auto& b) {
+                  return std::lexicographical_compare(a.begin(), a.end(),
+                                                      b.begin(), b.end(), less);
+              });
+    return triangles;
+}
+
+TEST(MeshOptimizerTest, CacheStatistics) {
+    // two triangles sharing an edge
+    std::vector<uint32_t> indices{0, 1, 2, 2, 1, 3};
+    auto statistics = analyzeVertexCache(indices.data(), indices.size(), 4);
+    EXPECT_EQ(statistics.triangles, 2u);
+    EXPECT_EQ(statistics.vertices, 4u);
+    EXPECT_EQ(statistics.transformed, 4u);
+    EXPECT_FLOAT_EQ(statistics.getACMR(), 2.f);
+    EXPECT_FLOAT_EQ(statistics.getATVR(), 1.f);
+}
+
+TEST(MeshOptimizerTest, ImprovesShuffledGrid) {
+    std::vector<TestVertex> vertices;
+    std::vector<uint32_t> indices;
+    shuffledGrid(32, vertices, indices);
+    auto original = sortedTriangles(vertices, indices);
+    auto statistics = optimizeMesh(vertices, indices);
+    EXPECT_GT(statistics.before.getACMR(), 2.f);
+    EXPECT_LT(statistics.after.getACMR(), 1.f);
+    EXPECT_LT(statistics.after.getATVR(), statistics.before.getATVR());
+    EXPECT_EQ(statistics.after.vertices, vertices.size());
+    // same triangles, only the order and the numbering changed
+    EXPECT_EQ(sortedTriangles(vertices, indices), original);
+}
+
+TEST(MeshOptimizerTest, FetchOrderFollowsFirstUse) {
+    std::vector<uint32_t> indices{3, 1, 4, 4, 1, 0};
+    auto remap = optimizeVertexFetch(indices.data(), indices.size(), 6);
+    EXPECT_EQ(indices, (std::vector<uint32_t>{0, 1, 2, 2, 1, 3}));
+    // the unreferenced vertices 2 and 5 go last
+    EXPECT_EQ(remap, (std::vector<uint32_t>{3, 1, 4, 0, 2, 5}));
+}
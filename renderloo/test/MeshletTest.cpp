@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <set>
+#include <vector>
+#include "core/Meshlet.hpp"
+
+// n x n quads on z = height(x, y), facing +z
+template <typename Height>
+static void grid(int n, Height height, std::vector<glm::vec3>& positions,
+                 std::vector<uint32_t>& indices) {
+    for (int y = 0; y <= n; y++) {
+        for (int x = 0; x <= n; x++)
+            positions.emplace_back(x, y, height(x, y));
+    }
+    for (int y = 0; y < n; y++) {
+        for (int x = 0; x < n; x++) {
+            uint32_t i = y * (n + 1) + x;
+            indices.insert(indices.end(), {i, i + 1, i + n + 1, i + 1,
+                                           i + n + 2, i + n + 1});
+        }
+    }
+}
+
+TEST(MeshletTest, Limits) {
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices;
+    grid(
+        64, [](int x, int y) { return std::sin(x * 0.3f) + y * 0.1f; },
+        positions, indices);
+    std::vector<Meshlet> meshlets = buildMeshlets(positions, indices);
+    ASSERT_FALSE(meshlets.empty());
+    uint32_t next = 0;
+    for (auto& meshlet : meshlets) {
+        // consecutive ranges covering every triangle
+        EXPECT_EQ(meshlet.firstIndex, next);
+        EXPECT_EQ(meshlet.indexCount % 3, 0u);
+        EXPECT_LE(meshlet.indexCount / 3, MESHLET_MAX_TRIANGLES);
+        next = meshlet.firstIndex + meshlet.indexCount;
+        std::set<uint32_t> vertices(
+            indices.begin() + meshlet.firstIndex,
+            indices.begin() + meshlet.firstIndex + meshlet.indexCount);
+        EXPECT_LE(vertices.size(), MESHLET_MAX_VERTICES);
+        for (uint32_t vertex : vertices) {
+            EXPECT_LE(glm::length(positions[vertex] - meshlet.center),
+                      meshlet.radius * 1.0001f);
+        }
+    }
+    EXPECT_EQ(next, indices.size());
+}
+
+TEST(MeshletTest, BackfaceCone) {
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices;
+    grid(16, [](int, int) { return 0.f; }, positions, indices);
+    std::vector<Meshlet> meshlets = buildMeshlets(positions, indices);
+    ASSERT_FALSE(meshlets.empty());
+    for (auto& meshlet : meshlets) {
+        EXPECT_NEAR(meshlet.coneAxis.z, 1.f, 1e-5f);
+        EXPECT_NEAR(meshlet.coneCutoff, 0.f, 1e-3f);
+        EXPECT_TRUE(isMeshletBackfacing(meshlet, glm::vec3(8.f, 8.f, -20.f)));
+        EXPECT_FALSE(isMeshletBackfacing(meshlet, glm::vec3(8.f, 8.f, 20.f)));
+        // just below the plane, within the conservative margin
+        EXPECT_FALSE(
+            isMeshletBackfacing(meshlet, glm::vec3(100.f, 8.f, -0.5f)));
+    }
+    // opposite faces never cull
+    std::vector<glm::vec3> box{{0, 0, 0}, {1, 0, 0}, {0, 1, 0},
+                               {0, 0, 1}, {1, 0, 1}, {0, 1, 1}};
+    std::vector<uint32_t> sides{0, 2, 1, 3, 4, 5};
+    Meshlet both = buildMeshlets(box, sides).front();
+    EXPECT_EQ(both.coneCutoff, 1.f);
+    EXPECT_FALSE(isMeshletBackfacing(both, glm::vec3(0.2f, 0.2f, -10.f)));
+    EXPECT_FALSE(isMeshletBackfacing(both, glm::vec3(0.2f, 0.2f, 10.f)));
+}
@@ -0,0 +1,54 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include "core/RenderQueue.hpp"
+
+// pass and cull mode are equal, material separates the runs
+static RenderItem makeItem(uint32_t mesh, uint32_t material, uint32_t depth) {
+    return RenderItem{makeSortKey(0, false, material, 0, depth), nullptr,
+                      mesh, 0};
+}
+
+static std::vector<uint32_t> meshesOf(const std::vector<RenderItem>& items) {
+    std::vector<uint32_t> meshes;
+    for (auto& item : items)
+        meshes.push_back(item.meshIndex);
+    return meshes;
+}
+
+TEST(RenderQueueTest, GatherInstances) {
+    // 2, 4, 6 and 7 copy mesh 0, 5 copies mesh 1
+    const std::vector<uint32_t> prototypes{0, 1, 0, 3, 0, 1, 0, 0, 8};
+    std::vector<RenderItem> items{
+        makeItem(0, 0, 0), makeItem(1, 0, 1), makeItem(2, 0, 2),
+        makeItem(3, 0, 3), makeItem(4, 0, 4), makeItem(5, 0, 5),
+        makeItem(6, 1, 0), makeItem(8, 1, 1), makeItem(7, 1, 2)};
+    InstanceGatherer gatherer;
+    gatherer.gather(items, prototypes);
+    // copies follow the front most item of their run, the first items keep
+    // their order and copies never leave their run
+    EXPECT_EQ(meshesOf(items),
+              (std::vector<uint32_t>{0, 2, 4, 1, 5, 3, 6, 7, 8}));
+
+    // runs start at the same index again, nothing of the last call remains
+    items = {makeItem(3, 0, 0), makeItem(5, 0, 1), makeItem(1, 0, 2)};
+    gatherer.gather(items, prototypes);
+    EXPECT_EQ(meshesOf(items), (std::vector<uint32_t>{3, 5, 1}));
+    items = {makeItem(1, 0, 0), makeItem(3, 0, 1), makeItem(5, 0, 2)};
+    gatherer.gather(items, prototypes);
+    EXPECT_EQ(meshesOf(items), (std::vector<uint32_t>{1, 5, 3}));
+}
+
+TEST(RenderQueueTest, InstanceRunsSplitAtLODLevels) {
+    const std::vector<uint32_t> prototypes{0, 1, 0, 3, 0, 1};
+    std::vector<RenderItem> items{makeItem(0, 0, 0), makeItem(2, 0, 1),
+                                  makeItem(4, 0, 2), makeItem(1, 0, 3),
+                                  makeItem(5, 0, 4), makeItem(3, 0, 5)};
+    EXPECT_EQ(findInstanceRunEnd(items, 0, prototypes, nullptr), 3u);
+    EXPECT_EQ(findInstanceRunEnd(items, 3, prototypes, nullptr), 5u);
+    EXPECT_EQ(findInstanceRunEnd(items, 5, prototypes, nullptr), 6u);
+    // mesh 4 is drawn at another level than the copies before it
+    const std::vector<uint8_t> lodLevels{0, 1, 0, 0, 1, 1};
+    EXPECT_EQ(findInstanceRunEnd(items, 0, prototypes, &lodLevels), 2u);
+    EXPECT_EQ(findInstanceRunEnd(items, 2, prototypes, &lodLevels), 3u);
+    EXPECT_EQ(findInstanceRunEnd(items, 3, prototypes, &lodLevels), 5u);
+}
@@ -0,0 +1,79 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <fstream>
+#include "core/MappedFile.hpp"
+#include "core/SceneCache.hpp"
+
+namespace fs = std::filesystem;
+
+static fs::path writeFile(const fs::path& path, const std::string& content) {
+    fs::create_directories(path.parent_path());
+    std::ofstream(path, std::ios::binary) << content;
+    return path;
+}
+
+TEST(SceneCacheTest, MappedFile) {
+    fs::path path = writeFile(
+        fs::temp_directory_path() / "renderloo_test" / "mapped.bin", "a");
+    MappedFile file(path);
+    ASSERT_TRUE(file.isOpen());
+    ASSERT_EQ(file.size(), 1u);
+    EXPECT_EQ(file.data()[0], 'a');
+    EXPECT_EQ(hashBytes(file.data(), file.size()), 0xaf63dc4c8601ec8cull);
+    MappedFile moved(std::move(file));
+    EXPECT_FALSE(file.isOpen());
+    EXPECT_TRUE(moved.isOpen());
+    EXPECT_FALSE(MappedFile(path.parent_path() / "missing.bin").isOpen());
+}
+
+TEST(SceneCacheTest, KeyValidation) {
+    fs::path path = writeFile(
+        fs::temp_directory_path() / "renderloo_test" / "model.gltf", "abcd");
+    auto key = makeSceneCacheKey(path);
+    ASSERT_TRUE(key.has_value());
+    EXPECT_TRUE(isSceneCacheKeyValid(*key, path));
+    // touched only, the content hash still matches
+    fs::last_write_time(path,
+                        fs::last_write_time(path) + std::chrono::hours(1));
+    EXPECT_TRUE(isSceneCacheKeyValid(*key, path));
+    writeFile(path, "abce");
+    EXPECT_FALSE(isSceneCacheKeyValid(*key, path));
+    writeFile(path, "abcde");
+    EXPECT_FALSE(isSceneCacheKeyValid(*key, path));
+    fs::remove(path);
+    EXPECT_FALSE(isSceneCacheKeyValid(*key, path));
+}
+
+TEST(SceneCacheTest, KeyCoversExternalFiles) {
+    fs::path directory = fs::temp_directory_path() / "renderloo_test" / "deps";
+    fs::remove_all(directory);
+    fs::path gltf = writeFile(directory / "model.gltf", "{}"),
+             glb = writeFile(directory / "model.glb", "glTF"),
+             buffer = writeFile(directory / "model.bin", "abcd");
+    writeFile(directory / "textures" / "albedo.png", "png");
+    auto gltfKey = makeSceneCacheKey(gltf), glbKey = makeSceneCacheKey(glb);
+    ASSERT_TRUE(gltfKey && glbKey);
+    EXPECT_TRUE(isSceneCacheKeyValid(*gltfKey, gltf));
+    // the files next to a .gltf are part of its identity, a .glb is alone
+    writeFile(buffer, "abcde");
+    EXPECT_FALSE(isSceneCacheKeyValid(*gltfKey, gltf));
+    EXPECT_TRUE(isSceneCacheKeyValid(*glbKey, glb));
+    gltfKey = makeSceneCacheKey(gltf);
+    writeFile(directory / "textures" / "albedo.png", "jpg");
+    fs::last_write_time(directory / "textures" / "albedo.png",
+                        fs::last_write_time(buffer) + std::chrono::hours(1));
+    EXPECT_FALSE(isSceneCacheKeyValid(*gltfKey, gltf));
+    // the scene cache itself does not count
+    gltfKey = makeSceneCacheKey(gltf);
+    writeFile(directory / ".cache" / "scenes" / "model.scene", "cache");
+    EXPECT_TRUE(isSceneCacheKeyValid(*gltfKey, gltf));
+    fs::remove_all(directory);
+}
+
+TEST(SceneCacheTest, PathPerSource) {
+    fs::path a = fs::path("models") / "a" / "scene.glb",
+             b = fs::path("models") / "b" / "scene.glb";
+    EXPECT_NE(getSceneCachePath(a), getSceneCachePath(b));
+    EXPECT_EQ(getSceneCachePath(a), getSceneCachePath(fs::absolute(a)));
+    EXPECT_EQ(getSceneCachePath(a).extension(), ".scene");
+}
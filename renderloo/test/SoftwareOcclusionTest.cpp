@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+#include "core/SoftwareOcclusion.hpp"
+
+static std::vector<float> emptyBuffer() {
+    return std::vector<float>(
+        SOFTWARE_OCCLUSION_WIDTH * SOFTWARE_OCCLUSION_HEIGHT, 0.0f);
+}
+
+static void rasterize(const OcclusionTriangle& triangle,
+                      std::vector<float>& buffer) {
+    rasterizeOcclusionTriangle(triangle, 0, SOFTWARE_OCCLUSION_HEIGHT,
+                               buffer.data());
+}
+
+TEST(SoftwareOcclusionTest, RejectsDegenerateTriangles) {
+    OcclusionTriangle triangle;
+    EXPECT_FALSE(setupOcclusionTriangle({0, 0, 0.5f}, {10, 10, 0.5f},
+                                        {20, 20, 0.5f}, triangle));
+    // entirely off screen
+    EXPECT_FALSE(setupOcclusionTriangle({-30, 0, 0.5f}, {-10, 0, 0.5f},
+                                        {-20, 20, 0.5f}, triangle));
+}
+
+TEST(SoftwareOcclusionTest, PixelCenterCoverage) {
+    auto buffer = emptyBuffer();
+    OcclusionTriangle triangle;
+    // clockwise on purpose, both windings are rasterized
+    ASSERT_TRUE(setupOcclusionTriangle({10, 10, 0.5f}, {10, 50, 0.5f},
+                                       {50, 10, 0.5f}, triangle));
+    rasterize(triangle, buffer);
+    auto at = [&](int x, int y) {
+        return buffer[y * SOFTWARE_OCCLUSION_WIDTH + x];
+    };
+    EXPECT_FLOAT_EQ(at(15, 15), 0.5f);
+    EXPECT_FLOAT_EQ(at(10, 20), 0.5f);
+    EXPECT_FLOAT_EQ(at(29, 29), 0.5f);
+    EXPECT_EQ(at(9, 20), 0.0f);
+    EXPECT_EQ(at(30, 30), 0.0f);
+    EXPECT_EQ(at(60, 15), 0.0f);
+}
+
+TEST(SoftwareOcclusionTest, DepthIsNeverNearerThanTheTriangle) {
+    auto buffer = emptyBuffer();
+    OcclusionTriangle triangle;
+    // depth falls from 0.9 at the left to 0.1 at the right
+    ASSERT_TRUE(setupOcclusionTriangle({0, 0, 0.9f}, {100, 0, 0.1f},
+                                       {0, 100, 0.9f}, triangle));
+    rasterize(triangle, buffer);
+    for (int x = 1; x < 90; x++) {
+        float exact = 0.9f - 0.8f * (x + 0.5f) / 100.0f;
+        float stored = buffer[10 * SOFTWARE_OCCLUSION_WIDTH + x];
+        if (stored > 0.0f) {
+            EXPECT_LE(stored, exact + 1e-5f) << x;
+        }
+    }
+}
+
+static void erode(std::vector<float>& buffer) {
+    std::vector<float> scratch(buffer.size());
+    erodeOcclusionRows(buffer.data(), 0, SOFTWARE_OCCLUSION_HEIGHT,
+                       scratch.data());
+    erodeOcclusionColumns(scratch.data(), 0, SOFTWARE_OCCLUSION_HEIGHT,
+                          buffer.data());
+}
+
+TEST(SoftwareOcclusionTest, ErosionDropsPartlyCoveredPixels) {
+    auto buffer = emptyBuffer();
+    OcclusionTriangle triangle;
+    ASSERT_TRUE(setupOcclusionTriangle({10, 10, 0.5f}, {10, 50, 0.5f},
+                                       {50, 10, 0.5f}, triangle));
+    rasterize(triangle, buffer);
+    auto at = [&](int x, int y) {
+        return buffer[y * SOFTWARE_OCCLUSION_WIDTH + x];
+    };
+    // centers on the long edge, half of the pixel is outside
+    EXPECT_FLOAT_EQ(at(30, 29), 0.5f);
+    EXPECT_FLOAT_EQ(at(29, 30), 0.5f);
+    erode(buffer);
+    EXPECT_EQ(at(30, 29), 0.0f);
+    EXPECT_EQ(at(29, 30), 0.0f);
+    EXPECT_FLOAT_EQ(at(15, 15), 0.5f);
+    EXPECT_FLOAT_EQ(at(11, 20), 0.5f);
+    EXPECT_FLOAT_EQ(at(28, 29), 0.5f);
+}
+
+TEST(SoftwareOcclusionTest, ErosionKeepsSharedEdgesAndBorders) {
+    auto buffer = emptyBuffer();
+    OcclusionTriangle first, second;
+    // depth rises to the right, eroded pixels take the farthest neighbour
+    glm::vec3 a{0, 0, 0.2f}, b{128, 0, 0.8f}, c{128, 128, 0.8f},
+        d{0, 128, 0.2f};
+    ASSERT_TRUE(setupOcclusionTriangle(a, b, c, first));
+    ASSERT_TRUE(setupOcclusionTriangle(a, c, d, second));
+    rasterize(first, buffer);
+    rasterize(second, buffer);
+    auto rasterized = buffer;
+    erode(buffer);
+    auto at = [](const std::vector<float>& buffer, int x, int y) {
+        return buffer[y * SOFTWARE_OCCLUSION_WIDTH + x];
+    };
+    for (int i = 1; i < 126; i++) {
+        // the diagonal both triangles share
+        EXPECT_GT(at(buffer, i, i), 0.0f) << i;
+        EXPECT_FLOAT_EQ(at(buffer, i, i), at(rasterized, i - 1, i)) << i;
+    }
+    // the buffer borders are not an edge of the occluder
+    EXPECT_GT(at(buffer, 0, 0), 0.0f);
+    EXPECT_GT(at(buffer, 60, SOFTWARE_OCCLUSION_HEIGHT - 1), 0.0f);
+    // next to the uncovered right half
+    EXPECT_GT(at(buffer, 126, 60), 0.0f);
+    EXPECT_EQ(at(buffer, 127, 60), 0.0f);
+}
+
+TEST(SoftwareOcclusionTest, RectangleTests) {
+    auto buffer = emptyBuffer();
+    OcclusionTriangle first, second;
+    // near quad over the left half of the buffer, no holes along the
+    // shared edge
+    glm::vec3 a{0, 0, 0.8f}, b{128, 0, 0.8f}, c{128, 128, 0.8f},
+        d{0, 128, 0.8f};
+    ASSERT_TRUE(setupOcclusionTriangle(a, b, c, first));
+    ASSERT_TRUE(setupOcclusionTriangle(a, c, d, second));
+    rasterize(first, buffer);
+    rasterize(second, buffer);
+    // behind the quad
+    EXPECT_TRUE(isRectOccluded(buffer.data(), 20, 20, 60, 60, 0.3f));
+    // in front of the quad
+    EXPECT_FALSE(isRectOccluded(buffer.data(), 20, 20, 60, 60, 0.9f));
+    // partly outside of it
+    EXPECT_FALSE(isRectOccluded(buffer.data(), 100, 20, 160, 60, 0.3f));
+}
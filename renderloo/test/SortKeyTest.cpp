@@ -0,0 +1,33 @@
+#include <gtest/gtest.h>
+#include "core/SortKey.hpp"
+
+TEST(SortKeyTest, FieldsOrderBySignificance) {
+    // pass dominates everything below it
+    EXPECT_LT(makeSortKey(0, true, 100, 100, 100),
+              makeSortKey(1, false, 0, 0, 0));
+    // single sided before double sided
+    EXPECT_LT(makeSortKey(0, false, 100, 100, 100),
+              makeSortKey(0, true, 0, 0, 0));
+    EXPECT_LT(makeSortKey(0, false, 1, 100, 100),
+              makeSortKey(0, false, 2, 0, 0));
+    EXPECT_LT(makeSortKey(0, false, 1, 1, 100),
+              makeSortKey(0, false, 1, 2, 0));
+    EXPECT_LT(makeSortKey(0, false, 1, 1, 1), makeSortKey(0, false, 1, 1, 2));
+}
+
+TEST(SortKeyTest, FieldsDoNotOverlap) {
+    constexpr uint32_t depthMax = (1u << SORT_KEY_DEPTH_BITS) - 1;
+    EXPECT_EQ(makeSortKey(0, false, 0, 0, depthMax + 1), 0u);
+    EXPECT_LT(makeSortKey(0, false, 0, 0, depthMax),
+              makeSortKey(0, false, 0, 1, 0));
+    EXPECT_EQ(makeSortKey(7, true, ~0u, ~0u, ~0u), ~uint64_t(0));
+}
+
+TEST(SortKeyTest, QuantizeDepthClamps) {
+    constexpr uint32_t depthMax = (1u << SORT_KEY_DEPTH_BITS) - 1;
+    EXPECT_EQ(quantizeSortDepth(-1.0f), 0u);
+    EXPECT_EQ(quantizeSortDepth(0.0f), 0u);
+    EXPECT_EQ(quantizeSortDepth(1.0f), depthMax);
+    EXPECT_EQ(quantizeSortDepth(2.0f), depthMax);
+    EXPECT_LT(quantizeSortDepth(0.25f), quantizeSortDepth(0.5f));
+}
@@ -0,0 +1,24 @@
+#include <gtest/gtest.h>
+#include "core/Statistics.hpp"
+
+TEST(StatisticsTest, PercentileInterpolates) {
+    std::vector<double> samples{4.0, 1.0, 3.0, 2.0, 5.0};
+    EXPECT_DOUBLE_EQ(percentile(samples, 0.0), 1.0);
+    EXPECT_DOUBLE_EQ(percentile(samples, 50.0), 3.0);
+    EXPECT_DOUBLE_EQ(percentile(samples, 100.0), 5.0);
+    EXPECT_DOUBLE_EQ(percentile(samples, 12.5), 1.5);
+}
+
+TEST(StatisticsTest, SummarizeEmptyAndFilled) {
+    EXPECT_EQ(summarize({}).count, 0);
+    std::vector<double> samples;
+    for (int i = 1; i <= 100; i++)
+        samples.push_back(i);
+    auto summary = summarize(samples);
+    EXPECT_EQ(summary.count, 100);
+    EXPECT_DOUBLE_EQ(summary.mean, 50.5);
+    EXPECT_DOUBLE_EQ(summary.min, 1.0);
+    EXPECT_DOUBLE_EQ(summary.max, 100.0);
+    EXPECT_NEAR(summary.p95, 95.05, 1e-9);
+    EXPECT_NEAR(summary.p99, 99.01, 1e-9);
+}
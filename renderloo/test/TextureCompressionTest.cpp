@@ -0,0 +1,62 @@
+#include <gtest/gtest.h>
+#include <cstdlib>
+#include <vector>
+#include "core/TextureCompression.hpp"
+
+TEST(TextureCompressionTest, BC4TwoValuesAreExact) {
+    uint8_t values[16], block[8], decoded[16];
+    for (int i = 0; i < 16; i++)
+        values[i] = i % 3 ? 20 : 230;
+    encodeBC4Block(values, block);
+    decodeBC4Block(block, decoded);
+    for (int i = 0; i < 16; i++)
+        EXPECT_EQ(decoded[i], values[i]);
+}
+
+TEST(TextureCompressionTest, BC7SolidBlock) {
+    uint8_t rgba[64], block[16], decoded[64];
+    for (int i = 0; i < 16; i++) {
+        rgba[i * 4] = 200;
+        rgba[i * 4 + 1] = 100;
+        rgba[i * 4 + 2] = 31;
+        rgba[i * 4 + 3] = 255;
+    }
+    encodeBC7Block(rgba, block);
+    ASSERT_TRUE(decodeBC7Block(block, decoded));
+    for (int i = 0; i < 64; i++)
+        EXPECT_NEAR(decoded[i], rgba[i], 1);
+}
+
+TEST(TextureCompressionTest, BC7GradientBlock) {
+    uint8_t rgba[64], block[16], decoded[64];
+    for (int i = 0; i < 16; i++) {
+        // descending, texel 0 starts at the far endpoint and the encoder has
+        // to swap them for the 3 bit anchor index
+        rgba[i * 4] = static_cast<uint8_t>(240 - i * 15);
+        rgba[i * 4 + 1] = static_cast<uint8_t>(120 - i * 6);
+        rgba[i * 4 + 2] = static_cast<uint8_t>(i * 4);
+        rgba[i * 4 + 3] = 255;
+    }
+    encodeBC7Block(rgba, block);
+    EXPECT_EQ(block[0] & 0x7f, 0x40);
+    ASSERT_TRUE(decodeBC7Block(block, decoded));
+    for (int i = 0; i < 64; i++)
+        EXPECT_NEAR(decoded[i], rgba[i], 6);
+}
+
+TEST(TextureCompressionTest, CompressLevels) {
+    std::vector<uint8_t> pixels(6 * 5 * 4);
+    for (size_t i = 0; i < pixels.size(); i++)
+        pixels[i] = static_cast<uint8_t>(i % 4 == 1 ? 77 : 0);
+    MipChain mips = generateMipChain(pixels.data(), 6, 5, false);
+    CompressedTexture texture = CompressedTexture::compress(
+        pixels.data(), 6, 5, mips, BlockFormat::BC4, 1);
+    ASSERT_EQ(texture.getLevels().size(), 3u);
+    // 2x2 blocks, then one per level
+    EXPECT_EQ(texture.getLevelSize(0), 4 * 8u);
+    EXPECT_EQ(texture.getLevelSize(2), 8u);
+    uint8_t values[16];
+    decodeBC4Block(texture.getLevel(1), values);
+    for (uint8_t value : values)
+        EXPECT_EQ(value, 77);
+}
@@ -0,0 +1,63 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include "core/TextureLoader.hpp"
+
+static std::vector<uint8_t> solidImage(int width, int height, uint8_t r,
+                                       uint8_t g, uint8_t b, uint8_t a) {
+    std::vector<uint8_t> pixels;
+    for (int i = 0; i < width * height; i++)
+        pixels.insert(pixels.end(), {r, g, b, a});
+    return pixels;
+}
+
+TEST(TextureLoaderTest, MipChainSizes) {
+    EXPECT_EQ(countMipLevels(1, 1), 1);
+    EXPECT_EQ(countMipLevels(256, 256), 9);
+    EXPECT_EQ(countMipLevels(300, 20), 9);
+    auto pixels = solidImage(12, 5, 0, 0, 0, 255);
+    MipChain chain = generateMipChain(pixels.data(), 12, 5, false);
+    ASSERT_EQ(chain.levels.size(), 3u);
+    EXPECT_EQ(chain.levels[0].width, 6);
+    EXPECT_EQ(chain.levels[0].height, 2);
+    EXPECT_EQ(chain.levels[2].width, 1);
+    EXPECT_EQ(chain.levels[2].height, 1);
+    EXPECT_EQ(chain.pixels.size(), (6 * 2 + 3 * 1 + 1 * 1) * 4u);
+    // level 0 followed by the chain, as the scene cache stores it
+    EXPECT_EQ(mipChainBytes(12, 5, 4), 12 * 5 * 4 + chain.pixels.size());
+    EXPECT_EQ(mipChainBytes(12, 5, 1), 12 * 5 * 4u);
+    EXPECT_EQ(generateMipChain(pixels.data(), 12, 5, false, MipFilter::Box, 2)
+                  .levels.size(),
+              1u);
+}
+
+TEST(TextureLoaderTest, SolidColorIsPreserved) {
+    auto pixels = solidImage(16, 16, 200, 100, 30, 128);
+    for (auto filter : {MipFilter::Box, MipFilter::Kaiser}) {
+        for (bool srgb : {false, true}) {
+            MipChain chain =
+                generateMipChain(pixels.data(), 16, 16, srgb, filter);
+            for (size_t i = 0; i < chain.pixels.size(); i += 4) {
+                ASSERT_NEAR(chain.pixels[i], 200, 1);
+                ASSERT_NEAR(chain.pixels[i + 1], 100, 1);
+                ASSERT_NEAR(chain.pixels[i + 2], 30, 1);
+                ASSERT_NEAR(chain.pixels[i + 3], 128, 1);
+            }
+        }
+    }
+}
+
+TEST(TextureLoaderTest, SRGBAveragesInLinearSpace) {
+    // black and white columns
+    std::vector<uint8_t> pixels;
+    for (int i = 0; i < 2; i++)
+        pixels.insert(pixels.end(), {0, 0, 0, 0, 255, 255, 255, 255});
+    std::vector<uint8_t> linear(4), srgb(4);
+    downsampleRGBA8(pixels.data(), 2, 2, linear.data(), false,
+                    MipFilter::Box);
+    downsampleRGBA8(pixels.data(), 2, 2, srgb.data(), true, MipFilter::Box);
+    EXPECT_NEAR(linear[0], 128, 1);
+    // linear 0.5 is 188 in sRGB
+    EXPECT_NEAR(srgb[0], 188, 1);
+    // alpha is never sRGB
+    EXPECT_NEAR(srgb[3], 128, 1);
+}
@@ -0,0 +1,67 @@
+#include <gtest/gtest.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <memory>
+#include <vector>
+#include "core/TransformCache.hpp"
+
+static void expectNear(const glm::mat4& a, const glm::mat4& b,
+                       float epsilon = 1e-5f) {
+    for (int c = 0; c < 4; c++)
+        for (int r = 0; r < 4; r++)
+            EXPECT_NEAR(a[c][r], b[c][r], epsilon) << c << ", " << r;
+}
+
+static glm::mat4 testTransform() {
+    glm::mat4 m = glm::translate(glm::mat4(1.0f), glm::vec3(3, -2, 5));
+    m = glm::rotate(m, glm::radians(35.0f), glm::vec3(0.3f, 1.0f, -0.2f));
+    return glm::scale(m, glm::vec3(2.0f, 0.5f, 1.5f));
+}
+
+TEST(TransformCacheTest, MultiplyMatchesGlm) {
+    glm::mat4 a = testTransform(),
+              b = glm::rotate(glm::mat4(1.0f), glm::radians(-70.0f),
+                              glm::vec3(1, 0, 0));
+    glm::mat4 out;
+    multiplyTransforms(a, b, out);
+    expectNear(out, a * b);
+    // the result may overwrite an input
+    multiplyTransforms(a, b, b);
+    expectNear(b, out);
+}
+
+TEST(TransformCacheTest, NormalMatrixMatchesInverseTranspose) {
+    glm::mat4 world = testTransform();
+    glm::mat4 normal;
+    computeNormalMatrix(world, normal);
+    glm::mat4 expected = glm::transpose(glm::inverse(world));
+    for (int c = 0; c < 3; c++)
+        for (int r = 0; r < 3; r++)
+            EXPECT_NEAR(normal[c][r], expected[c][r], 1e-5f);
+    // directions only, no translation
+    EXPECT_EQ(normal[0][3], 0.0f);
+    EXPECT_EQ(normal[3][0], 0.0f);
+    EXPECT_EQ(normal[3][3], 1.0f);
+}
+
+TEST(TransformCacheTest, UpdatesChangedMeshesOnly) {
+    std::vector<std::shared_ptr<loo::Mesh>> meshes;
+    for (int i = 0; i < 3; i++)
+        meshes.push_back(std::make_shared<loo::Mesh>());
+    loo::Mesh& moved = *meshes[1];
+    loo::Scene scene;
+    scene.addMeshes(std::move(meshes));
+
+    TransformCache transforms;
+    transforms.update(scene);
+    EXPECT_EQ(transforms.getUpdated(), 3);
+    transforms.update(scene);
+    EXPECT_EQ(transforms.getUpdated(), 0);
+
+    moved.objectMatrix = testTransform();
+    transforms.update(scene);
+    EXPECT_EQ(transforms.getUpdated(), 1);
+    expectNear(transforms.getWorld(1),
+               scene.getModelMatrix() * testTransform());
+    transforms.update(scene);
+    EXPECT_EQ(transforms.getUpdated(), 0);
+}
@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+#include <glm/gtc/packing.hpp>
+#include "core/VertexFormat.hpp"
+
+static void expectNear(const glm::vec3& a, const glm::vec3& b, float error) {
+    EXPECT_NEAR(a.x, b.x, error);
+    EXPECT_NEAR(a.y, b.y, error);
+    EXPECT_NEAR(a.z, b.z, error);
+}
+
+TEST(VertexFormatTest, OctahedralRoundTrip) {
+    const glm::vec3 normals[] = {
+        {0, 0, 1},  {0, 0, -1},         {1, 0, 0},         {0, -1, 0},
+        {1, 1, 1},  {-1, 0.5f, -0.25f}, {0.3f, -1, -0.7f}, {-1, -1, -1}};
+    for (auto normal : normals) {
+        normal = glm::normalize(normal);
+        glm::vec2 encoded = encodeOctahedral(normal);
+        EXPECT_LE(std::abs(encoded.x), 1.f);
+        EXPECT_LE(std::abs(encoded.y), 1.f);
+        expectNear(decodeOctahedral(encoded), normal, 1e-5f);
+    }
+}
+
+TEST(VertexFormatTest, PackVertex) {
+    auto quantization =
+        getPositionQuantization(glm::vec3(-1, 0, 2), glm::vec3(3, 0, 4));
+    // flat axes keep a scale of 1
+    EXPECT_EQ(quantization.scale.y, 1.f);
+    glm::vec3 position(0.5f, 0.f, 3.f), normal(0, 0, 1), tangent(1, 0, 0);
+    PackedVertex packed = packVertex(position, normal, glm::vec2(0.25f, 7.5f),
+                                     tangent, glm::vec3(0, -1, 0),
+                                     quantization);
+    glm::vec3 decoded;
+    for (int i = 0; i < 3; i++)
+        decoded[i] = quantization.offset[i] +
+                     quantization.scale[i] * packed.position[i] / 65535.f;
+    expectNear(decoded, position, 1e-4f);
+    // cross(n, t) is +y, the bitangent -y
+    EXPECT_EQ(packed.position[3], 0);
+    glm::vec2 n(packed.normalTangent[0] / 32767.f,
+                packed.normalTangent[1] / 32767.f);
+    expectNear(decodeOctahedral(n), normal, 1e-4f);
+    EXPECT_EQ(glm::unpackHalf1x16(packed.texCoord[0]), 0.25f);
+    EXPECT_EQ(glm::unpackHalf1x16(packed.texCoord[1]), 7.5f);
+}
+
+TEST(VertexFormatTest, BoneInfluence) {
+    struct SourceVertex {
+        float position[3];
+        int boneIDs[4];
+    };
+    SourceVertexLayout layout{sizeof(SourceVertex), {}};
+    for (int& offset : layout.offsets)
+        offset = -1;
+    layout.offsets[VERTEX_POSITION] = offsetof(SourceVertex, position);
+    SourceVertex vertices[2] = {{{0, 0, 0}, {-1, -1, -1, -1}},
+                                {{1, 0, 0}, {-1, -1, -1, -1}}};
+    auto data = reinterpret_cast<const uint8_t*>(vertices);
+    // no bone attribute at all
+    EXPECT_FALSE(hasBoneInfluence(data, 2, layout));
+    layout.offsets[VERTEX_BONE_IDS] = offsetof(SourceVertex, boneIDs);
+    EXPECT_FALSE(hasBoneInfluence(data, 2, layout));
+    vertices[1].boneIDs[2] = 0;
+    EXPECT_TRUE(hasBoneInfluence(data, 2, layout));
+    EXPECT_FALSE(hasBoneInfluence(data, 1, layout));
+}
+
+TEST(VertexFormatTest, PackSkin) {
+    PackedSkin skin =
+        packSkin(glm::ivec4(3, 7, -1, -1), glm::vec4(0.333f, 0.667f, 0, 0));
+    EXPECT_EQ(skin.boneIDs[0], 3);
+    EXPECT_EQ(skin.boneIDs[1], 7);
+    EXPECT_EQ(skin.boneIDs[2], PACKED_NO_BONE);
+    EXPECT_EQ(skin.weights[0] + skin.weights[1], 255);
+    EXPECT_NEAR(skin.weights[0], 85, 1);
+    EXPECT_EQ(skin.weights[2], 0);
+    // no influence at all
+    PackedSkin none = packSkin(glm::ivec4(-1), glm::vec4(0.f));
+    for (int i = 0; i < 4; i++) {
+        EXPECT_EQ(none.boneIDs[i], PACKED_NO_BONE);
+        EXPECT_EQ(none.weights[i], 0);
+    }
+}
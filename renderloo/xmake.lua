@@ -48,3 +48,4 @@ target("renderloo")
     add_files("src/main.cpp")
 
 includes("test")
+includes("bench")